@@ -4,11 +4,14 @@
  * Demonstrates automated ATEM control with timed input switching
  * 
  * This example shows how to:
- * - Create automated switching sequences
- * - Use timers for scheduled operations
+ * - Describe a switching sequence as a constant step array
+ * - Run it on the switcher's frame grid with runSequence()
  * - Monitor ATEM state changes
  * - Implement basic show automation
  * 
+ * The library times the steps itself, in frames of the switcher's video mode,
+ * so there is no millis() bookkeeping in the sketch.
+ * 
  * Hardware: ESP32 + ATEM Mini/Pro
  * Author: Mirza Ceyzar
  */
@@ -21,20 +24,21 @@ const char* ssid = "Your_WiFi_SSID";
 const char* password = "Your_WiFi_Password";
 const char* atem_ip = "192.168.1.100";
 
-// Timing configuration
-const unsigned long SWITCH_INTERVAL = 10000;  // Switch every 10 seconds
-const unsigned long CUT_DELAY = 2000;         // Cut 2 seconds after preview change
+// Timing configuration, in frames (50 per second in 1080p50)
+#define FRAMES_PER_SECOND 50
+#define CUT_DELAY         (2 * FRAMES_PER_SECOND)   // Cut 2 seconds after the preview change
+#define HOLD_TIME         (8 * FRAMES_PER_SECOND)   // Stay on air 8 more seconds
 
-// Switching sequence
-const uint16_t SEQUENCE[] = {
-  ATEM_INPUT_CAM1,
-  ATEM_INPUT_CAM2,
-  ATEM_INPUT_CAM3,
-  ATEM_INPUT_CAM4,
-  ATEM_INPUT_BARS,
-  ATEM_INPUT_COLOR1
+// Switching sequence: preview, wait, cut, wait - for every input, then again
+static const ATEMSequenceStep SHOW[] = {
+  atemSeqPreview(ATEM_INPUT_CAM1),   atemSeqWaitFrames(CUT_DELAY), atemSeqCut(), atemSeqWaitFrames(HOLD_TIME),
+  atemSeqPreview(ATEM_INPUT_CAM2),   atemSeqWaitFrames(CUT_DELAY), atemSeqCut(), atemSeqWaitFrames(HOLD_TIME),
+  atemSeqPreview(ATEM_INPUT_CAM3),   atemSeqWaitFrames(CUT_DELAY), atemSeqCut(), atemSeqWaitFrames(HOLD_TIME),
+  atemSeqPreview(ATEM_INPUT_CAM4),   atemSeqWaitFrames(CUT_DELAY), atemSeqCut(), atemSeqWaitFrames(HOLD_TIME),
+  atemSeqPreview(ATEM_INPUT_BARS),   atemSeqWaitFrames(CUT_DELAY), atemSeqCut(), atemSeqWaitFrames(HOLD_TIME),
+  atemSeqPreview(ATEM_INPUT_COLOR1), atemSeqWaitFrames(CUT_DELAY), atemSeqCut(), atemSeqWaitFrames(HOLD_TIME),
+  atemSeqGoto(0)
 };
-const int SEQUENCE_LENGTH = sizeof(SEQUENCE) / sizeof(SEQUENCE[0]);
 
 class AutomatedATEM : public ATEM {
 public:
@@ -47,17 +51,13 @@ public:
         Serial.println("CONNECTED - Starting automation");
         startAutomation();
         break;
-      case ATEM_ERROR: Serial.println("ERROR"); break;
+      case ATEM_ERROR: Serial.println("ERROR"); break;  // The sequence stops with the connection
     }
   }
   
   void onPreviewInputChanged(uint16_t input) override {
     Serial.print("[ATEM] Preview changed to: ");
     Serial.println(getInputName(input));
-    
-    // Schedule automatic cut
-    cutScheduled = true;
-    cutTime = millis() + CUT_DELAY;
   }
   
   void onProgramInputChanged(uint16_t input) override {
@@ -65,49 +65,18 @@ public:
     Serial.println(getInputName(input));
   }
   
-  void runAutomation() {
-    if (getConnectionState() != ATEM_CONNECTED) return;
-    
-    unsigned long now = millis();
-    
-    // Handle scheduled cuts
-    if (cutScheduled && now >= cutTime) {
-      Serial.println("[AUTO] Performing scheduled CUT");
-      cut();
-      cutScheduled = false;
-    }
-    
-    // Handle timed preview switching
-    if (now - lastSwitch >= SWITCH_INTERVAL) {
-      switchToNextInput();
-      lastSwitch = now;
-    }
-  }
-  
-private:
-  int currentSequenceIndex = 0;
-  unsigned long lastSwitch = 0;
-  bool cutScheduled = false;
-  unsigned long cutTime = 0;
-  
   void startAutomation() {
-    Serial.println("[AUTO] Automation started");
-    lastSwitch = millis();
-    currentSequenceIndex = 0;
+    if (runSequence(SHOW)) {
+      Serial.println("[AUTO] Automation started");
+    }
   }
   
-  void switchToNextInput() {
-    uint16_t nextInput = SEQUENCE[currentSequenceIndex];
-    
-    Serial.print("[AUTO] Switching preview to: ");
-    Serial.println(getInputName(nextInput));
-    
-    changePreviewInput(nextInput);
-    
-    // Move to next input in sequence
-    currentSequenceIndex = (currentSequenceIndex + 1) % SEQUENCE_LENGTH;
+  void stopAutomation() {
+    stopSequence();
+    Serial.println("[AUTO] Automation stopped");
   }
   
+private:
   String getInputName(uint16_t input) {
     switch (input) {
       case ATEM_INPUT_BLACK: return "BLACK";
@@ -154,22 +123,21 @@ void setup() {
   
   Serial.println("=================================");
   Serial.println("Automation Configuration:");
-  Serial.print("Switch interval: ");
-  Serial.print(SWITCH_INTERVAL / 1000);
-  Serial.println(" seconds");
+  Serial.print("Sequence steps: ");
+  Serial.println(sizeof(SHOW) / sizeof(SHOW[0]));
   Serial.print("Cut delay: ");
-  Serial.print(CUT_DELAY / 1000);
-  Serial.println(" seconds");
+  Serial.print(CUT_DELAY);
+  Serial.println(" frames");
+  Serial.print("Hold time: ");
+  Serial.print(HOLD_TIME);
+  Serial.println(" frames");
   Serial.println("=================================");
 }
 
 void loop() {
-  // Process ATEM communication
+  // Process ATEM communication (the sequence runs in here)
   myAtem.loop();
   
-  // Run automation logic
-  myAtem.runAutomation();
-  
   // Handle manual commands
   processSerialCommands();
   
@@ -185,11 +153,15 @@ void processSerialCommands() {
       printStatus();
     }
     else if (command.equalsIgnoreCase("stop")) {
-      Serial.println("[CMD] Automation would stop here (not implemented)");
+      myAtem.stopAutomation();
+    }
+    else if (command.equalsIgnoreCase("start")) {
+      myAtem.startAutomation();
     }
     else if (command.equalsIgnoreCase("help")) {
       Serial.println("Available commands:");
       Serial.println("  status - Show current status");
+      Serial.println("  start  - Restart automation");
       Serial.println("  stop   - Stop automation");
       Serial.println("  help   - Show this help");
     }
@@ -210,6 +182,13 @@ void printStatus() {
     Serial.println(state.program_input);
     Serial.print("Preview Input: ");
     Serial.println(state.preview_input);
+    Serial.print("Sequence: ");
+    if (myAtem.isSequenceRunning()) {
+      Serial.print("step ");
+      Serial.println(myAtem.getSequenceStep());
+    } else {
+      Serial.println("stopped");
+    }
   } else {
     Serial.println("DISCONNECTED");
   }
@@ -0,0 +1,106 @@
+/*
+ * EthernetTally.ino
+ * 
+ * Camera tally light on a wired Ethernet ESP32 (LAN8720, e.g. WT32-ETH01 or Olimex ESP32-POE)
+ * 
+ * This example shows how to:
+ * - Bring up the ETH interface instead of WiFi
+ * - Run the ATEM protocol on a raw lwIP socket (ATEMLwipTransport)
+ * - Drive tally LEDs from the switcher's own tally (on air through keyers,
+ *   SuperSource or another M/E counts too), woken only when this input flips
+ * 
+ * The default transport (WiFiUDP) also works over ETH; the lwIP transport skips
+ * the socket layer and its per-packet buffer copies. For a W5500 on the Arduino
+ * Ethernet library use ATEMUdpTransport<EthernetUDP> instead.
+ * 
+ * Hardware: ESP32 (classic, built-in EMAC) with LAN8720 PHY + ATEM switcher
+ * Author: Mirza Ceyzar
+ */
+
+#include <WiFi.h>
+#include <ETH.h>
+#include <ATEM.h>
+#include <ATEM_LwipTransport.h>
+
+// Network configuration
+const char* atem_ip = "192.168.1.100";
+
+// Tally configuration
+const uint16_t TALLY_INPUT = ATEM_INPUT_CAM1;
+const int PROGRAM_LED_PIN = 2;   // Red: on air
+const int PREVIEW_LED_PIN = 4;   // Green: on preview
+
+static bool eth_connected = false;
+
+void onNetworkEvent(arduino_event_id_t event) {
+  switch (event) {
+    case ARDUINO_EVENT_ETH_GOT_IP:
+      Serial.print("[ETH] IP: ");
+      Serial.println(ETH.localIP());
+      eth_connected = true;
+      break;
+    case ARDUINO_EVENT_ETH_DISCONNECTED:
+    case ARDUINO_EVENT_ETH_STOP:
+      Serial.println("[ETH] Link down");
+      eth_connected = false;
+      break;
+    default:
+      break;
+  }
+}
+
+class TallyATEM : public ATEM {
+public:
+  void onConnectionStateChanged(ATEMConnectionState state) override {
+    Serial.print("[ATEM] Connection: ");
+    switch (state) {
+      case ATEM_DISCONNECTED: Serial.println("DISCONNECTED"); break;
+      case ATEM_CONNECTING: Serial.println("CONNECTING"); break;
+      case ATEM_CONNECTED: Serial.println("CONNECTED"); break;
+      case ATEM_ERROR: Serial.println("ERROR"); break;
+    }
+  }
+  
+  void onTallyChanged(const ATEMTallyDiff& diff) override {
+    if (!diff.changed(TALLY_INPUT)) {
+      return;  // Another camera's tally
+    }
+    digitalWrite(PROGRAM_LED_PIN, diff.tally.isProgram(TALLY_INPUT) ? HIGH : LOW);
+    digitalWrite(PREVIEW_LED_PIN, diff.tally.isPreview(TALLY_INPUT) ? HIGH : LOW);
+  }
+  
+  // Quieter log: this node only cares about tally
+  void onProgramInputChanged(uint16_t input) override {}
+  void onPreviewInputChanged(uint16_t input) override {}
+};
+
+TallyATEM myAtem;
+ATEMLwipTransport transport;
+
+void setup() {
+  Serial.begin(115200);
+  pinMode(PROGRAM_LED_PIN, OUTPUT);
+  pinMode(PREVIEW_LED_PIN, OUTPUT);
+  
+  Serial.println();
+  Serial.println("=================================");
+  Serial.println("ATEM ESP32 Ethernet Tally");
+  Serial.println("=================================");
+  
+  // Connect to Ethernet (PHY settings come from the board definition)
+  WiFi.onEvent(onNetworkEvent);
+  ETH.begin();
+  while (!eth_connected) {
+    delay(100);
+  }
+  
+  // Use the raw lwIP transport, then connect without blocking
+  myAtem.setTransport(&transport);
+  IPAddress switcher;
+  switcher.fromString(atem_ip);
+  myAtem.beginAsync(switcher);
+}
+
+void loop() {
+  myAtem.runLoop();
+}
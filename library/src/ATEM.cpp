@@ -14,6 +14,12 @@
 
 #include "ATEM.h"
 
+#if ATEM_STATIC_MEMORY
+// Fixed-memory build: a String (or an IPAddress/number turned into one) in the
+// protocol engine is a compile error rather than a heap allocation per call
+#pragma GCC poison String toString
+#endif
+
 /**
  * @brief Constructor - Initialize ATEM object with default values
  * Sets up connection state, initial session ID, initializes counters and state
@@ -24,28 +30,69 @@ ATEM::ATEM() {
   _connection_state        = ATEM_DISCONNECTED;
   _session_id              = 0x53AB;  // Initial session ID for HELLO - ATEM will assign the real one
   _local_packet_id         = 768;     // Start with 768 to match HELLO packet ID that ATEM expects
-  _remote_packet_id        = 0;
-  _last_heartbeat          = 0;
+  _command_packet_id       = 0;
+  _heartbeat_phase         = 0;
+  _heartbeat_aligned       = false;
   _last_received           = 0;
   _connection_start_time   = 0;
-  _state_dirty             = false;
+  memset(&_state_changes, 0, sizeof(_state_changes));
+  memset(&_published_changes, 0, sizeof(_published_changes));
+  _reported_generation     = 0;
+  _subscriptions           = ATEM_SUBSCRIPTIONS;
+  memset(&_delivered_changes, 0, sizeof(_delivered_changes));
+  _delivered_flags         = 0;
+  _capabilities            = nullptr;
+  _product_name[0]         = '\0';
+  _protocol_major          = 0;
+  _protocol_minor          = 0;
   _log_level               = (ATEMLogLevel)ATEM_DEFAULT_LOG_LEVEL;  // Initialize with default log level
+  _transport               = &_default_transport;
+  _capture                 = nullptr;
   _udp_initialized         = false;   // Initialize UDP status flag
+  _rx_batch_max            = ATEM_RX_BATCH_MAX;
+  _rx_batch_budget_us      = ATEM_RX_BATCH_BUDGET_US;
+  _network_diagnostics     = false;   // TCP probe / UDP test packet are opt-in
+  _last_hello              = 0;
+  _hello_attempts          = 0;
+  _hello_retry_interval    = ATEM_HELLO_RETRY_INTERVAL;
+  _auto_reconnect          = ATEM_AUTO_RECONNECT;
+  _command_handler_count   = 0;
+  _reconnect_attempts      = 0;
+  _tx_length               = 0;
+  _tx_count                = 0;
+  _batching                = false;
+  _coalescing              = false;
+  _transitions_started     = 0;
+  _command_staged          = false;
+  _paced_staged            = false;
+  _optimistic              = false;
+  _rollbacks               = 0;
+  
+  // Network task is off until enableNetworkTask() is called
+  _task_mode               = false;
+  _task_running            = false;
+  _task_active             = false;
+  _task_core               = 1;
+  _task_priority           = ATEM_TASK_PRIORITY;
+  _task_stack_size         = ATEM_TASK_STACK_SIZE;
+  _events_dropped          = 0;
+#if ATEM_HAS_NETWORK_TASK
+  _task_handle             = nullptr;
+#endif
+#if ATEM_METRICS
+  _metrics_reset_requested = false;
+  resetMetrics();                     // After _task_active: applied directly
+  _last_service_us         = 0;
+#endif
   
   // Initialize packet retransmission storage
-  _packet_buffer_index = 0;
-  for (int i = 0; i < MAX_RETRANSMIT_PACKETS; i++) {
-    _sent_packets[i].in_use     = false;
-    _sent_packets[i].packet_id  = 0;
-    _sent_packets[i].length     = 0;
-    _sent_packets[i].timestamp  = 0;
-  }
+  _sent_packets.clear();
   
-  // Initialize state
-  _state.program_input        = 0;
-  _state.preview_input        = 0;
-  _state.in_transition        = false;
-  _state.transition_position  = 0;
+  // Initialize state - stale until the first state dump arrives. Section
+  // counts use the ATEM_MAX_* limits until the model is known.
+  atemStateReset(_state);
+  _tally.clear();
+  _tally_reported.clear();
   
   // Version info will be printed in begin() after Serial is ready
 }
@@ -59,109 +106,369 @@ ATEM::~ATEM() {
 }
 
 /**
- * @brief Initialize ATEM connection to specified IP address
+ * @brief Initialize ATEM connection to specified IP address (blocking)
  * @param ip IPAddress of the ATEM switcher to connect to
  * @return true if initialization and connection successful, false otherwise
  * 
- * This function:
- * 1. Prints version information to Serial
- * 2. Sets up UDP socket on LOCAL_PORT
- * 3. Tests basic network connectivity to ATEM
- * 4. Attempts connection handshake
+ * Initialization process:
+ * 1. Print version information to Serial for debugging
+ * 2. Set up UDP socket on LOCAL_PORT with error checking
+ * 3. Optionally run network diagnostics (see setNetworkDiagnostics())
+ * 4. Perform the ATEM protocol handshake, waiting up to CONNECTION_TIMEOUT ms
+ * 
+ * Use beginAsync() instead to start the handshake without blocking.
  */
+bool ATEM::begin(IPAddress ip) {
+  if (!setupConnection(ip)) {
+    return false;
+  }
+  
+#if ATEM_HAS_NETWORK_TASK
+  if (_task_mode) {
+    return startNetworkTask();
+  }
+#endif
+  
+  return connect();
+}
 
 /**
- * @brief Initialize ATEM connection to specified IP address with network diagnostics
+ * @brief Initialize ATEM connection without blocking
  * @param ip IPAddress of the ATEM switcher to connect to
- * @return true if initialization and connection successful, false otherwise
+ * @return true if the UDP socket is ready and the handshake was started
  * 
- * Enhanced initialization process includes:
- * 1. Print version information to Serial for debugging
- * 2. Set up UDP socket on LOCAL_PORT with error checking
- * 3. Perform comprehensive network connectivity tests:
- *    - TCP connectivity test to verify basic network reachability
- *    - UDP socket binding verification with port confirmation
- *    - UDP send capability test with response validation
- * 4. Attempt ATEM protocol handshake with enhanced error reporting
- * 
- * Network diagnostic features help identify:
- * - Network routing/firewall issues (TCP test)
- * - UDP socket problems (binding test)
- * - Basic UDP functionality (send test)
- * - ATEM protocol-specific issues (handshake analysis)
+ * Sends the first HELLO and returns immediately. runLoop() then drives the
+ * handshake: HELLO is resent with exponential backoff (ATEM_HELLO_RETRY_INTERVAL
+ * doubling up to ATEM_HELLO_RETRY_MAX_INTERVAL) until the switcher answers or
+ * CONNECTION_TIMEOUT expires. Progress is reported via onConnectionStateChanged()
+ * (CONNECTING, then CONNECTED or ERROR).
  */
-bool ATEM::begin(IPAddress ip) {
+bool ATEM::beginAsync(IPAddress ip) {
+  if (!setupConnection(ip)) {
+    return false;
+  }
+  
+#if ATEM_HAS_NETWORK_TASK
+  if (_task_mode) {
+    return startNetworkTask();
+  }
+#endif
+  
+  startHandshake();
+  return true;
+}
+
+/**
+ * @brief Replace the datagram transport
+ * @param transport Transport to use, nullptr to go back to WiFiUDP
+ * Ignored while the socket is open; call before begin()/beginAsync()
+ */
+void ATEM::setTransport(ATEMTransport* transport) {
+  if (_udp_initialized) {
+    ATEM_LOG(ATEM_LOG_WARN, "setTransport() ignored: call it before begin()");
+    return;
+  }
+  _transport = transport ? transport : &_default_transport;
+}
+
+/**
+ * @brief Select the command families decoded into the state store
+ * @param families ATEM_SUBSCRIBE_* bits; masked with the compiled-in ATEM_SUBSCRIPTIONS
+ * Ignored while the socket is open: a family switched on mid-session would
+ * only see updates, never its part of the state dump
+ */
+void ATEM::setSubscriptions(uint16_t families) {
+  if (_udp_initialized) {
+    ATEM_LOG(ATEM_LOG_WARN, "setSubscriptions() ignored: call it before begin()");
+    return;
+  }
+  _subscriptions = families & ATEM_SUBSCRIPTIONS;
+}
+
+/**
+ * @brief Set the rate of the paced channel for continuous controls
+ * @param frames_per_second Frame rate of the tick grid (0 turns pacing off)
+ * @param frames Frames between ticks
+ * Ignored while the socket is open: in task mode the pacer runs in the task
+ */
+void ATEM::setPacing(float frames_per_second, uint8_t frames) {
+  if (_udp_initialized) {
+    ATEM_LOG(ATEM_LOG_WARN, "setPacing() ignored: call it before begin()");
+    return;
+  }
+  _pacer.setRate(frames_per_second, frames);
+}
+
+/**
+ * @brief Turn optimistic program/preview updates on or off
+ * @param enable true to speculate on our own switching commands
+ * Turning it off keeps open speculations until they are confirmed or expire
+ */
+void ATEM::setOptimisticUpdates(bool enable) {
+  if (enable && _task_mode) {
+    ATEM_LOG(ATEM_LOG_WARN, "setOptimisticUpdates() ignored in task mode");
+    return;
+  }
+  _optimistic = enable;
+}
+
+/**
+ * @brief Shared setup for begin() and beginAsync()
+ * @param ip IPAddress of the ATEM switcher
+ * @return true if the UDP socket was opened
+ */
+bool ATEM::setupConnection(IPAddress ip) {
   _switcher_ip = ip;
+  _timers.cancel(ATEM_TIMER_RECONNECT);
+  _reconnect_attempts = 0;
   
   // Print version info now that Serial is ready
-  printVersionInfo();
+  if (logEnabled(ATEM_LOG_INFO)) {
+    printVersionInfo();
+  }
   
-  debugPrint("Initializing ATEM connection...");
+  ATEM_LOG(ATEM_LOG_DEBUG, "Initializing ATEM connection...");
   
   // Initialize UDP
-  if (!_udp.begin(LOCAL_PORT)) {
-    debugPrint("Failed to initialize UDP");
+  if (!_transport->begin(LOCAL_PORT)) {
+    ATEM_LOG(ATEM_LOG_ERROR, "Failed to initialize UDP");
     _udp_initialized = false;
     return false;
   }
   
   _udp_initialized = true;  // Mark UDP as successfully initialized
-  debugPrint("UDP initialized successfully");
+  ATEM_LOG(ATEM_LOG_DEBUG, "UDP initialized successfully");
+  ATEM_LOG(ATEM_LOG_INFO, "UDP socket bound to local port %d, switcher at %d.%d.%d.%d:%d",
+           LOCAL_PORT, ATEM_IP_ARGS(_switcher_ip), ATEM_PORT);
   
-  // Test basic network connectivity to ATEM
-  debugPrint("Testing network connectivity to ATEM...");
-  
-  // Test basic ping connectivity
-  logPrintf(ATEM_LOG_INFO, "Testing ping to ATEM at %s", _switcher_ip.toString().c_str());
+  if (_network_diagnostics) {
+    runNetworkDiagnostics();
+  }
+  return true;
+}
+
+/**
+ * @brief Opt-in network diagnostics (see setNetworkDiagnostics())
+ * 
+ * - TCP connect to ATEM:9910 to check basic reachability. This blocks for the
+ *   TCP connect timeout and usually fails, because the ATEM only speaks UDP.
+ * - Minimal 4-byte UDP send to confirm the socket can transmit.
+ */
+void ATEM::runNetworkDiagnostics() {
+  ATEM_LOG(ATEM_LOG_INFO, "Running network diagnostics against %d.%d.%d.%d", ATEM_IP_ARGS(_switcher_ip));
   
   // Test if we can reach the ATEM at all
   WiFiClient testClient;
   if (testClient.connect(_switcher_ip, ATEM_PORT)) {
-    debugPrint("TCP connection to ATEM:9910 successful");
+    ATEM_LOG(ATEM_LOG_INFO, "TCP connection to ATEM:9910 successful");
     testClient.stop();
   } else {
-    debugPrint("WARNING: Cannot TCP connect to ATEM:9910");
-    debugPrint("This might be normal - ATEM may only accept UDP");
+    ATEM_LOG(ATEM_LOG_INFO, "Cannot TCP connect to ATEM:9910 (normal - ATEM only accepts UDP)");
   }
   
-  // Test UDP socket binding
-  logPrintf(ATEM_LOG_INFO, "UDP socket bound to local port: %d", LOCAL_PORT);
-  logPrintf(ATEM_LOG_INFO, "Will send to ATEM IP: %s port: %d", 
-           _switcher_ip.toString().c_str(), ATEM_PORT);
-  
   // Test basic UDP send (ping-like test)
-  debugPrint("Testing UDP send capability...");
-  _udp.beginPacket(_switcher_ip, ATEM_PORT);
   uint8_t test_packet[] = {0x00, 0x04, 0x00, 0x00}; // Minimal 4-byte test
-  int sent = _udp.write(test_packet, 4);
-  bool send_result = _udp.endPacket();
-  logPrintf(ATEM_LOG_DEBUG, "Test UDP send result: wrote %d bytes, endPacket: %s", 
-           sent, send_result ? "SUCCESS" : "FAILED");
-  
-  return connect();
+  bool send_result = _transport->send(_switcher_ip, ATEM_PORT, test_packet, 4);
+  ATEM_LOG(ATEM_LOG_INFO, "Test UDP send result: %s", send_result ? "SUCCESS" : "FAILED");
 }
 
 /**
- * @brief Establish connection handshake with ATEM switcher
+ * @brief Establish connection handshake with ATEM switcher (blocking)
  * @return true if handshake successful, false if timeout or error
  * 
- * Sends HELLO packet with 20-byte format:
- * - Bytes 0-3: Flags and length (0x10, 0x14, 0x00, 0x00)
- * - Bytes 4-5: Session ID
- * - Bytes 6-11: Packet IDs and padding
+ * Starts the same handshake state machine beginAsync() uses and services it
+ * until it leaves ATEM_CONNECTING, i.e. for at most CONNECTION_TIMEOUT ms.
+ */
+bool ATEM::connect() {
+  startHandshake();
+  
+  while (_connection_state == ATEM_CONNECTING) {
+    serviceConnection();
+    if (_connection_state == ATEM_CONNECTING) {
+      delay(10);
+    }
+  }
+  
+  return _connection_state == ATEM_CONNECTED;
+}
+
+/**
+ * @brief Reset session tracking and send the first HELLO
+ * Reports ATEM_CONNECTING and arms the HELLO resend and handshake timeout
+ * timers; handleTimer() takes over from here
+ */
+void ATEM::startHandshake() {
+  ATEM_LOG(ATEM_LOG_DEBUG, "Attempting to connect to ATEM...");
+  
+  _session_id            = 0x53AB;  // Initial session ID for HELLO - ATEM will assign the real one
+  _rx_window.reset(0);
+  _last_received         = 0;
+  _connection_state      = ATEM_CONNECTING;
+  _connection_start_time = millis();
+  _hello_attempts        = 0;
+  _hello_retry_interval  = ATEM_HELLO_RETRY_INTERVAL;
+  
+  // Packets of a previous session are meaningless to the new one
+  _sent_packets.clear();
+  _pacer.clear();
+  _speculations.clear();
+  _tx_length = 0;
+  _tx_count  = 0;
+  ATEM_METRIC(_commands_awaiting = 0; _ack_sample_pending = false);
+  
+  notify(ATEM_EVENT_CONNECTION_STATE, 0, _connection_state);
+  
+  // Timers of a previous session are meaningless too
+  _timers.clear();
+  _timers.arm(ATEM_TIMER_HANDSHAKE_TIMEOUT, _connection_start_time + CONNECTION_TIMEOUT);
+  sendHello();
+  _timers.arm(ATEM_TIMER_HELLO_RESEND, _last_hello + _hello_retry_interval);
+}
+
+/**
+ * @brief Enter ATEM_ERROR after losing (or failing to establish) the connection
+ * Keeps the cached state but marks it stale, reports the error and, if auto
+ * reconnect is enabled, schedules the next handshake attempt
+ */
+void ATEM::connectionLost() {
+  _connection_state = ATEM_ERROR;
+  _timers.clear();
+  rollbackSpeculations();
+  if (_sequencer.running()) {
+    ATEM_LOG(ATEM_LOG_WARN, "Sequence stopped at step %d", _sequencer.step());
+    _sequencer.stop();
+  }
+  if (!_state.stale) {
+    _state_lock.beginWrite();
+    _state.stale = true;
+    _state_lock.endWrite();
+    markStateChanged(ATEM_STATE_CHANGED_STALE);
+  }
+  notify(ATEM_EVENT_CONNECTION_STATE, 0, _connection_state);
+  
+  if (_auto_reconnect && _udp_initialized) {
+    scheduleReconnect();
+  }
+}
+
+/**
+ * @brief Schedule the next reconnect attempt
  * 
- * Waits up to CONNECTION_TIMEOUT ms for response with 0x02 flag
+ * Jittered exponential backoff: the nominal delay is CONNECTION_RETRY_INTERVAL
+ * doubled per failed attempt (capped at ATEM_RECONNECT_MAX_INTERVAL), and the
+ * actual delay is picked at random from its upper half. The first retry after a
+ * dropped link therefore comes within 0.5-1 s, which covers short WiFi roams.
  */
+void ATEM::scheduleReconnect() {
+  unsigned long delay_ms = CONNECTION_RETRY_INTERVAL;
+  for (uint8_t i = 0; i < _reconnect_attempts && delay_ms < ATEM_RECONNECT_MAX_INTERVAL; i++) {
+    delay_ms *= 2;
+  }
+  if (delay_ms > ATEM_RECONNECT_MAX_INTERVAL) {
+    delay_ms = ATEM_RECONNECT_MAX_INTERVAL;
+  }
+  delay_ms = delay_ms / 2 + random(delay_ms / 2 + 1);
+  
+  if (_reconnect_attempts < 0xFF) {
+    _reconnect_attempts++;
+  }
+  _timers.arm(ATEM_TIMER_RECONNECT, millis() + delay_ms);
+  
+  ATEM_LOG(ATEM_LOG_INFO, "Reconnecting in %lums (attempt %d)", delay_ms, _reconnect_attempts);
+}
+
 /**
- * @brief Establish connection handshake with ATEM switcher (Enhanced Debugging Version)
- * @return true if handshake successful, false if timeout or error
+ * @brief Run the action of an expired protocol timer (called from serviceConnection())
+ * @param timer Timer that expired (already disarmed)
+ * @param now Current millis()
  * 
- * Enhanced HELLO packet transmission with comprehensive error checking:
- * - Validates UDP socket initialization before sending
- * - Sends 20-byte HELLO packet with corrected format matching working implementations
- * - Monitors packet transmission success (bytes written, endPacket result)
- * - Provides periodic status updates during connection wait period
- * - Logs all received packets with detailed analysis during handshake
+ * Each action checks the connection state it belongs to, so a timer that
+ * outlived its state is simply dropped. The switching to ATEM_CONNECTED happens
+ * in parsePacket() when the NewSessionId response arrives.
+ */
+void ATEM::handleTimer(ATEMTimerId timer, unsigned long now) {
+  switch (timer) {
+    case ATEM_TIMER_HELLO_RESEND:
+      // Resend HELLO with exponential backoff
+      if (_connection_state != ATEM_CONNECTING) break;
+      ATEM_LOG(ATEM_LOG_INFO, "No HELLO response after %lums - resending (attempt %d)",
+               now - _last_hello, _hello_attempts + 1);
+      sendHello();
+      
+      _hello_retry_interval *= 2;
+      if (_hello_retry_interval > ATEM_HELLO_RETRY_MAX_INTERVAL) {
+        _hello_retry_interval = ATEM_HELLO_RETRY_MAX_INTERVAL;
+      }
+      _timers.arm(ATEM_TIMER_HELLO_RESEND, _last_hello + _hello_retry_interval);
+      break;
+      
+    case ATEM_TIMER_HANDSHAKE_TIMEOUT:
+      if (_connection_state != ATEM_CONNECTING) break;
+      ATEM_LOG(ATEM_LOG_ERROR, "=== CONNECTION TIMEOUT ANALYSIS ===");
+      ATEM_LOG(ATEM_LOG_ERROR, "No HELLO response within %d ms (%d HELLO packet(s) sent)",
+               CONNECTION_TIMEOUT, _hello_attempts);
+      ATEM_LOG(ATEM_LOG_ERROR, "Sent HELLO to: %d.%d.%d.%d:%d, listening on local port: %d",
+               ATEM_IP_ARGS(_switcher_ip), ATEM_PORT, LOCAL_PORT);
+      ATEM_LOG(ATEM_LOG_ERROR, "Possible issues:");
+      ATEM_LOG(ATEM_LOG_ERROR, "1. ATEM device is not responding");
+      ATEM_LOG(ATEM_LOG_ERROR, "2. Network routing/firewall issues");
+      ATEM_LOG(ATEM_LOG_ERROR, "3. ATEM is on different network segment");
+      ATEM_LOG(ATEM_LOG_ERROR, "4. ATEM port 9910 is not accessible");
+      ATEM_LOG(ATEM_LOG_ERROR, "========================================");
+      connectionLost();
+      break;
+      
+    case ATEM_TIMER_HEARTBEAT:
+      // Heartbeat every 500ms when connected (matching Sofie library exactly)
+      if (_connection_state != ATEM_CONNECTED) break;
+      sendHeartbeat();
+      _timers.arm(ATEM_TIMER_HEARTBEAT, alignHeartbeat(now) + HEARTBEAT_INTERVAL);
+      break;
+      
+    case ATEM_TIMER_RECEIVE_TIMEOUT:
+      // Re-armed by every received packet, so this means CONNECTION_TIMEOUT of silence
+      if (_connection_state != ATEM_CONNECTED) break;
+      ATEM_LOG(ATEM_LOG_ERROR, "[T+%lums] CONNECTION TIMEOUT DETECTED! Last packet received at T+%lums, timeout threshold: %dms, gap: %lums",
+               now, _last_received, CONNECTION_TIMEOUT, now - _last_received);
+      
+      ATEM_LOG(ATEM_LOG_DEBUG, "Connection timeout - no packets received");
+      connectionLost();
+      break;
+      
+    case ATEM_TIMER_RECONNECT:
+      // Start the next handshake once the reconnect backoff has elapsed
+      if (_connection_state != ATEM_ERROR) break;
+      ATEM_LOG(ATEM_LOG_INFO, "Attempting reconnect to ATEM (attempt %d)", _reconnect_attempts);
+      startHandshake();
+      break;
+      
+    case ATEM_TIMER_PACING:
+      servicePacedCommands();
+      break;
+      
+    case ATEM_TIMER_OPTIMISTIC:
+      // Not confirmed in time: the switcher did not take the command
+      for (ATEMSpeculations::Entry* entry = _speculations.expired(now); entry; entry = _speculations.expired(now)) {
+        ATEM_LOG(ATEM_LOG_WARN, "%s input %d (M/E %d) not confirmed - rolling back to %d",
+                 entry->field == ATEM_SPECULATED_PROGRAM ? "Program" : "Preview",
+                 entry->value, entry->me + 1, entry->confirmed);
+        rollbackSpeculation(*entry);
+      }
+      armSpeculationTimer();
+      break;
+      
+    case ATEM_TIMER_SEQUENCE:
+      serviceSequence();
+      break;
+      
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Send the HELLO (connection request) packet
+ * @return true if the UDP write succeeded
  * 
  * HELLO packet structure (20 bytes):
  * - Byte 0: 0x10 (Hello flag)
@@ -172,17 +479,10 @@ bool ATEM::begin(IPAddress ip) {
  * - Bytes 8-9: Local packet ID (0x003A matches working example)
  * - Bytes 10-19: Padding (0x00)
  * 
- * Waits up to CONNECTION_TIMEOUT ms for HELLO_RESPONSE (0x02 flag)
- * Enhanced debugging shows exactly what packets are received and why they
- * are or aren't recognized as valid HELLO_RESPONSE packets.
+ * HELLO is not stored for retransmission (per Sofie library); a lost HELLO
+ * is recovered by the ATEM_TIMER_HELLO_RESEND timer resending it.
  */
-bool ATEM::connect() {
-  debugPrint("Attempting to connect to ATEM...");
-  _connection_state = ATEM_CONNECTING;
-  _connection_start_time = millis();
-  
-  logPrintf(ATEM_LOG_INFO, "Using initial session ID for HELLO: 0x%04X", _session_id);
-  
+bool ATEM::sendHello() {
   // Send HELLO packet - EXACT format from working JavaScript analysis
   // Working packet: 101453ab00000000003a00000100000000000000
   uint8_t hello_packet[20] = {
@@ -190,110 +490,48 @@ bool ATEM::connect() {
     0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
   };
   
-  // The packet ID for this HELLO is embedded as 0x003a (58) in the packet
-  // But ATEM will later request retransmission using a different ID scheme
-  uint16_t hello_storage_id = 768; // ID that ATEM will request for retransmit
-  
-  logPrintf(ATEM_LOG_DEBUG, "HELLO packet uses embedded ID 0x3a, stored as ID: %d", hello_storage_id);
-  
-  debugPrint("Sending HELLO packet...");
+  ATEM_LOG(ATEM_LOG_DEBUG, "Sending HELLO packet to %d.%d.%d.%d:%d from local port %d (session ID 0x%04X)",
+           ATEM_IP_ARGS(_switcher_ip), ATEM_PORT, LOCAL_PORT, _session_id);
   debugPrintHex(hello_packet, 20);
   
-  logPrintf(ATEM_LOG_DEBUG, "Sending to: %s:%d from local port: %d", 
-           _switcher_ip.toString().c_str(), ATEM_PORT, LOCAL_PORT);
+  bool send_success = sendDatagram(hello_packet, 20);
   
-  // Update version to reflect increased packet storage and new logging system
-  logInfo("*** ATEM PROTOCOL v1.10.1 ***");
-  logInfo("CRITICAL FIX: Increased packet storage to 100 packets");
-  logInfo("Analysis showed ATEM requests retransmit FROM packet ID 1");
-  logInfo("Previous 10-packet buffer was too small, causing retransmit failures");
-  logInfo("Now storing last 100 packets for proper retransmission");
-  
-  _connection_state = ATEM_CONNECTING;
-  _connection_start_time = millis();
-  
-  // HELLO packet should NOT be stored for retransmission per Sofie library
-  // Only data packets with AckRequest flag are stored in _inFlight array
+  // Log in Sofie format for comparison
+  ATEM_LOG_PACKET("SEND", hello_packet, 20);
   
-  _udp.beginPacket(_switcher_ip, ATEM_PORT);
-  size_t bytes_written = _udp.write(hello_packet, 20);
-  bool send_success = _udp.endPacket();
+  _last_hello = millis();
+  _hello_attempts++;
   
-  // Log in Sofie format for comparison
-  printSofieFormat("SEND", hello_packet, 20);
+  // Data packets after the HELLO are numbered 1, 2, 3, ...
+  _local_packet_id = 1;
   
-  if (bytes_written != 20 || !send_success) {
-    logPrintf(ATEM_LOG_ERROR, "HELLO packet send failed - wrote %d/20 bytes, endPacket: %s", 
-             bytes_written, send_success ? "OK" : "FAILED");
-    _connection_state = ATEM_ERROR;
+  if (!send_success) {
+    ATEM_LOG(ATEM_LOG_WARN, "HELLO packet send failed");
     return false;
   }
   
-  logPrintf(ATEM_LOG_INFO, "HELLO packet sent successfully (%d bytes) - NOT stored for retransmission", 
-           bytes_written);
-  
-  // Set our local packet ID counter to start from 1 for data packets
-  _local_packet_id = 1;  // First data packet will be ID 1
-  
-  // Set our local packet ID counter to start after the HELLO
-  _local_packet_id = 1;  // Next packets will be 1, 2, 3, etc.
-  
-  debugPrint("HELLO packet sent, waiting for response...");
-  debugPrint("Expected HELLO_RESPONSE packet - any packet will be logged");
-  
-  // Add a counter to show we're actively checking for packets
-  int check_count = 0;
-  
-  // Wait for response
-  unsigned long start_time = millis();
-  while (millis() - start_time < CONNECTION_TIMEOUT) {
-    processIncomingPacket();
-    
-    if (_connection_state == ATEM_CONNECTED) {
-      debugPrint("Successfully connected to ATEM!");
-      onConnectionStateChanged(_connection_state);
-      return true;
-    }
-    
-    // Show periodic status during wait
-    check_count++;
-    if (check_count % 100 == 0) { // Every ~1 second (100 * 10ms)
-      logPrintf(ATEM_LOG_DEBUG, "Still waiting for response... (%ds) - checking for packets every 10ms",
-               (millis() - start_time) / 1000);
-    }
-    
-    delay(10);
-  }
-  
-  debugPrint("Connection timeout");
-  logError("=== CONNECTION TIMEOUT ANALYSIS ===");
-  logPrintf(ATEM_LOG_ERROR, "Waited %d ms for HELLO response", CONNECTION_TIMEOUT);
-  logPrintf(ATEM_LOG_ERROR, "Sent HELLO to: %s:%d", _switcher_ip.toString().c_str(), ATEM_PORT);
-  logPrintf(ATEM_LOG_ERROR, "Listening on local port: %d", LOCAL_PORT);
-  logError("No packets were received during this time");
-  logError("Possible issues:");
-  logError("1. ATEM device is not responding");
-  logError("2. Network routing/firewall issues");
-  logError("3. ATEM is on different network segment");
-  logError("4. ATEM port 9910 is not accessible");
-  logError("========================================");
-  _connection_state = ATEM_ERROR;
-  onConnectionStateChanged(_connection_state);
-  return false;
+  ATEM_LOG(ATEM_LOG_DEBUG, "HELLO packet sent (20 bytes), waiting for response...");
+  return true;
 }
 
 /**
  * @brief Disconnect from ATEM switcher and cleanup resources
  * Sets connection state to DISCONNECTED and stops UDP communication
- * Triggers onConnectionStateChanged callback if currently connected
+ * Triggers onConnectionStateChanged callback if connected or connecting
  */
 void ATEM::disconnect() {
-  if (_connection_state == ATEM_CONNECTED) {
-    debugPrint("Disconnecting from ATEM...");
+  stopNetworkTask();
+  _timers.clear();
+  _pacer.clear();
+  rollbackSpeculations();
+  _sequencer.stop();
+  
+  if (_connection_state != ATEM_DISCONNECTED) {
+    ATEM_LOG(ATEM_LOG_DEBUG, "Disconnecting from ATEM...");
     _connection_state = ATEM_DISCONNECTED;
     onConnectionStateChanged(_connection_state);
   }
-  _udp.stop();
+  _transport->stop();
   _udp_initialized = false;  // Reset UDP initialization status
 }
 
@@ -316,101 +554,187 @@ ATEMConnectionState ATEM::getConnectionState() {
 
 /**
  * @brief Main processing loop - MUST be called frequently in main loop
+ * @return Milliseconds until the next protocol deadline (0 = call again now,
+ *         ATEM_NO_DEADLINE when nothing is scheduled)
  * 
  * This function handles:
- * 1. Processing incoming UDP packets from ATEM
- * 2. Sending periodic heartbeat packets (every 500ms - matching Sofie library)
- * 3. Detecting connection timeouts and handling retransmission requests
- * 4. Triggering state change events when internal state is modified
+ * 1. Draining queued UDP packets from ATEM (see setReceiveBatch())
+ * 2. Running due protocol timers: heartbeats (every 500ms - matching Sofie
+ *    library), HELLO resends, connection timeouts and reconnects
+ * 3. Triggering state change events when internal state is modified
  * 
  * Call this at least every 10ms for proper operation
  */
 
-void ATEM::runLoop() {
-  // Process incoming packets
-  processIncomingPacket();
+uint32_t ATEM::runLoop() {
+  if (_task_mode) {
+    // The network task owns the protocol; just deliver its events here
+    dispatchEvents();
+    return ATEM_NO_DEADLINE;
+  }
   
+  return serviceConnection();
+}
+
+/**
+ * @brief Service the ATEM connection once
+ * @return Milliseconds until the next protocol deadline (see runLoop())
+ * Shared by runLoop() (direct mode) and the network task (task mode)
+ */
+uint32_t ATEM::serviceConnection() {
+  ATEM_METRIC(
+    uint32_t now_us = micros();
+    if (_last_service_us) _metrics.loop_interval.record(now_us - _last_service_us);
+    _last_service_us = now_us;
+  );
+  
+  // Drain queued incoming packets (bounded by the receive batch limits)
+  int processed = processIncomingPackets();
+  
+  // Due protocol deadlines: HELLO resend, handshake and receive timeouts,
+  // heartbeat, reconnect
   unsigned long current_time = millis();
+  ATEMTimerId timer;
+  while (_timers.expired(current_time, timer)) {
+    handleTimer(timer, current_time);
+  }
+  
+  // Notify if state changed
+  if (_state_changes.sections) {
+    uint16_t changes = _state_changes.sections;
+    publishStateChanges();
+    notify(ATEM_EVENT_STATE_CHANGED, 0, changes);
+  }
   
-  // Send heartbeat every 500ms when connected (matching Sofie library exactly)
-  if (_connection_state == ATEM_CONNECTED && 
-      current_time - _last_heartbeat > HEARTBEAT_INTERVAL) {
-    sendHeartbeat();
-    _last_heartbeat = current_time;
+  // A full batch means more datagrams are probably waiting
+  if (processed >= _rx_batch_max) {
+    return 0;
+  }
+  return _timers.msUntilNext(current_time);
+}
+
+/**
+ * @brief Configure receive batching for runLoop()
+ * @param max_packets Maximum datagrams drained per call (0 is treated as 1)
+ * @param budget_us Microsecond budget per call (0 = no time limit)
+ */
+void ATEM::setReceiveBatch(uint8_t max_packets, uint32_t budget_us) {
+  _rx_batch_max = (max_packets == 0) ? 1 : max_packets;
+  _rx_batch_budget_us = budget_us;
+}
+
+/**
+ * @brief Align heartbeats to a slot in every HEARTBEAT_INTERVAL
+ * @param phase_ms Slot offset (taken modulo HEARTBEAT_INTERVAL)
+ */
+void ATEM::setHeartbeatPhase(uint16_t phase_ms) {
+  _heartbeat_phase = phase_ms % HEARTBEAT_INTERVAL;
+  _heartbeat_aligned = true;
+}
+
+/**
+ * @brief Time the next heartbeat interval counts from
+ * @param now millis() of the heartbeat
+ * @return now, or the start of its slot when heartbeats are aligned, so the
+ *         next one goes out in the same slot of the following interval
+ */
+unsigned long ATEM::alignHeartbeat(unsigned long now) {
+  if (!_heartbeat_aligned) {
+    return now;
   }
+  return now - (now + HEARTBEAT_INTERVAL - _heartbeat_phase) % HEARTBEAT_INTERVAL;
+}
+
+/**
+ * @brief Drain queued UDP packets from ATEM switcher
+ * @return Number of datagrams processed
+ * 
+ * The switcher sends its initial state dump as dozens of back-to-back packets.
+ * Handling them all in one call keeps ACKs prompt and lets the dump finish in
+ * one burst. The datagram limit and microsecond budget bound the time spent
+ * here so a flood of traffic cannot starve the sketch.
+ */
+int ATEM::processIncomingPackets() {
+  unsigned long start_us = micros();
+  int processed = 0;
   
-  // Check for connection timeout with detailed logging
-  if (_connection_state == ATEM_CONNECTED && 
-      current_time - _last_received > CONNECTION_TIMEOUT) {
-    logPrintf(ATEM_LOG_ERROR, "[T+%dms] CONNECTION TIMEOUT DETECTED! Last packet received at T+%dms, timeout threshold: %dms, gap: %dms",
-             current_time, _last_received, CONNECTION_TIMEOUT, current_time - _last_received);
+  while (processed < _rx_batch_max) {
+    if (!processIncomingPacket()) {
+      break;
+    }
+    processed++;
     
-    debugPrint("Connection timeout - no packets received");
-    _connection_state = ATEM_ERROR;
-    onConnectionStateChanged(_connection_state);
+    if (_rx_batch_budget_us > 0 && micros() - start_us >= _rx_batch_budget_us) {
+      break;
+    }
   }
   
-  // Notify if state changed
-  if (_state_dirty) {
-    onStateChanged();
-    _state_dirty = false;
+  if (processed > 1) {
+    ATEM_LOG(ATEM_LOG_VERBOSE, "Drained %d datagrams in %luus", processed, micros() - start_us);
   }
+  
+  return processed;
 }
 
 /**
- * @brief Process incoming UDP packets from ATEM switcher
+ * @brief Process one incoming UDP packet from ATEM switcher
+ * @return true if a datagram was read from the socket, false if none was pending
  * 
- * Checks for available UDP data, reads into buffer with bounds checking,
- * validates minimum packet size, updates last received timestamp,
- * prints debug information if enabled, and calls parsePacket() for processing
+ * Borrows the datagram from the transport when it can lend its own buffer
+ * (receiveView()), otherwise reads it into _rx_buffer. Validates minimum packet
+ * size, updates last received timestamp, prints debug information if enabled,
+ * and calls parsePacket(), which parses the commands in place
  */
-void ATEM::processIncomingPacket() {
-  int packet_size = _udp.parsePacket();
-  if (packet_size <= 0) {
-    return;
+bool ATEM::processIncomingPacket() {
+  const uint8_t* buffer = nullptr;
+  int length = _transport->receiveView(buffer);
+  bool borrowed = length >= 0;
+  if (!borrowed) {
+    buffer = _rx_buffer;
+    length = _transport->receive(_rx_buffer, sizeof(_rx_buffer));
+  }
+  if (length <= 0) {
+    return false;
+  }
+  if (length > MAX_PACKET_SIZE) {
+    length = MAX_PACKET_SIZE;  // Same truncation as a copy into _rx_buffer
+  }
+  ATEM_METRIC(recordReceivedDatagram());
+  if (_capture) {
+    _capture->record(ATEM_CAPTURE_RX, buffer, (uint16_t)length, micros());
   }
   
   // Enhanced packet logging with timestamps
   unsigned long current_time = millis();
-  logPrintf(ATEM_LOG_VERBOSE, "*** PACKET RECEIVED! Size: %d bytes from %s:%d to local port: %d at T+%dms (%s) ***",
-           packet_size, _udp.remoteIP().toString().c_str(), _udp.remotePort(), LOCAL_PORT, current_time,
-           (_last_received > 0) ? ("gap: " + String(current_time - _last_received) + "ms").c_str() : "first packet");
+  ATEM_LOG(ATEM_LOG_VERBOSE, "*** PACKET RECEIVED! Size: %d bytes from %d.%d.%d.%d:%d to local port: %d at T+%lums (gap: %lums) ***",
+           length, ATEM_IP_ARGS(_transport->remoteIP()), _transport->remotePort(), LOCAL_PORT, current_time,
+           (_last_received > 0) ? current_time - _last_received : 0UL);
   
   // Log that we received ANY packet during connection
   if (_connection_state == ATEM_CONNECTING) {
-    logDebug("This packet was received during connection attempt!");
+    ATEM_LOG(ATEM_LOG_DEBUG, "This packet was received during connection attempt!");
   }
   
-  uint8_t buffer[MAX_PACKET_SIZE];
-  int length = _udp.read(buffer, sizeof(buffer));
-  
   // Log in Sofie format for comparison
-  printSofieFormat("RECV", buffer, length);
+  ATEM_LOG_PACKET("RECV", buffer, length);
   
-  logPrintf(ATEM_LOG_DEBUG, "Successfully read %d bytes from UDP socket", length);
+  ATEM_LOG(ATEM_LOG_DEBUG, "Successfully read %d bytes from UDP socket", length);
   
   if (length < HEADER_SIZE) {
-    logPrintf(ATEM_LOG_ERROR, "Packet too short (%d bytes, need at least %d)", length, HEADER_SIZE);
-    return;
+    ATEM_LOG(ATEM_LOG_ERROR, "Packet too short (%d bytes, need at least %d)", length, HEADER_SIZE);
+    ATEM_METRIC(_metrics.rx_malformed_packets++);
+    if (borrowed) _transport->releaseView();
+    return true;
   }
   
   _last_received = millis();
+  _timers.arm(ATEM_TIMER_RECEIVE_TIMEOUT, _last_received + CONNECTION_TIMEOUT);
   
-  // Always show packet content during debugging
-  logPrintf(ATEM_LOG_VERBOSE, "Packet content (first %d bytes): ", 
-           (length > 32) ? 32 : length);
-  if (_log_level >= ATEM_LOG_VERBOSE) {
-    Serial.print("[ATEM VERBOSE] ");
-    for (int i = 0; i < ((length > 32) ? 32 : length); i++) {
-      if (buffer[i] < 16) Serial.print("0");
-      Serial.print(buffer[i], HEX);
-      Serial.print(" ");
-    }
-    if (length > 32) Serial.print("...");
-    Serial.println();
-  }
+  ATEM_LOG_HEX(ATEM_LOG_VERBOSE, "Packet content (first 32 bytes)", buffer, (length > 32) ? 32 : length);
   
   parsePacket(buffer, length);
+  if (borrowed) _transport->releaseView();
+  return true;
 }
 
 /**
@@ -419,21 +743,21 @@ void ATEM::processIncomingPacket() {
  * @param length Length of received packet
  * @return true if packet processed successfully, false on error
  * 
- * Packet structure (12-byte header):
- * - Byte 0: Flags (0x01=Hello, 0x02=Hello response, 0x80=Reliable, 0x10=ACK)
- * - Bytes 1-2: Packet length (big-endian)
- * - Byte 3: Unknown/padding
- * - Bytes 4-5: Session ID (big-endian)
- * - Bytes 6-7: Acknowledged packet ID (big-endian)
- * - Bytes 8-9: Remote packet ID (big-endian)
- * - Bytes 10-11: Unknown/padding
+ * Packet structure (12-byte header, as used by Sofie ATEM Connection):
+ * - Bytes 0-1: Flags (high 5 bits) and packet length (low 11 bits)
+ * - Bytes 2-3: Session ID (big-endian)
+ * - Bytes 4-5: Acknowledged packet ID (big-endian, AckReply packets)
+ * - Bytes 6-7: Retransmit-from packet ID (big-endian, RetransmitRequest packets)
+ * - Bytes 8-9: Unknown/padding
+ * - Bytes 10-11: Remote packet ID (big-endian)
  * 
- * Handles connection establishment, ACK requirements, and command processing
+ * Handles connection establishment, ACK requirements, and command processing.
+ * AckReply packets release every covered packet from the retransmit store.
  */
-bool ATEM::parsePacket(uint8_t* buffer, int length) {
+bool ATEM::parsePacket(const uint8_t* buffer, int length) {
   // Validate minimum packet size
   if (length < HEADER_SIZE) {
-    debugPrint("Packet too short for header");
+    ATEM_LOG(ATEM_LOG_DEBUG, "Packet too short for header");
     return false;
   }
   
@@ -442,108 +766,152 @@ bool ATEM::parsePacket(uint8_t* buffer, int length) {
   uint8_t flags = (buffer[0] >> 3);  // Flags are in high 5 bits of first byte
   uint16_t packet_length = flagsAndLength & 0x07FF;  // Length is low 11 bits
   uint16_t session_id = (buffer[2] << 8) | buffer[3];
-  uint16_t acked_packet_id = (buffer[6] << 8) | buffer[7];  // bytes 6-7
+  uint16_t acked_packet_id = (buffer[4] << 8) | buffer[5];  // bytes 4-5 (valid with AckReply flag)
+  uint16_t retransmit_from_id = (buffer[6] << 8) | buffer[7]; // bytes 6-7 (valid with RetransmitRequest flag)
   uint16_t remote_packet_id = (buffer[10] << 8) | buffer[11]; // CORRECTED: bytes 10-11 contain the ATEM's packet ID
   
   // Enhanced packet analysis (VERBOSE level only)
-  if (_log_level >= ATEM_LOG_VERBOSE) {
-    Serial.println("[ATEM VERBOSE] === PACKET ANALYSIS (SOFIE FORMAT) ===");
-    Serial.print("[ATEM VERBOSE] Raw first bytes: ");
-    for (int i = 0; i < 12 && i < length; i++) {
-      if (buffer[i] < 16) Serial.print("0");
-      Serial.print(buffer[i], HEX);
-      Serial.print(" ");
-    }
-    Serial.println();
-    Serial.print("[ATEM VERBOSE] Flags: 0x");
-    if (flags < 16) Serial.print("0");
-    Serial.print(flags, HEX);
-    Serial.print(" (");
-    if (flags & 0x01) Serial.print("AckRequest ");
-    if (flags & 0x02) Serial.print("NewSessionId ");
-    if (flags & 0x04) Serial.print("IsRetransmit ");
-    if (flags & 0x08) Serial.print("RetransmitRequest ");
-    if (flags & 0x10) Serial.print("AckReply ");
-    if (flags == 0x00) Serial.print("NONE");
-    Serial.println(")");
-    Serial.printf("[ATEM VERBOSE] Length: %d (actual: %d)\n", packet_length, length);
-    Serial.printf("[ATEM VERBOSE] Session ID: 0x%04X\n", session_id);
-    Serial.printf("[ATEM VERBOSE] Acked Packet ID: %d\n", acked_packet_id);
-    Serial.printf("[ATEM VERBOSE] Remote Packet ID: %d\n", remote_packet_id);
-    Serial.println("[ATEM VERBOSE] =======================================");
+  if (logEnabled(ATEM_LOG_VERBOSE)) {
+    char flag_names[80] = "";
+    if (flags & FLAG_ACK_REQUEST)        strcat(flag_names, "AckRequest ");
+    if (flags & FLAG_NEW_SESSION_ID)     strcat(flag_names, "NewSessionId ");
+    if (flags & FLAG_IS_RETRANSMIT)      strcat(flag_names, "IsRetransmit ");
+    if (flags & FLAG_RETRANSMIT_REQUEST) strcat(flag_names, "RetransmitRequest ");
+    if (flags & FLAG_ACK_REPLY)          strcat(flag_names, "AckReply ");
+    if (flags == 0x00)                   strcat(flag_names, "NONE");
+    
+    ATEM_LOG(ATEM_LOG_VERBOSE, "=== PACKET ANALYSIS (SOFIE FORMAT) ===");
+    ATEM_LOG_HEX(ATEM_LOG_VERBOSE, "Raw first bytes", buffer, (length < HEADER_SIZE) ? length : HEADER_SIZE);
+    ATEM_LOG(ATEM_LOG_VERBOSE, "Flags: 0x%02X (%s)", flags, flag_names);
+    ATEM_LOG(ATEM_LOG_VERBOSE, "Length: %d (actual: %d)", packet_length, length);
+    ATEM_LOG(ATEM_LOG_VERBOSE, "Session ID: 0x%04X", session_id);
+    ATEM_LOG(ATEM_LOG_VERBOSE, "Acked Packet ID: %d", acked_packet_id);
+    ATEM_LOG(ATEM_LOG_VERBOSE, "Retransmit From ID: %d", retransmit_from_id);
+    ATEM_LOG(ATEM_LOG_VERBOSE, "Remote Packet ID: %d", remote_packet_id);
+    ATEM_LOG(ATEM_LOG_VERBOSE, "=======================================");
   }
   
   // Validate packet length
   if (packet_length != length) {
-    logPrintf(ATEM_LOG_WARN, "Packet length mismatch: header says %d, actually received %d", packet_length, length);
+    ATEM_LOG(ATEM_LOG_WARN, "Packet length mismatch: header says %d, actually received %d", packet_length, length);
+    ATEM_METRIC(_metrics.rx_malformed_packets++);
   }
   
   // Handle connection response - look for NewSessionId flag (0x02)
   if (_connection_state == ATEM_CONNECTING) {
-    logDebug("*** ANALYZING PACKET DURING HELLO HANDSHAKE ***");
+    ATEM_LOG(ATEM_LOG_DEBUG, "*** ANALYZING PACKET DURING HELLO HANDSHAKE ***");
     
     if (flags & 0x02) { // NewSessionId flag from Sofie implementation
-      logInfo("*** HELLO_RESPONSE WITH NewSessionId FLAG DETECTED! ***");
+      ATEM_LOG(ATEM_LOG_INFO, "*** HELLO_RESPONSE WITH NewSessionId FLAG DETECTED! ***");
       
       // Use the session ID from the response header (exactly like Sofie does)
       _session_id = session_id;
-      logPrintf(ATEM_LOG_INFO, "ATEM assigned session ID: 0x%04X", _session_id);
+      ATEM_LOG(ATEM_LOG_INFO, "ATEM assigned session ID: 0x%04X", _session_id);
       
       _connection_state = ATEM_CONNECTED;
-      _last_heartbeat = millis();  // Initialize heartbeat timer when connection established
+      _timers.cancel(ATEM_TIMER_HELLO_RESEND);
+      _timers.cancel(ATEM_TIMER_HANDSHAKE_TIMEOUT);
+      _timers.arm(ATEM_TIMER_HEARTBEAT, alignHeartbeat(millis()) + HEARTBEAT_INTERVAL);  // Heartbeats start when connection established
+      ATEM_LOG(ATEM_LOG_INFO, "Connected to ATEM after %d HELLO attempt(s) in %lums",
+               _hello_attempts, millis() - _connection_start_time);
+      notify(ATEM_EVENT_CONNECTION_STATE, 0, _connection_state);
+      _reconnect_attempts = 0;
       
       // Send ACK for the hello response (like Sofie does)
+      _rx_window.reset(remote_packet_id);  // Data packets follow this ID
       if (remote_packet_id > 0) {
-        logPrintf(ATEM_LOG_DEBUG, "Sending ACK for packet ID: %d", remote_packet_id);
+        ATEM_LOG(ATEM_LOG_DEBUG, "Sending ACK for packet ID: %d", remote_packet_id);
         sendAck(remote_packet_id);
-        _remote_packet_id = remote_packet_id;  // Update our tracking
       }
       
       // CRITICAL: Start packet storage immediately after connection established
-      logInfo("*** INITIALIZING PACKET STORAGE FOR RETRANSMISSION ***");
-      logInfo("All outgoing packets will now be stored for potential retransmission");
+      ATEM_LOG(ATEM_LOG_INFO, "*** INITIALIZING PACKET STORAGE FOR RETRANSMISSION ***");
+      ATEM_LOG(ATEM_LOG_INFO, "All outgoing packets will now be stored for potential retransmission");
       
       return true;
     } else {
-      logPrintf(ATEM_LOG_DEBUG, "*** NOT A NewSessionId RESPONSE - flags: 0x%02X ***", flags);
+      ATEM_LOG(ATEM_LOG_DEBUG, "*** NOT A NewSessionId RESPONSE - flags: 0x%02X ***", flags);
     }
   }
   
   // Handle session ID changes (ATEM may reassign during operation)
   if (_connection_state == ATEM_CONNECTED && session_id != _session_id) {
-    logPrintf(ATEM_LOG_INFO, "Session ID changed from 0x%04X to 0x%04X - updating", _session_id, session_id);
+    ATEM_LOG(ATEM_LOG_INFO, "Session ID changed from 0x%04X to 0x%04X - updating", _session_id, session_id);
     _session_id = session_id;
   }
   
-  // Update packet tracking
-  if (remote_packet_id > _remote_packet_id) {
-    _remote_packet_id = remote_packet_id;
+  // Reliable packets go through the receive window, so a resent or duplicated
+  // datagram is not parsed again, a packet that overtook a missing one is left
+  // for the switcher to resend in order, and the ACK never runs ahead of a gap
+  bool fresh = true;
+  if (flags & FLAG_ACK_REQUEST) {
+    switch (_rx_window.receive(remote_packet_id)) {
+      case ATEM_RX_DUPLICATE:
+        ATEM_LOG(ATEM_LOG_VERBOSE, "Packet %d received again - acknowledging without parsing", remote_packet_id);
+        ATEM_METRIC(_metrics.rx_duplicate_packets++);
+        fresh = false;
+        break;
+      case ATEM_RX_OUT_OF_ORDER:
+        ATEM_LOG(ATEM_LOG_DEBUG, "Packet %d arrived before %d - dropped until it is resent", remote_packet_id,
+                 atemNextPacketId(_rx_window.lastInOrder()));
+        ATEM_METRIC(_metrics.rx_out_of_order_packets++);
+        fresh = false;
+        break;
+      default:
+        break;
+    }
+  }
+  
+  // Release every stored packet covered by the ATEM's cumulative ACK
+  if (flags & FLAG_ACK_REPLY) {
+    uint16_t released = _sent_packets.releaseAcked(acked_packet_id);
+    ATEM_METRIC(
+      if (_ack_sample_pending && atemPacketCoveredByAck(acked_packet_id, _ack_sample_id)) {
+        _metrics.ack_rtt.record(micros() - _ack_sample_us);
+        _ack_sample_pending = false;
+      }
+    );
+    if (released > 0) {
+      ATEM_LOG(ATEM_LOG_VERBOSE, "ACK for packet %d released %d stored packet(s), %d still unacknowledged",
+               acked_packet_id, released, _sent_packets.count());
+    }
+    // A paced value held back for this ACK can go out now
+    if (_pacer.acked(acked_packet_id)) {
+      servicePacedCommands();
+    }
+    // Speculations carried by it must now be echoed soon
+    if (_speculations.acked(acked_packet_id, millis())) {
+      armSpeculationTimer();
+    }
   }
   
   // Handle RetransmitRequest packets specifically
   if (flags & 0x08) { // RetransmitRequest flag
-    // Extract the fromPacketId from bytes 6-7 (like Sofie library does)
-    uint16_t from_packet_id = (buffer[6] << 8) | buffer[7];
-    
-    logPrintf(ATEM_LOG_INFO, "[T+%dms] ATEM requesting retransmit FROM packet ID: %d (sequence %d, like Sofie: from this packet onwards)",
-             millis(), from_packet_id, remote_packet_id);
+    // The fromPacketId lives in bytes 6-7 (like Sofie library does)
+    ATEM_LOG(ATEM_LOG_INFO, "[T+%lums] ATEM requesting retransmit FROM packet ID: %d (sequence %d, like Sofie: from this packet onwards)",
+             millis(), retransmit_from_id, remote_packet_id);
     
     // Handle the retransmit request by resending from the requested packet onwards
-    logDebug("IMPLEMENTING RETRANSMISSION FROM PACKET ONWARDS...");
-    handleRetransmitRequest(from_packet_id, remote_packet_id);
+    ATEM_LOG(ATEM_LOG_DEBUG, "IMPLEMENTING RETRANSMISSION FROM PACKET ONWARDS...");
+    handleRetransmitRequest(retransmit_from_id, remote_packet_id);
     return true; // Don't process further
   }
   
   // Send ACK for ALL packets with data (like Sofie does), not just AckRequest packets
-  // This is critical - ATEM expects ACK for every data packet to continue sending
-  if (length > HEADER_SIZE || (flags & 0x01)) {  // Has data OR explicit AckRequest
-    logPrintf(ATEM_LOG_DEBUG, "[T+%dms] Sending ACK for packet ID: %d (packet has %d bytes of data)",
+  // This is critical - ATEM expects ACK for every data packet to continue sending.
+  // Reliable packets are acknowledged cumulatively up to the last one without a gap.
+  if (flags & FLAG_ACK_REQUEST) {
+    ATEM_LOG(ATEM_LOG_DEBUG, "[T+%lums] Sending ACK for packet ID: %d (received %d, %d bytes of data)",
+             millis(), _rx_window.lastInOrder(), remote_packet_id, length - HEADER_SIZE);
+    sendAck(_rx_window.lastInOrder());
+  } else if (length > HEADER_SIZE) {
+    ATEM_LOG(ATEM_LOG_DEBUG, "[T+%lums] Sending ACK for packet ID: %d (packet has %d bytes of data)",
              millis(), remote_packet_id, length - HEADER_SIZE);
     sendAck(remote_packet_id);
   }
   
   // Process commands if present
-  if (length > HEADER_SIZE) {
+  if (length > HEADER_SIZE && fresh) {
     processInitialPayload(buffer + HEADER_SIZE, length - HEADER_SIZE);
   }
   
@@ -561,993 +929,2215 @@ bool ATEM::parsePacket(uint8_t* buffer, int length) {
  * - Bytes 4-7: 4-character command name (e.g., "PrgI", "PrvI")
  * - Bytes 8+: Command-specific data
  * 
- * Processes multiple commands that may be packed in single packet
- * Currently handles: PrgI (Program Input), PrvI (Preview Input)
+ * Commands are parsed in place: ATEMCommandReader checks that each block lies
+ * inside the packet and dispatchCommand() gets a view of its payload, so
+ * nothing is copied out of the receive buffer
  */
-void ATEM::processInitialPayload(uint8_t* data, int length) {
-  int offset = 0;
+void ATEM::processInitialPayload(const uint8_t* data, int length) {
+  ATEMCommandReader reader(ATEMByteView(data, (uint16_t)length));
+  uint32_t name;
+  ATEMByteView payload;
+  
+  _state_lock.beginWrite();
+  while (reader.next(name, payload)) {
+    ATEM_LOG(ATEM_LOG_VERBOSE, "Command: %.4s (%d bytes)", (const char*)(payload.data - 4), payload.length + 8);
+    dispatchCommand(name, payload);
+  }
+  _state_lock.endWrite();
   
-  while (offset + 8 <= length) {
-    // Bounds check before reading command length
-    if (offset + 2 > length) {
-      debugPrint("Insufficient data for command length");
-      break;
-    }
-    
-    uint16_t cmd_length = (data[offset] << 8) | data[offset + 1];
-    
-    // Validate command length
-    if (cmd_length < 8) {
-      debugPrint("Command length too short");
-      break;
-    }
-    
-    if (offset + cmd_length > length) {
-      debugPrint("Command extends beyond packet");
-      break;
-    }
-    
-    // Bounds check before reading command name
-    if (offset + 8 > length) {
-      debugPrint("Insufficient data for command name");
-      break;
-    }
-    
-    // Extract command name
-    char cmd_name[5];
-    memcpy(cmd_name, data + offset + 4, 4);
-    cmd_name[4] = '\0';
-    
-    logPrintf(ATEM_LOG_VERBOSE, "Command: %s (%d bytes)", cmd_name, cmd_length);
-    
-    // Process specific commands
-    if (strcmp(cmd_name, "PrgI") == 0) {
-      processProgramInput(data + offset + 8, cmd_length - 8);
-    }
-    else if (strcmp(cmd_name, "PrvI") == 0) {
-      processPreviewInput(data + offset + 8, cmd_length - 8);
-    }
-    
-    offset += cmd_length;
+  if (reader.malformed()) {
+    ATEM_LOG(ATEM_LOG_DEBUG, "Malformed command block at offset %d of %d", reader.offset(), length);
+    ATEM_METRIC(_metrics.rx_malformed_commands++);
   }
 }
 
 /**
- * @brief Process Program Input (PrgI) command from ATEM
- * @param data Pointer to PrgI command data (after 8-byte command header)
- * @param length Length of command data
- * 
- * PrgI command data structure:
- * - Bytes 0-1: ME (Mix Effects) index
- * - Bytes 2-3: Input source ID (big-endian)
+ * @brief Send one datagram to the switcher
+ * @param data Complete packet including the 12-byte header
+ * @param length Packet length
+ * @return true if the transport accepted the whole datagram
  * 
- * Updates internal program input state, sets dirty flag, and triggers
- * onProgramInputChanged() callback if value actually changed
+ * Every protocol packet (HELLO, ACK, command, retransmit) goes through here so
+ * the capture sees the traffic exactly as sent
  */
-void ATEM::processProgramInput(uint8_t* data, int length) {
-  if (length < 4) {
-    debugPrint("PrgI command data too short");
-    return;
-  }
-  
-  uint16_t input = (data[2] << 8) | data[3];
-  
-    if (input != _state.program_input) {
-    _state.program_input = input;
-    _state_dirty = true;
-    
-    logPrintf(ATEM_LOG_INFO, "Program input changed to: %d", input);
-    
-    onProgramInputChanged(input);
+bool ATEM::sendDatagram(const uint8_t* data, uint16_t length) {
+  if (_capture) {
+    _capture->record(ATEM_CAPTURE_TX, data, length, micros());
   }
+  return _transport->send(_switcher_ip, ATEM_PORT, data, length);
 }
 
 /**
- * @brief Process Preview Input (PrvI) command from ATEM
- * @param data Pointer to PrvI command data (after 8-byte command header)
- * @param length Length of command data
- * 
- * PrvI command data structure:
- * - Bytes 0-1: ME (Mix Effects) index  
- * - Bytes 2-3: Input source ID (big-endian)
+ * @brief Route one received command to the built-in and user handlers
+ * @param name Command name as atemFourCC()
+ * @param payload View of the command payload (after the 8-byte block header)
  * 
- * Updates internal preview input state, sets dirty flag, and triggers
- * onPreviewInputChanged() callback if value actually changed
+ * The name is compared as one 32-bit value instead of a string, and the switch
+ * lets the compiler build a jump table or binary search over the known codes,
+ * so the cost per command no longer grows with the number of handlers.
+ * Duplicate names are caught at compile time as duplicate case labels.
+ * Families not subscribed (setSubscriptions()) are dropped here without
+ * reading the payload.
  */
-void ATEM::processPreviewInput(uint8_t* data, int length) {
-  if (length < 4) {
-    debugPrint("PrvI command data too short");
-    return;
+void ATEM::dispatchCommand(uint32_t name, ATEMByteView payload) {
+  const uint8_t* data = payload.data;
+  int length = payload.length;
+  
+  ATEM_METRIC(
+    _metrics.rx_commands++;
+    if (_commands_awaiting) recordConfirmation(name);
+  );
+  
+  switch (name) {
+    case atemFourCC("_ver"): processVersion(data, length); break;
+    case atemFourCC("_pin"): processProductId(data, length); break;
+    case atemFourCC("_top"): processTopology(data, length); break;
+    case atemFourCC("_MeC"): processMixEffectConfig(data, length); break;
+    case atemFourCC("VidM"): processVideoMode(data, length); break;
+    case atemFourCC("PrgI"): if (subscribed(ATEM_SUBSCRIBE_PROGRAM_PREVIEW)) processProgramInput(data, length); break;
+    case atemFourCC("PrvI"): if (subscribed(ATEM_SUBSCRIBE_PROGRAM_PREVIEW)) processPreviewInput(data, length); break;
+    case atemFourCC("TrPs"): if (subscribed(ATEM_SUBSCRIBE_TRANSITIONS)) processTransitionPosition(data, length); break;
+    case atemFourCC("TrSS"): if (subscribed(ATEM_SUBSCRIBE_TRANSITIONS)) processTransitionProperties(data, length); break;
+    case atemFourCC("TrPr"): if (subscribed(ATEM_SUBSCRIBE_TRANSITIONS)) processTransitionPreview(data, length); break;
+    case atemFourCC("KeOn"): if (subscribed(ATEM_SUBSCRIBE_KEYERS)) processKeyerOnAir(data, length); break;
+    case atemFourCC("DskS"): if (subscribed(ATEM_SUBSCRIBE_KEYERS)) processDownstreamKeyerState(data, length); break;
+    case atemFourCC("DskP"): if (subscribed(ATEM_SUBSCRIBE_KEYERS)) processDownstreamKeyerProperties(data, length); break;
+    case atemFourCC("DskB"): if (subscribed(ATEM_SUBSCRIBE_KEYERS)) processDownstreamKeyerSources(data, length); break;
+    case atemFourCC("FtbS"): if (subscribed(ATEM_SUBSCRIBE_FADE_TO_BLACK)) processFadeToBlackState(data, length); break;
+    case atemFourCC("FtbP"): if (subscribed(ATEM_SUBSCRIBE_FADE_TO_BLACK)) processFadeToBlackProperties(data, length); break;
+    case atemFourCC("AuxS"): if (subscribed(ATEM_SUBSCRIBE_AUX)) processAuxSource(data, length); break;
+    case atemFourCC("MPCE"): if (subscribed(ATEM_SUBSCRIBE_MEDIA)) processMediaPlayerSource(data, length); break;
+    case atemFourCC("InPr"): if (subscribed(ATEM_SUBSCRIBE_INPUTS)) processInputProperties(data, length); break;
+    case atemFourCC("TlIn"): if (subscribed(ATEM_SUBSCRIBE_TALLY)) processTallyByIndex(data, length); break;
+    case atemFourCC("TlSr"): if (subscribed(ATEM_SUBSCRIBE_TALLY)) processTallyBySource(data, length); break;
+    case atemFourCC("InCm"): processInitComplete(); break;
+    default: break;
   }
   
-  uint16_t input = (data[2] << 8) | data[3];
-  
-  if (input != _state.preview_input) {
-    _state.preview_input = input;
-    _state_dirty = true;
-    
-    logPrintf(ATEM_LOG_INFO, "Preview input changed to: %d", input);
-    
-    onPreviewInputChanged(input);
+  for (uint8_t i = 0; i < _command_handler_count; i++) {
+    if (_command_handlers[i].name == name) {
+      _command_handlers[i].handler(name, data, (uint16_t)length, _command_handlers[i].context);
+      break;
+    }
   }
 }
 
 /**
- * @brief Send heartbeat packet to maintain connection with ATEM
- * 
- * Heartbeat packet structure (12 bytes):
- * - Byte 0: 0x80 (Reliable packet flag)
- * - Bytes 1-2: 0x0C, 0x00 (Length = 12 bytes)
- * - Byte 3: 0x00 (Unknown/padding)
- * - Bytes 4-5: Session ID (big-endian)
- * - Bytes 6-7: Last received packet ID from ATEM (big-endian)
- * - Bytes 8-9: Our local packet ID (big-endian)
- * - Bytes 10-11: 0x00 (Unknown/padding)
- * 
- * Must be sent every HEARTBEAT_INTERVAL ms to prevent timeout
- * Increments local packet ID after sending
+ * @brief Register a handler for a received command
+ * @param name Four-character command name
+ * @param handler Function called with the command payload
+ * @param context Passed through to the handler
+ * @return false if the name is invalid or all slots are in use
  */
-void ATEM::sendHeartbeat() {
-  // Build heartbeat packet like Sofie ATEM Connection library
-  uint16_t opcode = (FLAG_ACK_REQUEST << 11);  // AckRequest flag for heartbeat
-  uint16_t length = 12;  // Always 12 bytes for heartbeat
-  
-  uint8_t packet[HEADER_SIZE] = {0};
-  
-  // Opcode and length in first 2 bytes (big-endian)
-  packet[0] = (opcode | length) >> 8;
-  packet[1] = (opcode | length) & 0xFF;
-  
-  // Session ID in bytes 2-3 (big-endian)
-  packet[2] = (_session_id >> 8) & 0xFF;
-  packet[3] = _session_id & 0xFF;
-  
-  // Local packet ID in bytes 10-11 (big-endian)
-  packet[10] = (_local_packet_id >> 8) & 0xFF;
-  packet[11] = _local_packet_id & 0xFF;
-  
-  // Store packet for potential retransmission
-  storePacketForRetransmission(_local_packet_id, packet, HEADER_SIZE);
+bool ATEM::registerCommandHandler(const char* name, ATEMCommandHandler handler, void* context) {
+  if (!name || strlen(name) != 4 || !handler) {
+    ATEM_LOG(ATEM_LOG_ERROR, "registerCommandHandler: need a four-character name and a handler");
+    return false;
+  }
   
-  _udp.beginPacket(_switcher_ip, ATEM_PORT);
-  _udp.write(packet, HEADER_SIZE);
-  _udp.endPacket();
+  uint32_t code = atemFourCC(name);
+  for (uint8_t i = 0; i < _command_handler_count; i++) {
+    if (_command_handlers[i].name == code) {
+      _command_handlers[i].handler = handler;
+      _command_handlers[i].context = context;
+      return true;
+    }
+  }
   
-  // Log in Sofie format for comparison
-  printSofieFormat("SEND", packet, HEADER_SIZE);
+  if (_command_handler_count >= ATEM_MAX_COMMAND_HANDLERS) {
+    ATEM_LOG(ATEM_LOG_ERROR, "registerCommandHandler: no free slot for %s (ATEM_MAX_COMMAND_HANDLERS = %d)",
+             name, ATEM_MAX_COMMAND_HANDLERS);
+    return false;
+  }
   
-  _local_packet_id++;
+  CommandHandlerSlot& slot = _command_handlers[_command_handler_count++];
+  slot.name    = code;
+  slot.handler = handler;
+  slot.context = context;
+  return true;
+}
+
+/**
+ * @brief Remove the handler registered for a command
+ * @param name Four-character command name
+ * @return true if a handler was removed
+ */
+bool ATEM::unregisterCommandHandler(const char* name) {
+  if (!name || strlen(name) != 4) {
+    return false;
+  }
   
-  logPrintf(ATEM_LOG_DEBUG, "[T+%dms] Heartbeat sent", millis());
+  uint32_t code = atemFourCC(name);
+  for (uint8_t i = 0; i < _command_handler_count; i++) {
+    if (_command_handlers[i].name == code) {
+      _command_handlers[i] = _command_handlers[--_command_handler_count];
+      return true;
+    }
+  }
+  return false;
 }
 
 /**
- * @brief Send acknowledgment packet for received reliable data
- * @param packet_id ID of the packet being acknowledged
+ * @brief Process Initialization Complete (InCm) command from ATEM
  * 
- * ACK packet structure (12 bytes):
- * - Byte 0: 0x10 (ACK flag)
- * - Bytes 1-2: 0x0C, 0x00 (Length = 12 bytes)
- * - Byte 3: 0x00 (Unknown/padding)
- * - Bytes 4-5: Session ID (big-endian)
- * - Bytes 6-7: Packet ID being acknowledged (big-endian)
- * - Bytes 8-9: 0x00 (Local packet ID not used for ACK)
- * - Bytes 10-11: 0x00 (Unknown/padding)
+ * Sent after the last command of the initial state dump, so the cached state
+ * is now current for this session
+ */
+void ATEM::processInitComplete() {
+  ATEM_LOG(ATEM_LOG_DEBUG, "Initial state dump complete");
+  if (_state.stale) {
+    _state.stale = false;
+    markStateChanged(ATEM_STATE_CHANGED_STALE);
+  }
+}
+
+/**
+ * @brief Process Program Input (PrgI) command from ATEM
+ * @param data Pointer to PrgI command data (after 8-byte command header)
+ * @param length Length of command data
  * 
- * Required for reliable packet delivery in ATEM protocol
+ * PrgI command data structure:
+ * - Byte 0: ME (Mix Effects) index, byte 1 unused
+ * - Bytes 2-3: Input source ID (big-endian)
+ * 
+ * Updates the program input of that M/E, marks ATEM_STATE_CHANGED_PROGRAM and
+ * triggers onMixEffectProgramChanged() if the value actually changed
  */
-void ATEM::sendAck(uint16_t packet_id) {
-  // Build ACK packet exactly like Sofie ATEM Connection library
-  // Format: 800c [session_id] 0000 [acked_packet_id] 0000
-  uint8_t packet[HEADER_SIZE] = {0};
+void ATEM::processProgramInput(const uint8_t* data, int length) {
+  if (length < 4) {
+    ATEM_LOG(ATEM_LOG_DEBUG, "PrgI command data too short");
+    return;
+  }
   
-  // ACK flag (0x10) shifted to high 5 bits, with 12-byte length
-  packet[0] = 0x80;  // High 5 bits = 0x10 (AckReply flag), length = 0x0C (12 bytes)
-  packet[1] = 0x0C;
+  ATEMMixEffectState* me = mixEffectState(data[0]);
+  if (!me) return;
   
-  // Session ID in bytes 2-3 (big-endian)
-  packet[2] = (_session_id >> 8) & 0xFF;
-  packet[3] = _session_id & 0xFF;
+  uint16_t input = (data[2] << 8) | data[3];
   
-  // CRITICAL FIX: Acked packet ID goes in bytes 4-5 (big-endian), not 6-7!
-  packet[4] = (packet_id >> 8) & 0xFF;
-  packet[5] = packet_id & 0xFF;
+  if (reconcileSpeculation(ATEM_SPECULATED_PROGRAM, data[0], input)) return;
   
-  // Bytes 6-7 remain zero for ACK packets  
-  packet[6] = 0x00;
-  packet[7] = 0x00;
+  if (applyMixEffectInput(ATEM_SPECULATED_PROGRAM, data[0], input, 0)) {
+    ATEM_LOG(ATEM_LOG_INFO, "Program input changed to: %d (M/E %d)", input, data[0] + 1);
+  }
+}
+
+/**
+ * @brief Process Preview Input (PrvI) command from ATEM
+ * @param data Pointer to PrvI command data (after 8-byte command header)
+ * @param length Length of command data
+ * 
+ * PrvI command data structure:
+ * - Byte 0: ME (Mix Effects) index, byte 1 unused
+ * - Bytes 2-3: Input source ID (big-endian)
+ * 
+ * Updates the preview input of that M/E, marks ATEM_STATE_CHANGED_PREVIEW and
+ * triggers onMixEffectPreviewChanged() if the value actually changed
+ */
+void ATEM::processPreviewInput(const uint8_t* data, int length) {
+  if (length < 4) {
+    ATEM_LOG(ATEM_LOG_DEBUG, "PrvI command data too short");
+    return;
+  }
   
-  // Bytes 8-11 remain zero for ACK packets
+  ATEMMixEffectState* me = mixEffectState(data[0]);
+  if (!me) return;
   
-  _udp.beginPacket(_switcher_ip, ATEM_PORT);
-  _udp.write(packet, HEADER_SIZE);
-  _udp.endPacket();
+  uint16_t input = (data[2] << 8) | data[3];
   
-  // Log in Sofie format for comparison
-  printSofieFormat("SEND", packet, HEADER_SIZE);
+  if (reconcileSpeculation(ATEM_SPECULATED_PREVIEW, data[0], input)) return;
   
-  logPrintf(ATEM_LOG_VERBOSE, "[T+%dms] ACK sent for packet %d with session ID 0x%04X - HEX: ",
-           millis(), packet_id, _session_id);
-  if (_log_level >= ATEM_LOG_VERBOSE) {
-    for (int i = 0; i < HEADER_SIZE; i++) {
-      if (packet[i] < 16) Serial.print("0");
-      Serial.print(packet[i], HEX);
-      Serial.print(" ");
-    }
-    Serial.println();
+  if (applyMixEffectInput(ATEM_SPECULATED_PREVIEW, data[0], input, 0)) {
+    ATEM_LOG(ATEM_LOG_INFO, "Preview input changed to: %d (M/E %d)", input, data[0] + 1);
   }
 }
 
-// State access functions
+/**
+ * @brief Process Tally By Index (TlIn)
+ * Payload: u16 count @0, then one flags byte per input (input N at index N-1):
+ * bit 0 program, bit 1 preview
+ */
+void ATEM::processTallyByIndex(const uint8_t* data, int length) {
+  if (length < 2) return;
+  uint16_t count = (data[0] << 8) | data[1];
+  if (count > length - 2) count = length - 2;
+  
+  bool changed = false;
+  for (uint16_t i = 0; i < count; i++) {
+    changed |= _tally.set(i + 1, data[2 + i]);
+  }
+  if (changed) {
+    markStateChanged(ATEM_STATE_CHANGED_TALLY);
+    notify(ATEM_EVENT_TALLY_CHANGED, 0, 0);
+  }
+}
 
 /**
- * @brief Get complete current ATEM state
- * @return ATEMState struct containing program/preview inputs and transition status
- * Returns a copy of the internal state structure
+ * @brief Process Tally By Source (TlSr)
+ * Payload: u16 count @0, then per source u16 source ID and a flags byte
+ * (bit 0 program, bit 1 preview); covers internal sources as well
  */
-ATEMState ATEM::getState() {
-  return _state;
+void ATEM::processTallyBySource(const uint8_t* data, int length) {
+  if (length < 2) return;
+  uint16_t count = (data[0] << 8) | data[1];
+  if (count > (length - 2) / 3) count = (length - 2) / 3;
+  
+  bool changed = false;
+  for (uint16_t i = 0; i < count; i++) {
+    const uint8_t* entry = data + 2 + i * 3;
+    changed |= _tally.set((entry[0] << 8) | entry[1], entry[2]);
+  }
+  if (changed) {
+    markStateChanged(ATEM_STATE_CHANGED_TALLY);
+    notify(ATEM_EVENT_TALLY_CHANGED, 0, 0);
+  }
 }
 
 /**
- * @brief Get current program input number
- * @return uint16_t program input ID (1=CAM1, 2=CAM2, 0=BLACK, etc.)
+ * @brief Check an M/E index before encoding a control command
+ * @param me Mix effect index
+ * @return true if the connected model has this M/E
  */
-uint16_t ATEM::getProgramInput() {
-  return _state.program_input;
+bool ATEM::checkMixEffect(uint8_t me) {
+  if (me < _state.mix_effect_count) {
+    return true;
+  }
+  ATEM_LOG(ATEM_LOG_WARN, "M/E %d does not exist on this switcher (%d M/E)", me + 1, _state.mix_effect_count);
+  return false;
 }
 
 /**
- * @brief Get current preview input number
- * @return uint16_t preview input ID (1=CAM1, 2=CAM2, 0=BLACK, etc.)
+ * @brief Check an upstream keyer index before encoding a keyer command
+ * @param me Mix effect index
+ * @param keyer Upstream keyer index within the M/E
+ * @return true if the M/E exists and has this keyer
+ * 
+ * The keyer count comes from the model's capabilities and is refined by _MeC
  */
-uint16_t ATEM::getPreviewInput() {
-  return _state.preview_input;
+bool ATEM::checkUpstreamKeyer(uint8_t me, uint8_t keyer) {
+  if (!checkMixEffect(me)) return false;
+  if (keyer < _state.upstream_keyer_count) {
+    return true;
+  }
+  ATEM_LOG(ATEM_LOG_WARN, "Upstream keyer %d does not exist on this switcher (%d per M/E)",
+           keyer + 1, _state.upstream_keyer_count);
+  return false;
 }
 
-// Control function stubs (to be implemented in future versions)
+/**
+ * @brief Check a bus, keyer, generator or player index before encoding a command
+ * @param id Command whose index field is checked
+ * @param index Index the caller passed
+ * @return true if the detected model has it, or the model is not known yet
+ */
+bool ATEM::checkIndex(ATEMCommandId id, uint8_t index) {
+  uint16_t count = atemCommandIndexCount(id, _capabilities);
+  if (index < count) {
+    return true;
+  }
+  ATEM_LOG(ATEM_LOG_WARN, "%s index %d does not exist on %s (%d available)",
+           atemCommandSpec(id).name, index, _capabilities->name, count);
+  return false;
+}
 
-// ===========================================
-// CONTROL FUNCTIONS - PHASE 2 IMPLEMENTATION  
-// ===========================================
+/**
+ * @brief Get the label of an input for display
+ * @param input Input ID
+ * @param short_name true for the 4-character label, false for the long name
+ * @return Label set on the switcher (InPr), or the built-in default name
+ * 
+ * Returns a pointer into the state store or to a constant string, so labels
+ * can be drawn every frame without formatting or copying
+ */
+const char* ATEM::getInputLabel(uint16_t input, bool short_name) const {
+  const ATEMInputProperties* properties = atemStateFindInput(_state, input);
+  if (properties) {
+    const char* label = short_name ? properties->short_name : properties->long_name;
+    if (label[0]) {
+      return label;
+    }
+  }
+  return short_name ? getInputName(input) : getInputDescription(input);
+}
 
-// ✅ BASIC SWITCHING (1/4 COMPLETE)
+/**
+ * @brief Check an input ID against the detected model before sending it
+ * @param input Input ID
+ * @return true if valid or the model is not known yet
+ */
+bool ATEM::checkInput(uint16_t input) {
+  if (isValidInput(input)) {
+    return true;
+  }
+  ATEM_LOG(ATEM_LOG_WARN, "Input %d is not available on %s", input, _capabilities->name);
+  return false;
+}
 
 /**
- * @brief Change program input on ATEM switcher ✅ WORKING!
- * @param input Input ID to switch to program (1=CAM1, 2=CAM2, etc.)
- * 
- * Sends CPgI command to change program input
- * Uses same packet structure as CPvI but with "CPgI" command name
+ * @brief Get the state of an M/E reported by the switcher
+ * @param me M/E index from the command payload
+ * @return Entry in the state store, or nullptr if the model has no such M/E
  */
-void ATEM::changeProgramInput(uint16_t input) {
-  if (_connection_state != ATEM_CONNECTED) {
-    logPrintf(ATEM_LOG_WARN, "Cannot change program input: ATEM not connected");
-    return;
+ATEMMixEffectState* ATEM::mixEffectState(uint8_t me) {
+  if (me >= _state.mix_effect_count) {
+    ATEM_LOG(ATEM_LOG_VERBOSE, "Ignoring update for M/E %d (model has %d)", me + 1, _state.mix_effect_count);
+    return nullptr;
   }
-  
-  // ATEM CPgI (Change Program Input) command structure:
-  // Header: 12 bytes  
-  // Command: 4 bytes length + 4 bytes "CPgI" + 4 bytes data = 12 bytes
-  // Total: 24 bytes (12 header + 12 command section)
-  
-  const int command_length = 24;
-  
-  uint8_t packet[command_length] = {0};
-  
-  // Build packet header (identical to CPvI)
-  uint16_t opcode = (FLAG_ACK_REQUEST << 11);  // AckRequest flag
-  uint16_t length = command_length;
-  
-  // Opcode and length in first 2 bytes (big-endian)
-  packet[0] = (opcode | length) >> 8;
-  packet[1] = (opcode | length) & 0xFF;
-  
-  // Session ID in bytes 2-3 (big-endian)
-  packet[2] = (_session_id >> 8) & 0xFF;
-  packet[3] = _session_id & 0xFF;
-  
-  // Local packet ID in bytes 10-11 (big-endian)
-  packet[10] = (_local_packet_id >> 8) & 0xFF;
-  packet[11] = _local_packet_id & 0xFF;
-  
-  // Command data starts at byte 12
-  // Command length (12 bytes total for command)
-  packet[12] = 0x00;
-  packet[13] = 0x0C;  // 12 bytes total for command
-  packet[14] = 0x00;
-  packet[15] = 0x00;
-  
-  // Command name "CPgI" (Change Program Input) - ONLY DIFFERENCE FROM CPvI!
-  packet[16] = 'C';
-  packet[17] = 'P';
-  packet[18] = 'g';  // 'g' for program vs 'v' for preview
-  packet[19] = 'I';
-  
-  // Input number (4 bytes, big-endian) - Same as CPvI format
-  packet[20] = 0x00;
-  packet[21] = 0x00;
-  packet[22] = (input >> 8) & 0xFF;  // Upper byte of input value
-  packet[23] = input & 0xFF;         // Lower byte of input value
-  
-  // Store packet for potential retransmission
-  storePacketForRetransmission(_local_packet_id, packet, command_length);
-  
-  // Send the packet
-  _udp.beginPacket(_switcher_ip, ATEM_PORT);
-  _udp.write(packet, command_length);
-  bool success = _udp.endPacket();
-  
-  // Log the command
-  printSofieFormat("SEND", packet, command_length);
-  
-  // Force debug output (temporary)
-  Serial.print("ℹ️  ESP32 CPgI packet: ");
-  for (int i = 0; i < command_length; i++) {
-    if (packet[i] < 0x10) Serial.print("0");
-    Serial.print(packet[i], HEX);
+  return &_state.mix_effects[me];
+}
+
+/**
+ * @brief Set the program or preview input of an M/E and report the change
+ * @param field ATEM_SPECULATED_PROGRAM or ATEM_SPECULATED_PREVIEW
+ * @param me M/E index (already checked)
+ * @param input New input ID
+ * @param event_flags ATEM_EVENT_FLAG_* bits for the callback
+ * @return true if the value changed
+ * 
+ * Marks ATEM_STATE_CHANGED_PROGRAM/PREVIEW, keeps the M/E 1 summary fields in
+ * step and triggers onMixEffectProgramChanged()/onMixEffectPreviewChanged()
+ */
+bool ATEM::applyMixEffectInput(ATEMSpeculatedField field, uint8_t me, uint16_t input, uint8_t event_flags) {
+  bool program = field == ATEM_SPECULATED_PROGRAM;
+  uint16_t& current = program ? _state.mix_effects[me].program_input : _state.mix_effects[me].preview_input;
+  if (current == input) {
+    return false;
   }
-  Serial.println();
+  current = input;
+  markStateChanged(program ? ATEM_STATE_CHANGED_PROGRAM : ATEM_STATE_CHANGED_PREVIEW, me);
   
-  if (success) {
-    logPrintf(ATEM_LOG_INFO, "Sent CPgI command: program input %d", input);
-    _local_packet_id++;
-  } else {
-    logPrintf(ATEM_LOG_ERROR, "Failed to send CPgI command");
+  if (me == 0) {
+    (program ? _state.program_input : _state.preview_input) = input;
   }
+  notify(program ? ATEM_EVENT_PROGRAM_INPUT : ATEM_EVENT_PREVIEW_INPUT, me, input, event_flags);
+  return true;
 }
 
+// ===========================================
+// OPTIMISTIC UPDATES
+// ===========================================
+
 /**
- * @brief Change preview input on ATEM switcher ✅ WORKING!
+ * @brief Show the expected result of a switching command before it is confirmed
+ * @param field ATEM_SPECULATED_PROGRAM or ATEM_SPECULATED_PREVIEW
+ * @param me M/E index (already checked)
+ * @param input Input the command selects
  * 
- * Sends CPvI command to change preview input
- * @param input Input ID to switch to preview (1=CAM1, 2=CAM2, etc.)
+ * The first speculation on a field remembers the value the switcher reported;
+ * later ones only move the expected value and the packet to wait for. Nothing
+ * is recorded if the field already shows the input.
+ * 
+ * The packet to wait for is the one flushCommands() sent the command in. If the
+ * command is still in _tx_buffer (batch or sequence frame), its packet ID is
+ * not known yet - a heartbeat or an overflow flush can take the current one -
+ * so flushCommands() fills it in when the packet goes out.
  */
-void ATEM::changePreviewInput(uint16_t input) {
-  if (_connection_state != ATEM_CONNECTED) {
-    logPrintf(ATEM_LOG_WARN, "Cannot change preview input: ATEM not connected");
+void ATEM::speculate(ATEMSpeculatedField field, uint8_t me, uint16_t input) {
+  if (!_optimistic || _task_mode || _connection_state != ATEM_CONNECTED) {
     return;
   }
   
-  // ATEM CPvI (Change Preview Input) command structure:
-  // Header: 12 bytes
-  // Command: 4 bytes length + 4 bytes "CPvI" + 4 bytes data = 12 bytes
-  // Total: 24 bytes (12 header + 12 command section)
-  
-  const int command_length = 24;
-  
-  uint8_t packet[command_length] = {0};
-  
-  // Build packet header (similar to heartbeat but with data)
-  uint16_t opcode = (FLAG_ACK_REQUEST << 11);  // AckRequest flag
-  uint16_t length = command_length;
-  
-  // Opcode and length in first 2 bytes (big-endian)
-  packet[0] = (opcode | length) >> 8;
-  packet[1] = (opcode | length) & 0xFF;
-  
-  // Session ID in bytes 2-3 (big-endian)
-  packet[2] = (_session_id >> 8) & 0xFF;
-  packet[3] = _session_id & 0xFF;
-  
-  // Local packet ID in bytes 10-11 (big-endian)
-  packet[10] = (_local_packet_id >> 8) & 0xFF;
-  packet[11] = _local_packet_id & 0xFF;
-  
-  // Command data starts at byte 12
-  // Command length (4 bytes for "CPvI" + 8 bytes data = 12 bytes total) - FIXED!
-  packet[12] = 0x00;
-  packet[13] = 0x0C;  // 12 bytes total for command (was 0x08 = 8 bytes)
-  packet[14] = 0x00;
-  packet[15] = 0x00;
-  
-  // Command name "CPvI" (Change Preview Input)
-  packet[16] = 'C';
-  packet[17] = 'P';
-  packet[18] = 'v';
-  packet[19] = 'I';
-  
-  // Input number (4 bytes, big-endian) - Sofie format uses 4 bytes, not 2!
-  // No conversion needed - use input as-is (1-4) like Sofie does
-  packet[20] = 0x00;
-  packet[21] = 0x00;
-  packet[22] = (input >> 8) & 0xFF;  // Upper byte of input value
-  packet[23] = input & 0xFF;         // Lower byte of input value
-  
-  // Store packet for potential retransmission
-  storePacketForRetransmission(_local_packet_id, packet, command_length);
-  
-  // Send the packet
-  _udp.beginPacket(_switcher_ip, ATEM_PORT);
-  _udp.write(packet, command_length);
-  bool success = _udp.endPacket();
-  
-  // Log the command
-  printSofieFormat("SEND", packet, command_length);
-  
-  // Force debug output regardless of log level (temporary)
-  Serial.print("ℹ️  ESP32 CPvI packet: ");
-  for (int i = 0; i < command_length; i++) {
-    if (packet[i] < 0x10) Serial.print("0");
-    Serial.print(packet[i], HEX);
-  }
-  Serial.println();
-  
-  if (success) {
-    logPrintf(ATEM_LOG_INFO, "Sent CPvI command: preview input %d", input);
-    _local_packet_id++;
-  } else {
-    logPrintf(ATEM_LOG_ERROR, "Failed to send CPvI command");
+  uint16_t current = field == ATEM_SPECULATED_PROGRAM ? _state.mix_effects[me].program_input
+                                                      : _state.mix_effects[me].preview_input;
+  ATEMSpeculations::Entry* entry = _speculations.find(me, field);
+  if (!entry) {
+    if (current == input) return;
+    entry = _speculations.add(me, field, current);
+    if (!entry) return;  // Cannot happen: one entry per M/E and field
   }
+  entry->value     = input;
+  entry->sent      = _tx_length <= HEADER_SIZE;  // Already flushed by commitCommand()
+  entry->packet_id = _command_packet_id;
+  entry->acked     = false;
+  entry->deadline  = millis() + ATEM_OPTIMISTIC_TIMEOUT;
+  
+  applyMixEffectInput(field, me, input, ATEM_EVENT_FLAG_SPECULATIVE);
+  armSpeculationTimer();
 }
 
 /**
- * @brief Perform CUT transition (immediate switch) ✅ IMPLEMENTED!
+ * @brief Match a received PrgI/PrvI against an open speculation
+ * @return true if the update was consumed; false to apply it normally
  * 
- * Sends DCut command to perform immediate transition from preview to program
- * This instantly cuts from the current preview input to program output
+ * The echo of the speculated value closes the entry without another callback.
+ * A different value received before our packet was acknowledged describes the
+ * switcher before the command and only replaces the confirmed value; after the
+ * ACK it means the switcher did not do what we expected, so roll back to it.
  */
-void ATEM::cut() {
-  if (_connection_state != ATEM_CONNECTED) {
-    logPrintf(ATEM_LOG_WARN, "Cannot perform CUT: ATEM not connected");
-    return;
+bool ATEM::reconcileSpeculation(ATEMSpeculatedField field, uint8_t me, uint16_t input) {
+  ATEMSpeculations::Entry* entry = _speculations.find(me, field);
+  if (!entry) {
+    return false;
   }
   
-  // ATEM DCut (Direct Cut) command structure:
-  // Header: 12 bytes
-  // Command: 4 bytes length + 4 bytes "DCut" + 4 bytes data = 12 bytes
-  // Total: 24 bytes (12 header + 12 command section)
-  
-  const int command_length = 24;
-  
-  uint8_t packet[command_length] = {0};
-  
-  // Build packet header (same pattern as CPvI/CPgI)
-  uint16_t opcode = (FLAG_ACK_REQUEST << 11);  // AckRequest flag
-  uint16_t length = command_length;
-  
-  // Opcode and length in first 2 bytes (big-endian)
-  packet[0] = (opcode | length) >> 8;
-  packet[1] = (opcode | length) & 0xFF;
-  
-  // Session ID in bytes 2-3 (big-endian)
-  packet[2] = (_session_id >> 8) & 0xFF;
-  packet[3] = _session_id & 0xFF;
-  
-  // Local packet ID in bytes 10-11 (big-endian)
-  packet[10] = (_local_packet_id >> 8) & 0xFF;
-  packet[11] = _local_packet_id & 0xFF;
+  if (input == entry->value) {
+    ATEMSpeculations::remove(*entry);
+    armSpeculationTimer();
+    return true;
+  }
   
-  // Command data starts at byte 12
-  // Command length (12 bytes total for command)
-  packet[12] = 0x00;
-  packet[13] = 0x0C;  // 12 bytes total for command
-  packet[14] = 0x00;
-  packet[15] = 0x00;
-  
-  // Command name "DCut" (Direct Cut)
-  packet[16] = 'D';
-  packet[17] = 'C';
-  packet[18] = 'u';
-  packet[19] = 't';
-  
-  // ME index (Mix Effect index) - 4 bytes, big-endian
-  // For ATEM Mini Pro, ME index is 0 (first/only Mix Effect)
-  packet[20] = 0x00;
-  packet[21] = 0x00;
-  packet[22] = 0x00;
-  packet[23] = 0x00;  // ME 0 (first Mix Effect)
-  
-  // Store packet for potential retransmission
-  storePacketForRetransmission(_local_packet_id, packet, command_length);
-  
-  // Send the packet
-  _udp.beginPacket(_switcher_ip, ATEM_PORT);
-  _udp.write(packet, command_length);
-  bool success = _udp.endPacket();
-  
-  // Log the command
-  printSofieFormat("SEND", packet, command_length);
-  
-  if (success) {
-    logPrintf(ATEM_LOG_INFO, "Sent DCut command: performed CUT transition");
-    _local_packet_id++;
+  entry->confirmed = input;
+  if (entry->acked) {
+    ATEM_LOG(ATEM_LOG_INFO, "Switcher reported %s input %d (M/E %d), not %d - rolling back",
+             field == ATEM_SPECULATED_PROGRAM ? "program" : "preview", input, me + 1, entry->value);
+    rollbackSpeculation(*entry);
+    armSpeculationTimer();
+  }
+  return true;
+}
+
+/**
+ * @brief Restore the confirmed value of a speculation and drop it
+ * The callback runs with isCorrection() true if the value actually changes
+ */
+void ATEM::rollbackSpeculation(ATEMSpeculations::Entry& entry) {
+  ATEMSpeculations::remove(entry);
+  if (entry.me < _state.mix_effect_count &&
+      applyMixEffectInput((ATEMSpeculatedField)entry.field, entry.me, entry.confirmed, ATEM_EVENT_FLAG_CORRECTION)) {
+    _rollbacks++;
+  }
+}
+
+/**
+ * @brief Roll back every open speculation (connection lost or closed)
+ */
+void ATEM::rollbackSpeculations() {
+  for (ATEMSpeculations::Entry* entry = _speculations.first(); entry; entry = _speculations.first()) {
+    rollbackSpeculation(*entry);
+  }
+  _timers.cancel(ATEM_TIMER_OPTIMISTIC);
+}
+
+/**
+ * @brief Arm ATEM_TIMER_OPTIMISTIC for the earliest speculation deadline
+ */
+void ATEM::armSpeculationTimer() {
+  unsigned long at = 0;
+  if (_speculations.nextDeadline(at)) {
+    _timers.arm(ATEM_TIMER_OPTIMISTIC, at);
   } else {
-    logPrintf(ATEM_LOG_ERROR, "Failed to send DCut command");
+    _timers.cancel(ATEM_TIMER_OPTIMISTIC);
   }
 }
 
+// ===========================================
+// STATE STORE HANDLERS
+// ===========================================
+// Payload layouts follow the Sofie ATEM Connection deserializers. Each handler
+// checks the payload length and the section index, writes the state store and
+// marks its ATEM_STATE_CHANGED_* group only when a value actually changed.
+
 /**
- * @brief Perform AUTO transition (fade/wipe effect) ✅ IMPLEMENTED!
+ * @brief Process Protocol Version (_ver)
+ * Payload: u16 major @0, u16 minor @2
+ */
+void ATEM::processVersion(const uint8_t* data, int length) {
+  if (length < 4) return;
+  
+  _protocol_major = (data[0] << 8) | data[1];
+  _protocol_minor = (data[2] << 8) | data[3];
+  ATEM_LOG(ATEM_LOG_INFO, "Switcher protocol version %d.%d", _protocol_major, _protocol_minor);
+}
+
+/**
+ * @brief Process Product Identifier (_pin)
+ * Payload: product name @0 (up to 40 chars, NUL padded), u8 model @40
  * 
- * Sends DAut command to perform automated transition from preview to program
- * Uses the currently configured transition type (fade, wipe, etc.) and duration
+ * Matches the name against ATEM_MODEL_PATTERNS once per connection and caches
+ * the capabilities, which size the state store until _top reports the exact
+ * topology
  */
-void ATEM::autoTransition() {
-  if (_connection_state != ATEM_CONNECTED) {
-    logPrintf(ATEM_LOG_WARN, "Cannot perform AUTO transition: ATEM not connected");
-    return;
+void ATEM::processProductId(const uint8_t* data, int length) {
+  int name_length = 0;
+  while (name_length < length && name_length < ATEM_PRODUCT_NAME_LENGTH && data[name_length]) {
+    name_length++;
   }
+  memcpy(_product_name, data, name_length);
+  _product_name[name_length] = '\0';
   
-  // ATEM DAut (Direct Auto) command structure:
-  // Header: 12 bytes
-  // Command: 4 bytes length + 4 bytes "DAut" + 4 bytes data = 12 bytes
-  // Total: 24 bytes (12 header + 12 command section)
+  _capabilities = getATEMCapabilities(detectATEMModel(_product_name));
+  if (_capabilities) {
+    ATEM_LOG(ATEM_LOG_INFO, "Detected %s (%s)", _capabilities->name, _product_name);
+  } else {
+    ATEM_LOG(ATEM_LOG_WARN, "Unknown switcher model: %s", _product_name);
+  }
   
-  const int command_length = 24;
+  if (atemStateConfigure(_state, _capabilities)) {
+    markStateChanged(ATEM_STATE_CHANGED_TOPOLOGY);
+  }
+  _tally.configure(_capabilities);
+}
+
+/**
+ * @brief Process Topology (_top)
+ * Payload: u8 M/Es @0, u8 sources @1, u8 downstream keyers @2, u8 aux @3,
+ * u8 mix-minus outputs @4, u8 media players @5 (later fields vary by version)
+ */
+void ATEM::processTopology(const uint8_t* data, int length) {
+  if (length < 6) return;
   
-  uint8_t packet[command_length] = {0};
+  uint8_t me    = atemStateLimit(data[0] ? data[0] : 1, ATEM_MAX_MIX_EFFECTS);
+  uint8_t dsk   = atemStateLimit(data[2], ATEM_MAX_DOWNSTREAM_KEYERS);
+  uint8_t aux   = atemStateLimit(data[3], ATEM_MAX_AUX_OUTPUTS);
+  uint8_t media = atemStateLimit(data[5], ATEM_MAX_MEDIA_PLAYERS);
   
-  // Build packet header (same pattern as DCut)
-  uint16_t opcode = (FLAG_ACK_REQUEST << 11);  // AckRequest flag
-  uint16_t length = command_length;
+  if (data[0] > ATEM_MAX_MIX_EFFECTS || data[3] > ATEM_MAX_AUX_OUTPUTS) {
+    ATEM_LOG(ATEM_LOG_WARN, "Switcher has %d M/E and %d AUX, state store is limited to %d/%d",
+             data[0], data[3], ATEM_MAX_MIX_EFFECTS, ATEM_MAX_AUX_OUTPUTS);
+  }
   
-  // Opcode and length in first 2 bytes (big-endian)
-  packet[0] = (opcode | length) >> 8;
-  packet[1] = (opcode | length) & 0xFF;
+  if (_state.mix_effect_count != me || _state.downstream_keyer_count != dsk ||
+      _state.aux_count != aux || _state.media_player_count != media) {
+    _state.mix_effect_count       = me;
+    _state.downstream_keyer_count = dsk;
+    _state.aux_count              = aux;
+    _state.media_player_count     = media;
+    markStateChanged(ATEM_STATE_CHANGED_TOPOLOGY);
+  }
+}
+
+/**
+ * @brief Process Mix Effect Block Config (_MeC)
+ * Payload: u8 M/E @0, u8 upstream keyers @1
+ */
+void ATEM::processMixEffectConfig(const uint8_t* data, int length) {
+  if (length < 2 || data[0] != 0) return;  // Every M/E of a model has the same keyer count
+  
+  uint8_t usk = atemStateLimit(data[1], ATEM_MAX_UPSTREAM_KEYERS);
+  if (_state.upstream_keyer_count != usk) {
+    _state.upstream_keyer_count = usk;
+    markStateChanged(ATEM_STATE_CHANGED_TOPOLOGY);
+  }
+}
+
+/**
+ * @brief Process Video Mode (VidM)
+ * Payload: u8 video mode @0
+ * The frame rate sets the sequence engine's frame grid
+ */
+void ATEM::processVideoMode(const uint8_t* data, int length) {
+  if (length < 1) return;
+  
+  uint16_t rate = atemVideoModeFrameRate(data[0]);
+  if (_state.video_mode != data[0] || _state.frame_rate_mhz != rate) {
+    _state.video_mode     = data[0];
+    _state.frame_rate_mhz = rate;
+    markStateChanged(ATEM_STATE_CHANGED_VIDEO_MODE);
+    
+    if (rate == 0) {
+      ATEM_LOG(ATEM_LOG_WARN, "Unknown video mode %d - sequences run at %d fps", data[0],
+               ATEM_SEQUENCE_FALLBACK_FRAME_RATE);
+    }
+  }
+}
+
+static_assert(ATEM_MAX_MIX_EFFECTS <= 8, "_transitions_started has one bit per M/E");
+
+/**
+ * @brief Process Transition Position (TrPs)
+ * Payload: u8 ME @0, u8 in transition @1, u8 frames remaining @2, u16 position @4
+ */
+void ATEM::processTransitionPosition(const uint8_t* data, int length) {
+  if (length < 6) return;
+  ATEMMixEffectState* me = mixEffectState(data[0]);
+  if (!me) return;
+  
+  bool in_transition = data[1] != 0;
+  uint16_t position  = (data[4] << 8) | data[5];
+  if (in_transition) {
+    _transitions_started |= 1 << data[0];  // For ATEM_SEQ_WAIT_TRANSITION
+  }
+  
+  if (me->in_transition != in_transition || me->transition_position != position ||
+      me->transition_frames_left != data[2]) {
+    me->in_transition          = in_transition;
+    me->transition_position    = position;
+    me->transition_frames_left = data[2];
+    markStateChanged(ATEM_STATE_CHANGED_TRANSITION, data[0]);
+    
+    if (data[0] == 0) {
+      _state.in_transition       = in_transition;
+      _state.transition_position = (uint8_t)(position / 100);
+    }
+  }
+}
+
+/**
+ * @brief Process Transition Settings (TrSS)
+ * Payload: u8 ME @0, u8 style @1, u8 next transition layers @2
+ */
+void ATEM::processTransitionProperties(const uint8_t* data, int length) {
+  if (length < 3) return;
+  ATEMMixEffectState* me = mixEffectState(data[0]);
+  if (!me) return;
+  
+  if (me->transition_style != data[1] || me->transition_next != data[2]) {
+    me->transition_style = data[1];
+    me->transition_next  = data[2];
+    markStateChanged(ATEM_STATE_CHANGED_TRANSITION_SETUP, data[0]);
+  }
+}
+
+/**
+ * @brief Process Transition Preview (TrPr)
+ * Payload: u8 ME @0, u8 preview enabled @1
+ */
+void ATEM::processTransitionPreview(const uint8_t* data, int length) {
+  if (length < 2) return;
+  ATEMMixEffectState* me = mixEffectState(data[0]);
+  if (!me) return;
+  
+  bool preview = data[1] != 0;
+  if (me->preview_transition != preview) {
+    me->preview_transition = preview;
+    markStateChanged(ATEM_STATE_CHANGED_TRANSITION_SETUP, data[0]);
+  }
+}
+
+/**
+ * @brief Process Upstream Keyer On Air (KeOn)
+ * Payload: u8 ME @0, u8 keyer @1, u8 on air @2
+ */
+void ATEM::processKeyerOnAir(const uint8_t* data, int length) {
+  if (length < 3) return;
+  ATEMMixEffectState* me = mixEffectState(data[0]);
+  if (!me || data[1] >= _state.upstream_keyer_count) return;
+  
+  uint8_t mask   = (uint8_t)(1 << data[1]);
+  uint8_t on_air = data[2] ? (me->keyers_on_air | mask) : (me->keyers_on_air & ~mask);
+  if (me->keyers_on_air != on_air) {
+    me->keyers_on_air = on_air;
+    markStateChanged(ATEM_STATE_CHANGED_UPSTREAM_KEYERS, data[0]);
+  }
+}
+
+/**
+ * @brief Process Downstream Keyer State (DskS)
+ * Payload: u8 key @0, u8 on air @1, u8 in transition @2, u8 auto transitioning @3,
+ * u8 frames remaining @4
+ */
+void ATEM::processDownstreamKeyerState(const uint8_t* data, int length) {
+  if (length < 5 || data[0] >= _state.downstream_keyer_count) return;
+  ATEMDownstreamKeyerState& dsk = _state.downstream_keyers[data[0]];
+  
+  bool on_air = data[1] != 0, in_transition = data[2] != 0, auto_transitioning = data[3] != 0;
+  if (dsk.on_air != on_air || dsk.in_transition != in_transition ||
+      dsk.auto_transitioning != auto_transitioning || dsk.frames_left != data[4]) {
+    dsk.on_air             = on_air;
+    dsk.in_transition      = in_transition;
+    dsk.auto_transitioning = auto_transitioning;
+    dsk.frames_left        = data[4];
+    markStateChanged(ATEM_STATE_CHANGED_DOWNSTREAM_KEYERS, data[0]);
+  }
+}
+
+/**
+ * @brief Process Downstream Keyer Properties (DskP)
+ * Payload: u8 key @0, u8 tie @1, u8 rate @2 (key settings follow and are not stored)
+ */
+void ATEM::processDownstreamKeyerProperties(const uint8_t* data, int length) {
+  if (length < 3 || data[0] >= _state.downstream_keyer_count) return;
+  ATEMDownstreamKeyerState& dsk = _state.downstream_keyers[data[0]];
+  
+  bool tie = data[1] != 0;
+  if (dsk.tie != tie || dsk.rate != data[2]) {
+    dsk.tie  = tie;
+    dsk.rate = data[2];
+    markStateChanged(ATEM_STATE_CHANGED_DOWNSTREAM_KEYERS, data[0]);
+  }
+}
+
+/**
+ * @brief Process Downstream Keyer Sources (DskB)
+ * Payload: u8 key @0, u16 fill source @2, u16 key source @4
+ */
+void ATEM::processDownstreamKeyerSources(const uint8_t* data, int length) {
+  if (length < 6 || data[0] >= _state.downstream_keyer_count) return;
+  ATEMDownstreamKeyerState& dsk = _state.downstream_keyers[data[0]];
+  
+  uint16_t fill = (data[2] << 8) | data[3];
+  uint16_t key  = (data[4] << 8) | data[5];
+  if (dsk.fill_source != fill || dsk.key_source != key) {
+    dsk.fill_source = fill;
+    dsk.key_source  = key;
+    markStateChanged(ATEM_STATE_CHANGED_DOWNSTREAM_KEYERS, data[0]);
+  }
+}
+
+/**
+ * @brief Process Fade To Black State (FtbS)
+ * Payload: u8 ME @0, u8 fully black @1, u8 in transition @2, u8 frames remaining @3
+ */
+void ATEM::processFadeToBlackState(const uint8_t* data, int length) {
+  if (length < 4) return;
+  ATEMMixEffectState* me = mixEffectState(data[0]);
+  if (!me) return;
+  
+  bool fully_black = data[1] != 0, in_transition = data[2] != 0;
+  if (in_transition) {
+    _transitions_started |= 1 << data[0];  // For ATEM_SEQ_WAIT_TRANSITION
+  }
+  if (me->ftb_fully_black != fully_black || me->ftb_in_transition != in_transition ||
+      me->ftb_frames_left != data[3]) {
+    me->ftb_fully_black   = fully_black;
+    me->ftb_in_transition = in_transition;
+    me->ftb_frames_left   = data[3];
+    markStateChanged(ATEM_STATE_CHANGED_FADE_TO_BLACK, data[0]);
+  }
+}
+
+/**
+ * @brief Process Fade To Black Properties (FtbP)
+ * Payload: u8 ME @0, u8 rate @1
+ */
+void ATEM::processFadeToBlackProperties(const uint8_t* data, int length) {
+  if (length < 2) return;
+  ATEMMixEffectState* me = mixEffectState(data[0]);
+  if (!me) return;
+  
+  if (me->ftb_rate != data[1]) {
+    me->ftb_rate = data[1];
+    markStateChanged(ATEM_STATE_CHANGED_FADE_TO_BLACK, data[0]);
+  }
+}
+
+/**
+ * @brief Process Aux Source (AuxS)
+ * Payload: u8 aux @0, u16 source @2
+ */
+void ATEM::processAuxSource(const uint8_t* data, int length) {
+  if (length < 4 || data[0] >= _state.aux_count) return;
+  
+  uint16_t source = (data[2] << 8) | data[3];
+  if (_state.aux_sources[data[0]] != source) {
+    _state.aux_sources[data[0]] = source;
+    markStateChanged(ATEM_STATE_CHANGED_AUX, data[0]);
+  }
+}
+
+/**
+ * @brief Process Media Player Source (MPCE)
+ * Payload: u8 player @0, u8 source type @1, u8 still index @2, u8 clip index @3
+ */
+void ATEM::processMediaPlayerSource(const uint8_t* data, int length) {
+  if (length < 4 || data[0] >= _state.media_player_count) return;
+  ATEMMediaPlayerState& player = _state.media_players[data[0]];
+  
+  if (player.source_type != data[1] || player.still_index != data[2] || player.clip_index != data[3]) {
+    player.source_type = data[1];
+    player.still_index = data[2];
+    player.clip_index  = data[3];
+    markStateChanged(ATEM_STATE_CHANGED_MEDIA_PLAYERS, data[0]);
+  }
+}
+
+/**
+ * @brief Process Input Properties (InPr)
+ * Payload: u16 input @0, char long name[20] @2, char short name[4] @22, ...,
+ * u8 internal port type @32, u8 source availability @34, u8 M/E availability @35
+ */
+void ATEM::processInputProperties(const uint8_t* data, int length) {
+  if (length < 36) return;
+  
+  uint16_t id = (data[0] << 8) | data[1];
+  uint8_t known = _state.input_count;
+  ATEMInputProperties* input = atemStateInputSlot(_state, id);
+  if (!input) {
+    ATEM_LOG(ATEM_LOG_DEBUG, "No room for input %d (ATEM_MAX_INPUTS = %d)", id, ATEM_MAX_INPUTS);
+    return;
+  }
+  
+  bool changed = _state.input_count != known;
+  changed |= atemStateCopyName(input->long_name, data + 2, ATEM_INPUT_LONG_NAME_LENGTH);
+  changed |= atemStateCopyName(input->short_name, data + 22, ATEM_INPUT_SHORT_NAME_LENGTH);
+  
+  if (changed || input->port_type != data[32] ||
+      input->availability != data[34] || input->me_availability != data[35]) {
+    input->port_type       = data[32];
+    input->availability    = data[34];
+    input->me_availability = data[35];
+    markStateChanged(ATEM_STATE_CHANGED_INPUTS, (uint8_t)(input - _state.inputs));
+  }
+}
+
+/**
+ * @brief Send heartbeat packet to maintain connection with ATEM
+ * 
+ * A heartbeat is a header-only reliable packet (12 bytes, AckRequest flag) sent
+ * through sendPacket(), so it carries the current session and local packet ID
+ * and is stored for retransmission like any command packet.
+ * 
+ * Must be sent every HEARTBEAT_INTERVAL ms to prevent timeout
+ */
+void ATEM::sendHeartbeat() {
+  uint8_t packet[HEADER_SIZE];
+  sendPacket(packet, HEADER_SIZE);
+  
+  ATEM_LOG(ATEM_LOG_DEBUG, "[T+%lums] Heartbeat sent", millis());
+}
+
+/**
+ * @brief Send acknowledgment packet for received reliable data
+ * @param packet_id ID of the packet being acknowledged
+ * 
+ * ACK packet structure (12 bytes):
+ * - Byte 0: 0x10 (ACK flag)
+ * - Bytes 1-2: 0x0C, 0x00 (Length = 12 bytes)
+ * - Byte 3: 0x00 (Unknown/padding)
+ * - Bytes 4-5: Session ID (big-endian)
+ * - Bytes 6-7: Packet ID being acknowledged (big-endian)
+ * - Bytes 8-9: 0x00 (Local packet ID not used for ACK)
+ * - Bytes 10-11: 0x00 (Unknown/padding)
+ * 
+ * Required for reliable packet delivery in ATEM protocol
+ */
+void ATEM::sendAck(uint16_t packet_id) {
+  // Build ACK packet exactly like Sofie ATEM Connection library
+  // Format: 800c [session_id] 0000 [acked_packet_id] 0000
+  uint8_t packet[HEADER_SIZE] = {0};
+  
+  // ACK flag (0x10) shifted to high 5 bits, with 12-byte length
+  packet[0] = 0x80;  // High 5 bits = 0x10 (AckReply flag), length = 0x0C (12 bytes)
+  packet[1] = 0x0C;
   
   // Session ID in bytes 2-3 (big-endian)
   packet[2] = (_session_id >> 8) & 0xFF;
   packet[3] = _session_id & 0xFF;
   
-  // Local packet ID in bytes 10-11 (big-endian)
-  packet[10] = (_local_packet_id >> 8) & 0xFF;
-  packet[11] = _local_packet_id & 0xFF;
+  // CRITICAL FIX: Acked packet ID goes in bytes 4-5 (big-endian), not 6-7!
+  packet[4] = (packet_id >> 8) & 0xFF;
+  packet[5] = packet_id & 0xFF;
   
-  // Command data starts at byte 12
-  // Command length (12 bytes total for command)
-  packet[12] = 0x00;
-  packet[13] = 0x0C;  // 12 bytes total for command
-  packet[14] = 0x00;
-  packet[15] = 0x00;
-  
-  // Command name "DAut" (Direct Auto)
-  packet[16] = 'D';
-  packet[17] = 'A';
-  packet[18] = 'u';
-  packet[19] = 't';
-  
-  // ME index (Mix Effect index) - 4 bytes, big-endian
-  // For ATEM Mini Pro, ME index is 0 (first/only Mix Effect)
-  packet[20] = 0x00;
-  packet[21] = 0x00;
-  packet[22] = 0x00;
-  packet[23] = 0x00;  // ME 0 (first Mix Effect)
-  
-  // Store packet for potential retransmission
-  storePacketForRetransmission(_local_packet_id, packet, command_length);
-  
-  // Send the packet
-  _udp.beginPacket(_switcher_ip, ATEM_PORT);
-  _udp.write(packet, command_length);
-  bool success = _udp.endPacket();
-  
-  // Log the command
-  printSofieFormat("SEND", packet, command_length);
-  
-  if (success) {
-    logPrintf(ATEM_LOG_INFO, "Sent DAut command: performed AUTO transition");
-    _local_packet_id++;
-  } else {
-    logPrintf(ATEM_LOG_ERROR, "Failed to send DAut command");
+  // Bytes 6-7 remain zero for ACK packets  
+  packet[6] = 0x00;
+  packet[7] = 0x00;
+  
+  // Bytes 8-11 remain zero for ACK packets
+  
+  sendDatagram(packet, HEADER_SIZE);
+  
+  // Log in Sofie format for comparison
+  ATEM_LOG_PACKET("SEND", packet, HEADER_SIZE);
+  
+  ATEM_LOG(ATEM_LOG_VERBOSE, "[T+%lums] ACK sent for packet %d with session ID 0x%04X",
+           millis(), packet_id, _session_id);
+  ATEM_LOG_HEX(ATEM_LOG_VERBOSE, "ACK", packet, HEADER_SIZE);
+}
+
+// State access functions
+
+/**
+ * @brief Get complete current ATEM state
+ * @return ATEMState struct containing program/preview inputs and transition status
+ * Returns a copy of the internal state structure, taken between two updates
+ * of the network task in task mode
+ */
+ATEMState ATEM::getState() {
+  ATEMState state;
+  readShared(_state_lock, &state, &_state, sizeof(state));
+  return state;
+}
+
+/**
+ * @brief Get current program input number
+ * @param me Mix effect index
+ * @return uint16_t program input ID (1=CAM1, 2=CAM2, 0=BLACK, etc.)
+ */
+uint16_t ATEM::getProgramInput(uint8_t me) {
+  return me < _state.mix_effect_count ? _state.mix_effects[me].program_input : 0;
+}
+
+/**
+ * @brief Get current preview input number
+ * @param me Mix effect index
+ * @return uint16_t preview input ID (1=CAM1, 2=CAM2, 0=BLACK, etc.)
+ */
+uint16_t ATEM::getPreviewInput(uint8_t me) {
+  return me < _state.mix_effect_count ? _state.mix_effects[me].preview_input : 0;
+}
+
+// ===========================================
+// CONTROL FUNCTIONS - PHASE 2 IMPLEMENTATION  
+// ===========================================
+// Every control method encodes its payload through beginCommand()/commitCommand()
+// (see ATEM_Commands.h for the command table). Payload layouts follow the Sofie
+// ATEM Connection serializers noted on each method. They return false when an
+// index or value is out of range for the connected model or the TX path is busy.
+
+// ✅ BASIC SWITCHING
+
+/**
+ * @brief Change program input on ATEM switcher ✅ WORKING!
+ * @param input Input ID to switch to program (1=CAM1, 2=CAM2, etc.)
+ * @param me Mix effect index
+ * 
+ * Sends CPgI command - payload: u8 ME index @0, u16 source @2
+ */
+bool ATEM::changeProgramInput(uint16_t input, uint8_t me) {
+  if (!checkMixEffect(me) || !checkInput(input)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_CPGI);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, me);
+  atemPutU16(payload, 2, input);
+  
+  if (commitCommand()) {
+    speculate(ATEM_SPECULATED_PROGRAM, me, input);
+    ATEM_LOG(ATEM_LOG_INFO, "Sent CPgI command: program input %d (M/E %d)", input, me + 1);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Change preview input on ATEM switcher ✅ WORKING!
+ * @param input Input ID to switch to preview (1=CAM1, 2=CAM2, etc.)
+ * @param me Mix effect index
+ * 
+ * Sends CPvI command - payload: u8 ME index @0, u16 source @2
+ */
+bool ATEM::changePreviewInput(uint16_t input, uint8_t me) {
+  if (!checkMixEffect(me) || !checkInput(input)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_CPVI);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, me);
+  atemPutU16(payload, 2, input);
+  
+  if (commitCommand()) {
+    speculate(ATEM_SPECULATED_PREVIEW, me, input);
+    ATEM_LOG(ATEM_LOG_INFO, "Sent CPvI command: preview input %d (M/E %d)", input, me + 1);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Perform CUT transition (immediate switch) ✅ IMPLEMENTED!
+ * @param me Mix effect index
+ * 
+ * Sends DCut command to perform immediate transition from preview to program
+ * Payload: u8 ME index @0
+ */
+bool ATEM::cut(uint8_t me) {
+  if (!checkMixEffect(me)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_DCUT);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, me);
+  
+  if (commitCommand()) {
+    // A cut swaps program and preview
+    uint16_t program = getProgramInput(me);
+    speculate(ATEM_SPECULATED_PROGRAM, me, getPreviewInput(me));
+    speculate(ATEM_SPECULATED_PREVIEW, me, program);
+    ATEM_LOG(ATEM_LOG_INFO, "Sent DCut command: performed CUT transition");
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Perform AUTO transition (fade/wipe effect) ✅ IMPLEMENTED!
+ * @param me Mix effect index
+ * 
+ * Sends DAut command to perform automated transition from preview to program
+ * Uses the currently configured transition type (fade, wipe, etc.) and duration
+ * Payload: u8 ME index @0
+ */
+bool ATEM::autoTransition(uint8_t me) {
+  if (!checkMixEffect(me)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_DAUT);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, me);
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent DAut command: performed AUTO transition");
+    return true;
+  }
+  return false;
+}
+
+// 🔄 ADVANCED SWITCHING
+
+/**
+ * @brief Fade to black or fade from black ✅ IMPLEMENTED!
+ * 
+ * Sends FtbA command to toggle fade to black state for specified Mix Effect
+ * Based on Sofie FadeToBlackAutoCommand - payload: u8 ME index @0
+ */
+bool ATEM::fadeToBlack(uint8_t me) {
+  if (!checkMixEffect(me)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_FTBA);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, me);
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent FtbA command: fade to black toggle for ME %d", me);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Set fade to black rate ✅ IMPLEMENTED!
+ * 
+ * Sends FtbC command to set fade to black rate for specified Mix Effect
+ * Based on Sofie FadeToBlackRateCommand - payload: u8 mask @0, u8 ME @1, u8 rate @2
+ */
+bool ATEM::setFadeToBlackRate(uint16_t rate, uint8_t me) {
+  if (!checkMixEffect(me)) return false;
+  if (rate > 0xFF) {
+    ATEM_LOG(ATEM_LOG_WARN, "Fade to black rate %d is above the 255 frame limit", rate);
+    return false;
+  }
+  uint8_t* payload = beginCommand(ATEM_CMD_FTBC);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, 0x01);   // Mask: rate
+  atemPutU8(payload, 1, me);
+  atemPutU8(payload, 2, rate);   // Rate in frames (8-bit on the wire)
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent FtbC command: set fade to black rate to %d frames for ME %d", rate, me);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Set transition position manually ✅ IMPLEMENTED!
+ * 
+ * Sends CTPs command to set transition position for specified Mix Effect
+ * Based on Sofie TransitionPositionCommand - payload: u8 ME @0, u16 position @2
+ * Paced per M/E, so it can be called for every T-bar sample
+ */
+bool ATEM::setTransitionPosition(uint16_t position, uint8_t me) {
+  if (!checkMixEffect(me)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_CTPS, true);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, me);
+  atemPutU16(payload, 2, position);
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent CTPs command: set transition position to %d for ME %d", position, me);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Enable/disable transition preview ✅ IMPLEMENTED!
+ * 
+ * Sends CTPr command to enable/disable transition preview for specified Mix Effect
+ * Based on Sofie PreviewTransitionCommand - payload: u8 ME @0, u8 preview @1
+ */
+bool ATEM::previewTransition(bool on, uint8_t me) {
+  if (!checkMixEffect(me)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_CTPR);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, me);
+  atemPutU8(payload, 1, on ? 1 : 0);
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent CTPr command: %s transition preview for ME %d", on ? "enabled" : "disabled", me);
+    return true;
+  }
+  return false;
+}
+
+// 🔄 AUX & DOWNSTREAM KEYS
+
+/**
+ * @brief Set AUX output source ✅ IMPLEMENTED!
+ * 
+ * Sends CAuS command - based on Sofie AuxSourceCommand
+ * Payload: u8 mask @0, u8 bus @1, u16 source @2
+ */
+bool ATEM::setAuxSource(uint16_t source, uint8_t bus) {
+  if (!checkIndex(ATEM_CMD_CAUS, bus)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_CAUS);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, 0x01);   // Mask: source
+  atemPutU8(payload, 1, bus);
+  atemPutU16(payload, 2, source);
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent CAuS command: AUX %d source %d", bus, source);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Set downstream key on air state ✅ IMPLEMENTED!
+ * 
+ * Sends CDsL command - based on Sofie DownstreamKeyOnAirCommand
+ * Payload: u8 key @0, u8 on air @1
+ */
+bool ATEM::setDownstreamKeyOnAir(bool onAir, uint8_t key) {
+  if (!checkIndex(ATEM_CMD_CDSL, key)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_CDSL);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, key);
+  atemPutU8(payload, 1, onAir ? 1 : 0);
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent CDsL command: DSK %d %s", key, onAir ? "on air" : "off air");
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Auto transition downstream key ✅ IMPLEMENTED!
+ * 
+ * Sends DDsA command - based on Sofie DownstreamKeyAutoCommand (protocol 8.0.1+
+ * layout, used by all current switchers)
+ * Payload: u8 mask @0, u8 key @1, u8 towards on air @2
+ */
+bool ATEM::autoDownstreamKey(uint8_t key, bool isTowardsOnAir) {
+  if (!checkIndex(ATEM_CMD_DDSA, key)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_DDSA);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, 0x01);   // Mask: direction
+  atemPutU8(payload, 1, key);
+  atemPutU8(payload, 2, isTowardsOnAir ? 1 : 0);
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent DDsA command: DSK %d auto towards %s", key, isTowardsOnAir ? "on air" : "off air");
+    return true;
+  }
+  return false;
+}
+
+// 🔄 UPSTREAM KEYS
+
+/**
+ * @brief Set upstream keyer on air state ✅ IMPLEMENTED!
+ * 
+ * Sends CKOn command - based on Sofie MixEffectKeyOnAirCommand
+ * Payload: u8 ME @0, u8 keyer @1, u8 on air @2
+ */
+bool ATEM::setUpstreamKeyerOnAir(bool onAir, uint8_t me, uint8_t keyer) {
+  if (!checkUpstreamKeyer(me, keyer)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_CKON);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, me);
+  atemPutU8(payload, 1, keyer);
+  atemPutU8(payload, 2, onAir ? 1 : 0);
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent CKOn command: ME %d keyer %d %s", me, keyer, onAir ? "on air" : "off air");
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Set upstream keyer cut source ✅ IMPLEMENTED!
+ * 
+ * Sends CKeC command - based on Sofie MixEffectKeyCutSourceSetCommand
+ * Payload: u8 ME @0, u8 keyer @1, u16 source @2
+ */
+bool ATEM::setUpstreamKeyerCutSource(uint16_t cutSource, uint8_t me, uint8_t keyer) {
+  if (!checkUpstreamKeyer(me, keyer)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_CKEC);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, me);
+  atemPutU8(payload, 1, keyer);
+  atemPutU16(payload, 2, cutSource);
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent CKeC command: ME %d keyer %d cut source %d", me, keyer, cutSource);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Set upstream keyer fill source ✅ IMPLEMENTED!
+ * 
+ * Sends CKeF command - based on Sofie MixEffectKeyFillSourceSetCommand
+ * Payload: u8 ME @0, u8 keyer @1, u16 source @2
+ */
+bool ATEM::setUpstreamKeyerFillSource(uint16_t fillSource, uint8_t me, uint8_t keyer) {
+  if (!checkUpstreamKeyer(me, keyer)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_CKEF);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, me);
+  atemPutU8(payload, 1, keyer);
+  atemPutU16(payload, 2, fillSource);
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent CKeF command: ME %d keyer %d fill source %d", me, keyer, fillSource);
+    return true;
+  }
+  return false;
+}
+
+// 🔄 MEDIA & SETTINGS
+
+/**
+ * @brief Set color generator color ✅ IMPLEMENTED!
+ * 
+ * Sends CClV command - based on Sofie ColorGeneratorCommand
+ * Payload: u8 mask @0, u8 index @1, u16 hue*10 @2, u16 saturation*1000 @4,
+ * u16 luma*1000 @6
+ */
+bool ATEM::setColorGeneratorColour(float hue, float saturation, float lightness, uint8_t index) {
+  if (!checkIndex(ATEM_CMD_CCLV, index)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_CCLV, true);
+  if (!payload) return false;
+  
+  hue        = constrain(hue, 0.0f, 359.9f);
+  saturation = constrain(saturation, 0.0f, 1.0f);
+  lightness  = constrain(lightness, 0.0f, 1.0f);
+  
+  atemPutU8(payload, 0, 0x07);   // Mask: hue | saturation | luma
+  atemPutU8(payload, 1, index);
+  atemPutU16(payload, 2, (uint16_t)(hue * 10.0f + 0.5f));
+  atemPutU16(payload, 4, (uint16_t)(saturation * 1000.0f + 0.5f));
+  atemPutU16(payload, 6, (uint16_t)(lightness * 1000.0f + 0.5f));
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent CClV command: color %d h=%.1f s=%.2f l=%.2f", index, hue, saturation, lightness);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Set media player source ✅ IMPLEMENTED!
+ * 
+ * Sends MPCS command - based on Sofie MediaPlayerSourceCommand
+ * Payload: u8 mask @0, u8 player @1, u8 source type @2, u8 still @3, u8 clip @4
+ * sourceIndex is written to the still or clip field depending on sourceType.
+ */
+bool ATEM::setMediaPlayerSource(uint8_t sourceType, uint8_t sourceIndex, uint8_t player) {
+  if (!checkIndex(ATEM_CMD_MPCS, player)) return false;
+  uint8_t* payload = beginCommand(ATEM_CMD_MPCS);
+  if (!payload) return false;
+  
+  bool is_clip = (sourceType == 2);
+  
+  atemPutU8(payload, 0, 0x01 | (is_clip ? 0x04 : 0x02));  // Mask: type + still or clip
+  atemPutU8(payload, 1, player);
+  atemPutU8(payload, 2, sourceType);
+  atemPutU8(payload, is_clip ? 4 : 3, sourceIndex);
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent MPCS command: media player %d %s %d", player, is_clip ? "clip" : "still", sourceIndex);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Set multiviewer window source ✅ IMPLEMENTED!
+ * 
+ * Sends CMvI command - based on Sofie MultiViewerSourceCommand
+ * Payload: u8 multiviewer @0, u8 window @1, u16 source @2
+ */
+bool ATEM::setMultiViewerWindowSource(uint16_t source, uint8_t mv, uint8_t window) {
+  if (!checkIndex(ATEM_CMD_CMVI, mv)) return false;
+  if (window >= ATEM_MAX_MULTIVIEWER_WINDOWS) {
+    ATEM_LOG(ATEM_LOG_WARN, "Multiviewer window %d does not exist (%d windows)", window, ATEM_MAX_MULTIVIEWER_WINDOWS);
+    return false;
+  }
+  uint8_t* payload = beginCommand(ATEM_CMD_CMVI);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, mv);
+  atemPutU8(payload, 1, window);
+  atemPutU16(payload, 2, source);
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent CMvI command: multiviewer %d window %d source %d", mv, window, source);
+    return true;
+  }
+  return false;
+}
+
+// 🔄 AUDIO (BASIC)
+
+/**
+ * @brief Set classic audio mixer input gain ✅ IMPLEMENTED!
+ * 
+ * Sends CAMI command (the classic mixer's input properties command) - based on
+ * Sofie AudioMixerInputCommand
+ * Payload: u8 mask @0, u16 input @2, u8 mix option @4, u16 gain @6, s16 balance @8
+ */
+bool ATEM::setClassicAudioMixerInputGain(uint16_t input, float gain) {
+  uint8_t* payload = beginCommand(ATEM_CMD_CAMI, true);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, 0x02);   // Mask: gain
+  atemPutU16(payload, 2, input);
+  atemPutU16(payload, 6, atemDecibelToGain(gain));
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent CAMI command: audio input %d gain %.1f dB", input, gain);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Set classic audio mixer master gain ✅ IMPLEMENTED!
+ * 
+ * Sends CAMM command (the classic mixer's master properties command) - based on
+ * Sofie AudioMixerMasterCommand
+ * Payload: u8 mask @0, u16 gain @2, s16 balance @4, u8 follow fade to black @6
+ */
+bool ATEM::setClassicAudioMixerMasterGain(float gain) {
+  uint8_t* payload = beginCommand(ATEM_CMD_CAMM);
+  if (!payload) return false;
+  
+  atemPutU8(payload, 0, 0x01);   // Mask: gain
+  atemPutU16(payload, 2, atemDecibelToGain(gain));
+  
+  if (commitCommand()) {
+    ATEM_LOG(ATEM_LOG_INFO, "Sent CAMM command: master gain %.1f dB", gain);
+    return true;
+  }
+  return false;
+}
+
+// Command encoding
+
+/**
+ * @brief Start a command batch
+ * 
+ * Control calls made until commitBatch() are packed into as few reliable
+ * packets as possible (up to ATEM_TX_BUFFER_SIZE bytes each) instead of one
+ * datagram per call. The switcher applies the commands of one packet in order.
+ */
+void ATEM::beginBatch() {
+  if (_batching) {
+    ATEM_LOG(ATEM_LOG_WARN, "beginBatch() called while a batch is already open");
+    return;
+  }
+  _batching = true;
+}
+
+/**
+ * @brief Send every command collected since beginBatch()
+ * @return true if all packets were sent (or handed to the network task)
+ */
+bool ATEM::commitBatch() {
+  if (!_batching) {
+    return true;
+  }
+  _batching = false;
+  
+  if (_command_staged) {
+    return pushStagedCommand(false);
+  }
+  bool sent = flushCommands();
+  servicePacedCommands();  // Held back while the batch was open
+  return sent;
+}
+
+/**
+ * @brief Check if a command batch is open
+ * @return true between beginBatch() and commitBatch()
+ */
+bool ATEM::isBatching() {
+  return _batching;
+}
+
+// ===========================================
+// SEQUENCES
+// ===========================================
+
+/**
+ * @brief Run a timed switching sequence
+ * @return false if not connected, the sequence is empty or the queue was full
+ */
+bool ATEM::runSequence(const ATEMSequenceStep* steps, uint16_t count) {
+  if (!steps || count == 0) {
+    ATEM_LOG(ATEM_LOG_WARN, "runSequence() called with an empty sequence");
+    return false;
+  }
+  if (_connection_state != ATEM_CONNECTED) {
+    ATEM_LOG(ATEM_LOG_WARN, "Cannot run sequence: ATEM not connected");
+    return false;
+  }
+  return requestSequence(steps, count);
+}
+
+/**
+ * @brief Stop the running sequence
+ */
+void ATEM::stopSequence() {
+  requestSequence(nullptr, 0);
+}
+
+/**
+ * @brief Start or stop a sequence in the network context
+ * @return false if the command queue was full
+ */
+bool ATEM::requestSequence(const ATEMSequenceStep* steps, uint16_t count) {
+  if (!shouldQueueCommand()) {
+    startSequence(steps, count);
+    return true;
+  }
+  
+  // Queued like a command, so it starts after the commands before it
+  static_assert(sizeof(steps) + sizeof(count) <= sizeof(QueuedCommand::payload), "Sequence request must fit a queue record");
+  if (_command_staged) {
+    pushStagedCommand(true);
+  }
+  _staged_command.id    = 0;
+  _staged_command.flags = QUEUED_COMMAND_SEQUENCE;
+  memcpy(_staged_command.payload, &steps, sizeof(steps));
+  memcpy(_staged_command.payload + sizeof(steps), &count, sizeof(count));
+  _command_staged = true;
+  
+  if (_batching) {
+    return true;
+  }
+  return pushStagedCommand(false);
+}
+
+/**
+ * @brief Start encoding a control command
+ * @param id Command to encode
+ * @return Zeroed payload to fill, or nullptr if the command cannot be sent
+ * 
+ * In direct mode the command block is appended straight into _tx_buffer. When
+ * called from the application while the network task runs, the payload is
+ * staged in a queue record instead and commitCommand() hands it to the task.
+ */
+uint8_t* ATEM::beginCommand(ATEMCommandId id, bool paced) {
+  paced = paced && _pacer.enabled() && !_batching && !_coalescing;  // A batch keeps its order
+  
+  if (shouldQueueCommand()) {
+    // Inside a batch the previous record is pushed only now, so the task can
+    // tell from the last record's flags where the batch ends
+    if (_command_staged) {
+      pushStagedCommand(true);
+    }
+    _staged_command.id    = id;
+    _staged_command.flags = paced ? QUEUED_COMMAND_PACED : 0;
+    memset(_staged_command.payload, 0, sizeof(_staged_command.payload));
+    _command_staged = true;
+    return _staged_command.payload;
+  }
+  
+  if (paced) {
+    if (_connection_state != ATEM_CONNECTED) {
+      ATEM_LOG(ATEM_LOG_WARN, "Cannot send %s: ATEM not connected", atemCommandSpec(id).name);
+      return nullptr;
+    }
+    _paced_command.id = id;
+    memset(_paced_command.payload, 0, sizeof(_paced_command.payload));
+    _paced_staged = true;
+    return _paced_command.payload;
+  }
+  
+  // Paced values given before this command go out first, in the same packet.
+  // A value held back for its ACK stays behind, so order is then only kept
+  // per parameter.
+  if (_pacer.pending() && appendPacedCommands() > 0) {
+    _pacer.ticked(micros());
+  }
+  return appendCommand(id);
+}
+
+/**
+ * @brief Finish the command started by beginCommand()
+ * @return true if the command was sent, batched or queued for the network task
+ */
+bool ATEM::commitCommand() {
+  if (_paced_staged) {
+    _paced_staged = false;
+    ATEMCommandId id = (ATEMCommandId)_paced_command.id;
+    if (_pacer.update(id, _paced_command.payload)) {
+      servicePacedCommands();
+      return true;
+    }
+    // Every slot busy: send this value as an ordinary command
+    if (appendPacedCommands() > 0) {
+      _pacer.ticked(micros());
+    }
+    uint8_t* payload = appendCommand(id);
+    if (!payload) return false;
+    memcpy(payload, _paced_command.payload, atemCommandSpec(id).payload_length);
+  } else if (_command_staged) {
+    if (_batching) {
+      return true;  // Pushed by the next beginCommand() or commitBatch()
+    }
+    return pushStagedCommand(false);
+  }
+  
+  if (_batching || _coalescing) {
+    return true;  // Sent by commitBatch() or serviceSequence()
+  }
+  return flushCommands();
+}
+
+/**
+ * @brief Hand the staged command record to the network task
+ * @param batch_continues More commands of the same batch follow
+ * @return false if the command queue was full
+ */
+bool ATEM::pushStagedCommand(bool batch_continues) {
+  _command_staged = false;
+  _staged_command.flags = (_staged_command.flags & (QUEUED_COMMAND_PACED | QUEUED_COMMAND_SEQUENCE)) |
+                          (batch_continues ? QUEUED_COMMAND_BATCH_CONTINUES : 0);
+  
+  if (!_command_queue.push(_staged_command)) {
+    ATEM_LOG(ATEM_LOG_WARN, "Command queue full - dropping %s", (_staged_command.flags & QUEUED_COMMAND_SEQUENCE) ?
+             "sequence request" : atemCommandSpec((ATEMCommandId)_staged_command.id).name);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Send the paced values that are due
+ * 
+ * Runs in the network context after a paced update, on ATEM_TIMER_PACING and
+ * when an ACK frees a parameter. Every value that is pending and has no packet
+ * in flight goes into one reliable packet. Skipped while a batch is being
+ * encoded in _tx_buffer; the next update, tick or ACK sends it.
+ */
+void ATEM::servicePacedCommands() {
+  if (_connection_state != ATEM_CONNECTED || _tx_length > 0 || !_pacer.pending()) {
+    return;
+  }
+  
+  uint32_t now_us = micros();
+  uint32_t wait_us = _pacer.usUntilTick(now_us);
+  if (wait_us > 0) {
+    _timers.arm(ATEM_TIMER_PACING, millis() + (wait_us + 999) / 1000);
+    return;
+  }
+  
+  uint8_t count = appendPacedCommands();
+  if (count == 0) {
+    return;  // Everything pending waits for an ACK
+  }
+  
+  flushCommands();
+  _pacer.ticked(now_us);
+  ATEM_LOG(ATEM_LOG_VERBOSE, "Sent %d paced value(s)", count);
+}
+
+/**
+ * @brief Append the paced values that can be sent now to _tx_buffer
+ * @return Number of values appended
+ * 
+ * A value whose parameter still has a packet in flight is left for the ACK.
+ */
+uint8_t ATEM::appendPacedCommands() {
+  uint8_t count = 0;
+  ATEMPacer::Slot* slot;
+  while ((slot = _pacer.nextReady()) != nullptr) {
+    ATEMCommandId id = (ATEMCommandId)slot->id;
+    uint8_t* payload = appendCommand(id);
+    if (!payload) break;
+    memcpy(payload, slot->payload, atemCommandSpec(id).payload_length);
+    _pacer.sent(*slot, _local_packet_id);  // Number of the packet flushCommands() sends
+    count++;
+  }
+  return count;
+}
+
+/**
+ * @brief Start a sequence (nullptr stops it); runs its first steps at once
+ */
+void ATEM::startSequence(const ATEMSequenceStep* steps, uint16_t count) {
+  if (!steps) {
+    if (_sequencer.running()) {
+      ATEM_LOG(ATEM_LOG_INFO, "Sequence stopped at step %d", _sequencer.step());
+    }
+    _sequencer.stop();
+    _timers.cancel(ATEM_TIMER_SEQUENCE);
+    return;
+  }
+  if (_connection_state != ATEM_CONNECTED) {
+    ATEM_LOG(ATEM_LOG_WARN, "Cannot run sequence: ATEM not connected");
+    return;
+  }
+  
+  _sequencer.start(steps, count, micros(), _state.frame_rate_mhz);
+  _transitions_started = 0;
+  ATEM_LOG(ATEM_LOG_INFO, "Sequence started (%d steps)", count);
+  serviceSequence();
+}
+
+/**
+ * @brief Run the sequence steps that are due
+ * 
+ * Runs in the network context when a sequence starts and on
+ * ATEM_TIMER_SEQUENCE. The timer only has millisecond resolution, so it is
+ * armed for the first millisecond at or after the step's frame; the frame
+ * itself is computed in microseconds by _sequencer and never drifts.
+ */
+void ATEM::serviceSequence() {
+  while (_sequencer.running()) {
+    uint32_t wait_us = _sequencer.usUntilDue(micros());
+    if (wait_us > 0) {
+      _timers.arm(ATEM_TIMER_SEQUENCE, millis() + (wait_us + 999) / 1000);
+      return;
+    }
+    _sequencer.setFrameRate(_state.frame_rate_mhz);
+    
+    // Everything up to the next wait goes out in one packet
+    _coalescing = true;
+    uint8_t steps = 0;
+    while (_sequencer.running()) {
+      const ATEMSequenceStep* step = _sequencer.current();
+      if (!step || step->op == ATEM_SEQ_END) {
+        ATEM_LOG(ATEM_LOG_INFO, "Sequence finished");
+        _sequencer.stop();
+        break;
+      }
+      if (!runSequenceStep(*step)) {
+        break;
+      }
+      if (++steps >= ATEM_SEQUENCE_MAX_STEPS_PER_FRAME) {
+        ATEM_LOG(ATEM_LOG_WARN, "Sequence ran %d steps without a wait - waiting a frame", steps);
+        _sequencer.waitFrames(1);
+        break;
+      }
+    }
+    _coalescing = false;
+    flushCommands();
+    servicePacedCommands();  // Held back while the steps were encoded
+  }
+}
+
+/**
+ * @brief Run one sequence step
+ * @return true to go on with the next step in this frame
+ */
+bool ATEM::runSequenceStep(const ATEMSequenceStep& step) {
+  switch (step.op) {
+    case ATEM_SEQ_PREVIEW:             changePreviewInput(step.value, step.index); break;
+    case ATEM_SEQ_PROGRAM:             changeProgramInput(step.value, step.index); break;
+    case ATEM_SEQ_CUT:                 cut(step.index); break;
+    case ATEM_SEQ_TRANSITION_POSITION: setTransitionPosition(step.value, step.index); break;
+    case ATEM_SEQ_AUX:                 setAuxSource(step.value, step.index); break;
+    case ATEM_SEQ_DSK_ON_AIR:          setDownstreamKeyOnAir(step.value != 0, step.index); break;
+    case ATEM_SEQ_DSK_AUTO:            autoDownstreamKey(step.index); break;
+    case ATEM_SEQ_USK_ON_AIR:          setUpstreamKeyerOnAir((step.value & 0xFF) != 0, step.index, step.value >> 8); break;
+    
+    case ATEM_SEQ_AUTO:
+    case ATEM_SEQ_FADE_TO_BLACK:
+      // A later ATEM_SEQ_WAIT_TRANSITION waits for this transition to start
+      if (step.index < ATEM_MAX_MIX_EFFECTS) {
+        _transitions_started &= ~(1 << step.index);
+      }
+      if (step.op == ATEM_SEQ_AUTO) {
+        autoTransition(step.index);
+      } else {
+        fadeToBlack(step.index);
+      }
+      break;
+      
+    case ATEM_SEQ_WAIT_FRAMES:
+      _sequencer.next();
+      _sequencer.waitFrames(step.value);
+      return step.value == 0;
+      
+    case ATEM_SEQ_WAIT_TRANSITION: {
+      // Done once the transition started and ended again; gives up if it has
+      // not started within the start frames (e.g. the command was refused)
+      const ATEMMixEffectState* me = mixEffectState(step.index);
+      uint16_t start_frames = step.value ? step.value : ATEM_SEQUENCE_TRANSITION_START_FRAMES;
+      bool done;
+      if (!me) {
+        done = true;
+      } else if (_transitions_started & (1 << step.index)) {
+        done = !me->in_transition && !me->ftb_in_transition;
+      } else {
+        done = _sequencer.waitedFrames() >= start_frames;
+      }
+      if (done) {
+        _sequencer.next();
+        return true;
+      }
+      _sequencer.waitedFrame();
+      _sequencer.waitFrames(1);
+      return false;
+    }
+    
+    case ATEM_SEQ_GOTO:
+      _sequencer.jump(step.value);
+      return true;
+      
+    default:
+      ATEM_LOG(ATEM_LOG_WARN, "Unknown sequence step %d at %d - skipped", step.op, _sequencer.step());
+      break;
   }
+  _sequencer.next();
+  return true;
 }
 
-// 🔄 ADVANCED SWITCHING
-
 /**
- * @brief Fade to black or fade from black ✅ IMPLEMENTED!
- * 
- * Sends FtbA command to toggle fade to black state for specified Mix Effect
- * Based on Sofie ATEM Connection library FadeToBlackAutoCommand
+ * @brief Append a command block to the packet in _tx_buffer
+ * @param id Command to encode
+ * @return Zeroed payload to fill, or nullptr if not connected
+ * Sends the pending packet first if the new block would not fit
  */
-void ATEM::fadeToBlack(uint8_t me) {
+uint8_t* ATEM::appendCommand(ATEMCommandId id) {
   if (_connection_state != ATEM_CONNECTED) {
-    logPrintf(ATEM_LOG_WARN, "Cannot perform fade to black: ATEM not connected");
-    return;
+    ATEM_LOG(ATEM_LOG_WARN, "Cannot send %s: ATEM not connected", atemCommandSpec(id).name);
+    return nullptr;
   }
   
-  // ATEM FtbA (Fade to Black Auto) command structure:
-  // Header: 12 bytes
-  // Command: 4 bytes length + 4 bytes "FtbA" + 4 bytes data = 12 bytes
-  // Total: 24 bytes (12 header + 12 command section)
-  
-  const int command_length = 24;
-  
-  uint8_t packet[command_length] = {0};
-  
-  // Build packet header (same pattern as DCut/DAut)
-  uint16_t opcode = (FLAG_ACK_REQUEST << 11);  // AckRequest flag
-  uint16_t length = command_length;
-  
-  // Opcode and length in first 2 bytes (big-endian)
-  packet[0] = (opcode | length) >> 8;
-  packet[1] = (opcode | length) & 0xFF;
-  
-  // Session ID in bytes 2-3 (big-endian)
-  packet[2] = (_session_id >> 8) & 0xFF;
-  packet[3] = _session_id & 0xFF;
-  
-  // Local packet ID in bytes 10-11 (big-endian)
-  packet[10] = (_local_packet_id >> 8) & 0xFF;
-  packet[11] = _local_packet_id & 0xFF;
-  
-  // Command data starts at byte 12
-  // Command length (12 bytes total for command)
-  packet[12] = 0x00;
-  packet[13] = 0x0C;  // 12 bytes total for command
-  packet[14] = 0x00;
-  packet[15] = 0x00;
-  
-  // Command name "FtbA" (Fade to Black Auto)
-  packet[16] = 'F';
-  packet[17] = 't';
-  packet[18] = 'b';
-  packet[19] = 'A';
-  
-  // ME index (Mix Effect index) - 4 bytes, big-endian
-  // Based on Sofie: buffer.writeUInt8(this.mixEffect, 0); (first byte is ME index)
-  packet[20] = me;
-  packet[21] = 0x00;
-  packet[22] = 0x00;
-  packet[23] = 0x00;
-  
-  // Store packet for potential retransmission
-  storePacketForRetransmission(_local_packet_id, packet, command_length);
-  
-  // Send the packet
-  _udp.beginPacket(_switcher_ip, ATEM_PORT);
-  _udp.write(packet, command_length);
-  bool success = _udp.endPacket();
-  
-  // Log the command
-  printSofieFormat("SEND", packet, command_length);
-  
-  if (success) {
-    logPrintf(ATEM_LOG_INFO, "Sent FtbA command: fade to black toggle for ME %d", me);
-    _local_packet_id++;
-  } else {
-    logPrintf(ATEM_LOG_ERROR, "Failed to send FtbA command");
+  uint16_t block_size = atemCommandBlockSize(id);
+  if (_tx_length + block_size > ATEM_TX_BUFFER_SIZE) {
+    flushCommands();
   }
+  if (_tx_length == 0) {
+    _tx_length = HEADER_SIZE;
+  }
+  
+  uint8_t* payload = atemWriteCommandHeader(_tx_buffer + _tx_length, id);
+  _tx_length += block_size;
+  _tx_count++;
+  ATEM_METRIC(
+    _command_sent_us[id] = micros();
+    _commands_awaiting |= (uint32_t)1 << id;
+  );
+  return payload;
 }
 
 /**
- * @brief Set fade to black rate ✅ IMPLEMENTED!
- * 
- * Sends FtbC command to set fade to black rate for specified Mix Effect
- * Based on Sofie ATEM Connection library FadeToBlackRateCommand
+ * @brief Send the commands collected in _tx_buffer as one reliable packet
+ * @return true if nothing was pending or the packet was sent
  */
-void ATEM::setFadeToBlackRate(uint16_t rate, uint8_t me) {
-  if (_connection_state != ATEM_CONNECTED) {
-    logPrintf(ATEM_LOG_WARN, "Cannot set fade to black rate: ATEM not connected");
-    return;
+bool ATEM::flushCommands() {
+  if (_tx_length <= HEADER_SIZE) {
+    _tx_length = 0;
+    _tx_count = 0;
+    return true;
   }
   
-  // ATEM FtbC (Fade to Black Rate Change) command structure:
-  // Header: 12 bytes
-  // Command: 4 bytes length + 4 bytes "FtbC" + 4 bytes data = 12 bytes
-  // Total: 24 bytes (12 header + 12 command section)
-  
-  const int command_length = 24;
+  uint16_t length = _tx_length;
+  uint8_t count = _tx_count;
+  _tx_length = 0;
+  _tx_count = 0;
   
-  uint8_t packet[command_length] = {0};
+  // The packet is stored for retransmission even if the write fails, so the
+  // commands in it are on their way either way
+  _command_packet_id = _local_packet_id;
+  bool sent = sendPacket(_tx_buffer, length);
+  _speculations.sentIn(_command_packet_id);
   
-  // Build packet header (same pattern as other commands)
-  uint16_t opcode = (FLAG_ACK_REQUEST << 11);  // AckRequest flag
-  uint16_t length = command_length;
-  
-  // Opcode and length in first 2 bytes (big-endian)
-  packet[0] = (opcode | length) >> 8;
-  packet[1] = (opcode | length) & 0xFF;
-  
-  // Session ID in bytes 2-3 (big-endian)
-  packet[2] = (_session_id >> 8) & 0xFF;
-  packet[3] = _session_id & 0xFF;
-  
-  // Local packet ID in bytes 10-11 (big-endian)
-  packet[10] = (_local_packet_id >> 8) & 0xFF;
-  packet[11] = _local_packet_id & 0xFF;
+  if (!sent) {
+    ATEM_LOG(ATEM_LOG_ERROR, "Failed to send command packet (%d command(s), %d bytes)", count, length);
+    return false;
+  }
   
-  // Command data starts at byte 12
-  // Command length (12 bytes total for command)
-  packet[12] = 0x00;
-  packet[13] = 0x0C;  // 12 bytes total for command
-  packet[14] = 0x00;
-  packet[15] = 0x00;
-  
-  // Command name "FtbC" (Fade to Black Rate Change)
-  packet[16] = 'F';
-  packet[17] = 't';
-  packet[18] = 'b';
-  packet[19] = 'C';
-  
-  // Command data (4 bytes) - Based on Sofie:
-  // buffer.writeUInt8(1, 0);                    // Mask field
-  // buffer.writeUInt8(this.mixEffect, 1);       // ME index
-  // buffer.writeUInt8(this.properties.rate, 2); // Rate value
-  packet[20] = 0x01;  // Mask: 1 = rate field is being set
-  packet[21] = me;    // ME index
-  packet[22] = rate & 0xFF;  // Rate (in frames) - lower 8 bits
-  packet[23] = 0x00;  // Reserved/padding
-  
-  // Store packet for potential retransmission
-  storePacketForRetransmission(_local_packet_id, packet, command_length);
-  
-  // Send the packet
-  _udp.beginPacket(_switcher_ip, ATEM_PORT);
-  _udp.write(packet, command_length);
-  bool success = _udp.endPacket();
-  
-  // Log the command
-  printSofieFormat("SEND", packet, command_length);
-  
-  if (success) {
-    logPrintf(ATEM_LOG_INFO, "Sent FtbC command: set fade to black rate to %d frames for ME %d", rate, me);
-    _local_packet_id++;
-  } else {
-    logPrintf(ATEM_LOG_ERROR, "Failed to send FtbC command");
+  if (count > 1) {
+    ATEM_LOG(ATEM_LOG_DEBUG, "Sent %d commands in one %d-byte packet", count, length);
   }
+  return true;
 }
 
 /**
- * @brief Set transition position manually ✅ IMPLEMENTED!
+ * @brief Send a reliable packet to the switcher
+ * @param packet Packet buffer; the 12-byte header is filled in here
+ * @param length Total packet length including the header
+ * @return true if the UDP write succeeded
  * 
- * Sends CTPs command to set transition position for specified Mix Effect
- * Based on Sofie ATEM Connection library TransitionPositionCommand
+ * Writes the AckRequest header with the current session and local packet ID,
+ * stores the packet for retransmission and advances the packet ID. The ID
+ * advances even when the UDP write fails: the packet is already stored and
+ * will be resent if the switcher asks for it.
  */
-void ATEM::setTransitionPosition(uint16_t position, uint8_t me) {
-  if (_connection_state != ATEM_CONNECTED) {
-    logPrintf(ATEM_LOG_WARN, "Cannot set transition position: ATEM not connected");
-    return;
-  }
-  
-  // ATEM CTPs (Change Transition Position) command structure:
-  // Header: 12 bytes
-  // Command: 4 bytes length + 4 bytes "CTPs" + 4 bytes data = 12 bytes
-  // Total: 24 bytes (12 header + 12 command section)
-  
-  const int command_length = 24;
-  
-  uint8_t packet[command_length] = {0};
-  
-  // Build packet header (same pattern as other commands)
-  uint16_t opcode = (FLAG_ACK_REQUEST << 11);  // AckRequest flag
-  uint16_t length = command_length;
+bool ATEM::sendPacket(uint8_t* packet, uint16_t length) {
+  uint16_t opcode = (FLAG_ACK_REQUEST << 11);
   
-  // Opcode and length in first 2 bytes (big-endian)
+  // Flags and length in bytes 0-1, session ID in bytes 2-3 (big-endian)
   packet[0] = (opcode | length) >> 8;
   packet[1] = (opcode | length) & 0xFF;
-  
-  // Session ID in bytes 2-3 (big-endian)
   packet[2] = (_session_id >> 8) & 0xFF;
   packet[3] = _session_id & 0xFF;
   
+  // Bytes 4-9 (ack / retransmit fields) are unused on outgoing data packets
+  memset(packet + 4, 0, 6);
+  
   // Local packet ID in bytes 10-11 (big-endian)
   packet[10] = (_local_packet_id >> 8) & 0xFF;
   packet[11] = _local_packet_id & 0xFF;
   
-  // Command data starts at byte 12
-  // Command length (12 bytes total for command)
-  packet[12] = 0x00;
-  packet[13] = 0x0C;  // 12 bytes total for command
-  packet[14] = 0x00;
-  packet[15] = 0x00;
-  
-  // Command name "CTPs" (Change Transition Position)
-  packet[16] = 'C';
-  packet[17] = 'T';
-  packet[18] = 'P';
-  packet[19] = 's';
-  
-  // Command data (4 bytes) - Based on Sofie:
-  // buffer.writeUInt8(this.mixEffect, 0);                // ME index
-  // buffer.writeUInt16BE(this.properties.handlePosition, 2); // Position (big-endian)
-  packet[20] = me;                        // ME index
-  packet[21] = 0x00;                      // Reserved
-  packet[22] = (position >> 8) & 0xFF;    // Position high byte
-  packet[23] = position & 0xFF;           // Position low byte
-  
-  // Store packet for potential retransmission
-  storePacketForRetransmission(_local_packet_id, packet, command_length);
-  
-  // Send the packet
-  _udp.beginPacket(_switcher_ip, ATEM_PORT);
-  _udp.write(packet, command_length);
-  bool success = _udp.endPacket();
-  
-  // Log the command
-  printSofieFormat("SEND", packet, command_length);
-  
-  if (success) {
-    logPrintf(ATEM_LOG_INFO, "Sent CTPs command: set transition position to %d for ME %d", position, me);
-    _local_packet_id++;
-  } else {
-    logPrintf(ATEM_LOG_ERROR, "Failed to send CTPs command");
-  }
-}
-
-/**
- * @brief Enable/disable transition preview ✅ IMPLEMENTED!
- * 
- * Sends CTPr command to enable/disable transition preview for specified Mix Effect
- * Based on Sofie ATEM Connection library PreviewTransitionCommand
- */
-void ATEM::previewTransition(bool on, uint8_t me) {
-  if (_connection_state != ATEM_CONNECTED) {
-    logPrintf(ATEM_LOG_WARN, "Cannot set transition preview: ATEM not connected");
-    return;
-  }
-  
-  // ATEM CTPr (Change Transition Preview) command structure:
-  // Header: 12 bytes
-  // Command: 4 bytes length + 4 bytes "CTPr" + 4 bytes data = 12 bytes
-  // Total: 24 bytes (12 header + 12 command section)
+  storePacketForRetransmission(_local_packet_id, packet, length);
   
-  const int command_length = 24;
-  
-  uint8_t packet[command_length] = {0};
-  
-  // Build packet header (same pattern as other commands)
-  uint16_t opcode = (FLAG_ACK_REQUEST << 11);  // AckRequest flag
-  uint16_t length = command_length;
-  
-  // Opcode and length in first 2 bytes (big-endian)
-  packet[0] = (opcode | length) >> 8;
-  packet[1] = (opcode | length) & 0xFF;
+  ATEM_METRIC(
+    _metrics.tx_packets++;
+    if (!_ack_sample_pending) {
+      _ack_sample_id = _local_packet_id;
+      _ack_sample_us = micros();
+      _ack_sample_pending = true;
+    }
+  );
   
-  // Session ID in bytes 2-3 (big-endian)
-  packet[2] = (_session_id >> 8) & 0xFF;
-  packet[3] = _session_id & 0xFF;
+  bool success = sendDatagram(packet, length);
   
-  // Local packet ID in bytes 10-11 (big-endian)
-  packet[10] = (_local_packet_id >> 8) & 0xFF;
-  packet[11] = _local_packet_id & 0xFF;
+  ATEM_LOG_PACKET("SEND", packet, length);
   
-  // Command data starts at byte 12
-  // Command length (12 bytes total for command)
-  packet[12] = 0x00;
-  packet[13] = 0x0C;  // 12 bytes total for command
-  packet[14] = 0x00;
-  packet[15] = 0x00;
-  
-  // Command name "CTPr" (Change Transition Preview)
-  packet[16] = 'C';
-  packet[17] = 'T';
-  packet[18] = 'P';
-  packet[19] = 'r';
-  
-  // Command data (4 bytes) - Based on Sofie:
-  // buffer.writeUInt8(this.mixEffect, 0);                        // ME index
-  // buffer.writeUInt8(this.properties.preview ? 1 : 0, 1);      // Preview on/off
-  packet[20] = me;              // ME index
-  packet[21] = on ? 1 : 0;      // Preview enable (1) or disable (0)
-  packet[22] = 0x00;            // Reserved
-  packet[23] = 0x00;            // Reserved
-  
-  // Store packet for potential retransmission
-  storePacketForRetransmission(_local_packet_id, packet, command_length);
-  
-  // Send the packet
-  _udp.beginPacket(_switcher_ip, ATEM_PORT);
-  _udp.write(packet, command_length);
-  bool success = _udp.endPacket();
-  
-  // Log the command
-  printSofieFormat("SEND", packet, command_length);
-  
-  if (success) {
-    logPrintf(ATEM_LOG_INFO, "Sent CTPr command: %s transition preview for ME %d", on ? "enabled" : "disabled", me);
-    _local_packet_id++;
-  } else {
-    logPrintf(ATEM_LOG_ERROR, "Failed to send CTPr command");
-  }
+  _local_packet_id = atemNextPacketId(_local_packet_id);
+  return success;
 }
 
-// 🔄 AUX & DOWNSTREAM KEYS
+// Network task (optional FreeRTOS mode)
 
 /**
- * @brief Set AUX output source
- * TODO: Send CAuS command
+ * @brief Enable network task mode (must be called before begin())
+ * @param core CPU core to pin the task to (-1 = no affinity)
+ * @param priority FreeRTOS priority of the network task
+ * @param stack_size Task stack size in bytes
+ * @return true if task mode is available on this platform
  */
-void ATEM::setAuxSource(uint16_t source, uint8_t bus) {
-  logPrintf(ATEM_LOG_INFO, "setAuxSource(source=%d, bus=%d) - TODO: implement CAuS command", source, bus);
-  debugPrint("setAuxSource() - not implemented yet");
+bool ATEM::enableNetworkTask(int8_t core, uint8_t priority, uint32_t stack_size) {
+#if ATEM_HAS_NETWORK_TASK
+  if (_task_running) {
+    ATEM_LOG(ATEM_LOG_WARN, "enableNetworkTask() must be called before begin()");
+    return false;
+  }
+  _task_mode       = true;
+  _task_core       = core;
+  _task_priority   = priority;
+#if ATEM_STATIC_MEMORY
+  if (stack_size > ATEM_TASK_STACK_SIZE) {
+    ATEM_LOG(ATEM_LOG_WARN, "Task stack is fixed at ATEM_TASK_STACK_SIZE (%d bytes) with ATEM_STATIC_MEMORY",
+             ATEM_TASK_STACK_SIZE);
+    stack_size = ATEM_TASK_STACK_SIZE;
+  }
+#endif
+  _task_stack_size = stack_size;
+  return true;
+#else
+  ATEM_LOG(ATEM_LOG_WARN, "Network task mode requires FreeRTOS (ESP32) - using runLoop() polling");
+  return false;
+#endif
 }
 
 /**
- * @brief Set downstream key on air state
- * TODO: Send CDsL command
+ * @brief Check if the protocol runs in its own FreeRTOS task
+ * @return true while the network task is running
  */
-void ATEM::setDownstreamKeyOnAir(bool onAir, uint8_t key) {
-  logPrintf(ATEM_LOG_INFO, "setDownstreamKeyOnAir(onAir=%s, key=%d) - TODO: implement CDsL command", onAir ? "true" : "false", key);
-  debugPrint("setDownstreamKeyOnAir() - not implemented yet");
+bool ATEM::isNetworkTaskRunning() {
+  return _task_mode && _task_running;
 }
 
 /**
- * @brief Auto transition downstream key
- * TODO: Send DDsA command
+ * @brief Least free stack the network task has had since it started
+ * @return Bytes, 0 if the task is not running
  */
-void ATEM::autoDownstreamKey(uint8_t key, bool isTowardsOnAir) {
-  logPrintf(ATEM_LOG_INFO, "autoDownstreamKey(key=%d, towards=%s) - TODO: implement DDsA command", key, isTowardsOnAir ? "onAir" : "offAir");
-  debugPrint("autoDownstreamKey() - not implemented yet");
+uint32_t ATEM::getNetworkTaskStackHighWater() {
+#if ATEM_HAS_NETWORK_TASK
+  TaskHandle_t task = _task_handle;
+  if (task) {
+    return (uint32_t)uxTaskGetStackHighWaterMark(task) * sizeof(StackType_t);
+  }
+#endif
+  return 0;
 }
 
-// 🔄 UPSTREAM KEYS
+#if ATEM_HAS_NETWORK_TASK
+/**
+ * @brief Start the network task (task mode part of begin()/beginAsync())
+ * @return true if the task was created
+ */
+bool ATEM::startNetworkTask() {
+  // The network task performs the handshake and then services the connection
+  _task_running = true;
+  _task_active  = true;
+  BaseType_t core = (_task_core < 0 || _task_core >= portNUM_PROCESSORS) ? tskNO_AFFINITY : _task_core;
+#if ATEM_STATIC_MEMORY
+  _task_handle = xTaskCreateStaticPinnedToCore(networkTaskEntry, "atem_net", _task_stack_size, this,
+                                               _task_priority, _task_stack, &_task_control, core);
+  if (!_task_handle) {
+#else
+  if (xTaskCreatePinnedToCore(networkTaskEntry, "atem_net", _task_stack_size, this,
+                              _task_priority, &_task_handle, core) != pdPASS) {
+#endif
+    ATEM_LOG(ATEM_LOG_ERROR, "Failed to start ATEM network task");
+    _task_running = false;
+    _task_active  = false;
+    _task_handle = nullptr;
+    return false;
+  }
+  ATEM_LOG(ATEM_LOG_INFO, "ATEM network task started (core %d, priority %d, stack %d bytes)",
+           _task_core, _task_priority, _task_stack_size);
+  return true;
+}
 
 /**
- * @brief Set upstream keyer on air state
- * TODO: Send CKOn command
+ * @brief FreeRTOS entry point of the network task
+ * @param arg Pointer to the owning ATEM instance
+ * 
+ * Starts the handshake, then services the connection (including HELLO retries)
+ * every ATEM_TASK_PERIOD_MS until stopNetworkTask() clears _task_running.
+ * Control commands queued by the application are executed before each service
+ * pass so they go out promptly.
  */
-void ATEM::setUpstreamKeyerOnAir(bool onAir, uint8_t me, uint8_t keyer) {
-  logPrintf(ATEM_LOG_INFO, "setUpstreamKeyerOnAir(onAir=%s, me=%d, keyer=%d) - TODO: implement CKOn command", onAir ? "true" : "false", me, keyer);
-  debugPrint("setUpstreamKeyerOnAir() - not implemented yet");
+void ATEM::networkTaskEntry(void* arg) {
+  ATEM* self = static_cast<ATEM*>(arg);
+  // The creating call may not have stored the handle yet when the task starts
+  self->_task_handle = xTaskGetCurrentTaskHandle();
+  
+  self->startHandshake();
+  
+  while (self->_task_running) {
+    // Metrics change all through a pass, so copyMetrics() reads between passes
+    ATEM_METRIC(
+      self->_metrics_lock.beginWrite();
+      if (self->_metrics_reset_requested) {
+        self->_metrics_reset_requested = false;
+        self->resetMetrics();
+      }
+    );
+    self->executeQueuedCommands();
+    self->serviceConnection();
+    ATEM_METRIC(self->_metrics_lock.endWrite());
+    vTaskDelay(pdMS_TO_TICKS(ATEM_TASK_PERIOD_MS));
+  }
+  
+  // Events and commands go through the queues until this point, including
+  // those of the last pass after stopNetworkTask() cleared _task_running
+  self->_task_handle = nullptr;
+  self->_task_active = false;
+  vTaskDelete(nullptr);
 }
+#endif
 
 /**
- * @brief Set upstream keyer cut source
- * TODO: Send CKeC command
+ * @brief Stop the network task and wait for it to exit
+ * Safe to call when task mode is off or the task was never started
  */
-void ATEM::setUpstreamKeyerCutSource(uint16_t cutSource, uint8_t me, uint8_t keyer) {
-  logPrintf(ATEM_LOG_INFO, "setUpstreamKeyerCutSource(cutSource=%d, me=%d, keyer=%d) - TODO: implement CKeC command", cutSource, me, keyer);
-  debugPrint("setUpstreamKeyerCutSource() - not implemented yet");
+void ATEM::stopNetworkTask() {
+#if ATEM_HAS_NETWORK_TASK
+  if (!_task_running) {
+    return;
+  }
+  _task_running = false;
+  
+  // The task clears _task_active right before deleting itself
+  while (_task_active) {
+    vTaskDelay(pdMS_TO_TICKS(ATEM_TASK_PERIOD_MS));
+  }
+  _command_queue.clear();
+  dispatchEvents();
+#endif
 }
 
 /**
- * @brief Set upstream keyer fill source
- * TODO: Send CKeF command
+ * @brief Check whether a control call must be forwarded to the network task
+ * @return true when in task mode and called from outside the network task
  */
-void ATEM::setUpstreamKeyerFillSource(uint16_t fillSource, uint8_t me, uint8_t keyer) {
-  logPrintf(ATEM_LOG_INFO, "setUpstreamKeyerFillSource(fillSource=%d, me=%d, keyer=%d) - TODO: implement CKeF command", fillSource, me, keyer);
-  debugPrint("setUpstreamKeyerFillSource() - not implemented yet");
+bool ATEM::shouldQueueCommand() {
+#if ATEM_HAS_NETWORK_TASK
+  return _task_active && xTaskGetCurrentTaskHandle() != _task_handle;
+#else
+  return false;
+#endif
 }
 
-// 🔄 MEDIA & SETTINGS
+/**
+ * @brief Copy part of the state store, tally or metrics without tearing it
+ * @param lock _state_lock for _state and _tally, _metrics_lock for _metrics
+ * @param dest Destination
+ * @param src Member of _state, _tally, _published_changes or _metrics
+ * @param size Bytes to copy
+ * 
+ * Outside the network task the copy is repeated until no update ran during it.
+ * While an update is running the reader sleeps a tick, so a network task of
+ * lower priority on the same core can finish it.
+ */
+void ATEM::readShared(const ATEMSeqLock& lock, void* dest, const void* src, size_t size) {
+#if ATEM_HAS_NETWORK_TASK
+  if (shouldQueueCommand()) {
+    for (;;) {
+      uint32_t start = lock.readBegin();
+      if (start & 1) {
+        vTaskDelay(1);
+        continue;
+      }
+      memcpy(dest, src, size);
+      if (!lock.readRetry(start)) {
+        return;
+      }
+    }
+  }
+#endif
+  memcpy(dest, src, size);
+}
 
 /**
- * @brief Set color generator color
- * TODO: Send CClV command
+ * @brief Send all queued control commands (runs in the network task)
+ * Each record already holds the encoded payload. Everything queued since the
+ * last pass is coalesced into as few packets as possible; if the last record
+ * belongs to a batch that is still being queued, the packet stays open until
+ * the rest of the batch arrives. Paced records update _pacer instead.
  */
-void ATEM::setColorGeneratorColour(float hue, float saturation, float lightness, uint8_t index) {
-  logPrintf(ATEM_LOG_INFO, "setColorGeneratorColour(h=%.1f, s=%.2f, l=%.2f, idx=%d) - TODO: implement CClV command", hue, saturation, lightness, index);
-  debugPrint("setColorGeneratorColour() - not implemented yet");
+void ATEM::executeQueuedCommands() {
+  QueuedCommand cmd;
+  bool batch_open = false;
+  
+  while (_command_queue.pop(cmd)) {
+    ATEMCommandId id = (ATEMCommandId)cmd.id;
+    batch_open = (cmd.flags & QUEUED_COMMAND_BATCH_CONTINUES) != 0;
+    
+    if (cmd.flags & QUEUED_COMMAND_SEQUENCE) {
+      const ATEMSequenceStep* steps;
+      uint16_t count;
+      memcpy(&steps, cmd.payload, sizeof(steps));
+      memcpy(&count, cmd.payload + sizeof(steps), sizeof(count));
+      startSequence(steps, count);
+      continue;
+    }
+    
+    if ((cmd.flags & QUEUED_COMMAND_PACED) && _connection_state == ATEM_CONNECTED &&
+        _pacer.update(id, cmd.payload)) {
+      continue;
+    }
+    
+    uint8_t* payload = appendCommand(id);
+    if (!payload) continue;
+    memcpy(payload, cmd.payload, atemCommandSpec(id).payload_length);
+  }
+  
+  if (!batch_open) {
+    flushCommands();
+    servicePacedCommands();
+  }
 }
 
 /**
- * @brief Set media player source
- * TODO: Send MPCS command
+ * @brief Hand the changes collected in this pass to onStateChanged() delivery
+ * 
+ * Runs in the network context. Once the previous publication was reported the
+ * new changes replace it; until then they are merged into it, so an event that
+ * is delivered late still reports everything since the last callback. Changes
+ * may therefore be reported twice, never missed.
  */
-void ATEM::setMediaPlayerSource(uint8_t sourceType, uint8_t sourceIndex, uint8_t player) {
-  logPrintf(ATEM_LOG_INFO, "setMediaPlayerSource(type=%d, idx=%d, player=%d) - TODO: implement MPCS command", sourceType, sourceIndex, player);
-  debugPrint("setMediaPlayerSource() - not implemented yet");
+void ATEM::publishStateChanges() {
+  _state_lock.beginWrite();
+  if (_reported_generation.load(std::memory_order_acquire) == _published_changes.generation) {
+    _published_changes.changes = _state_changes;
+  } else {
+    atemStateChangesMerge(_published_changes.changes, _state_changes);
+  }
+  _published_changes.generation++;
+  _state_lock.endWrite();
+  memset(&_state_changes, 0, sizeof(_state_changes));
 }
 
 /**
- * @brief Set multiviewer window source
- * TODO: Send CMvI command
+ * @brief Report an event to the application
+ * @param type ATEMEventType
+ * @param me Mix effect index
+ * @param value Event payload
+ * 
+ * In direct mode the matching callback runs immediately. In task mode the event
+ * is queued so callbacks always run in the application's own task.
  */
-void ATEM::setMultiViewerWindowSource(uint16_t source, uint8_t mv, uint8_t window) {
-  logPrintf(ATEM_LOG_INFO, "setMultiViewerWindowSource(source=%d, mv=%d, window=%d) - TODO: implement CMvI command", source, mv, window);
-  debugPrint("setMultiViewerWindowSource() - not implemented yet");
+void ATEM::notify(uint8_t type, uint8_t me, uint16_t value, uint8_t flags) {
+  if (_task_active) {
+    ATEMEvent event;
+    event.type  = type;
+    event.me    = me;
+    event.flags = flags;
+    event.value = value;
+    if (!_event_queue.push(event)) {
+      _events_dropped++;
+    }
+    return;
+  }
+  
+  ATEMEvent event;
+  event.type  = type;
+  event.me    = me;
+  event.flags = flags;
+  event.value = value;
+  deliverEvent(event);
 }
 
-// 🔄 AUDIO (BASIC)
+/**
+ * @brief Invoke the virtual callback matching an event
+ * @param event Event to deliver
+ */
+void ATEM::deliverEvent(const ATEMEvent& event) {
+  switch (event.type) {
+    case ATEM_EVENT_CONNECTION_STATE: onConnectionStateChanged((ATEMConnectionState)event.value); break;
+    case ATEM_EVENT_PROGRAM_INPUT:
+      _delivered_flags = event.flags;
+      onMixEffectProgramChanged(event.me, event.value);
+      _delivered_flags = 0;
+      break;
+    case ATEM_EVENT_PREVIEW_INPUT:
+      _delivered_flags = event.flags;
+      onMixEffectPreviewChanged(event.me, event.value);
+      _delivered_flags = 0;
+      break;
+    case ATEM_EVENT_STATE_CHANGED: {
+      // Events queued behind each other share one publication; report it once
+      PublishedChanges published;
+      readShared(_state_lock, &published, &_published_changes, sizeof(published));
+      if (published.generation == _reported_generation.load(std::memory_order_relaxed)) {
+        break;
+      }
+      _delivered_changes = published.changes;
+      _reported_generation.store(published.generation, std::memory_order_release);
+      onStateChanged();
+      memset(&_delivered_changes, 0, sizeof(_delivered_changes));
+      break;
+    }
+    case ATEM_EVENT_TALLY_CHANGED: {
+      // Diff against what the callback saw last, so queued events coalesce. The
+      // live map is copied consistently into the reported one, which the
+      // callback reads while the network task goes on updating the live map.
+      ATEMTallyDiff diff(_tally_reported);
+      readShared(_state_lock, &_tally_reported, &_tally, sizeof(_tally_reported));
+      diff.update();
+      if (!diff.empty()) onTallyChanged(diff);
+      break;
+    }
+    default: break;
+  }
+}
 
 /**
- * @brief Set classic audio mixer input gain
- * TODO: Send CAIP command
+ * @brief Take the oldest pending event from the network task
+ * @param event Filled with the event if one was pending
+ * @return true if an event was returned
  */
-void ATEM::setClassicAudioMixerInputGain(uint8_t input, float gain) {
-  logPrintf(ATEM_LOG_INFO, "setClassicAudioMixerInputGain(input=%d, gain=%.1f) - TODO: implement CAIP command", input, gain);
-  debugPrint("setClassicAudioMixerInputGain() - not implemented yet");
+bool ATEM::pollEvent(ATEMEvent& event) {
+  return _event_queue.pop(event);
 }
 
 /**
- * @brief Set classic audio mixer master gain
- * TODO: Send CAMP command
+ * @brief Deliver all queued events to the virtual callbacks
+ * Called from runLoop() in task mode, so callbacks run in the application task
  */
-void ATEM::setClassicAudioMixerMasterGain(float gain) {
-  logPrintf(ATEM_LOG_INFO, "setClassicAudioMixerMasterGain(gain=%.1f) - TODO: implement CAMP command", gain);
-  debugPrint("setClassicAudioMixerMasterGain() - not implemented yet");
+void ATEM::dispatchEvents() {
+  ATEMEvent event;
+  while (_event_queue.pop(event)) {
+    deliverEvent(event);
+  }
+  
+  if (_events_dropped > 0) {
+    ATEM_LOG(ATEM_LOG_WARN, "Event queue overflowed - %d event(s) dropped", _events_dropped);
+    _events_dropped = 0;
+  }
 }
 
 // Event callbacks (default implementations - override in derived class)
@@ -1588,6 +3178,30 @@ void ATEM::onPreviewInputChanged(uint16_t input) {
   // Override in your implementation
 }
 
+/**
+ * @brief Default per-M/E program input change handler
+ * @param me Mix effect index
+ * @param input New program input ID
+ * Forwards M/E 0 to onProgramInputChanged() so single-M/E sketches keep working
+ */
+void ATEM::onMixEffectProgramChanged(uint8_t me, uint16_t input) {
+  if (me == 0) {
+    onProgramInputChanged(input);
+  }
+}
+
+/**
+ * @brief Default per-M/E preview input change handler
+ * @param me Mix effect index
+ * @param input New preview input ID
+ * Forwards M/E 0 to onPreviewInputChanged() so single-M/E sketches keep working
+ */
+void ATEM::onMixEffectPreviewChanged(uint8_t me, uint16_t input) {
+  if (me == 0) {
+    onPreviewInputChanged(input);
+  }
+}
+
 /**
  * @brief Default general state change handler
  * Called after any state variable is updated (program, preview, transition)
@@ -1598,6 +3212,14 @@ void ATEM::onStateChanged() {
   // Override in your implementation
 }
 
+/**
+ * @brief Default tally change handler
+ * @param diff Inputs whose tally changed
+ */
+void ATEM::onTallyChanged(const ATEMTallyDiff& diff) {
+  // Override in your implementation
+}
+
 // Debug and utility functions
 
 /**
@@ -1607,7 +3229,7 @@ void ATEM::onStateChanged() {
  * Adds consistent "[ATEM] " prefix to all debug messages
  */
 void ATEM::debugPrint(const char* message) {
-  logDebug(message);  // Convert to new logging system
+  ATEM_LOG(ATEM_LOG_DEBUG, "%s", message);  // Convert to new logging system
 }
 
 /**
@@ -1619,20 +3241,10 @@ void ATEM::debugPrint(const char* message) {
  * Format: "HEX: 01 23 45 67 89 AB CD EF ..." with 16 bytes per line
  * Only prints if debug output is enabled
  */
-void ATEM::debugPrintHex(uint8_t* data, int length) {
-  if (_log_level < ATEM_LOG_VERBOSE) return;  // Only show at VERBOSE level
-  
+void ATEM::debugPrintHex(const uint8_t* data, int length) {
   // Bounds checking to prevent buffer overflow
   int safe_length = (length > MAX_PACKET_SIZE) ? MAX_PACKET_SIZE : length;
-  
-  Serial.print("[ATEM VERBOSE] HEX: ");
-  for (int i = 0; i < safe_length; i++) {
-    if (data[i] < 0x10) Serial.print("0");
-    Serial.print(data[i], HEX);
-    Serial.print(" ");
-    if ((i + 1) % 16 == 0) Serial.println();
-  }
-  Serial.println();
+  ATEM_LOG_HEX(ATEM_LOG_VERBOSE, "HEX", data, safe_length);
 }
 
 /**
@@ -1661,7 +3273,14 @@ void ATEM::printConnectionInfo() {
   Serial.print("Local Packet ID: ");
   Serial.println(_local_packet_id);
   Serial.print("Remote Packet ID: ");
-  Serial.println(_remote_packet_id);
+  Serial.println(_rx_window.lastInOrder());
+  Serial.print("Retransmit Store: ");
+  Serial.print(_sent_packets.count());
+  Serial.print(" packets, ");
+  Serial.print(_sent_packets.bytesUsed());
+  Serial.print("/");
+  Serial.print(ATEMRetransmitStore::capacityBytes());
+  Serial.println(" bytes");
   Serial.print("Program Input: ");
   Serial.println(_state.program_input);
   Serial.print("Preview Input: ");
@@ -1669,6 +3288,129 @@ void ATEM::printConnectionInfo() {
   Serial.println("==========================");
 }
 
+#if ATEM_METRICS
+/**
+ * @brief Copy the metrics without tearing them
+ * @param out Destination
+ * 
+ * The network task holds _metrics_lock for each pass, so in task mode the copy
+ * shows the counters and histograms as they were between two passes.
+ */
+void ATEM::copyMetrics(ATEMMetrics& out) {
+  readShared(_metrics_lock, &out, &_metrics, sizeof(out));
+}
+
+/**
+ * @brief Clear all metrics and drop samples still waiting for an answer
+ */
+void ATEM::resetMetrics() {
+#if ATEM_HAS_NETWORK_TASK
+  if (shouldQueueCommand()) {
+    _metrics_reset_requested = true;  // Applied by the network task between passes
+    return;
+  }
+#endif
+  _metrics.reset();
+  memset(_command_sent_us, 0, sizeof(_command_sent_us));
+  _commands_awaiting  = 0;
+  _ack_sample_pending = false;
+  _ack_sample_id      = 0;
+  _ack_sample_us      = 0;
+  _rx_rate_window     = millis();
+  _rx_rate_count      = 0;
+}
+
+/**
+ * @brief Time the commands a received state command confirms
+ * A command answered by its confirming state update stops waiting; repeated
+ * sends before the answer are timed from the most recent one.
+ */
+void ATEM::recordConfirmation(uint32_t name) {
+  uint32_t now_us = micros();
+  for (uint8_t i = 0; i < ATEM_CMD_COUNT; i++) {
+    uint32_t bit = (uint32_t)1 << i;
+    if ((_commands_awaiting & bit) && atemFourCC(ATEM_COMMAND_SPECS[i].confirmed_by) == name) {
+      _metrics.command_rtt[i].record(now_us - _command_sent_us[i]);
+      _commands_awaiting &= ~bit;
+    }
+  }
+}
+
+/**
+ * @brief Count a datagram and publish the rate once per second
+ */
+void ATEM::recordReceivedDatagram() {
+  _metrics.rx_datagrams++;
+  _rx_rate_count++;
+  
+  unsigned long now = millis();
+  if (now - _rx_rate_window >= 1000) {
+    _metrics.rx_datagrams_per_second = _rx_rate_count;
+    _rx_rate_count  = 0;
+    _rx_rate_window = now;
+  }
+}
+
+/**
+ * @brief Print one line per histogram to Serial
+ */
+static void printLatency(const char* label, const ATEMLatencyHistogram& histogram) {
+  Serial.print(label);
+  Serial.print(": n=");
+  Serial.print(histogram.count);
+  if (histogram.count) {
+    Serial.print(" min=");
+    Serial.print(histogram.min_us);
+    Serial.print(" p50=");
+    Serial.print(histogram.percentileUs(50));
+    Serial.print(" p99=");
+    Serial.print(histogram.percentileUs(99));
+    Serial.print(" max=");
+    Serial.print(histogram.max_us);
+    Serial.print(" us");
+  }
+  Serial.println();
+}
+
+/**
+ * @brief Print a metrics summary to Serial
+ * Commands that were never confirmed are left out.
+ */
+void ATEM::printMetrics() {
+  Serial.println("=== ATEM Metrics ===");
+  printLatency("ACK RTT", _metrics.ack_rtt);
+  for (uint8_t i = 0; i < ATEM_CMD_COUNT; i++) {
+    if (_metrics.command_rtt[i].count) {
+      printLatency(ATEM_COMMAND_SPECS[i].name, _metrics.command_rtt[i]);
+    }
+  }
+  printLatency("Loop interval", _metrics.loop_interval);
+  Serial.print("RX: ");
+  Serial.print(_metrics.rx_datagrams);
+  Serial.print(" datagrams (");
+  Serial.print(_metrics.rx_datagrams_per_second);
+  Serial.print("/s), ");
+  Serial.print(_metrics.rx_commands);
+  Serial.print(" commands, ");
+  Serial.print(_metrics.rx_malformed_packets);
+  Serial.print(" malformed packets, ");
+  Serial.print(_metrics.rx_malformed_commands);
+  Serial.print(" malformed commands, ");
+  Serial.print(_metrics.rx_duplicate_packets);
+  Serial.print(" duplicates, ");
+  Serial.print(_metrics.rx_out_of_order_packets);
+  Serial.println(" out of order");
+  Serial.print("TX: ");
+  Serial.print(_metrics.tx_packets);
+  Serial.print(" packets, ");
+  Serial.print(_metrics.retransmit_requests);
+  Serial.print(" retransmit requests, ");
+  Serial.print(_metrics.packets_resent);
+  Serial.println(" packets resent");
+  Serial.println("====================");
+}
+#endif
+
 /**
  * @brief Print library version information to Serial
  * Displays formatted version banner including:
@@ -1703,132 +3445,91 @@ void ATEM::printVersionInfo() {
  * @param data Pointer to packet data
  * @param length Length of packet data
  * 
- * Stores packet in circular buffer for retransmission on request.
- * Uses circular buffer to maintain recent packets while avoiding memory issues.
- * Old packets are automatically overwritten when buffer is full.
+ * Copies the packet into the retransmit arena, back-to-back with the packets
+ * sent before it. When the byte budget or packet-count cap is reached the
+ * oldest packets are evicted; acknowledged packets are released earlier by
+ * parsePacket() as soon as the ATEM's ACK covers them.
  */
 void ATEM::storePacketForRetransmission(uint16_t packet_id, uint8_t* data, int length) {
-  if (length > MAX_PACKET_SIZE) {
-    Serial.print("[ATEM] WARNING: Packet too large for storage: ");
-    Serial.print(length);
-    Serial.print(" > ");
-    Serial.println(MAX_PACKET_SIZE);
+  if (length <= 0 || length > ATEM_RETRANSMIT_BUFFER_SIZE) {
+    ATEM_LOG(ATEM_LOG_WARN, "Packet too large for retransmit storage: %d > %d",
+             length, ATEM_RETRANSMIT_BUFFER_SIZE);
     return;
   }
   
-  // Use circular buffer
-  StoredPacket* slot = &_sent_packets[_packet_buffer_index];
-  
-  slot->packet_id = packet_id;
-  slot->length = length;
-  slot->timestamp = millis();
-  slot->in_use = true;
-  memcpy(slot->data, data, length);
+  uint32_t evicted_before = _sent_packets.evictedCount();
+  _sent_packets.store(packet_id, data, (uint16_t)length, millis());
   
-  logPrintf(ATEM_LOG_DEBUG, "Stored packet ID %d in slot %d (%d bytes)",
-           packet_id, _packet_buffer_index, length);
+  if (_sent_packets.evictedCount() != evicted_before) {
+    ATEM_LOG(ATEM_LOG_WARN, "Retransmit store full - evicted %d unacknowledged packet(s)",
+             _sent_packets.evictedCount() - evicted_before);
+  }
   
-  // Move to next slot (circular)
-  _packet_buffer_index = (_packet_buffer_index + 1) % MAX_RETRANSMIT_PACKETS;
+  ATEM_LOG(ATEM_LOG_DEBUG, "Stored packet ID %d (%d bytes, %d packets / %d bytes in store)",
+           packet_id, length, _sent_packets.count(), _sent_packets.bytesUsed());
 }
 
 /**
  * @brief Handle retransmit request from ATEM
  * @param from_packet_id Starting packet ID to retransmit from
+ * @param sequence_to_ack Remote packet ID to acknowledge after resending
  * 
  * Based on Sofie atem-connection analysis: ATEM requests retransmit FROM a packet ID,
  * meaning resend that packet AND ALL SUBSEQUENT packets (like TCP retransmission).
  * This is different from requesting a single specific packet.
+ * The retransmit store only holds packets that are still unacknowledged, in
+ * send order, so the resend walks forward from the requested packet (or the
+ * first outstanding packet after it, if it was already acknowledged) to the
+ * newest one. Sequence comparisons are 15-bit wrap-aware.
  */
 void ATEM::handleRetransmitRequest(uint16_t from_packet_id, uint16_t sequence_to_ack) {
-  Serial.print("[T+");
-  Serial.print(millis());
-  Serial.print("ms] Retransmitting FROM packet ");
-  Serial.print(from_packet_id);
-  Serial.println(" onwards (like Sofie library)");
-  
-  // Find the starting packet and retransmit from there onwards
-  bool found_start = false;
+  // Karn's rule: a resent packet's ACK cannot be attributed to either send
+  ATEM_METRIC(_metrics.retransmit_requests++; _ack_sample_pending = false);
+  
+  ATEM_LOG(ATEM_LOG_INFO, "[T+%lums] Retransmitting FROM packet %d onwards", millis(), from_packet_id);
+  
+  int start = _sent_packets.indexFrom(from_packet_id);
   int retransmit_count = 0;
   
-  // Search through our stored packets for the starting packet
-  for (int i = 0; i < MAX_RETRANSMIT_PACKETS; i++) {
-    StoredPacket* slot = &_sent_packets[i];
-    
-    if (!slot->in_use) continue;
-    
-    // Once we find the starting packet, retransmit it and all subsequent ones
-    if (slot->packet_id == from_packet_id) {
-      found_start = true;
-    }
-    
-    if (found_start) {
-      Serial.print("[T+");
-      Serial.print(millis());
-      Serial.print("ms] Retransmitting packet ID ");
-      Serial.print(slot->packet_id);
-      Serial.print(" from slot ");
-      Serial.print(i);
-      Serial.print(" (");
-      Serial.print(slot->length);
-      Serial.println(" bytes)");
+  if (start >= 0) {
+    for (uint16_t i = start; i < _sent_packets.count(); i++) {
+      const ATEMRetransmitStore::Entry& slot = _sent_packets.at(i);
+      uint8_t* data = (uint8_t*)_sent_packets.data(slot);
+      
+      ATEM_LOG(ATEM_LOG_DEBUG, "Retransmitting packet ID %d (%d bytes)", slot.packet_id, slot.length);
       
-      _udp.beginPacket(_switcher_ip, ATEM_PORT);
-      _udp.write(slot->data, slot->length);
-      _udp.endPacket();
+      sendDatagram(data, slot.length);
       
       // Log in Sofie format for comparison
-      printSofieFormat("SEND", slot->data, slot->length);
+      ATEM_LOG_PACKET("SEND", data, slot.length);
       
+      _sent_packets.markResent(i, millis());
       retransmit_count++;
+      ATEM_METRIC(_metrics.packets_resent++);
     }
   }
   
   if (retransmit_count > 0) {
-    Serial.print("[T+");
-    Serial.print(millis());
-    Serial.print("ms] Retransmission complete - sent ");
-    Serial.print(retransmit_count);
-    Serial.print(" packets from ID ");
-    Serial.print(from_packet_id);
-    Serial.println(" onwards");
+    ATEM_LOG(ATEM_LOG_INFO, "Retransmission complete - sent %d packet(s) from ID %d, ACKing sequence %d",
+             retransmit_count, from_packet_id, sequence_to_ack);
     
     // CRITICAL: Send ACK response after retransmission (like Sofie library does)
-    Serial.print("[T+");
-    Serial.print(millis());
-    Serial.print("ms] Sending ACK response for sequence ");
-    Serial.println(sequence_to_ack);
     sendAck(sequence_to_ack);
   } else {
     // Starting packet not found in storage - this is critical
-    Serial.print("[T+");
-    Serial.print(millis());
-    Serial.print("ms] *** CRITICAL: RETRANSMIT FROM ");
-    Serial.print(from_packet_id);
-    Serial.println(" FAILED - starting packet not found! ***");
+    ATEM_LOG(ATEM_LOG_WARN, "Retransmit from %d failed - starting packet not found (%d packet(s) stored)",
+             from_packet_id, _sent_packets.count());
     
-    Serial.println("[ATEM] Packet storage status:");
-    for (int i = 0; i < MAX_RETRANSMIT_PACKETS; i++) {
-      StoredPacket* slot = &_sent_packets[i];
-      if (slot->in_use) {
-        Serial.print("  Slot ");
-        Serial.print(i);
-        Serial.print(": Packet ID ");
-        Serial.print(slot->packet_id);
-        Serial.print(" (");
-        Serial.print(slot->length);
-        Serial.print(" bytes, age ");
-        Serial.print(millis() - slot->timestamp);
-        Serial.println("ms)");
+    if (logEnabled(ATEM_LOG_DEBUG)) {
+      for (uint16_t i = 0; i < _sent_packets.count(); i++) {
+        const ATEMRetransmitStore::Entry& slot = _sent_packets.at(i);
+        ATEM_LOG(ATEM_LOG_DEBUG, "  #%d: Packet ID %d (%d bytes, last sent %lums ago, resent %dx)",
+                 i, slot.packet_id, slot.length, millis() - slot.timestamp, slot.resend_count);
       }
     }
     
     // CRITICAL FIX: Send ACK even when we can't retransmit to prevent retransmission storm
-    Serial.print("[T+");
-    Serial.print(millis());
-    Serial.print("ms] Sending ACK for sequence ");
-    Serial.print(sequence_to_ack);
-    Serial.println(" (packet too old but acknowledging request)");
+    ATEM_LOG(ATEM_LOG_DEBUG, "Sending ACK for sequence %d (packet too old but acknowledging request)", sequence_to_ack);
     sendAck(sequence_to_ack);
   }
 }
@@ -1839,79 +3540,103 @@ void ATEM::handleRetransmitRequest(uint16_t from_packet_id, uint16_t sequence_to
  * @param data Pointer to packet data
  * @param length Packet length
  */
-void ATEM::printSofieFormat(const char* prefix, uint8_t* data, int length) {
+void ATEM::printSofieFormat(const char* prefix, const uint8_t* data, int length) {
   // Only print if log level allows DEBUG or higher
-  if (_log_level >= ATEM_LOG_DEBUG) {
-    Serial.print("ℹ️  Info: ");
-    Serial.print(prefix);
-    Serial.print(" ");
-    
-    // Print continuous hex string like Sofie does
-    for (int i = 0; i < length && i < 64; i++) {  // Limit to prevent overflow
-      if (data[i] < 0x10) Serial.print("0");
-      Serial.print(data[i], HEX);
-    }
-    Serial.println();
+  if (!logEnabled(ATEM_LOG_DEBUG)) {
+    return;
   }
+  
+  Serial.print("ℹ️  Info: ");
+  Serial.print(prefix);
+  Serial.print(" ");
+  
+  // Print continuous hex string like Sofie does
+  for (int i = 0; i < length && i < 64; i++) {  // Limit to prevent overflow
+    if (data[i] < 0x10) Serial.print("0");
+    Serial.print(data[i], HEX);
+  }
+  Serial.println();
 }
 
 /**
  * @brief Logging System Implementation
- * Provides configurable verbosity levels for ESP32 output control
+ * Provides configurable verbosity levels for ESP32 output control.
+ * Call sites use the ATEM_LOG() macros, which test logEnabled() before any
+ * argument is evaluated; these functions are the output sinks.
  */
 
-void ATEM::logError(const char* message) {
-  if (_log_level >= ATEM_LOG_ERROR) {
-    Serial.print("[ATEM ERROR] ");
-    Serial.println(message);
+/**
+ * @brief Print the "[ATEM ...] " prefix for a log level
+ */
+void ATEM::printLogPrefix(ATEMLogLevel level) {
+  switch (level) {
+    case ATEM_LOG_ERROR:   Serial.print("[ATEM ERROR] "); break;
+    case ATEM_LOG_WARN:    Serial.print("[ATEM WARN] "); break;
+    case ATEM_LOG_INFO:    Serial.print("[ATEM] "); break;
+    case ATEM_LOG_DEBUG:   Serial.print("[ATEM DEBUG] "); break;
+    case ATEM_LOG_VERBOSE: Serial.print("[ATEM VERBOSE] "); break;
+    default: Serial.print("[ATEM] "); break;
   }
 }
 
+void ATEM::logError(const char* message) {
+  ATEM_LOG(ATEM_LOG_ERROR, "%s", message);
+}
+
 void ATEM::logWarn(const char* message) {
-  if (_log_level >= ATEM_LOG_WARN) {
-    Serial.print("[ATEM WARN] ");
-    Serial.println(message);
-  }
+  ATEM_LOG(ATEM_LOG_WARN, "%s", message);
 }
 
 void ATEM::logInfo(const char* message) {
-  if (_log_level >= ATEM_LOG_INFO) {
-    Serial.print("[ATEM] ");
-    Serial.println(message);
-  }
+  ATEM_LOG(ATEM_LOG_INFO, "%s", message);
 }
 
 void ATEM::logDebug(const char* message) {
-  if (_log_level >= ATEM_LOG_DEBUG) {
-    Serial.print("[ATEM DEBUG] ");
-    Serial.println(message);
-  }
+  ATEM_LOG(ATEM_LOG_DEBUG, "%s", message);
 }
 
 void ATEM::logVerbose(const char* message) {
-  if (_log_level >= ATEM_LOG_VERBOSE) {
-    Serial.print("[ATEM VERBOSE] ");
-    Serial.println(message);
-  }
+  ATEM_LOG(ATEM_LOG_VERBOSE, "%s", message);
 }
 
 void ATEM::logPrintf(ATEMLogLevel level, const char* format, ...) {
-  if (_log_level >= level) {
-    char buffer[256];
-    va_list args;
-    va_start(args, format);
-    vsnprintf(buffer, sizeof(buffer), format, args);
-    va_end(args);
-    
-    // Add appropriate prefix based on level
-    switch (level) {
-      case ATEM_LOG_ERROR:   Serial.print("[ATEM ERROR] "); break;
-      case ATEM_LOG_WARN:    Serial.print("[ATEM WARN] "); break;
-      case ATEM_LOG_INFO:    Serial.print("[ATEM] "); break;
-      case ATEM_LOG_DEBUG:   Serial.print("[ATEM DEBUG] "); break;
-      case ATEM_LOG_VERBOSE: Serial.print("[ATEM VERBOSE] "); break;
-      default: Serial.print("[ATEM] "); break;
+  if (!logEnabled(level)) {
+    return;
+  }
+  
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  
+  printLogPrefix(level);
+  Serial.println(buffer);
+}
+
+/**
+ * @brief Print a labelled hex dump, 32 bytes per line
+ * @param level Log level of the dump
+ * @param label Text printed before the bytes
+ * @param data Bytes to dump
+ * @param length Number of bytes
+ */
+void ATEM::logHex(ATEMLogLevel level, const char* label, const uint8_t* data, int length) {
+  if (!logEnabled(level)) {
+    return;
+  }
+  
+  printLogPrefix(level);
+  Serial.print(label);
+  Serial.print(": ");
+  for (int i = 0; i < length; i++) {
+    if (data[i] < 0x10) Serial.print("0");
+    Serial.print(data[i], HEX);
+    Serial.print(" ");
+    if ((i + 1) % 32 == 0 && i + 1 < length) {
+      Serial.println();
+      printLogPrefix(level);
     }
-    Serial.println(buffer);
   }
+  Serial.println();
 }
@@ -19,7 +19,44 @@
 #include <WiFi.h>
 #include <WiFiUdp.h>
 #include <WiFiClient.h>
+#include "ATEM_Transport.h"
+#include "ATEM_View.h"
+#include "ATEM_Timers.h"
+#include "ATEM_Capture.h"
+#include "ATEM_Pacer.h"
+#include "ATEM_Optimistic.h"
+#include "ATEM_Sequence.h"
+#include "ATEM_Snapshot.h"
+#include "ATEM_Tally.h"
 #include "ATEM_Inputs.h"
+#include "ATEM_Retransmit.h"
+#include "ATEM_Commands.h"
+#include "ATEM_Queue.h"
+#include "ATEM_State.h"
+#include "ATEM_Metrics.h"
+
+// Fixed-memory build: no heap allocation after begin() (see README "Fixed Memory")
+#ifndef ATEM_STATIC_MEMORY
+#define ATEM_STATIC_MEMORY           0         // 1 = default transport and network task use no heap
+#endif
+
+// WiFiUDP allocates a receive buffer per datagram; the fixed-memory build uses
+// the raw lwIP transport instead, which parses pbufs in place
+#if ATEM_STATIC_MEMORY && defined(ARDUINO_ARCH_ESP32)
+#include "ATEM_LwipTransport.h"
+typedef ATEMLwipTransport ATEMDefaultTransport;
+#else
+typedef ATEMWiFiTransport ATEMDefaultTransport;
+#endif
+
+// Optional FreeRTOS network task (ESP32 only)
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#define ATEM_HAS_NETWORK_TASK        1
+#else
+#define ATEM_HAS_NETWORK_TASK        0
+#endif
 
 // Version Information
 #define ATEM_ESP32_VERSION "v2.1.0"
@@ -29,14 +66,63 @@
 #define ATEM_PORT                    9910
 #define LOCAL_PORT                   9910
 #define CONNECTION_TIMEOUT           5000      // 5 seconds connection timeout
-#define CONNECTION_RETRY_INTERVAL    1000      // 1 second reconnection check
+#define CONNECTION_RETRY_INTERVAL    1000      // Base reconnect delay (doubled per failed attempt, jittered)
+#ifndef ATEM_RECONNECT_MAX_INTERVAL
+#define ATEM_RECONNECT_MAX_INTERVAL  30000     // Upper bound for the reconnect delay
+#endif
+#ifndef ATEM_AUTO_RECONNECT
+#define ATEM_AUTO_RECONNECT          1         // Reconnect automatically after a timeout (see setAutoReconnect())
+#endif
+#ifndef ATEM_HELLO_RETRY_INTERVAL
+#define ATEM_HELLO_RETRY_INTERVAL    250       // First HELLO resend after 250ms, doubling each time
+#endif
+#ifndef ATEM_HELLO_RETRY_MAX_INTERVAL
+#define ATEM_HELLO_RETRY_MAX_INTERVAL 2000     // Upper bound for the HELLO resend interval
+#endif
 #define RETRANSMIT_INTERVAL          10        // 10ms retransmit check
 #define HEARTBEAT_INTERVAL           500       // 500ms heartbeat (matching Sofie library exactly)
 #define MAX_PACKET_SIZE              1500
 #define HEADER_SIZE                  12
-// Retransmission settings - based on Sofie analysis showing retransmit FROM packet 1
-// ATEM can request retransmission of very old packets, need to store many more
-#define MAX_RETRANSMIT_PACKETS       100       // Store last 100 packets instead of 10
+// Outgoing command packets are encoded in place into one TX buffer; batched
+// commands (beginBatch()/commitBatch()) are packed up to this packet size
+#ifndef ATEM_TX_BUFFER_SIZE
+#define ATEM_TX_BUFFER_SIZE          1416      // Largest command packet (matches Sofie maxPacketSize)
+#endif
+static_assert(ATEM_TX_BUFFER_SIZE >= HEADER_SIZE + ATEM_COMMAND_HEADER_SIZE + ATEM_MAX_COMMAND_PAYLOAD, "ATEM_TX_BUFFER_SIZE cannot hold a command");
+static_assert(ATEM_TX_BUFFER_SIZE < 2048, "ATEM packet length is an 11-bit field");
+static_assert(ATEM_TX_BUFFER_SIZE <= ATEM_RETRANSMIT_BUFFER_SIZE, "Retransmit buffer must hold a full command packet");
+// Retransmission settings - ATEM_RETRANSMIT_BUFFER_SIZE (byte budget) and
+// MAX_RETRANSMIT_PACKETS (packet-count cap) are defined in ATEM_Retransmit.h
+
+// Receive batching - runLoop() drains up to ATEM_RX_BATCH_MAX queued datagrams,
+// stopping early once ATEM_RX_BATCH_BUDGET_US microseconds have been spent
+#define ATEM_PRODUCT_NAME_LENGTH     40        // _pin product name field
+#ifndef ATEM_MAX_COMMAND_HANDLERS
+#define ATEM_MAX_COMMAND_HANDLERS    8         // Slots for registerCommandHandler()
+#endif
+#ifndef ATEM_RX_BATCH_MAX
+#define ATEM_RX_BATCH_MAX            16        // Datagrams per runLoop() call (1 = one per call)
+#endif
+#ifndef ATEM_RX_BATCH_BUDGET_US
+#define ATEM_RX_BATCH_BUDGET_US      5000      // Time budget per runLoop() call (0 = no limit)
+#endif
+
+// Network task settings - see enableNetworkTask()
+#ifndef ATEM_TASK_STACK_SIZE
+#define ATEM_TASK_STACK_SIZE         4096      // Network task stack size in bytes
+#endif
+#ifndef ATEM_TASK_PRIORITY
+#define ATEM_TASK_PRIORITY           3         // Above the Arduino loop task (1)
+#endif
+#ifndef ATEM_TASK_PERIOD_MS
+#define ATEM_TASK_PERIOD_MS          2         // Network task service interval
+#endif
+#ifndef ATEM_COMMAND_QUEUE_SIZE
+#define ATEM_COMMAND_QUEUE_SIZE      16        // Control commands queued for the network task
+#endif
+#ifndef ATEM_EVENT_QUEUE_SIZE
+#define ATEM_EVENT_QUEUE_SIZE        32        // Events queued for the application
+#endif
 
 // Logging Levels - configurable in user code before including ATEM.h
 enum ATEMLogLevel {
@@ -53,6 +139,38 @@ enum ATEMLogLevel {
 #define ATEM_DEFAULT_LOG_LEVEL ATEM_LOG_INFO
 #endif
 
+// Compile-time log ceiling - call sites above this level are compiled out
+// entirely (no formatting, no strings in flash), whatever setLogLevel() says.
+// Set it as a build flag so the library sources see it too, e.g.
+//   build_flags = -DATEM_MAX_LOG_LEVEL=ATEM_LOG_WARN
+#ifndef ATEM_MAX_LOG_LEVEL
+#define ATEM_MAX_LOG_LEVEL ATEM_LOG_VERBOSE
+#endif
+
+// Level-checked logging for use inside ATEM (and subclasses). The level is
+// tested before any argument is evaluated, and the test folds to false at
+// compile time for levels above ATEM_MAX_LOG_LEVEL.
+#define ATEM_LOG(level, ...) \
+  do { if (logEnabled(level)) logPrintf(level, __VA_ARGS__); } while (0)
+
+// Lets GCC check ATEM_LOG() arguments against the format (-Wformat)
+#if defined(__GNUC__)
+#define ATEM_PRINTF_FORMAT(format_index, args_index) \
+  __attribute__((format(printf, format_index, args_index)))
+#else
+#define ATEM_PRINTF_FORMAT(format_index, args_index)
+#endif
+
+// IPAddress arguments without building a String: "%d.%d.%d.%d", ATEM_IP_ARGS(ip)
+#define ATEM_IP_ARGS(ip)             (ip)[0], (ip)[1], (ip)[2], (ip)[3]
+
+#define ATEM_LOG_HEX(level, label, data, length) \
+  do { if (logEnabled(level)) logHex(level, label, data, length); } while (0)
+
+// Sofie-format packet trace (DEBUG level)
+#define ATEM_LOG_PACKET(prefix, data, length) \
+  do { if (logEnabled(ATEM_LOG_DEBUG)) printSofieFormat(prefix, data, length); } while (0)
+
 // ATEM Protocol Flags (exact match to Sofie ATEM Connection library)
 #define FLAG_ACK_REQUEST             0x01
 #define FLAG_NEW_SESSION_ID          0x02
@@ -68,6 +186,35 @@ enum ATEMConnectionState {
   ATEM_ERROR
 };
 
+// Events delivered from the network task to the application (see pollEvent())
+enum ATEMEventType {
+  ATEM_EVENT_CONNECTION_STATE,     // value = ATEMConnectionState
+  ATEM_EVENT_PROGRAM_INPUT,        // value = new program input
+  ATEM_EVENT_PREVIEW_INPUT,        // value = new preview input
+  ATEM_EVENT_STATE_CHANGED,        // value = ATEM_STATE_CHANGED_* bits
+  ATEM_EVENT_TALLY_CHANGED         // value unused; the diff is taken when the event is delivered
+};
+
+// ATEMEvent::flags
+#define ATEM_EVENT_FLAG_SPECULATIVE      0x01  // Expected result of our own command, not confirmed yet
+#define ATEM_EVENT_FLAG_CORRECTION       0x02  // A speculative value was rolled back
+
+struct ATEMEvent {
+  uint8_t type;                    // ATEMEventType
+  uint8_t me;                      // Mix effect index the event refers to
+  uint8_t flags;                   // ATEM_EVENT_FLAG_* bits
+  uint16_t value;                  // Event payload (see ATEMEventType)
+};
+
+/**
+ * Handler for a received command, see ATEM::registerCommandHandler()
+ * @param name Four-character command name as atemFourCC()
+ * @param payload Command data after the 8-byte block header
+ * @param length Payload length in bytes
+ * @param context Pointer passed at registration
+ */
+typedef void (*ATEMCommandHandler)(uint32_t name, const uint8_t* payload, uint16_t length, void* context);
+
 // ATEM Input Sources (based on Sofie library)
 #define ATEM_INPUT_BLACK             0
 #define ATEM_INPUT_CAM1              1
@@ -95,22 +242,6 @@ struct ATEMPacketHeader {
   uint16_t packet_id;
 };
 
-// ATEM Command Structure
-struct ATEMCommand {
-  uint16_t length;
-  uint16_t unknown;
-  char name[4];
-  uint8_t data[1480]; // Max command data size
-};
-
-// ATEM State Structure (simplified for initial implementation)
-struct ATEMState {
-  uint16_t program_input;
-  uint16_t preview_input;
-  bool in_transition;
-  uint8_t transition_position;
-};
-
 class ATEM {
 public:
   // Constructor and Destructor
@@ -128,20 +259,61 @@ public:
   
   // Connection Management
   /**
-   * @brief Initialize ATEM connection to specified IP address
+   * @brief Initialize ATEM connection to specified IP address (blocking)
    * @param ip IPAddress of the ATEM switcher
    * @return true if initialization and connection successful, false otherwise
-   * Prints version info, sets up UDP, tests connectivity, and attempts handshake
+   * Prints version info, sets up UDP and waits up to CONNECTION_TIMEOUT for the handshake
    */
   bool begin(IPAddress ip);
   
   /**
-   * @brief Establish connection handshake with ATEM switcher
+   * @brief Initialize ATEM connection without blocking
+   * @param ip IPAddress of the ATEM switcher
+   * @return true if the UDP socket is ready and the handshake was started
+   * Sends HELLO and returns; runLoop() resends it with backoff until the switcher
+   * answers or CONNECTION_TIMEOUT expires. Progress is reported through
+   * onConnectionStateChanged() (CONNECTING -> CONNECTED or ERROR).
+   */
+  bool beginAsync(IPAddress ip);
+  
+  /**
+   * @brief Establish connection handshake with ATEM switcher (blocking)
    * @return true if handshake successful, false if timeout or error
    * Sends HELLO packet and waits for response to establish session
    */
   bool connect();
   
+  /**
+   * @brief Enable the opt-in network diagnostics in begin()/beginAsync()
+   * @param enable true to run a TCP probe and a UDP test send before the handshake
+   * The TCP probe blocks for the TCP connect timeout and is expected to fail
+   * (the ATEM is UDP-only); only useful when debugging network reachability
+   */
+  void setNetworkDiagnostics(bool enable) { _network_diagnostics = enable; }
+  
+  /**
+   * @brief Use another datagram transport instead of the built-in WiFiUDP one
+   * @param transport Transport to use (must outlive the ATEM object), nullptr for WiFi
+   * Call before begin()/beginAsync(); see ATEM_Transport.h
+   */
+  void setTransport(ATEMTransport* transport);
+  
+  /**
+   * @brief Record every datagram sent and received into a capture ring
+   * @param capture Capture to record into (must outlive the ATEM object), nullptr to stop
+   * See ATEM_Capture.h for flushing it to a file or collector and replaying it
+   */
+  void setCapture(ATEMCapture* capture) { _capture = capture; }
+  
+  /**
+   * @brief Enable or disable the automatic reconnect supervisor
+   * @param enable true to reconnect after a timeout (default ATEM_AUTO_RECONNECT)
+   * After the link drops, runLoop() restarts the handshake with jittered exponential
+   * backoff based on CONNECTION_RETRY_INTERVAL. The cached ATEMState stays readable
+   * with stale = true until the new session's state dump has arrived.
+   */
+  void setAutoReconnect(bool enable) { _auto_reconnect = enable; if (!enable) _timers.cancel(ATEM_TIMER_RECONNECT); }
+  
   /**
    * @brief Disconnect from ATEM switcher and cleanup resources
    * Sends disconnect notification and stops UDP communication
@@ -163,59 +335,342 @@ public:
   // Main Loop - call this frequently
   /**
    * @brief Main processing loop - MUST be called frequently in main loop
+   * @return Milliseconds until the next protocol deadline (heartbeat, HELLO resend,
+   *         timeout, reconnect): 0 if more work is pending, ATEM_NO_DEADLINE if
+   *         nothing is scheduled (disconnected, or task mode)
    * Processes incoming packets, sends heartbeats, handles timeouts, and triggers events
-   * Call this at least every 10ms for proper operation
+   * Call this at least every 10ms for proper operation, or sleep for the returned
+   * time capped at the latency you accept for received packets (they are not
+   * deadlines, so a long sleep delays them)
+   * In task mode only delivers queued events to the callbacks; timing no longer matters
+   */
+  uint32_t runLoop();
+  
+  /**
+   * @brief Run the protocol in a dedicated FreeRTOS task (call before begin())
+   * @param core CPU core to pin the task to (-1 = no affinity)
+   * @param priority FreeRTOS priority of the network task
+   * @param stack_size Task stack size in bytes
+   * @return true if task mode is available on this platform
+   * 
+   * In task mode begin() starts the network task, which handles the handshake,
+   * receive, ACKs, heartbeats and timeouts independently of the sketch. Control
+   * calls (changeProgramInput(), cut(), ...) are queued to the task, and state
+   * changes come back as events: drain them with pollEvent(), or call runLoop()
+   * to deliver them through the usual on...Changed() callbacks.
+   */
+  bool enableNetworkTask(int8_t core = 1, uint8_t priority = ATEM_TASK_PRIORITY,
+                         uint32_t stack_size = ATEM_TASK_STACK_SIZE);
+  
+  /**
+   * @brief Check if the protocol runs in its own FreeRTOS task
+   * @return true if enableNetworkTask() was called and the task is running
+   */
+  bool isNetworkTaskRunning();
+  
+  /**
+   * @brief Least free stack the network task has had since it started
+   * @return Bytes (stack high-water mark), 0 if the task is not running
+   */
+  uint32_t getNetworkTaskStackHighWater();
+  
+  /**
+   * @brief Take the oldest pending event from the network task
+   * @param event Filled with the event if one was pending
+   * @return true if an event was returned, false if the queue is empty
+   * Only meaningful in task mode; callbacks are not invoked for polled events
+   */
+  bool pollEvent(ATEMEvent& event);
+  
+  /**
+   * @brief Configure how many queued datagrams runLoop() processes per call
+   * @param max_packets Maximum datagrams drained per call (1 = legacy one-per-call)
+   * @param budget_us Stop draining after this many microseconds (0 = no time limit)
+   * Lets the initial state dump complete in one burst instead of one packet per loop
+   */
+  void setReceiveBatch(uint8_t max_packets, uint32_t budget_us = ATEM_RX_BATCH_BUDGET_US);
+  
+  /**
+   * @brief Select the command families decoded into the state store
+   * @param families ATEM_SUBSCRIBE_* bits (default ATEM_SUBSCRIBE_ALL)
+   * Commands of other families are skipped by length and their sections keep
+   * their reset values. Families not compiled in (ATEM_SUBSCRIPTIONS) stay off.
+   * Registered command handlers still see every command.
+   * Ignored while the socket is open; call before begin()/beginAsync()
+   */
+  void setSubscriptions(uint16_t families);
+  uint16_t getSubscriptions() const { return _subscriptions; }
+  
+  /**
+   * @brief Set the rate of the paced channel for continuous controls
+   * @param frames_per_second Frame rate of the tick grid (0 sends every call at once)
+   * @param frames Frames between ticks
+   * setTransitionPosition(), setClassicAudioMixerInputGain() and
+   * setColorGeneratorColour() keep only the newest value per parameter and send
+   * it on the next tick, with at most one unacknowledged packet per parameter
+   * (see ATEM_Pacer.h). Inside beginBatch() they are sent with the batch.
+   * Ignored while the socket is open; call before begin()/beginAsync()
    */
-  void runLoop();
+  void setPacing(float frames_per_second, uint8_t frames = ATEM_PACING_FRAMES);
+  
+  /**
+   * @brief Paced values replaced by a newer one before they were sent
+   */
+  uint32_t getMergedUpdates() const { return _pacer.mergedUpdates(); }
+  
+  /**
+   * @brief Apply program/preview changes locally before the switcher confirms them
+   * @param enable true to update the state store as soon as a command is sent
+   * changeProgramInput(), changePreviewInput() and cut() then update the state
+   * and call onMixEffectProgramChanged()/onMixEffectPreviewChanged() at once,
+   * with isSpeculative() true. The switcher's echo confirms the value silently;
+   * if it contradicts it, or never comes, the confirmed value is restored and
+   * the callback runs again with isCorrection() true (see ATEM_Optimistic.h).
+   * Not available in task mode, where the state belongs to the network task
+   */
+  void setOptimisticUpdates(bool enable);
+  bool getOptimisticUpdates() const { return _optimistic; }
+  
+  /**
+   * @brief Speculative changes still waiting for the switcher
+   */
+  uint8_t getPendingSpeculations() const { return _speculations.count(); }
+  
+  /**
+   * @brief Speculative changes that had to be rolled back
+   */
+  uint32_t getRollbacks() const { return _rollbacks; }
+  
+  /**
+   * @brief Align heartbeats to a fixed slot in every HEARTBEAT_INTERVAL
+   * @param phase_ms Offset of the slot from millis() multiples of HEARTBEAT_INTERVAL
+   * Used by ATEMSessionManager to interleave the heartbeats of several sessions
+   * on one socket. Without it heartbeats run HEARTBEAT_INTERVAL after the last one.
+   */
+  void setHeartbeatPhase(uint16_t phase_ms);
+  
+  /**
+   * @brief Register a handler for a received command
+   * @param name Four-character command name, e.g. "AuxS" or "_ver"
+   * @param handler Called with the raw payload every time the command arrives
+   * @param context Passed through to the handler
+   * @return false if all ATEM_MAX_COMMAND_HANDLERS slots are in use
+   * Works for commands the library does not parse as well as ones it does (the
+   * handler runs after the library has updated its own state). Registering the
+   * same name again replaces the previous handler. In task mode the handler runs
+   * on the network task.
+   */
+  bool registerCommandHandler(const char* name, ATEMCommandHandler handler, void* context = nullptr);
+  
+  /**
+   * @brief Remove the handler registered for a command
+   * @return true if a handler was registered for the name
+   */
+  bool unregisterCommandHandler(const char* name);
   
   // State Access
   /**
    * @brief Get complete current ATEM state
-   * @return ATEMState struct containing program/preview inputs and transition status
+   * @return Copy of the state store (all M/Es, keyers, aux, FTB, media players, inputs)
+   * The store is several hundred bytes; prefer getStateRef() when polling often.
+   * In task mode the copy is taken between two updates of the network task, so
+   * it is never torn
    */
   ATEMState getState();
   
+  /**
+   * @brief Read the state store in place without copying it
+   * @return Reference to the internal state, updated as commands arrive
+   * In task mode the network task writes it concurrently; use getState() there
+   */
+  const ATEMState& getStateRef() const { return _state; }
+  
+  /**
+   * @brief Which parts of the state changed
+   * @return ATEM_STATE_CHANGED_* bits for the current onStateChanged() call
+   * Only meaningful inside onStateChanged(); in task mode the same bits are the
+   * value of the ATEM_EVENT_STATE_CHANGED event
+   */
+  uint16_t getStateChanges() const { return _delivered_changes.sections; }
+  
+  /**
+   * @brief Which M/Es, keyers, buses, players and inputs changed
+   * @return Section bits plus one mask per section with several entries
+   * Only meaningful inside onStateChanged(). In task mode, events that queued up
+   * before the callback ran are reported together.
+   */
+  const ATEMStateChanges& getStateChangeMasks() const { return _delivered_changes; }
+  
+  /**
+   * @brief Whether the input change being reported is our own unconfirmed command
+   * Only meaningful inside onMixEffectProgramChanged()/onMixEffectPreviewChanged()
+   * and the M/E 1 callbacks they forward to (see setOptimisticUpdates())
+   */
+  bool isSpeculative() const { return _delivered_flags & ATEM_EVENT_FLAG_SPECULATIVE; }
+  
+  /**
+   * @brief Whether the input change being reported undoes a speculative one
+   * Only meaningful inside the same callbacks as isSpeculative()
+   */
+  bool isCorrection() const { return _delivered_flags & ATEM_EVENT_FLAG_CORRECTION; }
+  
   /**
    * @brief Get current program input number
-   * @return uint16_t program input ID (e.g., 1=CAM1, 2=CAM2, etc.)
+   * @param me Mix effect index (default 0)
+   * @return uint16_t program input ID (e.g., 1=CAM1, 2=CAM2, etc.), 0 for an unknown M/E
    */
-  uint16_t getProgramInput();
+  uint16_t getProgramInput(uint8_t me = 0);
   
   /**
    * @brief Get current preview input number  
-   * @return uint16_t preview input ID (e.g., 1=CAM1, 2=CAM2, etc.)
+   * @param me Mix effect index (default 0)
+   * @return uint16_t preview input ID (e.g., 1=CAM1, 2=CAM2, etc.), 0 for an unknown M/E
+   */
+  uint16_t getPreviewInput(uint8_t me = 0);
+  
+  /**
+   * @brief Get the number of M/E rows of the connected switcher
+   * @return M/E count (from the model capabilities, at most ATEM_MAX_MIX_EFFECTS)
+   */
+  uint8_t getMixEffectCount() const { return _state.mix_effect_count; }
+  
+  // Switcher Identification (from _ver / _pin / _top at connect time)
+  /**
+   * @brief Get the detected switcher model
+   * @return ATEMModel matched from the _pin product name, ATEM_MODEL_UNKNOWN until then
    */
-  uint16_t getPreviewInput();
+  ATEMModel getModel() const { return _capabilities ? _capabilities->model : ATEM_MODEL_UNKNOWN; }
+  
+  /**
+   * @brief Get the capabilities of the detected model
+   * @return Entry of ATEM_CAPABILITIES, or nullptr if the model is unknown
+   */
+  const ATEMCapabilities* getCapabilities() const { return _capabilities; }
+  
+  /**
+   * @brief Get the product name reported by the switcher
+   * @return Name from the _pin command (empty until received)
+   */
+  const char* getProductName() const { return _product_name; }
+  
+  /**
+   * @brief Get the protocol version reported by the switcher
+   * @return (major << 16) | minor from the _ver command, 0 until received
+   */
+  uint32_t getProtocolVersion() const { return ((uint32_t)_protocol_major << 16) | _protocol_minor; }
+  
+  /**
+   * @brief Check an input ID against the detected model
+   * @param input Input ID as used by changeProgramInput()
+   * @return true if valid for the model, or if the model is not known yet
+   */
+  bool isValidInput(uint16_t input) const { return !_capabilities || isValidInputForModel(input, _capabilities); }
+  
+  /**
+   * @brief Get the label of an input as configured on the switcher
+   * @param input Input ID
+   * @param short_name true for the 4-character label (tally/multiviewer), false for the long name
+   * @return Switcher label from InPr, or getInputName()/getInputDescription() until it is known
+   * The pointer stays valid for the session; no per-call formatting or copies
+   */
+  const char* getInputLabel(uint16_t input, bool short_name = false) const;
+  
+  /**
+   * @brief Tally of every input as computed by the switcher (TlIn/TlSr)
+   * @return Program/preview bitsets; an input counts as on program when it is
+   *         on air through any path (M/E, keyers, SuperSource)
+   * This is the live map; in task mode the network task updates it, so read
+   * diff.tally inside onTallyChanged() for a consistent copy
+   */
+  const ATEMTally& getTally() const { return _tally; }
+  bool isOnProgram(uint16_t input) const { return _tally.isProgram(input); }
+  bool isOnPreview(uint16_t input) const { return _tally.isPreview(input); }
   
   
   // ===========================================
   // CONTROL FUNCTIONS - PHASE 2 IMPLEMENTATION
   // ===========================================
   
-  // ✅ BASIC SWITCHING (3/4 COMPLETE - MAJOR PROGRESS!)
+  // 📦 COMMAND BATCHING
+  /**
+   * @brief Start collecting control commands into one packet
+   * Every control call until commitBatch() is packed into the same reliable
+   * datagram (split only if it would exceed ATEM_TX_BUFFER_SIZE)
+   */
+  void beginBatch();
+  
+  /**
+   * @brief Send the commands collected since beginBatch()
+   * @return true if the batch was sent (or handed to the network task)
+   */
+  bool commitBatch();
+  
+  /**
+   * @brief Check if a command batch is open
+   * @return true between beginBatch() and commitBatch()
+   */
+  bool isBatching();
+  
+  // 🎬 SEQUENCES
+  /**
+   * @brief Run a timed switching sequence (see ATEM_Sequence.h)
+   * @param steps Step array; not copied, so it must stay valid while it runs
+   * @param count Number of steps
+   * @return false if not connected or the sequence is empty
+   * The first steps go out at once and later ones on the switcher's frame
+   * grid. Replaces a sequence that is still running. Stops when the
+   * connection is lost.
+   */
+  bool runSequence(const ATEMSequenceStep* steps, uint16_t count);
+  template <size_t N>
+  bool runSequence(const ATEMSequenceStep (&steps)[N]) { return runSequence(steps, N); }
+  
+  /**
+   * @brief Stop the running sequence; commands already sent are not undone
+   */
+  void stopSequence();
+  
+  /**
+   * @brief Check if a sequence is running
+   * In task mode this becomes true once the network task has taken the sequence
+   */
+  bool isSequenceRunning() const { return _sequencer.running(); }
+  
+  /**
+   * @brief Index of the step the running sequence is at
+   */
+  uint16_t getSequenceStep() const { return _sequencer.step(); }
+  
+  // ✅ BASIC SWITCHING
+  // Control methods return true once the command is queued, false if an index
+  // or value is out of range for the connected model (logged as a warning).
   /**
    * @brief Change preview input on ATEM switcher ✅ WORKING!
    * @param input Input ID to switch to preview (1=CAM1, 2=CAM2, etc.) 
+   * @param me Mix effect index (default 0)
    */
-  void changePreviewInput(uint16_t input);
+  bool changePreviewInput(uint16_t input, uint8_t me = 0);
   
   /**
    * @brief Change program input on ATEM switcher ✅ WORKING!
    * @param input Input ID to switch to program (1=CAM1, 2=CAM2, etc.)
+   * @param me Mix effect index (default 0)
    */
-  void changeProgramInput(uint16_t input);
+  bool changeProgramInput(uint16_t input, uint8_t me = 0);
   
   /**
    * @brief Perform CUT transition (immediate switch) ✅ IMPLEMENTED!
+   * @param me Mix effect index (default 0)
    * Immediately cuts from preview to program using DCut command
    */
-  void cut();
+  bool cut(uint8_t me = 0);
   
   /**
    * @brief Perform AUTO transition (fade/wipe) ✅ IMPLEMENTED!
+   * @param me Mix effect index (default 0)
    * Performs transition effect from preview to program using DAut command
    */
-  void autoTransition();
+  bool autoTransition(uint8_t me = 0);
   
   // 🔄 ADVANCED SWITCHING
   /**
@@ -223,23 +678,23 @@ public:
    * @param me Mix effect index (default 0)
    * Sends FtbA command to toggle fade to black state
    */
-  void fadeToBlack(uint8_t me = 0);
+  bool fadeToBlack(uint8_t me = 0);
   
   /**
    * @brief Set fade to black rate ✅ IMPLEMENTED!
-   * @param rate Rate in frames
+   * @param rate Rate in frames (up to 255, larger values are rejected)
    * @param me Mix effect index (default 0)
    * Sends FtbC command to set fade to black transition rate
    */
-  void setFadeToBlackRate(uint16_t rate, uint8_t me = 0);
+  bool setFadeToBlackRate(uint16_t rate, uint8_t me = 0);
   
   /**
    * @brief Set transition position manually ✅ IMPLEMENTED!
    * @param position Position 0-10000 (0=preview, 10000=program)
    * @param me Mix effect index (default 0)
-   * Sends CTPs command to set transition position
+   * Sends CTPs command to set transition position (paced, see setPacing())
    */
-  void setTransitionPosition(uint16_t position, uint8_t me = 0);
+  bool setTransitionPosition(uint16_t position, uint8_t me = 0);
   
   /**
    * @brief Enable/disable transition preview ✅ IMPLEMENTED!
@@ -247,32 +702,32 @@ public:
    * @param me Mix effect index (default 0)
    * Sends CTPr command to enable/disable transition preview
    */
-  void previewTransition(bool on, uint8_t me = 0);
+  bool previewTransition(bool on, uint8_t me = 0);
   
   // 🔄 AUX & DOWNSTREAM KEYS
   /**
    * @brief Set AUX output source
    * @param source Input source ID
    * @param bus AUX bus index (default 0)
-   * TODO: Send CAuS command
+   * Sends CAuS command ✅ IMPLEMENTED!
    */
-  void setAuxSource(uint16_t source, uint8_t bus = 0);
+  bool setAuxSource(uint16_t source, uint8_t bus = 0);
   
   /**
    * @brief Set downstream key on air state
    * @param onAir Enable/disable downstream key
    * @param key Downstream key index (default 0)
-   * TODO: Send CDsL command
+   * Sends CDsL command ✅ IMPLEMENTED!
    */
-  void setDownstreamKeyOnAir(bool onAir, uint8_t key = 0);
+  bool setDownstreamKeyOnAir(bool onAir, uint8_t key = 0);
   
   /**
    * @brief Auto transition downstream key
    * @param key Downstream key index (default 0)
    * @param isTowardsOnAir Direction of auto transition
-   * TODO: Send DDsA command
+   * Sends DDsA command ✅ IMPLEMENTED!
    */
-  void autoDownstreamKey(uint8_t key = 0, bool isTowardsOnAir = true);
+  bool autoDownstreamKey(uint8_t key = 0, bool isTowardsOnAir = true);
   
   // 🔄 UPSTREAM KEYS
   /**
@@ -280,27 +735,27 @@ public:
    * @param onAir Enable/disable upstream keyer
    * @param me Mix effect index (default 0)
    * @param keyer Keyer index (default 0)
-   * TODO: Send CKOn command
+   * Sends CKOn command ✅ IMPLEMENTED!
    */
-  void setUpstreamKeyerOnAir(bool onAir, uint8_t me = 0, uint8_t keyer = 0);
+  bool setUpstreamKeyerOnAir(bool onAir, uint8_t me = 0, uint8_t keyer = 0);
   
   /**
    * @brief Set upstream keyer cut source
    * @param cutSource Input source for cut
    * @param me Mix effect index (default 0)  
    * @param keyer Keyer index (default 0)
-   * TODO: Send CKeC command
+   * Sends CKeC command ✅ IMPLEMENTED!
    */
-  void setUpstreamKeyerCutSource(uint16_t cutSource, uint8_t me = 0, uint8_t keyer = 0);
+  bool setUpstreamKeyerCutSource(uint16_t cutSource, uint8_t me = 0, uint8_t keyer = 0);
   
   /**
    * @brief Set upstream keyer fill source
    * @param fillSource Input source for fill
    * @param me Mix effect index (default 0)
    * @param keyer Keyer index (default 0)
-   * TODO: Send CKeF command
+   * Sends CKeF command ✅ IMPLEMENTED!
    */
-  void setUpstreamKeyerFillSource(uint16_t fillSource, uint8_t me = 0, uint8_t keyer = 0);
+  bool setUpstreamKeyerFillSource(uint16_t fillSource, uint8_t me = 0, uint8_t keyer = 0);
   
   // 🔄 MEDIA & SETTINGS
   /**
@@ -309,43 +764,43 @@ public:
    * @param saturation Saturation (0.0-1.0)
    * @param lightness Lightness (0.0-1.0)
    * @param index Color generator index (default 0)
-   * TODO: Send CClV command
+   * Sends CClV command (paced, see setPacing()) ✅ IMPLEMENTED!
    */
-  void setColorGeneratorColour(float hue, float saturation, float lightness, uint8_t index = 0);
+  bool setColorGeneratorColour(float hue, float saturation, float lightness, uint8_t index = 0);
   
   /**
    * @brief Set media player source
    * @param sourceType Source type (1=still, 2=clip)
    * @param sourceIndex Source index
    * @param player Media player index (default 0)
-   * TODO: Send MPCS command
+   * Sends MPCS command ✅ IMPLEMENTED!
    */
-  void setMediaPlayerSource(uint8_t sourceType, uint8_t sourceIndex, uint8_t player = 0);
+  bool setMediaPlayerSource(uint8_t sourceType, uint8_t sourceIndex, uint8_t player = 0);
   
   /**
    * @brief Set multiviewer window source
    * @param source Input source ID
    * @param mv Multiviewer index (default 0)
    * @param window Window index (default 0)
-   * TODO: Send CMvI command
+   * Sends CMvI command ✅ IMPLEMENTED!
    */
-  void setMultiViewerWindowSource(uint16_t source, uint8_t mv = 0, uint8_t window = 0);
+  bool setMultiViewerWindowSource(uint16_t source, uint8_t mv = 0, uint8_t window = 0);
   
   // 🔄 AUDIO (BASIC)
   /**
    * @brief Set classic audio mixer input gain
-   * @param input Input index
+   * @param input Audio input index (input IDs, 1001+ for XLR/RCA/MP1/MP2)
    * @param gain Gain level (-60.0 to 6.0 dB)
-   * TODO: Send CAIP command
+   * Sends CAMI command (paced, see setPacing()) ✅ IMPLEMENTED!
    */
-  void setClassicAudioMixerInputGain(uint8_t input, float gain);
+  bool setClassicAudioMixerInputGain(uint16_t input, float gain);
   
   /**
    * @brief Set classic audio mixer master gain
    * @param gain Master gain level (-60.0 to 6.0 dB)
-   * TODO: Send CAMP command
+   * Sends CAMM command ✅ IMPLEMENTED!
    */
-  void setClassicAudioMixerMasterGain(float gain);
+  bool setClassicAudioMixerMasterGain(float gain);
   
   // Event Callbacks - override these for custom behavior
   /**
@@ -356,26 +811,51 @@ public:
   virtual void onConnectionStateChanged(ATEMConnectionState state);
   
   /**
-   * @brief Callback triggered when program input changes
+   * @brief Callback triggered when program input of M/E 1 changes
    * @param input New program input ID
    * Override this method to handle program input changes in your application
    */
   virtual void onProgramInputChanged(uint16_t input);
   
   /**
-   * @brief Callback triggered when preview input changes
+   * @brief Callback triggered when preview input of M/E 1 changes
    * @param input New preview input ID
    * Override this method to handle preview input changes in your application
    */
   virtual void onPreviewInputChanged(uint16_t input);
   
+  /**
+   * @brief Callback triggered when the program input of any M/E changes
+   * @param me Mix effect index
+   * @param input New program input ID
+   * The default implementation forwards M/E 0 to onProgramInputChanged(input)
+   */
+  virtual void onMixEffectProgramChanged(uint8_t me, uint16_t input);
+  
+  /**
+   * @brief Callback triggered when the preview input of any M/E changes
+   * @param me Mix effect index
+   * @param input New preview input ID
+   * The default implementation forwards M/E 0 to onPreviewInputChanged(input)
+   */
+  virtual void onMixEffectPreviewChanged(uint8_t me, uint16_t input);
+  
   /**
    * @brief Callback triggered when any ATEM state changes
-   * Called after any state variable is updated (program, preview, transition)
+   * Called once per runLoop() in which the state store was updated; call
+   * getStateChanges() to see which sections changed and getStateChangeMasks()
+   * for the entries within them
    * Override this method for general state change handling
    */
   virtual void onStateChanged();
   
+  /**
+   * @brief Callback triggered when the tally of any input changes
+   * @param diff Inputs whose program or preview bit flipped, and the new tally
+   * Only called when at least one bit changed since the previous call
+   */
+  virtual void onTallyChanged(const ATEMTallyDiff& diff);
+  
   // Debug functions
   /**
    * @brief Enable or disable debug output to Serial
@@ -398,6 +878,16 @@ public:
    */
   ATEMLogLevel getLogLevel() { return _log_level; }
   
+  /**
+   * @brief Check whether a log level would currently be printed
+   * @param level Level to test
+   * @return true if level is within both ATEM_MAX_LOG_LEVEL and setLogLevel()
+   * Constant-folds to false for levels above ATEM_MAX_LOG_LEVEL
+   */
+  bool logEnabled(ATEMLogLevel level) const {
+    return level <= ATEM_MAX_LOG_LEVEL && level <= _log_level;
+  }
+  
   /**
    * @brief Print detailed connection information to Serial
    * Displays current state, IP, session ID, packet counters, and input states
@@ -405,6 +895,34 @@ public:
    */
   void printConnectionInfo();
   
+#if ATEM_METRICS
+  // Metrics (build with -DATEM_METRICS=1)
+  /**
+   * @brief Get the latency histograms and traffic counters
+   * @return Live metrics, updated by the protocol engine
+   * In task mode the network task updates them while you read; use copyMetrics()
+   */
+  const ATEMMetrics& getMetrics() const { return _metrics; }
+  
+  /**
+   * @brief Copy the metrics as of one moment
+   * @param out Destination (about 1.5 KB, so not a small stack)
+   * In task mode the copy is taken between two network task passes.
+   */
+  void copyMetrics(ATEMMetrics& out);
+  
+  /**
+   * @brief Clear all metrics and start a new measurement window
+   * In task mode the network task clears them before its next pass.
+   */
+  void resetMetrics();
+  
+  /**
+   * @brief Print a metrics summary (p50/p99/max per measured command) to Serial
+   */
+  void printMetrics();
+#endif
+  
   /**
    * @brief Print library version information to Serial
    * Displays version number, build date, and library basis
@@ -424,48 +942,275 @@ public:
    * @param data Pointer to packet data
    * @param length Packet length
    */
-  void printSofieFormat(const char* prefix, uint8_t* data, int length);
+  void printSofieFormat(const char* prefix, const uint8_t* data, int length);
 
 private:
   // Network
-  WiFiUDP _udp;                    // UDP socket for ATEM communication
+  ATEMDefaultTransport _default_transport; // WiFiUDP, or raw lwIP with ATEM_STATIC_MEMORY on ESP32
+  ATEMTransport* _transport;       // Socket for ATEM communication (_default_transport unless replaced)
   IPAddress _switcher_ip;          // IP address of ATEM switcher
   bool _udp_initialized;           // Track UDP socket initialization status
+  uint8_t _rx_buffer[MAX_PACKET_SIZE]; // Receive copy for transports that cannot lend their buffers
+  ATEMCapture* _capture;           // Traffic capture (see setCapture()), nullptr if off
   
   // Connection State
   ATEMConnectionState _connection_state;  // Current connection status
   uint16_t _session_id;                   // Session ID for this connection
   uint16_t _local_packet_id;              // Counter for outgoing packets
-  uint16_t _remote_packet_id;             // Last received packet ID from ATEM
-  unsigned long _last_heartbeat;          // Timestamp of last heartbeat sent
+  uint16_t _command_packet_id;            // ID of the last packet flushCommands() sent
+  ATEMReceiveWindow _rx_window;           // Packet IDs received from ATEM (cumulative ACK point)
+  uint16_t _heartbeat_phase;              // Heartbeat slot offset (see setHeartbeatPhase())
+  bool _heartbeat_aligned;                // setHeartbeatPhase() was called
   unsigned long _last_received;           // Timestamp of last packet received
+  ATEMTimers _timers;                     // Protocol deadlines (ATEM_Timers.h)
   unsigned long _connection_start_time;   // When connection attempt started
+  unsigned long _last_hello;              // When the last HELLO was sent
+  uint16_t _hello_retry_interval;         // Current HELLO resend interval (ms)
+  uint8_t _hello_attempts;                // HELLO packets sent in this attempt
+  bool _network_diagnostics;              // Run TCP probe / UDP test in begin()
+  bool _auto_reconnect;                   // Reconnect supervisor enabled
+  uint8_t _reconnect_attempts;            // Failed attempts since the last connection
   
   // ATEM State
   ATEMState _state;                // Current ATEM switcher state
-  bool _state_dirty;               // Flag indicating state has changed
+  ATEMTally _tally;                // Live tally bitsets
+  ATEMTally _tally_reported;       // Tally as of the last onTallyChanged() call
+  ATEMSeqLock _state_lock;         // Held by the network task while it updates _state and _tally
+  ATEMStateChanges _state_changes; // Changes not yet published (network side)
+  struct PublishedChanges {
+    ATEMStateChanges changes;
+    uint32_t generation;           // Bumped per publication
+  } _published_changes;            // Under _state_lock, read by onStateChanged() delivery
+  std::atomic<uint32_t> _reported_generation;  // Last publication onStateChanged() reported
+  uint16_t _subscriptions;         // ATEM_SUBSCRIBE_* families decoded (see setSubscriptions())
+  
+#if ATEM_METRICS
+  // Metrics
+  ATEMMetrics _metrics;
+  ATEMSeqLock _metrics_lock;                   // Held by the network task for each pass
+  volatile bool _metrics_reset_requested;      // resetMetrics() from another task
+  uint32_t _command_sent_us[ATEM_CMD_COUNT];   // micros() when each command type was last sent
+  uint32_t _commands_awaiting;                 // Bit n = ATEMCommandId n waits for confirmation
+  uint32_t _ack_sample_us;                     // micros() when _ack_sample_id was sent
+  uint16_t _ack_sample_id;                     // Packet timed for the ACK round trip
+  bool _ack_sample_pending;
+  uint32_t _last_service_us;                   // Previous serviceConnection() call
+  unsigned long _rx_rate_window;               // millis() when the current 1 s rate window began
+  uint32_t _rx_rate_count;                     // Datagrams in the current window
+  
+  /**
+   * @brief Record the round trip of commands confirmed by a received command
+   * @param name Received command name as atemFourCC()
+   */
+  void recordConfirmation(uint32_t name);
+  
+  /**
+   * @brief Count a received datagram and roll the per-second rate window
+   */
+  void recordReceivedDatagram();
+#endif
+  
+  // Switcher identification
+  const ATEMCapabilities* _capabilities;            // Detected model, nullptr until _pin
+  char _product_name[ATEM_PRODUCT_NAME_LENGTH + 1]; // From _pin
+  uint16_t _protocol_major;                         // From _ver
+  uint16_t _protocol_minor;
+  ATEMStateChanges _delivered_changes;  // Changes of the onStateChanged() call in progress
+  uint8_t _delivered_flags;        // ATEM_EVENT_FLAG_* of the input callback in progress
   
   // Packet Retransmission Storage
-  struct StoredPacket {
-    uint16_t packet_id;            // Packet ID for this stored packet
-    uint8_t data[MAX_PACKET_SIZE]; // Packet data
-    int length;                    // Actual length of packet data
-    unsigned long timestamp;       // When packet was sent
-    bool in_use;                   // Whether this slot is occupied
+  ATEMRetransmitStore _sent_packets; // Ring arena of unacknowledged outgoing packets
+  
+  // Command encoding (see beginCommand())
+  struct QueuedCommand {
+    uint8_t id;                                // ATEMCommandId
+    uint8_t flags;                             // QUEUED_COMMAND_* flags
+    uint8_t payload[ATEM_MAX_COMMAND_PAYLOAD]; // Encoded payload
   };
-  StoredPacket _sent_packets[MAX_RETRANSMIT_PACKETS]; // Circular buffer for sent packets
-  int _packet_buffer_index;        // Current index in circular buffer
+  static const uint8_t QUEUED_COMMAND_BATCH_CONTINUES = 0x01; // More commands of the batch follow
+  static const uint8_t QUEUED_COMMAND_PACED = 0x02;           // Goes through _pacer
+  static const uint8_t QUEUED_COMMAND_SEQUENCE = 0x04;        // Payload is a step pointer and count, not a command
+  uint8_t _tx_buffer[ATEM_TX_BUFFER_SIZE];     // Reusable outgoing packet buffer
+  uint16_t _tx_length;                         // Bytes encoded in _tx_buffer (0 = idle)
+  uint8_t _tx_count;                           // Command blocks in _tx_buffer
+  bool _batching;                              // Between beginBatch() and commitBatch()
+  bool _coalescing;                            // Sequence steps of one frame are being encoded
+  QueuedCommand _staged_command;               // Application-side record for the network task
+  bool _command_staged;                        // _staged_command awaits commitCommand()
+  ATEMPacer _pacer;                            // Latest-value-wins channel (see setPacing())
+  QueuedCommand _paced_command;                // Paced value being encoded in direct mode
+  bool _paced_staged;                          // _paced_command awaits commitCommand()
+  
+  // Optimistic updates (see setOptimisticUpdates())
+  bool _optimistic;                            // Speculate on our own switching commands
+  ATEMSpeculations _speculations;              // Confirmed values behind the speculated state
+  uint32_t _rollbacks;                         // Speculations undone
+  
+  // Sequence engine (see runSequence())
+  ATEMSequencer _sequencer;                    // Runs in the network context
+  uint8_t _transitions_started;                // Bit n = M/E n reported a running transition
+  
+  // Network task (see enableNetworkTask())
+  bool _task_mode;                 // Protocol runs in the network task
+  volatile bool _task_running;     // Cleared to ask the task to exit
+  volatile bool _task_active;      // Task exists: events are queued, commands forwarded (cleared by the task on exit)
+  int8_t _task_core;               // Core the task is pinned to (-1 = any)
+  uint8_t _task_priority;          // FreeRTOS priority
+  uint32_t _task_stack_size;       // Stack size in bytes
+  uint32_t _events_dropped;        // Events lost because the queue was full
+  ATEMSpscQueue<QueuedCommand, ATEM_COMMAND_QUEUE_SIZE> _command_queue; // App -> task
+  ATEMSpscQueue<ATEMEvent, ATEM_EVENT_QUEUE_SIZE> _event_queue;       // Task -> app
+  
+  // User command handlers (registerCommandHandler())
+  struct CommandHandlerSlot {
+    uint32_t name;                 // atemFourCC() of the command
+    ATEMCommandHandler handler;
+    void* context;
+  };
+  CommandHandlerSlot _command_handlers[ATEM_MAX_COMMAND_HANDLERS];
+  uint8_t _command_handler_count;
+#if ATEM_HAS_NETWORK_TASK
+  TaskHandle_t _task_handle;       // Handle of the running network task
+#if ATEM_STATIC_MEMORY
+  StaticTask_t _task_control;      // Task control block, so xTaskCreateStatic() needs no heap
+  StackType_t _task_stack[ATEM_TASK_STACK_SIZE / sizeof(StackType_t)];
+#endif
+  
+  /**
+   * @brief Create the network task (task mode part of begin()/beginAsync())
+   * @return true if the task was created
+   */
+  bool startNetworkTask();
+  
+  /**
+   * @brief FreeRTOS entry point of the network task
+   * @param arg Pointer to the owning ATEM instance
+   */
+  static void networkTaskEntry(void* arg);
+#endif
+  
+  // Receive batching
+  uint8_t _rx_batch_max;           // Datagrams drained per runLoop() call
+  uint32_t _rx_batch_budget_us;    // Microsecond budget per runLoop() call (0 = unlimited)
   
   // Logging
   ATEMLogLevel _log_level;         // Current logging verbosity level
   
+  // Connection Setup Functions
+  /**
+   * @brief Shared setup for begin() and beginAsync(): banner, UDP socket, diagnostics
+   * @param ip IPAddress of the ATEM switcher
+   * @return true if the UDP socket was opened
+   */
+  bool setupConnection(IPAddress ip);
+  
+  /**
+   * @brief Opt-in TCP probe and UDP test send (see setNetworkDiagnostics())
+   */
+  void runNetworkDiagnostics();
+  
+  /**
+   * @brief Reset session tracking, report CONNECTING and send the first HELLO
+   */
+  void startHandshake();
+  
+  /**
+   * @brief Mark the connection lost: state stale, report ERROR, schedule reconnect
+   */
+  void connectionLost();
+  
+  /**
+   * @brief Schedule the next reconnect attempt with jittered exponential backoff
+   */
+  void scheduleReconnect();
+  
+  /**
+   * @brief Run the action of an expired protocol timer
+   * @param timer Expired timer
+   * @param now Current millis()
+   */
+  void handleTimer(ATEMTimerId timer, unsigned long now);
+  
+  /**
+   * @brief Send the 20-byte HELLO packet
+   * @return true if the UDP write succeeded
+   */
+  bool sendHello();
+  
+  // Network Task Functions
+  /**
+   * @brief Process incoming packets, expired timers and state notifications
+   * @return Milliseconds until the next protocol deadline
+   * Body of runLoop() in direct mode; called periodically by the network task in task mode
+   */
+  uint32_t serviceConnection();
+  
+  /**
+   * @brief Stop the network task and wait for it to exit
+   */
+  void stopNetworkTask();
+  
+  /**
+   * @brief Check whether a control call must be forwarded to the network task
+   * @return true when in task mode and called from a task other than the network task
+   */
+  bool shouldQueueCommand();
+  
+  /**
+   * @brief Copy part of the state store, tally or metrics without tearing it
+   * @param lock Seqlock the network task holds while it updates src
+   * Retries while the network task updates it (see ATEMSeqLock)
+   */
+  void readShared(const ATEMSeqLock& lock, void* dest, const void* src, size_t size);
+  
+  /**
+   * @brief Send all queued control commands (network task side)
+   */
+  void executeQueuedCommands();
+  
+  /**
+   * @brief Deliver queued events to the virtual callbacks (application side)
+   */
+  void dispatchEvents();
+  
+  /**
+   * @brief Report an event, either directly to the callbacks or via the event queue
+   * @param type ATEMEventType
+   * @param me Mix effect index
+   * @param value Event payload
+   * @param flags ATEM_EVENT_FLAG_* bits
+   */
+  void notify(uint8_t type, uint8_t me = 0, uint16_t value = 0, uint8_t flags = 0);
+  
+  /**
+   * @brief Invoke the virtual callback matching an event
+   * @param event Event to deliver
+   */
+  void deliverEvent(const ATEMEvent& event);
+  
   // Protocol Functions
   /**
-   * @brief Process incoming UDP packets from ATEM
+   * @brief Process one incoming UDP packet from ATEM
+   * @return true if a datagram was read from the socket, false if none was pending
    * Reads available UDP data, validates packet size, and calls parsePacket()
    * Updates _last_received timestamp and prints debug info if enabled
    */
-  void processIncomingPacket();
+  bool processIncomingPacket();
+  
+  /**
+   * @brief Drain queued UDP packets within the configured batch limits
+   * @return Number of datagrams processed
+   * Calls processIncomingPacket() until the socket is empty, the datagram limit
+   * is reached, or the microsecond budget is spent
+   */
+  int processIncomingPackets();
+  
+  /**
+   * @brief Time the next heartbeat interval counts from
+   * @param now millis() of the heartbeat
+   * @return now, or the start of its slot when setHeartbeatPhase() is in use
+   */
+  unsigned long alignHeartbeat(unsigned long now);
   
   /**
    * @brief Parse received ATEM packet and handle protocol logic
@@ -474,23 +1219,94 @@ private:
    * @return true if packet processed successfully, false on error
    * Handles connection responses, ACKs, and command processing
    */
-  bool parsePacket(uint8_t* buffer, int length);
+  bool parsePacket(const uint8_t* buffer, int length);
   
   /**
-   * @brief Process individual ATEM command (unused - placeholder)
-   * @param cmd Pointer to ATEMCommand structure
-   * TODO: Future implementation for structured command processing
+   * @brief Start encoding a control command
+   * @param id Command from ATEM_COMMAND_SPECS
+   * @param paced Latest-value-wins command (see setPacing())
+   * @return Zeroed payload to fill with atemPut*(), or nullptr if not connected
+   * Writes into _tx_buffer, or into a queue record when called from the
+   * application while the network task is running. A paced command is encoded
+   * into a scratch record and handed to _pacer by commitCommand()
    */
-  void processCommand(ATEMCommand* cmd);
+  uint8_t* beginCommand(ATEMCommandId id, bool paced = false);
   
   /**
-   * @brief Send packet to ATEM switcher (unused - placeholder)
-   * @param flags Packet flags byte
-   * @param data Optional data payload
-   * @param data_length Length of data payload
-   * TODO: Future implementation for general packet sending
+   * @brief Send (or queue) the command started by beginCommand()
+   * @return true on success
+   * Inside a batch the command stays in the TX buffer until commitBatch()
    */
-  void sendPacket(uint8_t flags, uint8_t* data = nullptr, int data_length = 0);
+  bool commitCommand();
+  
+  /**
+   * @brief Push the staged command record to the network task
+   * @param batch_continues More commands of the same batch follow
+   * @return false if the command queue was full
+   */
+  bool pushStagedCommand(bool batch_continues);
+  
+  /**
+   * @brief Send the paced values that are due (network context)
+   * Arms ATEM_TIMER_PACING when the next tick is still ahead
+   */
+  void servicePacedCommands();
+  
+  /**
+   * @brief Append every paced value that has no packet in flight to _tx_buffer
+   * @return Number of values appended
+   */
+  uint8_t appendPacedCommands();
+  
+  /**
+   * @brief Start or stop a sequence in the network context
+   * @param steps Step array, nullptr to stop
+   */
+  void startSequence(const ATEMSequenceStep* steps, uint16_t count);
+  
+  /**
+   * @brief Start or stop a sequence from either side
+   * From the application in task mode the request is queued to the network
+   * task behind the commands already queued; otherwise it is applied at once
+   * @return false if the command queue was full
+   */
+  bool requestSequence(const ATEMSequenceStep* steps, uint16_t count);
+  
+  /**
+   * @brief Run the sequence steps that are due (network context)
+   * Steps up to the next wait go out in one packet; arms ATEM_TIMER_SEQUENCE
+   * for the next frame the sequence waits for
+   */
+  void serviceSequence();
+  
+  /**
+   * @brief Run one sequence step
+   * @return true to go on with the next step in the same frame, false to wait
+   */
+  bool runSequenceStep(const ATEMSequenceStep& step);
+  
+  /**
+   * @brief Append a command block to the packet in _tx_buffer
+   * @param id Command from ATEM_COMMAND_SPECS
+   * @return Zeroed payload, or nullptr if not connected
+   * Sends the pending packet first if the block would not fit
+   */
+  uint8_t* appendCommand(ATEMCommandId id);
+  
+  /**
+   * @brief Send the commands collected in _tx_buffer as one reliable packet
+   * @return true if nothing was pending or the packet was sent
+   */
+  bool flushCommands();
+  
+  /**
+   * @brief Send a reliable packet to the ATEM switcher
+   * @param packet Packet buffer, header bytes are filled in
+   * @param length Total packet length including the 12-byte header
+   * @return true if the UDP write succeeded
+   * Stores the packet for retransmission and advances the local packet ID
+   */
+  bool sendPacket(uint8_t* packet, uint16_t length);
   
   /**
    * @brief Send heartbeat packet to maintain connection
@@ -511,16 +1327,17 @@ private:
    * @param packet_id ID of the packet being sent
    * @param data Pointer to packet data
    * @param length Length of packet data
-   * Stores packet in circular buffer for retransmission on request
+   * Copies packet into the retransmit arena, evicting the oldest packets if full
    */
   void storePacketForRetransmission(uint16_t packet_id, uint8_t* data, int length);
   
   /**
    * @brief Handle retransmit request from ATEM
-   * @param requested_packet_id ID of packet requested for retransmission
-   * Searches stored packets and resends if found, or sends current sync if not
+   * @param from_packet_id First packet ID requested for retransmission
+   * @param sequence_to_ack Remote packet ID to acknowledge after resending
+   * Resends the requested packet and every stored packet sent after it
    */
-  void handleRetransmitRequest(uint16_t requested_packet_id, uint16_t sequence_to_ack);
+  void handleRetransmitRequest(uint16_t from_packet_id, uint16_t sequence_to_ack);
   
   // Command Processing
   /**
@@ -529,7 +1346,149 @@ private:
    * @param length Length of command data
    * Parses multiple commands in single packet and dispatches to specific handlers
    */
-  void processInitialPayload(uint8_t* data, int length);
+  void processInitialPayload(const uint8_t* data, int length);
+  
+  /**
+   * @brief Route one received command to its handler
+   * @param name Command name as atemFourCC()
+   * @param payload View of the command payload inside the receive buffer
+   * Built-in handlers are a switch on the 32-bit name, then user handlers run
+   */
+  void dispatchCommand(uint32_t name, ATEMByteView payload);
+  
+  /**
+   * @brief Send one datagram to the switcher, recording it in the capture
+   * @return true if the transport accepted the whole datagram
+   */
+  bool sendDatagram(const uint8_t* data, uint16_t length);
+  
+  /**
+   * @brief Check whether a command family is decoded
+   * @param family ATEM_SUBSCRIBE_* bit
+   * Constant-folds to false for families left out of ATEM_SUBSCRIPTIONS, so
+   * the calls to their handlers compile away
+   */
+  bool subscribed(uint16_t family) const {
+    return (ATEM_SUBSCRIPTIONS & family) && (_subscriptions & family);
+  }
+  
+  /**
+   * @brief Process Initialization Complete (InCm): the state dump has arrived
+   */
+  void processInitComplete();
+  
+  /**
+   * @brief Record a state update to report through onStateChanged()
+   * @param change ATEM_STATE_CHANGED_* bit of the section that was updated
+   * @param index Entry within the section (see atemStateChangesMark())
+   */
+  void markStateChanged(uint16_t change, uint8_t index = 0) {
+    atemStateChangesMark(_state_changes, change, index);
+  }
+  
+  /**
+   * @brief Hand the collected changes to the application side (network context)
+   * Replaces the published changes once they were reported, merges into them
+   * otherwise, so a slow application sees every change at least once
+   */
+  void publishStateChanges();
+  
+  /**
+   * @brief Check an M/E index before encoding a control command
+   * @param me Mix effect index
+   * @return true if the connected model has this M/E (logs a warning otherwise)
+   */
+  bool checkMixEffect(uint8_t me);
+  
+  /**
+   * @brief Check an M/E and upstream keyer index before encoding a keyer command
+   * @param me Mix effect index
+   * @param keyer Upstream keyer index within the M/E
+   * @return true if the M/E exists and has this keyer (logs a warning otherwise)
+   */
+  bool checkUpstreamKeyer(uint8_t me, uint8_t keyer);
+  
+  /**
+   * @brief Check the bus/keyer/generator/player index of a command
+   * @param id Command whose index field is checked (see atemCommandIndexCount())
+   * @param index Index the caller passed
+   * @return true if the detected model has it, or the model is not known yet
+   */
+  bool checkIndex(ATEMCommandId id, uint8_t index);
+  
+  /**
+   * @brief Check an input ID before encoding a switching command
+   * @param input Input ID
+   * @return true if the detected model has this input (logs a warning otherwise)
+   */
+  bool checkInput(uint16_t input);
+  
+  /**
+   * @brief Get the state of an M/E reported by the switcher
+   * @param me M/E index from the command payload
+   * @return Entry in the state store, or nullptr if the index is out of range
+   */
+  ATEMMixEffectState* mixEffectState(uint8_t me);
+  
+  /**
+   * @brief Set the program or preview input of an M/E and report the change
+   * @param field ATEM_SPECULATED_PROGRAM or ATEM_SPECULATED_PREVIEW
+   * @param me M/E index (already checked)
+   * @param input New input ID
+   * @param event_flags ATEM_EVENT_FLAG_* bits for the callback
+   * @return true if the value changed
+   */
+  bool applyMixEffectInput(ATEMSpeculatedField field, uint8_t me, uint16_t input, uint8_t event_flags);
+  
+  /**
+   * @brief Show the expected result of a switching command before it is confirmed
+   * Call after commitCommand(). No-op unless optimistic updates are on, we are
+   * connected and not in task mode
+   */
+  void speculate(ATEMSpeculatedField field, uint8_t me, uint16_t input);
+  
+  /**
+   * @brief Match a received PrgI/PrvI against an open speculation
+   * @return true if the update was consumed (confirmed, or held back until
+   *         our command takes effect); false to apply it normally
+   */
+  bool reconcileSpeculation(ATEMSpeculatedField field, uint8_t me, uint16_t input);
+  
+  /**
+   * @brief Restore the confirmed value of a speculation and drop it
+   */
+  void rollbackSpeculation(ATEMSpeculations::Entry& entry);
+  
+  /**
+   * @brief Roll back every open speculation (connection lost or closed)
+   */
+  void rollbackSpeculations();
+  
+  /**
+   * @brief Arm ATEM_TIMER_OPTIMISTIC for the earliest speculation deadline
+   */
+  void armSpeculationTimer();
+  
+  // State dump / update handlers (payload already stripped of its 8-byte header)
+  void processVersion(const uint8_t* data, int length);               // _ver
+  void processProductId(const uint8_t* data, int length);             // _pin
+  void processTopology(const uint8_t* data, int length);              // _top
+  void processVideoMode(const uint8_t* data, int length);             // VidM
+  void processMixEffectConfig(const uint8_t* data, int length);       // _MeC
+  void processTransitionPosition(const uint8_t* data, int length);    // TrPs
+  void processTransitionProperties(const uint8_t* data, int length);  // TrSS
+  void processTransitionPreview(const uint8_t* data, int length);     // TrPr
+  void processKeyerOnAir(const uint8_t* data, int length);            // KeOn
+  void processDownstreamKeyerState(const uint8_t* data, int length);  // DskS
+  void processDownstreamKeyerProperties(const uint8_t* data, int length); // DskP
+  void processDownstreamKeyerSources(const uint8_t* data, int length);    // DskB
+  void processFadeToBlackState(const uint8_t* data, int length);      // FtbS
+  void processFadeToBlackProperties(const uint8_t* data, int length); // FtbP
+  void processAuxSource(const uint8_t* data, int length);             // AuxS
+  void processMediaPlayerSource(const uint8_t* data, int length);     // MPCE
+  void processInputProperties(const uint8_t* data, int length);       // InPr
+  void processTallyByIndex(const uint8_t* data, int length);          // TlIn
+  void processTallyBySource(const uint8_t* data, int length);         // TlSr
   
   /**
    * @brief Process Program Input (PrgI) command from ATEM
@@ -537,7 +1496,7 @@ private:
    * @param length Length of command data
    * Updates internal program input state and triggers events
    */
-  void processProgramInput(uint8_t* data, int length);
+  void processProgramInput(const uint8_t* data, int length);
   
   /**
    * @brief Process Preview Input (PrvI) command from ATEM  
@@ -545,7 +1504,7 @@ private:
    * @param length Length of command data
    * Updates internal preview input state and triggers events
    */
-  void processPreviewInput(uint8_t* data, int length);
+  void processPreviewInput(const uint8_t* data, int length);
   
   // Utility Functions
   /**
@@ -570,7 +1529,7 @@ private:
    * @param length Number of bytes to dump
    * Prints hex bytes with bounds checking, 16 bytes per line
    */
-  void debugPrintHex(uint8_t* data, int length);
+  void debugPrintHex(const uint8_t* data, int length);
   
   // Logging Functions
   /**
@@ -609,7 +1568,22 @@ private:
    * @param format Printf-style format string
    * @param ... Additional arguments for format string
    */
-  void logPrintf(ATEMLogLevel level, const char* format, ...);
+  void logPrintf(ATEMLogLevel level, const char* format, ...) ATEM_PRINTF_FORMAT(3, 4);
+  
+  /**
+   * @brief Print a labelled hex dump if the log level allows
+   * @param level Log level of the dump
+   * @param label Text printed before the bytes
+   * @param data Bytes to dump
+   * @param length Number of bytes
+   */
+  void logHex(ATEMLogLevel level, const char* label, const uint8_t* data, int length);
+  
+  /**
+   * @brief Print the "[ATEM ...] " prefix for a log level
+   * @param level Log level
+   */
+  void printLogPrefix(ATEMLogLevel level);
 };
 
 #endif // ATEM_H
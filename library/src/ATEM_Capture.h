@@ -0,0 +1,437 @@
+#ifndef ATEM_CAPTURE_H
+#define ATEM_CAPTURE_H
+
+#include <stdint.h>
+#include <string.h>  // For memcpy, memcmp
+#include <Arduino.h>  // For Print, micros()
+#include "ATEM_Transport.h"
+
+/**
+ * @file ATEM_Capture.h
+ * @brief Binary capture ring of raw protocol traffic, and its replay
+ *
+ * ATEMCapture keeps the most recent datagrams in both directions, timestamped
+ * with micros(), in a fixed byte budget. Recording is one memcpy per datagram,
+ * so it can stay on during a show instead of the VERBOSE hex dumps:
+ *
+ *   ATEMCapture capture;
+ *   atem.setCapture(&capture);
+ *   ...
+ *   capture.setEnabled(false);              // Freeze the last few seconds
+ *   File file = SD.open("/atem.cap", FILE_WRITE);
+ *   capture.writeTo(file);                  // Any Print: SD, LittleFS, Serial
+ *
+ * setCollector() also forwards every record as one UDP datagram to a collector
+ * as it is captured. The image written by writeTo() (and the collector
+ * datagrams) is "ATEMCAP1" followed by the records, each an 8-byte big-endian
+ * header {u32 time_us, u16 length, u8 direction, u8 reserved} and the datagram.
+ *
+ * ATEMCaptureReplay is a transport that plays the received side of a capture
+ * back into an ATEM instance, e.g. in the host test build next to
+ * ATEMSimulator, to reproduce an issue with the original timing. load()
+ * reads an image back into a capture.
+ *
+ * In network task mode recording runs in the task; freeze the capture with
+ * setEnabled(false) before reading it from loop(). The buffer only exists if
+ * the sketch creates an ATEMCapture.
+ */
+
+// ===========================================
+// COMPILE-TIME CONFIGURATION
+// ===========================================
+#ifndef ATEM_CAPTURE_BUFFER_SIZE
+#define ATEM_CAPTURE_BUFFER_SIZE     16384     // Last few seconds of a busy session
+#endif
+
+#define ATEM_CAPTURE_MAGIC           "ATEMCAP1"
+#define ATEM_CAPTURE_MAGIC_SIZE      8
+#define ATEM_CAPTURE_HEADER_SIZE     8         // Per-record header
+
+static_assert(ATEM_CAPTURE_BUFFER_SIZE > ATEM_CAPTURE_HEADER_SIZE, "ATEM_CAPTURE_BUFFER_SIZE is too small");
+
+enum ATEMCaptureDirection : uint8_t {
+    ATEM_CAPTURE_RX = 0,                     // Received from the switcher
+    ATEM_CAPTURE_TX = 1                      // Sent to the switcher
+};
+
+struct ATEMCaptureRecord {
+    uint32_t time_us;                        // micros() when the datagram was captured
+    ATEMCaptureDirection direction;
+    uint16_t length;
+    const uint8_t* data;                     // Datagram inside the capture buffer
+};
+
+/**
+ * Read position for ATEMCapture::read(), from ATEMCapture::begin()
+ */
+struct ATEMCaptureCursor {
+    uint32_t offset;
+    uint32_t remaining;                      // Records left to read
+};
+
+// ===========================================
+// CAPTURE RING
+// ===========================================
+/**
+ * Records are stored back-to-back and never split across the end of the
+ * buffer (as ATEMRetransmitStore does), so each one can be written or replayed
+ * in place. The oldest records are overwritten when the buffer is full.
+ */
+class ATEMCapture {
+public:
+    ATEMCapture() : _enabled(true), _collector(nullptr), _collector_port(0) { clear(); }
+
+    /**
+     * Drop every record
+     */
+    void clear() {
+        _start = 0;
+        _end = 0;
+        _limit = 0;
+        _count = 0;
+        _wrapped = false;
+        _dropped = 0;
+    }
+
+    /**
+     * Pause or resume recording (pause to keep the traffic before a glitch)
+     */
+    void setEnabled(bool enabled) { _enabled = enabled; }
+    bool isEnabled() const { return _enabled; }
+
+    /**
+     * Forward every record to a collector as it is captured
+     * @param transport Socket to send from (e.g. a spare ATEMWiFiTransport), nullptr to stop
+     * @param ip Collector address
+     * @param port Collector UDP port
+     */
+    void setCollector(ATEMTransport* transport, const IPAddress& ip, uint16_t port) {
+        _collector = transport;
+        _collector_ip = ip;
+        _collector_port = port;
+    }
+
+    /**
+     * Capture one datagram
+     * @param direction ATEM_CAPTURE_RX or ATEM_CAPTURE_TX
+     * @param time_us Timestamp (normally micros())
+     */
+    void record(ATEMCaptureDirection direction, const uint8_t* data, uint16_t length, uint32_t time_us) {
+        if (!_enabled) {
+            return;
+        }
+        uint32_t size = ATEM_CAPTURE_HEADER_SIZE + length;
+        uint32_t offset;
+        if (size > ATEM_CAPTURE_BUFFER_SIZE || !allocate(size, offset)) {
+            _dropped++;
+            return;
+        }
+        uint8_t* header = _buffer + offset;
+        header[0] = time_us >> 24;
+        header[1] = time_us >> 16;
+        header[2] = time_us >> 8;
+        header[3] = time_us;
+        header[4] = length >> 8;
+        header[5] = length;
+        header[6] = direction;
+        header[7] = 0;
+        memcpy(header + ATEM_CAPTURE_HEADER_SIZE, data, length);
+        _count++;
+        if (_collector) {
+            _collector->send(_collector_ip, _collector_port, header, (uint16_t)size);
+        }
+    }
+
+    uint32_t recordCount() const { return _count; }
+
+    /**
+     * Datagrams too large for the whole buffer
+     */
+    uint32_t droppedRecords() const { return _dropped; }
+
+    /**
+     * Walk the records oldest first
+     *   ATEMCaptureCursor cursor = capture.begin();
+     *   ATEMCaptureRecord record;
+     *   while (capture.read(cursor, record)) { ... }
+     */
+    ATEMCaptureCursor begin() const {
+        ATEMCaptureCursor cursor = {_start, _count};
+        return cursor;
+    }
+
+    bool read(ATEMCaptureCursor& cursor, ATEMCaptureRecord& record) const {
+        if (cursor.remaining == 0) {
+            return false;
+        }
+        if (_wrapped && cursor.offset == _limit) {
+            cursor.offset = 0;
+        }
+        const uint8_t* header = _buffer + cursor.offset;
+        record.time_us   = ((uint32_t)header[0] << 24) | ((uint32_t)header[1] << 16) |
+                           ((uint32_t)header[2] << 8) | header[3];
+        record.length    = (header[4] << 8) | header[5];
+        record.direction = (ATEMCaptureDirection)header[6];
+        record.data      = header + ATEM_CAPTURE_HEADER_SIZE;
+        cursor.offset += ATEM_CAPTURE_HEADER_SIZE + record.length;
+        cursor.remaining--;
+        return true;
+    }
+
+    /**
+     * Write the capture as an image (magic, then the records oldest first)
+     * @param out Destination, e.g. an SD or LittleFS File
+     * @return Bytes written
+     */
+    size_t writeTo(Print& out) const {
+        size_t written = out.write((const uint8_t*)ATEM_CAPTURE_MAGIC, ATEM_CAPTURE_MAGIC_SIZE);
+        ATEMCaptureCursor cursor = begin();
+        ATEMCaptureRecord record;
+        while (read(cursor, record)) {
+            written += out.write(record.data - ATEM_CAPTURE_HEADER_SIZE, ATEM_CAPTURE_HEADER_SIZE + record.length);
+        }
+        return written;
+    }
+
+    /**
+     * Replace the records with those of an image written by writeTo()
+     * @return false if the image is not a capture or is truncated (records up
+     *         to the damage are kept)
+     */
+    bool load(const uint8_t* image, uint32_t length) {
+        clear();
+        if (length < ATEM_CAPTURE_MAGIC_SIZE || memcmp(image, ATEM_CAPTURE_MAGIC, ATEM_CAPTURE_MAGIC_SIZE) != 0) {
+            return false;
+        }
+        bool enabled = _enabled;
+        ATEMTransport* collector = _collector;
+        _enabled = true;
+        _collector = nullptr;
+        uint32_t offset = ATEM_CAPTURE_MAGIC_SIZE;
+        bool intact = true;
+        while (offset < length) {
+            const uint8_t* header = image + offset;
+            if (length - offset < ATEM_CAPTURE_HEADER_SIZE ||
+                length - offset - ATEM_CAPTURE_HEADER_SIZE < (uint32_t)((header[4] << 8) | header[5])) {
+                intact = false;
+                break;
+            }
+            uint16_t size = (header[4] << 8) | header[5];
+            uint32_t time_us = ((uint32_t)header[0] << 24) | ((uint32_t)header[1] << 16) |
+                               ((uint32_t)header[2] << 8) | header[3];
+            record((ATEMCaptureDirection)header[6], header + ATEM_CAPTURE_HEADER_SIZE, size, time_us);
+            offset += ATEM_CAPTURE_HEADER_SIZE + size;
+        }
+        _enabled = enabled;
+        _collector = collector;
+        return intact;
+    }
+
+private:
+    uint32_t recordSize(uint32_t offset) const {
+        return ATEM_CAPTURE_HEADER_SIZE + ((_buffer[offset + 4] << 8) | _buffer[offset + 5]);
+    }
+
+    void evictOldest() {
+        _start += recordSize(_start);
+        _count--;
+        if (_count == 0) {
+            _start = _end = _limit = 0;
+            _wrapped = false;
+        } else if (_wrapped && _start == _limit) {
+            _start = 0;  // The rest lies at the beginning of the buffer
+            _wrapped = false;
+        }
+    }
+
+    /**
+     * Find room for a record at the write position, wrapping and evicting as needed
+     */
+    bool allocate(uint32_t size, uint32_t& offset) {
+        for (;;) {
+            if (!_wrapped) {
+                if (_end + size <= ATEM_CAPTURE_BUFFER_SIZE) {
+                    break;
+                }
+                if (_count == 0) {
+                    return false;
+                }
+                _limit = _end;  // Records now continue at offset 0
+                _end = 0;
+                _wrapped = true;
+            }
+            if (_wrapped && _end + size <= _start) {
+                break;
+            }
+            evictOldest();
+        }
+        offset = _end;
+        _end += size;
+        return true;
+    }
+
+    uint8_t _buffer[ATEM_CAPTURE_BUFFER_SIZE];
+    uint32_t _start;                         // Oldest record
+    uint32_t _end;                           // Write position
+    uint32_t _limit;                         // End of the records before the wrap, if _wrapped
+    uint32_t _count;
+    uint32_t _dropped;
+    bool _wrapped;                           // Newer records continue at offset 0
+    bool _enabled;
+    ATEMTransport* _collector;
+    IPAddress _collector_ip;
+    uint16_t _collector_port;
+};
+
+// ===========================================
+// REPLAY TRANSPORT
+// ===========================================
+/**
+ * Plays the received datagrams of a capture back to an ATEM instance
+ *
+ *   ATEMCapture capture;
+ *   capture.load(image, image_length);
+ *   ATEMCaptureReplay replay(capture);
+ *   atem.setTransport(&replay);
+ *   atem.beginAsync(IPAddress(192, 168, 10, 240));
+ *
+ * The clock starts at the first datagram the instance sends (its HELLO), which
+ * is lined up with the first captured TX record; each RX record is then
+ * delivered once as much time has passed as in the capture. Datagrams the
+ * instance sends are only counted: the replay does not react to them.
+ */
+class ATEMCaptureReplay : public ATEMTransport {
+public:
+    explicit ATEMCaptureReplay(const ATEMCapture& capture)
+        : _capture(capture), _paced(true), _open(false), _started(false), _lent(false),
+          _sent(0), _delivered(0), _start_us(0), _first_us(0) {}
+
+    /**
+     * Deliver RX records as soon as they are asked for instead of at their captured time
+     */
+    void setPaced(bool paced) { _paced = paced; }
+
+    bool begin(uint16_t local_port) override {
+        _cursor = _capture.begin();
+        _open = true;
+        _started = false;
+        _lent = false;
+        _sent = 0;
+        _delivered = 0;
+        return true;
+    }
+
+    void stop() override {
+        _open = false;
+    }
+
+    bool send(const IPAddress& ip, uint16_t port, const uint8_t* data, uint16_t length) override {
+        if (!_open) {
+            return false;
+        }
+        if (!_started) {
+            _started = true;
+            _start_us = (uint32_t)micros();
+            _first_us = firstTxTime();
+        }
+        _sent++;
+        return true;
+    }
+
+    int receive(uint8_t* buffer, uint16_t size) override {
+        const uint8_t* data;
+        int length = receiveView(data);
+        if (length <= 0) {
+            return 0;
+        }
+        if (length > size) length = size;
+        memcpy(buffer, data, length);
+        releaseView();
+        return length;
+    }
+
+    int receiveView(const uint8_t*& data) override {
+        if (!_open || !_started) {
+            return 0;
+        }
+        if (!_lent) {
+            ATEMCaptureCursor cursor = _cursor;
+            ATEMCaptureRecord record;
+            for (;;) {
+                if (!_capture.read(cursor, record)) {
+                    return 0;
+                }
+                if (record.direction == ATEM_CAPTURE_RX) {
+                    break;
+                }
+                _cursor = cursor;  // Skip captured TX records
+            }
+            if (_paced && (int32_t)(((uint32_t)micros() - _start_us) - (record.time_us - _first_us)) < 0) {
+                return 0;
+            }
+            _next = record;
+            _next_cursor = cursor;
+            _lent = true;
+        }
+        data = _next.data;
+        return _next.length;
+    }
+
+    void releaseView() override {
+        if (_lent) {
+            _cursor = _next_cursor;
+            _lent = false;
+            _delivered++;
+        }
+    }
+
+    /**
+     * @return true once every RX record has been delivered
+     */
+    bool finished() const {
+        ATEMCaptureCursor cursor = _cursor;
+        ATEMCaptureRecord record;
+        while (_capture.read(cursor, record)) {
+            if (record.direction == ATEM_CAPTURE_RX) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint32_t datagramsDelivered() const { return _delivered; }
+    uint32_t datagramsSent() const { return _sent; }
+
+private:
+    uint32_t firstTxTime() const {
+        ATEMCaptureCursor cursor = _capture.begin();
+        ATEMCaptureRecord record;
+        uint32_t first = 0;
+        bool found = false;
+        while (_capture.read(cursor, record)) {
+            if (!found) {
+                first = record.time_us;  // Fallback: the oldest record
+                found = true;
+            }
+            if (record.direction == ATEM_CAPTURE_TX) {
+                return record.time_us;
+            }
+        }
+        return first;
+    }
+
+    const ATEMCapture& _capture;
+    ATEMCaptureCursor _cursor;               // Next record to look at
+    ATEMCaptureCursor _next_cursor;          // After the lent record
+    ATEMCaptureRecord _next;                 // Lent RX record
+    bool _paced;
+    bool _open;
+    bool _started;                           // First datagram sent: the clock runs
+    bool _lent;
+    uint32_t _sent;
+    uint32_t _delivered;
+    uint32_t _start_us;                      // micros() at the first datagram sent
+    uint32_t _first_us;                      // Capture time lined up with _start_us
+};
+
+#endif // ATEM_CAPTURE_H
@@ -0,0 +1,199 @@
+#ifndef ATEM_COMMANDS_H
+#define ATEM_COMMANDS_H
+
+#include <stdint.h>
+#include <string.h>  // For memcpy, memset
+#include <math.h>    // For powf
+#include "ATEM_Models.h"  // For ATEMCapabilities
+
+/**
+ * @file ATEM_Commands.h
+ * @brief Compile-time table of outgoing ATEM commands and payload encoders
+ *
+ * Every control command is a fixed-size block inside a reliable packet:
+ *
+ *   u16 length | u16 reserved | 4-char name | payload
+ *
+ * The name and payload size of each command live in ATEM_COMMAND_SPECS, indexed
+ * by ATEMCommandId. ATEM::beginCommand() writes the block header straight into
+ * the reusable TX buffer and returns the zeroed payload, which the control
+ * methods fill with the atemPut*() helpers below (layouts follow the Sofie ATEM
+ * Connection serializers). Adding a command is one enum entry, one table row
+ * and the payload writes.
+ *
+ * confirmed_by names the state command the switcher sends back once it has
+ * applied the change (CPgI -> PrgI); the latency metrics use it to time the
+ * round trip.
+ */
+
+// Command block header: u16 length + u16 reserved + 4-char name
+#define ATEM_COMMAND_HEADER_SIZE     8
+
+// Largest payload in ATEM_COMMAND_SPECS (CAMI); sizes queued command records
+#define ATEM_MAX_COMMAND_PAYLOAD     12
+
+// Protocol limits for CMvI, which the capability table does not describe per model
+#define ATEM_MAX_MULTIVIEWERS        4         // Constellation 8K
+#define ATEM_MAX_MULTIVIEWER_WINDOWS 16        // 4x4 layout
+
+// ===========================================
+// FOURCC HELPERS
+// ===========================================
+/**
+ * Pack a four-character command name into a big-endian uint32_t
+ * constexpr so it can be used in tables, static_asserts and switch labels.
+ */
+constexpr uint32_t atemFourCC(const char* name) {
+    return ((uint32_t)(uint8_t)name[0] << 24) | ((uint32_t)(uint8_t)name[1] << 16) |
+           ((uint32_t)(uint8_t)name[2] << 8)  |  (uint32_t)(uint8_t)name[3];
+}
+
+/**
+ * Read the four-character name of a received command block as a uint32_t
+ * @param name Bytes 4-7 of the command block
+ */
+inline uint32_t atemReadFourCC(const uint8_t* name) {
+    return ((uint32_t)name[0] << 24) | ((uint32_t)name[1] << 16) |
+           ((uint32_t)name[2] << 8)  |  (uint32_t)name[3];
+}
+
+// ===========================================
+// PAYLOAD WRITERS (big-endian)
+// ===========================================
+inline void atemPutU8(uint8_t* payload, uint8_t offset, uint8_t value) {
+    payload[offset] = value;
+}
+
+inline void atemPutU16(uint8_t* payload, uint8_t offset, uint16_t value) {
+    payload[offset]     = (value >> 8) & 0xFF;
+    payload[offset + 1] = value & 0xFF;
+}
+
+inline void atemPutI16(uint8_t* payload, uint8_t offset, int16_t value) {
+    atemPutU16(payload, offset, (uint16_t)value);
+}
+
+// ===========================================
+// COMMAND TABLE
+// ===========================================
+enum ATEMCommandId : uint8_t {
+    ATEM_CMD_CPGI = 0,   // Program input
+    ATEM_CMD_CPVI,       // Preview input
+    ATEM_CMD_DCUT,       // Cut
+    ATEM_CMD_DAUT,       // Auto transition
+    ATEM_CMD_FTBA,       // Fade to black (auto)
+    ATEM_CMD_FTBC,       // Fade to black rate
+    ATEM_CMD_CTPS,       // Transition position
+    ATEM_CMD_CTPR,       // Transition preview
+    ATEM_CMD_CAUS,       // Aux source
+    ATEM_CMD_CDSL,       // Downstream key on air
+    ATEM_CMD_DDSA,       // Downstream key auto
+    ATEM_CMD_CKON,       // Upstream keyer on air
+    ATEM_CMD_CKEC,       // Upstream keyer cut source
+    ATEM_CMD_CKEF,       // Upstream keyer fill source
+    ATEM_CMD_CCLV,       // Color generator colour
+    ATEM_CMD_MPCS,       // Media player source
+    ATEM_CMD_CMVI,       // Multiviewer window source
+    ATEM_CMD_CAMI,       // Classic audio mixer input
+    ATEM_CMD_CAMM,       // Classic audio mixer master
+    ATEM_CMD_COUNT
+};
+
+struct ATEMCommandSpec {
+    char name[5];            // Four-character command name (NUL terminated for logging)
+    uint8_t payload_length;  // Payload bytes after the 8-byte block header
+    char confirmed_by[5];    // State command the switcher answers with once applied
+};
+
+// Indexed by ATEMCommandId - keep both lists in the same order
+constexpr ATEMCommandSpec ATEM_COMMAND_SPECS[ATEM_CMD_COUNT] = {
+    {"CPgI", 4,  "PrgI"},
+    {"CPvI", 4,  "PrvI"},
+    {"DCut", 4,  "PrgI"},
+    {"DAut", 4,  "TrPs"},
+    {"FtbA", 4,  "FtbS"},
+    {"FtbC", 4,  "FtbP"},
+    {"CTPs", 4,  "TrPs"},
+    {"CTPr", 4,  "TrPr"},
+    {"CAuS", 4,  "AuxS"},
+    {"CDsL", 4,  "DskS"},
+    {"DDsA", 4,  "DskS"},
+    {"CKOn", 4,  "KeOn"},
+    {"CKeC", 4,  "KeBP"},
+    {"CKeF", 4,  "KeBP"},
+    {"CClV", 8,  "ColV"},
+    {"MPCS", 8,  "MPCE"},
+    {"CMvI", 4,  "MvIn"},
+    {"CAMI", 12, "AMIP"},
+    {"CAMM", 8,  "AMMO"},
+};
+
+static_assert(atemFourCC(ATEM_COMMAND_SPECS[ATEM_CMD_CPGI].name) == atemFourCC("CPgI"), "ATEM_COMMAND_SPECS out of order");
+static_assert(atemFourCC(ATEM_COMMAND_SPECS[ATEM_CMD_CTPR].name) == atemFourCC("CTPr"), "ATEM_COMMAND_SPECS out of order");
+static_assert(atemFourCC(ATEM_COMMAND_SPECS[ATEM_CMD_CAMM].name) == atemFourCC("CAMM"), "ATEM_COMMAND_SPECS out of order");
+static_assert(ATEM_COMMAND_SPECS[ATEM_CMD_CAMI].payload_length <= ATEM_MAX_COMMAND_PAYLOAD, "ATEM_MAX_COMMAND_PAYLOAD too small");
+
+inline const ATEMCommandSpec& atemCommandSpec(ATEMCommandId id) {
+    return ATEM_COMMAND_SPECS[id];
+}
+
+/**
+ * Total size of one encoded command block (header + payload)
+ */
+inline uint16_t atemCommandBlockSize(ATEMCommandId id) {
+    return ATEM_COMMAND_HEADER_SIZE + ATEM_COMMAND_SPECS[id].payload_length;
+}
+
+/**
+ * Write a command block header and clear its payload
+ * @param block Destination, at least atemCommandBlockSize(id) bytes
+ * @return Pointer to the payload
+ */
+inline uint8_t* atemWriteCommandHeader(uint8_t* block, ATEMCommandId id) {
+    const ATEMCommandSpec& spec = ATEM_COMMAND_SPECS[id];
+    uint16_t size = atemCommandBlockSize(id);
+
+    atemPutU16(block, 0, size);
+    block[2] = 0x00;
+    block[3] = 0x00;
+    memcpy(block + 4, spec.name, 4);
+    memset(block + ATEM_COMMAND_HEADER_SIZE, 0, spec.payload_length);
+    return block + ATEM_COMMAND_HEADER_SIZE;
+}
+
+/**
+ * Number of entries the index field of a command can address on a model
+ * (AUX bus, downstream keyer, colour generator, media player or multiviewer).
+ * M/E indexes are checked against the state store instead.
+ * @param caps Detected model, nullptr while it is unknown
+ * @return Valid indexes are below this; 0x100 when the model is unknown or the
+ *         command has no model-dependent index
+ */
+inline uint16_t atemCommandIndexCount(ATEMCommandId id, const ATEMCapabilities* caps) {
+    if (!caps) return 0x100;
+    switch (id) {
+        case ATEM_CMD_CAUS: return caps->aux_outputs;
+        case ATEM_CMD_CDSL:
+        case ATEM_CMD_DDSA: return caps->downstream_keyers;
+        case ATEM_CMD_CCLV: return caps->color_generators;
+        case ATEM_CMD_MPCS: return caps->media_players;
+        case ATEM_CMD_CMVI: return caps->has_multiview ? ATEM_MAX_MULTIVIEWERS : 0;
+        default:            return 0x100;
+    }
+}
+
+// ===========================================
+// VALUE CONVERSIONS
+// ===========================================
+/**
+ * Convert a gain in dB to the switcher's linear 16-bit representation
+ * (10^(dB/20) * 32768, clamped; -60 dB and below maps to silence)
+ */
+inline uint16_t atemDecibelToGain(float db) {
+    if (db <= -60.0f) return 0;
+    float linear = powf(10.0f, db / 20.0f) * 32768.0f;
+    if (linear >= 65535.0f) return 0xFFFF;
+    return (uint16_t)linear;
+}
+
+#endif // ATEM_COMMANDS_H
@@ -2,7 +2,6 @@
 #define ATEM_INPUTS_H
 
 #include <stdint.h>  // For uint16_t
-#include <stdio.h>   // For snprintf
 #include "ATEM_Models.h"  // For model detection and capabilities
 
 /**
@@ -146,12 +145,37 @@ uint8_t getMaxMediaPlayer(const ATEMCapabilities* capabilities = nullptr);
 // ===========================================
 // UNIVERSAL INPUT NAME FUNCTIONS
 // ===========================================
+// Names are constant strings, so the returned pointers stay valid, can be used
+// several times in one expression and are safe to call from any task.
+#define ATEM_MAX_CAMERA_NAME         40        // Cameras with a built-in name
+
+static const char* const ATEM_CAMERA_NAMES[ATEM_MAX_CAMERA_NAME] = {
+    "CAM1", "CAM2", "CAM3", "CAM4", "CAM5", "CAM6", "CAM7", "CAM8",
+    "CAM9", "CAM10", "CAM11", "CAM12", "CAM13", "CAM14", "CAM15", "CAM16",
+    "CAM17", "CAM18", "CAM19", "CAM20", "CAM21", "CAM22", "CAM23", "CAM24",
+    "CAM25", "CAM26", "CAM27", "CAM28", "CAM29", "CAM30", "CAM31", "CAM32",
+    "CAM33", "CAM34", "CAM35", "CAM36", "CAM37", "CAM38", "CAM39", "CAM40"
+};
+
+static const char* const ATEM_CAMERA_DESCRIPTIONS[ATEM_MAX_CAMERA_NAME] = {
+    "Camera 1", "Camera 2", "Camera 3", "Camera 4", "Camera 5",
+    "Camera 6", "Camera 7", "Camera 8", "Camera 9", "Camera 10",
+    "Camera 11", "Camera 12", "Camera 13", "Camera 14", "Camera 15",
+    "Camera 16", "Camera 17", "Camera 18", "Camera 19", "Camera 20",
+    "Camera 21", "Camera 22", "Camera 23", "Camera 24", "Camera 25",
+    "Camera 26", "Camera 27", "Camera 28", "Camera 29", "Camera 30",
+    "Camera 31", "Camera 32", "Camera 33", "Camera 34", "Camera 35",
+    "Camera 36", "Camera 37", "Camera 38", "Camera 39", "Camera 40"
+};
+
+/**
+ * Default short name of an input ("CAM3", "MP1", "PGM", ...)
+ * The switcher's own labels are available through ATEM::getInputLabel()
+ */
 inline const char* getInputName(uint16_t input) {
     // Camera inputs (1-40)
-    if (input >= 1 && input <= 40) {
-        static char camName[8];
-        snprintf(camName, sizeof(camName), "CAM%d", input);
-        return camName;
+    if (input >= 1 && input <= ATEM_MAX_CAMERA_NAME) {
+        return ATEM_CAMERA_NAMES[input - 1];
     }
     
     switch(input) {
@@ -180,12 +204,13 @@ inline const char* getInputName(uint16_t input) {
     }
 }
 
+/**
+ * Default long name of an input ("Camera 3", "Media Player 1", ...)
+ */
 inline const char* getInputDescription(uint16_t input) {
     // Camera inputs (1-40)
-    if (input >= 1 && input <= 40) {
-        static char camDesc[16];
-        snprintf(camDesc, sizeof(camDesc), "Camera %d", input);
-        return camDesc;
+    if (input >= 1 && input <= ATEM_MAX_CAMERA_NAME) {
+        return ATEM_CAMERA_DESCRIPTIONS[input - 1];
     }
     
     switch(input) {
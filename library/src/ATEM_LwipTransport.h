@@ -0,0 +1,267 @@
+#ifndef ATEM_LWIP_TRANSPORT_H
+#define ATEM_LWIP_TRANSPORT_H
+
+#include "ATEM_Transport.h"
+
+/**
+ * @file ATEM_LwipTransport.h
+ * @brief ATEM transport on a raw lwIP udp_pcb (ESP32)
+ *
+ * WiFiUDP::parsePacket() allocates a receive buffer, copies the datagram out of
+ * the socket into it and read() copies it again. ATEMLwipTransport registers a
+ * receive callback on a udp_pcb instead: the lwIP thread hands each pbuf to a
+ * lock-free queue as-is, and receiveView() lends the pbuf payload to the
+ * protocol engine, which parses it in place before freeing it. No copy, no
+ * allocation beyond the pbuf the driver received into, and no socket layer, on
+ * whatever interface (WiFi or ETH) routes to the switcher.
+ *
+ *   #include <ATEM_LwipTransport.h>
+ *   ATEMLwipTransport transport;
+ *   atem.setTransport(&transport);
+ *
+ * pcb setup, teardown and sends run on the lwIP thread through tcpip_api_call(),
+ * like the core's AsyncUDP. Datagrams arriving while ATEM_LWIP_RX_QUEUE pbufs
+ * are waiting are dropped (and counted); the switcher retransmits them.
+ *
+ * send() copies each datagram into one pbuf allocated by begin() and reused as
+ * long as nothing else holds a reference to it. While the previous datagram is
+ * still referenced (e.g. queued behind an ARP request) a one-off PBUF_RAM pbuf
+ * is used instead; on ESP-IDF, which builds lwIP with MEMP_MEM_MALLOC, every
+ * pbuf allocation is a heap allocation. The WiFi driver may also take a TX
+ * buffer from the heap per frame unless static TX buffers are configured.
+ * ATEM packets fit in one MTU; a datagram receiveView() gets as a pbuf chain
+ * (IP fragments) would need a heap copy to parse in place, so it is dropped and
+ * counted instead.
+ */
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+#include <atomic>
+#include <string.h>  // For memcpy
+#include <lwip/udp.h>
+#include <lwip/pbuf.h>
+#include <lwip/priv/tcpip_priv.h>  // For tcpip_api_call
+#include "ATEM_Queue.h"
+
+#ifndef ATEM_LWIP_RX_QUEUE
+#define ATEM_LWIP_RX_QUEUE           32        // Received pbufs held until receive()
+#endif
+
+#ifndef ATEM_LWIP_TX_SIZE
+#define ATEM_LWIP_TX_SIZE            1472      // Largest datagram sent from the reused pbuf
+#endif
+
+class ATEMLwipTransport : public ATEMTransport {
+public:
+    ATEMLwipTransport()
+        : _pcb(nullptr), _tx(nullptr), _tx_payload(nullptr), _view(nullptr), _remote_port(0), _dropped(0),
+          _chained(0) {}
+    ~ATEMLwipTransport() { stop(); }
+
+    bool begin(uint16_t local_port) override {
+        stop();
+        PcbCall call;
+        call.self = this;
+        call.port = local_port;
+        call.err  = ERR_OK;
+        tcpip_api_call(&ATEMLwipTransport::beginApi, &call.base);
+        return call.err == ERR_OK;
+    }
+
+    void stop() override {
+        if (_pcb) {
+            PcbCall call;
+            call.self = this;
+            call.port = 0;
+            call.err  = ERR_OK;
+            tcpip_api_call(&ATEMLwipTransport::stopApi, &call.base);
+        }
+        releaseView();
+        Received item;
+        while (_rx.pop(item)) {
+            pbuf_free(item.packet);
+        }
+    }
+
+    bool send(const IPAddress& ip, uint16_t port, const uint8_t* data, uint16_t length) override {
+        if (!_pcb) {
+            return false;
+        }
+        // The pbuf is filled on the lwIP thread, where its reference count is stable
+        SendCall call;
+        call.self   = this;
+        call.data   = data;
+        call.length = length;
+        call.port   = port;
+        call.err    = ERR_OK;
+        IP_ADDR4(&call.address, ip[0], ip[1], ip[2], ip[3]);
+        tcpip_api_call(&ATEMLwipTransport::sendApi, &call.base);
+        return call.err == ERR_OK;
+    }
+
+    int receive(uint8_t* buffer, uint16_t size) override {
+        Received item;
+        if (!popReceived(item)) {
+            return 0;
+        }
+        uint16_t length = pbuf_copy_partial(item.packet, buffer, size, 0);
+        pbuf_free(item.packet);
+        return length;
+    }
+
+    int receiveView(const uint8_t*& data) override {
+        releaseView();
+        Received item;
+        while (popReceived(item)) {
+            // Datagrams normally arrive in one pbuf; merging a chain would
+            // allocate, so drop it and let the switcher resend
+            if (item.packet->next) {
+                pbuf_free(item.packet);
+                _chained.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            _view = item.packet;
+            data = (const uint8_t*)item.packet->payload;
+            return item.packet->len;
+        }
+        return 0;
+    }
+
+    void releaseView() override {
+        if (_view) {
+            pbuf_free(_view);
+            _view = nullptr;
+        }
+    }
+
+    IPAddress remoteIP() override { return _remote_ip; }
+    uint16_t remotePort() override { return _remote_port; }
+
+    /**
+     * Datagrams dropped because the receive queue was full
+     */
+    uint32_t droppedDatagrams() const { return _dropped.load(std::memory_order_relaxed); }
+
+    /**
+     * Datagrams dropped by receiveView() because they arrived as a pbuf chain
+     */
+    uint32_t chainedDatagrams() const { return _chained.load(std::memory_order_relaxed); }
+
+private:
+    struct Received {
+        struct pbuf* packet;
+        ip_addr_t address;
+        uint16_t port;
+    };
+
+    // tcpip_api_call() messages: the base must be the first member
+    struct PcbCall {
+        struct tcpip_api_call_data base;
+        ATEMLwipTransport* self;
+        uint16_t port;
+        err_t err;
+    };
+
+    struct SendCall {
+        struct tcpip_api_call_data base;
+        ATEMLwipTransport* self;
+        const uint8_t* data;
+        uint16_t length;
+        ip_addr_t address;
+        uint16_t port;
+        err_t err;
+    };
+
+    struct udp_pcb* _pcb;
+    struct pbuf* _tx;                    // Reused by send(), lwIP thread only
+    void* _tx_payload;                   // _tx payload before lwIP prepends headers
+    struct pbuf* _view;                  // Lent out by receiveView()
+    ATEMSpscQueue<Received, ATEM_LWIP_RX_QUEUE + 1> _rx;  // lwIP thread -> receive()
+    IPAddress _remote_ip;
+    uint16_t _remote_port;
+    std::atomic<uint32_t> _dropped;
+    std::atomic<uint32_t> _chained;      // Only written by receiveView(), atomic for readers
+
+    bool popReceived(Received& item) {
+        if (!_rx.pop(item)) {
+            return false;
+        }
+        const ip4_addr_t* source = ip_2_ip4(&item.address);
+        _remote_ip = IPAddress(ip4_addr1(source), ip4_addr2(source), ip4_addr3(source), ip4_addr4(source));
+        _remote_port = item.port;
+        return true;
+    }
+
+    // Runs on the lwIP thread: queue the pbuf without copying it
+    static void onReceive(void* arg, struct udp_pcb* pcb, struct pbuf* packet, const ip_addr_t* address, u16_t port) {
+        ATEMLwipTransport* self = (ATEMLwipTransport*)arg;
+        Received item;
+        item.packet  = packet;
+        item.address = *address;
+        item.port    = port;
+        if (!self->_rx.push(item)) {
+            pbuf_free(packet);
+            self->_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static err_t beginApi(struct tcpip_api_call_data* data) {
+        PcbCall* call = (PcbCall*)data;
+        struct udp_pcb* pcb = udp_new();
+        if (!pcb) {
+            call->err = ERR_MEM;
+            return call->err;
+        }
+        call->err = udp_bind(pcb, IP_ADDR_ANY, call->port);
+        if (call->err != ERR_OK) {
+            udp_remove(pcb);
+            return call->err;
+        }
+        udp_recv(pcb, &ATEMLwipTransport::onReceive, call->self);
+        call->self->_pcb = pcb;
+        // PBUF_TRANSPORT leaves room for the UDP, IP and link headers; without
+        // it every send() allocates
+        call->self->_tx = pbuf_alloc(PBUF_TRANSPORT, ATEM_LWIP_TX_SIZE, PBUF_RAM);
+        call->self->_tx_payload = call->self->_tx ? call->self->_tx->payload : nullptr;
+        return ERR_OK;
+    }
+
+    static err_t stopApi(struct tcpip_api_call_data* data) {
+        PcbCall* call = (PcbCall*)data;
+        udp_remove(call->self->_pcb);
+        call->self->_pcb = nullptr;
+        if (call->self->_tx) {
+            pbuf_free(call->self->_tx);
+            call->self->_tx = nullptr;
+        }
+        return ERR_OK;
+    }
+
+    static err_t sendApi(struct tcpip_api_call_data* data) {
+        SendCall* call = (SendCall*)data;
+        ATEMLwipTransport* self = call->self;
+        struct pbuf* packet = self->_tx;
+        if (packet && packet->ref == 1 && call->length <= ATEM_LWIP_TX_SIZE) {
+            // Undo the headers the previous udp_sendto() prepended
+            packet->payload = self->_tx_payload;
+            packet->len = packet->tot_len = call->length;
+        } else {
+            // Still referenced (ARP queue, driver) or too long: use a fresh pbuf
+            packet = pbuf_alloc(PBUF_TRANSPORT, call->length, PBUF_RAM);
+            if (!packet) {
+                call->err = ERR_MEM;
+                return call->err;
+            }
+        }
+        memcpy(packet->payload, call->data, call->length);
+        call->err = udp_sendto(self->_pcb, packet, &call->address, call->port);
+        if (packet != self->_tx) {
+            pbuf_free(packet);
+        }
+        return call->err;
+    }
+};
+
+#endif // ARDUINO_ARCH_ESP32
+
+#endif // ATEM_LWIP_TRANSPORT_H
@@ -0,0 +1,122 @@
+#ifndef ATEM_METRICS_H
+#define ATEM_METRICS_H
+
+#include <stdint.h>
+#include <string.h>  // For memset
+#include "ATEM_Commands.h"  // For ATEM_CMD_COUNT
+
+/**
+ * @file ATEM_Metrics.h
+ * @brief Optional latency and traffic counters for the protocol engine
+ *
+ * Compiled in with a build flag (off by default, so the library has no extra
+ * RAM or CPU cost unless asked for):
+ *   -DATEM_METRICS=1
+ *
+ * Latencies are measured with micros() and collected in log2 histograms, so
+ * recording a sample is a handful of integer operations and the memory use is
+ * fixed. ATEM::getMetrics() returns the live struct for polling or pushing to
+ * a monitoring system; ATEM::resetMetrics() starts a new measurement window.
+ */
+
+#ifndef ATEM_METRICS
+#define ATEM_METRICS                 0
+#endif
+
+#if ATEM_METRICS
+#define ATEM_METRIC(...) do { __VA_ARGS__; } while (0)
+#else
+#define ATEM_METRIC(...) do { } while (0)
+#endif
+
+// Bucket n holds samples below (ATEM_METRICS_BUCKET_BASE_US << n); the last
+// bucket collects everything slower. 12 buckets: <250us, <500us ... <256ms, more.
+#define ATEM_METRICS_BUCKETS         12
+#define ATEM_METRICS_BUCKET_BASE_US  250
+
+static_assert(ATEM_CMD_COUNT <= 32, "Commands awaiting confirmation are tracked in a 32-bit mask");
+
+// ===========================================
+// LATENCY HISTOGRAM
+// ===========================================
+struct ATEMLatencyHistogram {
+    uint32_t count;                          // Samples recorded
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;                       // For the mean (total_us / count)
+    uint32_t buckets[ATEM_METRICS_BUCKETS];
+
+    void reset() {
+        memset(this, 0, sizeof(*this));
+        min_us = 0xFFFFFFFF;
+    }
+
+    void record(uint32_t us) {
+        uint8_t bucket = 0;
+        uint32_t limit = ATEM_METRICS_BUCKET_BASE_US;
+        while (bucket < ATEM_METRICS_BUCKETS - 1 && us >= limit) {
+            bucket++;
+            limit <<= 1;
+        }
+        buckets[bucket]++;
+        count++;
+        total_us += us;
+        if (us < min_us) min_us = us;
+        if (us > max_us) max_us = us;
+    }
+
+    uint32_t meanUs() const { return count ? (uint32_t)(total_us / count) : 0; }
+
+    /**
+     * Upper bound of the bucket holding the given percentile
+     * @param percent 1-100 (50 = median, 99 = p99)
+     * @return Microseconds, max_us for the open-ended last bucket, 0 without samples
+     */
+    uint32_t percentileUs(uint8_t percent) const {
+        if (count == 0) return 0;
+        uint32_t target = (uint32_t)(((uint64_t)count * percent + 99) / 100);
+        uint32_t seen = 0;
+        uint32_t limit = ATEM_METRICS_BUCKET_BASE_US;
+        for (uint8_t i = 0; i < ATEM_METRICS_BUCKETS - 1; i++, limit <<= 1) {
+            seen += buckets[i];
+            if (seen >= target) return limit < max_us ? limit : max_us;
+        }
+        return max_us;
+    }
+};
+
+// ===========================================
+// METRICS
+// ===========================================
+struct ATEMMetrics {
+    // Round trips
+    ATEMLatencyHistogram ack_rtt;            // Reliable packet sent -> ATEM ACK (one sample in flight)
+    ATEMLatencyHistogram command_rtt[ATEM_CMD_COUNT]; // Command sent -> confirming state command, by ATEMCommandId
+
+    // Service loop
+    ATEMLatencyHistogram loop_interval;      // Time between runLoop() services (network task period in task mode)
+
+    // Traffic
+    uint32_t rx_datagrams;                   // Datagrams read from the socket
+    uint32_t rx_datagrams_per_second;        // Rate over the last completed second
+    uint32_t rx_commands;                    // Commands dispatched from received payloads
+    uint32_t rx_malformed_packets;           // Datagrams too short or with a bad header length
+    uint32_t rx_malformed_commands;          // Payloads cut off by a bad command length
+    uint32_t rx_duplicate_packets;           // Reliable packets received again and not parsed
+    uint32_t rx_out_of_order_packets;        // Arrived before an earlier packet (dropped, resent by the switcher)
+    uint32_t tx_packets;                     // Reliable packets sent (commands and heartbeats)
+    uint32_t retransmit_requests;            // RetransmitRequest packets received
+    uint32_t packets_resent;                 // Packets sent again for those requests
+
+    void reset() {
+        ack_rtt.reset();
+        for (uint8_t i = 0; i < ATEM_CMD_COUNT; i++) command_rtt[i].reset();
+        loop_interval.reset();
+        rx_datagrams = rx_datagrams_per_second = rx_commands = 0;
+        rx_malformed_packets = rx_malformed_commands = 0;
+        rx_duplicate_packets = rx_out_of_order_packets = 0;
+        tx_packets = retransmit_requests = packets_resent = 0;
+    }
+};
+
+#endif // ATEM_METRICS_H
@@ -2,6 +2,7 @@
 #define ATEM_MODELS_H
 
 #include <stdint.h>
+#include <stddef.h>  // For size_t
 
 /**
  * @file ATEM_Models.h
@@ -63,6 +64,10 @@ struct ATEMCapabilities {
     bool has_streaming;        // Built-in streaming
     bool has_recording;        // Built-in recording
     uint16_t max_input_id;     // Highest input ID for validation
+    uint8_t mix_effects;       // M/E rows (1-4)
+    uint8_t upstream_keyers;   // Upstream keyers per M/E
+    uint8_t downstream_keyers; // Downstream keyers
+    uint8_t aux_outputs;       // AUX buses addressable with CAuS (Mini HDMI out is AUX 1)
 };
 
 // ===========================================
@@ -85,7 +90,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 0,
         .has_streaming = true,
         .has_recording = false,
-        .max_input_id = 3020
+        .max_input_id = 3020,
+        .mix_effects = 1,
+        .upstream_keyers = 1,
+        .downstream_keyers = 1,
+        .aux_outputs = 1
     },
     {
         .model = ATEM_MINI_PRO,
@@ -102,7 +111,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 0,
         .has_streaming = true,
         .has_recording = true,
-        .max_input_id = 10012
+        .max_input_id = 10012,
+        .mix_effects = 1,
+        .upstream_keyers = 1,
+        .downstream_keyers = 1,
+        .aux_outputs = 1
     },
     {
         .model = ATEM_MINI_PRO_ISO,
@@ -119,7 +132,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 0,
         .has_streaming = true,
         .has_recording = true,
-        .max_input_id = 10012
+        .max_input_id = 10012,
+        .mix_effects = 1,
+        .upstream_keyers = 1,
+        .downstream_keyers = 1,
+        .aux_outputs = 1
     },
     {
         .model = ATEM_MINI_EXTREME,
@@ -136,7 +153,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 4,
         .has_streaming = true,
         .has_recording = true,
-        .max_input_id = 11001
+        .max_input_id = 11001,
+        .mix_effects = 1,
+        .upstream_keyers = 4,
+        .downstream_keyers = 2,
+        .aux_outputs = 2
     },
     {
         .model = ATEM_MINI_EXTREME_ISO,
@@ -153,7 +174,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 4,
         .has_streaming = true,
         .has_recording = true,
-        .max_input_id = 11001
+        .max_input_id = 11001,
+        .mix_effects = 1,
+        .upstream_keyers = 4,
+        .downstream_keyers = 2,
+        .aux_outputs = 2
     },
     
     // Television Studio Series
@@ -172,7 +197,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 1,
         .has_streaming = false,
         .has_recording = false,
-        .max_input_id = 11001
+        .max_input_id = 11001,
+        .mix_effects = 1,
+        .upstream_keyers = 1,
+        .downstream_keyers = 2,
+        .aux_outputs = 1
     },
     {
         .model = ATEM_TVS_HD8,
@@ -189,7 +218,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 4,
         .has_streaming = false,
         .has_recording = false,
-        .max_input_id = 11001
+        .max_input_id = 11001,
+        .mix_effects = 1,
+        .upstream_keyers = 4,
+        .downstream_keyers = 2,
+        .aux_outputs = 2
     },
     {
         .model = ATEM_TVS_HD8_ISO,
@@ -206,7 +239,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 4,
         .has_streaming = false,
         .has_recording = true,
-        .max_input_id = 11001
+        .max_input_id = 11001,
+        .mix_effects = 1,
+        .upstream_keyers = 4,
+        .downstream_keyers = 2,
+        .aux_outputs = 2
     },
     {
         .model = ATEM_TVS_4K8,
@@ -223,7 +260,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 4,
         .has_streaming = false,
         .has_recording = false,
-        .max_input_id = 11001
+        .max_input_id = 11001,
+        .mix_effects = 1,
+        .upstream_keyers = 4,
+        .downstream_keyers = 2,
+        .aux_outputs = 10
     },
     
     // Production Studio Series
@@ -242,7 +283,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 4,
         .has_streaming = false,
         .has_recording = false,
-        .max_input_id = 11001
+        .max_input_id = 11001,
+        .mix_effects = 1,
+        .upstream_keyers = 1,
+        .downstream_keyers = 2,
+        .aux_outputs = 3
     },
     
     // Constellation Series (Flagship models)
@@ -261,7 +306,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 4,
         .has_streaming = false,
         .has_recording = false,
-        .max_input_id = 11001
+        .max_input_id = 11001,
+        .mix_effects = 1,
+        .upstream_keyers = 4,
+        .downstream_keyers = 4,
+        .aux_outputs = 6
     },
     {
         .model = ATEM_CONSTELLATION_4K,
@@ -278,7 +327,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 4,
         .has_streaming = false,
         .has_recording = false,
-        .max_input_id = 11001
+        .max_input_id = 11001,
+        .mix_effects = 4,
+        .upstream_keyers = 4,
+        .downstream_keyers = 4,
+        .aux_outputs = 24
     },
     {
         .model = ATEM_CONSTELLATION_8K,
@@ -295,7 +348,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 4,
         .has_streaming = false,
         .has_recording = false,
-        .max_input_id = 11001
+        .max_input_id = 11001,
+        .mix_effects = 4,
+        .upstream_keyers = 4,
+        .downstream_keyers = 4,
+        .aux_outputs = 24
     },
     
     // SDI Series
@@ -314,7 +371,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 0,
         .has_streaming = false,
         .has_recording = false,
-        .max_input_id = 3020
+        .max_input_id = 3020,
+        .mix_effects = 1,
+        .upstream_keyers = 1,
+        .downstream_keyers = 1,
+        .aux_outputs = 1
     },
     {
         .model = ATEM_SDI_PRO_ISO,
@@ -331,7 +392,11 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 1,
         .has_streaming = true,
         .has_recording = true,
-        .max_input_id = 11001
+        .max_input_id = 11001,
+        .mix_effects = 1,
+        .upstream_keyers = 1,
+        .downstream_keyers = 1,
+        .aux_outputs = 1
     },
     {
         .model = ATEM_SDI_EXTREME_ISO,
@@ -348,16 +413,76 @@ static const ATEMCapabilities ATEM_CAPABILITIES[] = {
         .supersource_boxes = 4,
         .has_streaming = true,
         .has_recording = true,
-        .max_input_id = 11001
+        .max_input_id = 11001,
+        .mix_effects = 1,
+        .upstream_keyers = 4,
+        .downstream_keyers = 2,
+        .aux_outputs = 2
     }
 };
 
+// ===========================================
+// PRODUCT NAME MATCHING
+// ===========================================
+struct ATEMModelPattern {
+    const char* pattern;       // Lowercase substring of the product name
+    ATEMModel model;
+};
+
+// Checked in order - more specific names must come before their prefixes
+static const ATEMModelPattern ATEM_MODEL_PATTERNS[] = {
+    // Mini Series
+    {"mini extreme iso",          ATEM_MINI_EXTREME_ISO},
+    {"mini extreme",              ATEM_MINI_EXTREME},
+    {"mini pro iso",              ATEM_MINI_PRO_ISO},
+    {"mini pro",                  ATEM_MINI_PRO},
+    {"mini",                      ATEM_MINI},
+
+    // Television Studio Series
+    {"television studio hd8 iso", ATEM_TVS_HD8_ISO},
+    {"television studio hd8",     ATEM_TVS_HD8},
+    {"television studio 4k8",     ATEM_TVS_4K8},
+    {"television studio hd",      ATEM_TVS_HD},
+
+    // Production Studio Series
+    {"production studio 4k",      ATEM_PRODUCTION_STUDIO_4K},
+
+    // Constellation Series
+    {"constellation 8k",          ATEM_CONSTELLATION_8K},
+    {"constellation 4k",          ATEM_CONSTELLATION_4K},
+    {"constellation hd",          ATEM_CONSTELLATION_HD},
+
+    // SDI Series
+    {"sdi extreme iso",           ATEM_SDI_EXTREME_ISO},
+    {"sdi pro iso",               ATEM_SDI_PRO_ISO},
+    {"sdi",                       ATEM_SDI}
+};
+
+/**
+ * Case-insensitive substring test without allocating
+ * @param text Text to search (any case)
+ * @param pattern Lowercase pattern
+ */
+inline bool atemContainsIgnoreCase(const char* text, const char* pattern) {
+    for (; *text; text++) {
+        const char* t = text;
+        const char* p = pattern;
+        while (*p && *t && (*t >= 'A' && *t <= 'Z' ? *t + ('a' - 'A') : *t) == *p) {
+            t++;
+            p++;
+        }
+        if (!*p) return true;
+    }
+    return false;
+}
+
 // ===========================================
 // HELPER FUNCTIONS
 // ===========================================
 
 /**
  * Get ATEM model capabilities by model enum
+ * Called once per connection; ATEM caches the result (see ATEM::getCapabilities())
  */
 inline const ATEMCapabilities* getATEMCapabilities(ATEMModel model) {
     for (size_t i = 0; i < sizeof(ATEM_CAPABILITIES) / sizeof(ATEM_CAPABILITIES[0]); i++) {
@@ -369,41 +494,17 @@ inline const ATEMCapabilities* getATEMCapabilities(ATEMModel model) {
 }
 
 /**
- * Detect ATEM model from product name string (from discovery)
+ * Detect ATEM model from product name string (from the _pin command or discovery)
+ * Walks ATEM_MODEL_PATTERNS without heap allocation
  */
 inline ATEMModel detectATEMModel(const char* productName) {
     if (!productName) return ATEM_MODEL_UNKNOWN;
     
-    // Convert to lowercase for comparison
-    String name = String(productName);
-    name.toLowerCase();
-    
-    // Mini Series Detection
-    if (name.indexOf("mini extreme iso") >= 0) return ATEM_MINI_EXTREME_ISO;
-    if (name.indexOf("mini extreme") >= 0) return ATEM_MINI_EXTREME;
-    if (name.indexOf("mini pro iso") >= 0) return ATEM_MINI_PRO_ISO;
-    if (name.indexOf("mini pro") >= 0) return ATEM_MINI_PRO;
-    if (name.indexOf("mini") >= 0) return ATEM_MINI;
-    
-    // Television Studio Series
-    if (name.indexOf("television studio hd8 iso") >= 0) return ATEM_TVS_HD8_ISO;
-    if (name.indexOf("television studio hd8") >= 0) return ATEM_TVS_HD8;
-    if (name.indexOf("television studio 4k8") >= 0) return ATEM_TVS_4K8;
-    if (name.indexOf("television studio hd") >= 0) return ATEM_TVS_HD;
-    
-    // Production Studio Series
-    if (name.indexOf("production studio 4k") >= 0) return ATEM_PRODUCTION_STUDIO_4K;
-    
-    // Constellation Series
-    if (name.indexOf("constellation 8k") >= 0) return ATEM_CONSTELLATION_8K;
-    if (name.indexOf("constellation 4k") >= 0) return ATEM_CONSTELLATION_4K;
-    if (name.indexOf("constellation hd") >= 0) return ATEM_CONSTELLATION_HD;
-    
-    // SDI Series
-    if (name.indexOf("sdi extreme iso") >= 0) return ATEM_SDI_EXTREME_ISO;
-    if (name.indexOf("sdi pro iso") >= 0) return ATEM_SDI_PRO_ISO;
-    if (name.indexOf("sdi") >= 0) return ATEM_SDI;
-    
+    for (size_t i = 0; i < sizeof(ATEM_MODEL_PATTERNS) / sizeof(ATEM_MODEL_PATTERNS[0]); i++) {
+        if (atemContainsIgnoreCase(productName, ATEM_MODEL_PATTERNS[i].pattern)) {
+            return ATEM_MODEL_PATTERNS[i].model;
+        }
+    }
     return ATEM_MODEL_UNKNOWN;
 }
 
@@ -0,0 +1,187 @@
+#ifndef ATEM_OPTIMISTIC_H
+#define ATEM_OPTIMISTIC_H
+
+#include <stdint.h>
+#include "ATEM_Retransmit.h"  // For atemPacketCoveredByAck
+#include "ATEM_State.h"       // For ATEM_MAX_MIX_EFFECTS
+
+/**
+ * @file ATEM_Optimistic.h
+ * @brief Journal of speculative program/preview changes
+ *
+ * With optimistic updates on, changeProgramInput(), changePreviewInput() and
+ * cut() write the expected result into the state store at once instead of
+ * waiting a round trip for the switcher's PrgI/PrvI. The journal remembers, per
+ * M/E and field, the value the switcher last confirmed and the packet that
+ * carries the change:
+ *
+ *   - an echo with the speculated value confirms it and drops the entry
+ *   - an echo with another value before the ACK is taken as the switcher's
+ *     state before our command and only replaces the confirmed value
+ *   - an echo with another value after the ACK contradicts the speculation
+ *   - no echo within ATEM_OPTIMISTIC_CONFIRM_WINDOW of the ACK, or no ACK
+ *     within ATEM_OPTIMISTIC_TIMEOUT, means the switcher did not take it
+ *
+ * A contradicted or expired speculation is rolled back to the confirmed value.
+ * Only the confirmed values are kept here; the speculated ones live in
+ * ATEMState, so the journal costs a few bytes per M/E instead of a second
+ * state copy.
+ */
+
+// ===========================================
+// COMPILE-TIME CONFIGURATION
+// ===========================================
+#ifndef ATEM_OPTIMISTIC_TIMEOUT
+#define ATEM_OPTIMISTIC_TIMEOUT          1000  // ms a speculation waits for its ACK
+#endif
+
+#ifndef ATEM_OPTIMISTIC_CONFIRM_WINDOW
+#define ATEM_OPTIMISTIC_CONFIRM_WINDOW   250   // ms after the ACK for the PrgI/PrvI echo
+#endif
+
+#define ATEM_MAX_SPECULATIONS            (2 * ATEM_MAX_MIX_EFFECTS)  // Program and preview per M/E
+
+enum ATEMSpeculatedField : uint8_t {
+    ATEM_SPECULATED_PROGRAM = 0,
+    ATEM_SPECULATED_PREVIEW
+};
+
+// ===========================================
+// SPECULATION JOURNAL
+// ===========================================
+class ATEMSpeculations {
+public:
+    struct Entry {
+        uint8_t me;
+        uint8_t field;                       // ATEMSpeculatedField
+        bool active;
+        bool acked;                          // Switcher acknowledged the packet
+        bool sent;                           // packet_id is known (packet has gone out)
+        uint16_t value;                      // Speculated input
+        uint16_t confirmed;                  // Input the switcher last reported
+        uint16_t packet_id;                  // Packet carrying the change, once sent
+        unsigned long deadline;              // millis() at which it is rolled back
+    };
+
+    ATEMSpeculations() { clear(); }
+
+    void clear() {
+        for (uint8_t i = 0; i < ATEM_MAX_SPECULATIONS; i++) {
+            _entries[i].active = false;
+        }
+    }
+
+    Entry* find(uint8_t me, uint8_t field) {
+        for (uint8_t i = 0; i < ATEM_MAX_SPECULATIONS; i++) {
+            Entry& entry = _entries[i];
+            if (entry.active && entry.me == me && entry.field == field) return &entry;
+        }
+        return nullptr;
+    }
+
+    /**
+     * Start tracking a field
+     * @param confirmed Value the switcher last reported
+     * @return Entry, nullptr if the journal is full
+     */
+    Entry* add(uint8_t me, uint8_t field, uint16_t confirmed) {
+        for (uint8_t i = 0; i < ATEM_MAX_SPECULATIONS; i++) {
+            Entry& entry = _entries[i];
+            if (!entry.active) {
+                entry.active = true;
+                entry.me = me;
+                entry.field = field;
+                entry.confirmed = confirmed;
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    static void remove(Entry& entry) { entry.active = false; }
+
+    /**
+     * First entry still open (for rolling everything back)
+     */
+    Entry* first() {
+        for (uint8_t i = 0; i < ATEM_MAX_SPECULATIONS; i++) {
+            if (_entries[i].active) return &_entries[i];
+        }
+        return nullptr;
+    }
+
+    uint8_t count() const {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < ATEM_MAX_SPECULATIONS; i++) {
+            if (_entries[i].active) n++;
+        }
+        return n;
+    }
+
+    /**
+     * Record the packet that carries the changes still waiting to be sent
+     * (called once the batch or sequence frame holding them goes out)
+     */
+    void sentIn(uint16_t packet_id) {
+        for (uint8_t i = 0; i < ATEM_MAX_SPECULATIONS; i++) {
+            Entry& entry = _entries[i];
+            if (entry.active && !entry.sent) {
+                entry.sent = true;
+                entry.packet_id = packet_id;
+            }
+        }
+    }
+
+    /**
+     * Mark the entries whose packet a cumulative ACK covers; the echo is due
+     * within ATEM_OPTIMISTIC_CONFIRM_WINDOW from now
+     * @return true if a deadline moved
+     */
+    bool acked(uint16_t ack_id, unsigned long now) {
+        bool moved = false;
+        for (uint8_t i = 0; i < ATEM_MAX_SPECULATIONS; i++) {
+            Entry& entry = _entries[i];
+            if (entry.active && entry.sent && !entry.acked && atemPacketCoveredByAck(ack_id, entry.packet_id)) {
+                entry.acked = true;
+                unsigned long window_end = now + ATEM_OPTIMISTIC_CONFIRM_WINDOW;
+                if ((int32_t)(window_end - entry.deadline) < 0) {
+                    entry.deadline = window_end;
+                }
+                moved = true;
+            }
+        }
+        return moved;
+    }
+
+    /**
+     * @return An entry whose deadline has passed, nullptr when there is none
+     */
+    Entry* expired(unsigned long now) {
+        for (uint8_t i = 0; i < ATEM_MAX_SPECULATIONS; i++) {
+            Entry& entry = _entries[i];
+            if (entry.active && (int32_t)(now - entry.deadline) >= 0) return &entry;
+        }
+        return nullptr;
+    }
+
+    /**
+     * Earliest deadline of the open entries
+     * @return false if the journal is empty
+     */
+    bool nextDeadline(unsigned long& at) const {
+        bool found = false;
+        for (uint8_t i = 0; i < ATEM_MAX_SPECULATIONS; i++) {
+            const Entry& entry = _entries[i];
+            if (entry.active && (!found || (int32_t)(entry.deadline - at) < 0)) {
+                at = entry.deadline;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+private:
+    Entry _entries[ATEM_MAX_SPECULATIONS];
+};
+
+#endif // ATEM_OPTIMISTIC_H
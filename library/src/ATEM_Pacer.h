@@ -0,0 +1,228 @@
+#ifndef ATEM_PACER_H
+#define ATEM_PACER_H
+
+#include <stdint.h>
+#include <string.h>  // For memcpy
+#include "ATEM_Commands.h"    // For ATEMCommandId, atemCommandSpec
+#include "ATEM_Retransmit.h"  // For atemPacketCoveredByAck
+
+/**
+ * @file ATEM_Pacer.h
+ * @brief Latest-value-wins channel for continuous controls
+ *
+ * A T-bar or fader sampled at 100+ Hz would otherwise cost one reliable packet
+ * per sample. Paced commands (CTPs, CAMI, CClV) are instead kept in one slot
+ * per parameter (command + M/E, audio input or colour generator index):
+ *
+ *   - a new value replaces a pending one that has not been sent yet
+ *   - pending values go out together on a frame-aligned tick, at most once per
+ *     ATEM_PACING_FRAMES frames of ATEM_PACING_FRAME_RATE (default every 20 ms)
+ *   - a parameter whose last packet is not acknowledged yet keeps its newest
+ *     value back until the ACK arrives, so there is never more than one
+ *     unacknowledged packet per parameter
+ *
+ * After an idle period the first value is sent at once, so a single call is
+ * not delayed. The tick grid restarts from there. A non-paced command takes the
+ * values that are due with it, ahead of itself; a value held back for its ACK
+ * is only ordered against its own parameter.
+ */
+
+// ===========================================
+// COMPILE-TIME CONFIGURATION
+// ===========================================
+#ifndef ATEM_PACED_SLOTS
+#define ATEM_PACED_SLOTS             8         // Parameters pending or in flight at once
+#endif
+
+#ifndef ATEM_PACING_FRAME_RATE
+#define ATEM_PACING_FRAME_RATE       50        // Frames per second of the tick grid
+#endif
+
+#ifndef ATEM_PACING_FRAMES
+#define ATEM_PACING_FRAMES           1         // Frames between ticks
+#endif
+
+/**
+ * Parameter a paced command controls, taken from its payload
+ * @return Key, or -1 if the command is not paced
+ */
+inline int32_t atemPacedKey(ATEMCommandId id, const uint8_t* payload) {
+    switch (id) {
+        case ATEM_CMD_CTPS: return payload[0];                       // M/E
+        case ATEM_CMD_CAMI: return (payload[2] << 8) | payload[3];   // Audio input
+        case ATEM_CMD_CCLV: return payload[1];                       // Colour generator
+        default:            return -1;
+    }
+}
+
+// ===========================================
+// PACER
+// ===========================================
+class ATEMPacer {
+public:
+    struct Slot {
+        uint8_t id;                          // ATEMCommandId
+        uint16_t key;                        // See atemPacedKey()
+        uint16_t packet_id;                  // Packet carrying the last value sent
+        bool pending;                        // Newest value not sent yet
+        bool in_flight;                      // Last packet not acknowledged yet
+        uint8_t payload[ATEM_MAX_COMMAND_PAYLOAD];
+    };
+
+    ATEMPacer() : _merged(0) {
+        setRate(ATEM_PACING_FRAME_RATE, ATEM_PACING_FRAMES);
+        clear();
+    }
+
+    /**
+     * Drop every pending value and forget packets in flight (new session)
+     */
+    void clear() {
+        for (uint8_t i = 0; i < ATEM_PACED_SLOTS; i++) {
+            _slots[i].pending = false;
+            _slots[i].in_flight = false;
+        }
+        _ticking = false;
+    }
+
+    /**
+     * Set the tick grid
+     * @param frames_per_second Frame rate, e.g. 50 or 59.94 (0 turns pacing off)
+     * @param frames Frames between ticks
+     */
+    void setRate(float frames_per_second, uint8_t frames) {
+        if (frames_per_second <= 0.0f) {
+            _interval_us = 0;
+            return;
+        }
+        if (frames == 0) frames = 1;
+        _interval_us = (uint32_t)(1000000.0f * frames / frames_per_second + 0.5f);
+        if (_interval_us == 0) _interval_us = 1;
+    }
+
+    bool enabled() const { return _interval_us != 0; }
+    uint32_t intervalUs() const { return _interval_us; }
+
+    /**
+     * Store the newest value of a parameter
+     * @return false if the command is not paced or every slot is busy (send it directly)
+     */
+    bool update(ATEMCommandId id, const uint8_t* payload) {
+        int32_t key = atemPacedKey(id, payload);
+        if (key < 0) {
+            return false;
+        }
+        Slot* free_slot = nullptr;
+        for (uint8_t i = 0; i < ATEM_PACED_SLOTS; i++) {
+            Slot& slot = _slots[i];
+            if (slot.pending || slot.in_flight) {
+                if (slot.id == id && slot.key == key) {
+                    if (slot.pending) _merged++;
+                    store(slot, payload);
+                    return true;
+                }
+            } else if (!free_slot) {
+                free_slot = &slot;
+            }
+        }
+        if (!free_slot) {
+            return false;
+        }
+        free_slot->id = id;
+        free_slot->key = (uint16_t)key;
+        free_slot->in_flight = false;
+        store(*free_slot, payload);
+        return true;
+    }
+
+    /**
+     * @return true if some parameter has a value waiting for its ACK or the tick
+     */
+    bool pending() const {
+        for (uint8_t i = 0; i < ATEM_PACED_SLOTS; i++) {
+            if (_slots[i].pending) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @param now_us Current micros()
+     * @return Microseconds until the next tick (0 if due)
+     */
+    uint32_t usUntilTick(uint32_t now_us) const {
+        if (!_ticking) {
+            return 0;
+        }
+        int32_t remaining = (int32_t)(_next_tick_us - now_us);
+        return remaining > 0 ? (uint32_t)remaining : 0;
+    }
+
+    /**
+     * Next slot to send on this tick: a pending value with no packet in flight
+     * @return Slot, nullptr when there is none
+     */
+    Slot* nextReady() {
+        for (uint8_t i = 0; i < ATEM_PACED_SLOTS; i++) {
+            if (_slots[i].pending && !_slots[i].in_flight) return &_slots[i];
+        }
+        return nullptr;
+    }
+
+    /**
+     * Record that a slot's value was put in a packet
+     */
+    void sent(Slot& slot, uint16_t packet_id) {
+        slot.pending = false;
+        slot.in_flight = true;
+        slot.packet_id = packet_id;
+    }
+
+    /**
+     * Start the next tick interval after sending
+     * Stays on the frame grid while values keep coming, and restarts it from
+     * now after an idle period
+     */
+    void ticked(uint32_t now_us) {
+        if (_ticking && (uint32_t)(now_us - _next_tick_us) < _interval_us) {
+            _next_tick_us += _interval_us;
+        } else {
+            _next_tick_us = now_us + _interval_us;
+        }
+        _ticking = true;
+    }
+
+    /**
+     * Release the slots whose packet a cumulative ACK covers
+     * @return true if a held-back value can now be sent
+     */
+    bool acked(uint16_t ack_id) {
+        bool unblocked = false;
+        for (uint8_t i = 0; i < ATEM_PACED_SLOTS; i++) {
+            Slot& slot = _slots[i];
+            if (slot.in_flight && atemPacketCoveredByAck(ack_id, slot.packet_id)) {
+                slot.in_flight = false;
+                unblocked |= slot.pending;
+            }
+        }
+        return unblocked;
+    }
+
+    /**
+     * Values replaced before they were sent
+     */
+    uint32_t mergedUpdates() const { return _merged; }
+
+private:
+    static void store(Slot& slot, const uint8_t* payload) {
+        memcpy(slot.payload, payload, atemCommandSpec((ATEMCommandId)slot.id).payload_length);
+        slot.pending = true;
+    }
+
+    Slot _slots[ATEM_PACED_SLOTS];
+    uint32_t _interval_us;                   // 0 = pacing off
+    uint32_t _next_tick_us;
+    bool _ticking;                           // _next_tick_us is valid
+    uint32_t _merged;
+};
+
+#endif // ATEM_PACER_H
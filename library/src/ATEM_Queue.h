@@ -0,0 +1,122 @@
+#ifndef ATEM_QUEUE_H
+#define ATEM_QUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @file ATEM_Queue.h
+ * @brief Lock-free single-producer/single-consumer ring buffer, and the
+ *        sequence lock guarding state shared with the network task
+ *
+ * The queue hands control commands from the application task to the ATEM
+ * network task, and events back the other way. Exactly one task may push and
+ * exactly one (other) task may pop; no locks or heap allocation are involved,
+ * so either side can be called from a tight loop without blocking the other.
+ *
+ * Holds up to N - 1 elements (one slot separates full from empty).
+ */
+template <typename T, uint16_t N>
+class ATEMSpscQueue {
+    static_assert(N >= 2, "ATEMSpscQueue needs at least two slots");
+
+public:
+    ATEMSpscQueue() : _head(0), _tail(0) {}
+
+    /**
+     * Producer side: append an element
+     * @return false if the queue is full (element not stored)
+     */
+    bool push(const T& item) {
+        uint16_t tail = _tail.load(std::memory_order_relaxed);
+        uint16_t next = (uint16_t)((tail + 1) % N);
+        if (next == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        _items[tail] = item;
+        _tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer side: remove the oldest element
+     * @return false if the queue is empty
+     */
+    bool pop(T& item) {
+        uint16_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = _items[head];
+        _head.store((uint16_t)((head + 1) % N), std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Consumer side: discard everything currently queued
+     */
+    void clear() {
+        _head.store(_tail.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    static uint16_t capacity() { return N - 1; }
+
+private:
+    T _items[N];
+    std::atomic<uint16_t> _head;  // Next slot to pop (written by consumer)
+    std::atomic<uint16_t> _tail;  // Next slot to push (written by producer)
+};
+
+// ===========================================
+// SEQUENCE LOCK
+// ===========================================
+/**
+ * One writer, any number of readers that copy and retry
+ *
+ * The network task brackets its updates of the state store and tally with
+ * beginWrite()/endWrite(). The sequence is odd while an update is running, so
+ * a reader that copied during one sees it changed and copies again:
+ *
+ *   uint32_t start;
+ *   do {
+ *     start = lock.readBegin();
+ *     memcpy(&copy, &shared, sizeof(copy));
+ *   } while (lock.readRetry(start));
+ *
+ * The writer never waits, so the network task is not slowed by readers.
+ */
+class ATEMSeqLock {
+public:
+    ATEMSeqLock() : _sequence(0) {}
+
+    void beginWrite() {
+        _sequence.store(_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void endWrite() {
+        _sequence.store(_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @return Sequence before the copy (odd while a write is running)
+     */
+    uint32_t readBegin() const { return _sequence.load(std::memory_order_acquire); }
+
+    /**
+     * @return true if the copy started at readBegin() may be torn
+     */
+    bool readRetry(uint32_t start) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return (start & 1) || _sequence.load(std::memory_order_relaxed) != start;
+    }
+
+private:
+    std::atomic<uint32_t> _sequence;
+};
+
+#endif // ATEM_QUEUE_H
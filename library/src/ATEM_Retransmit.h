@@ -0,0 +1,314 @@
+#ifndef ATEM_RETRANSMIT_H
+#define ATEM_RETRANSMIT_H
+
+#include <stdint.h>
+#include <string.h>  // For memcpy
+
+/**
+ * @file ATEM_Retransmit.h
+ * @brief Variable-length ring arena for outgoing reliable packets, and the
+ *        15-bit packet ID arithmetic and receive window shared by both directions
+ *
+ * Outgoing packets are copied back-to-back into a fixed byte budget instead of
+ * one MAX_PACKET_SIZE slot each. A packet is never split across the end of the
+ * arena, so every stored packet can be handed to the UDP socket in one write.
+ * Entries are kept in send order and freed as soon as a cumulative ACK covers
+ * them; the oldest entry is evicted early only when either the byte budget or
+ * the packet-count cap would be exceeded.
+ *
+ * Both limits are compile-time settings (set them with build flags so the
+ * library and the sketch agree on the object layout):
+ *   -DATEM_RETRANSMIT_BUFFER_SIZE=4096   Byte budget of the arena
+ *   -DMAX_RETRANSMIT_PACKETS=100         Maximum number of stored packets
+ *
+ * Packet IDs wrap from 32767 to 0, about every 4.5 hours at two packets per
+ * second, so they are never compared with < or >; use atemPacketIdDelta().
+ */
+
+// ===========================================
+// COMPILE-TIME CONFIGURATION
+// ===========================================
+#ifndef ATEM_RETRANSMIT_BUFFER_SIZE
+#define ATEM_RETRANSMIT_BUFFER_SIZE  4096      // 4 KB holds ~170 typical 24-byte command packets
+#endif
+
+#ifndef MAX_RETRANSMIT_PACKETS
+#define MAX_RETRANSMIT_PACKETS       100       // Packet-count cap (index ring entries)
+#endif
+
+// Packet IDs are 15-bit and wrap at 32768 (matches Sofie MAX_PACKET_ID)
+#define ATEM_MAX_PACKET_ID           0x8000
+
+static_assert(ATEM_RETRANSMIT_BUFFER_SIZE <= 0xFFFF, "ATEM_RETRANSMIT_BUFFER_SIZE must fit in 16-bit offsets");
+static_assert(MAX_RETRANSMIT_PACKETS > 0, "MAX_RETRANSMIT_PACKETS must be at least 1");
+
+// ===========================================
+// SEQUENCE HELPERS
+// ===========================================
+/**
+ * Signed distance between two packet IDs in the 15-bit sequence space
+ * @return Packets from `from` to `to`, -16384 to 16383 (positive if `to` is newer)
+ */
+inline int16_t atemPacketIdDelta(uint16_t from, uint16_t to) {
+    uint16_t delta = (uint16_t)((to - from) & (ATEM_MAX_PACKET_ID - 1));
+    return delta < ATEM_MAX_PACKET_ID / 2 ? (int16_t)delta : (int16_t)(delta - ATEM_MAX_PACKET_ID);
+}
+
+/**
+ * Check whether an ACK for ack_id also covers packet_id
+ * ACKs are cumulative: a packet is covered if it lies in the half of the 15-bit
+ * sequence space that ends at ack_id, so coverage stays correct across the wrap
+ * from 32767 back to 0.
+ */
+inline bool atemPacketCoveredByAck(uint16_t ack_id, uint16_t packet_id) {
+    return atemPacketIdDelta(packet_id, ack_id) >= 0;
+}
+
+/**
+ * Next packet ID in the 15-bit sequence space
+ */
+inline uint16_t atemNextPacketId(uint16_t packet_id) {
+    return (uint16_t)((packet_id + 1) & (ATEM_MAX_PACKET_ID - 1));
+}
+
+// ===========================================
+// RECEIVE WINDOW
+// ===========================================
+enum ATEMReceiveVerdict : uint8_t {
+    ATEM_RX_IN_ORDER = 0,                    // The next packet: parse it
+    ATEM_RX_OUT_OF_ORDER,                    // An earlier packet is missing: not parsed, the switcher resends it
+    ATEM_RX_DUPLICATE                        // Seen before: ACK again, do not parse
+};
+
+/**
+ * Remote packet IDs received so far
+ *
+ * Keeps the last ID received without a gap, which is the cumulative ACK point.
+ * Only the next packet is parsed: one that arrives ahead of a missing packet is
+ * left out of the ACK, and the switcher resends it after the missing one, so
+ * state updates are applied in the order they were sent (as Sofie does). A
+ * retransmitted or duplicated datagram is recognised and not parsed twice.
+ */
+class ATEMReceiveWindow {
+public:
+    ATEMReceiveWindow() { reset(0); }
+
+    /**
+     * Start a session
+     * @param last_id ID of the packet before the first one expected
+     */
+    void reset(uint16_t last_id) { _last = last_id; }
+
+    /**
+     * Classify a received packet; only an in-order packet is marked as received
+     */
+    ATEMReceiveVerdict receive(uint16_t packet_id) {
+        int16_t delta = atemPacketIdDelta(_last, packet_id);
+        if (delta <= 0) {
+            return ATEM_RX_DUPLICATE;
+        }
+        if (delta > 1) {
+            return ATEM_RX_OUT_OF_ORDER;
+        }
+        _last = packet_id;
+        return ATEM_RX_IN_ORDER;
+    }
+
+    /**
+     * Last packet received with every earlier one (ID to acknowledge)
+     */
+    uint16_t lastInOrder() const { return _last; }
+
+private:
+    uint16_t _last;
+};
+
+// ===========================================
+// RETRANSMIT STORE
+// ===========================================
+class ATEMRetransmitStore {
+public:
+    struct Entry {
+        uint16_t packet_id;        // Packet ID of the stored packet
+        uint16_t offset;           // Start of the packet inside the arena
+        uint16_t length;           // Packet length in bytes
+        uint8_t resend_count;      // Times the packet has been retransmitted
+        unsigned long timestamp;   // millis() when the packet was last sent
+    };
+
+    ATEMRetransmitStore() { clear(); }
+
+    /**
+     * Drop every stored packet
+     */
+    void clear() {
+        _head = 0;
+        _count = 0;
+        _evicted = 0;
+    }
+
+    /**
+     * Copy a packet into the arena, evicting the oldest packets if needed
+     * @return false if the packet is larger than the whole arena
+     */
+    bool store(uint16_t packet_id, const uint8_t* data, uint16_t length, unsigned long now) {
+        if (length == 0 || length > ATEM_RETRANSMIT_BUFFER_SIZE) {
+            return false;
+        }
+
+        if (_count == MAX_RETRANSMIT_PACKETS) {
+            evictOldest();
+        }
+
+        uint16_t offset;
+        while (!allocate(length, offset)) {
+            evictOldest();
+        }
+
+        Entry& slot = _entries[(_head + _count) % MAX_RETRANSMIT_PACKETS];
+        slot.packet_id = packet_id;
+        slot.offset    = offset;
+        slot.length    = length;
+        slot.resend_count = 0;
+        slot.timestamp = now;
+        memcpy(_arena + offset, data, length);
+        _count++;
+        return true;
+    }
+
+    /**
+     * Free every stored packet covered by a cumulative ACK
+     * Packets are stored in send order, so released packets are always the oldest.
+     * @return Number of packets released
+     */
+    uint16_t releaseAcked(uint16_t ack_id) {
+        uint16_t released = 0;
+        while (_count > 0 && atemPacketCoveredByAck(ack_id, at(0).packet_id)) {
+            _head = (_head + 1) % MAX_RETRANSMIT_PACKETS;
+            _count--;
+            released++;
+        }
+        return released;
+    }
+
+    /**
+     * Find the first unacknowledged packet at or after from_packet_id
+     * Used for retransmit requests: if the requested packet was already released
+     * the resend starts at the next packet that is still outstanding.
+     * @return Position in send order, or -1 if no stored packet qualifies
+     */
+    int indexFrom(uint16_t from_packet_id) const {
+        uint16_t before = (uint16_t)((from_packet_id - 1) & (ATEM_MAX_PACKET_ID - 1));
+        for (uint16_t i = 0; i < _count; i++) {
+            if (!atemPacketCoveredByAck(before, at(i).packet_id)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Record that a stored packet has been sent again
+     */
+    void markResent(uint16_t index, unsigned long now) {
+        Entry& slot = _entries[(_head + index) % MAX_RETRANSMIT_PACKETS];
+        if (slot.resend_count < 0xFF) slot.resend_count++;
+        slot.timestamp = now;
+    }
+
+    /**
+     * Find a stored packet by ID
+     * @return Position in send order (0 = oldest), or -1 if not stored
+     */
+    int indexOf(uint16_t packet_id) const {
+        for (uint16_t i = 0; i < _count; i++) {
+            if (at(i).packet_id == packet_id) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Access a stored packet in send order (0 = oldest)
+     */
+    const Entry& at(uint16_t index) const {
+        return _entries[(_head + index) % MAX_RETRANSMIT_PACKETS];
+    }
+
+    const uint8_t* data(const Entry& entry) const { return _arena + entry.offset; }
+
+    uint16_t count() const { return _count; }
+    bool isEmpty() const { return _count == 0; }
+
+    /**
+     * Number of packets dropped to make room before they were acknowledged
+     */
+    uint32_t evictedCount() const { return _evicted; }
+
+    /**
+     * Bytes currently occupied by stored packets
+     */
+    uint16_t bytesUsed() const {
+        uint16_t used = 0;
+        for (uint16_t i = 0; i < _count; i++) {
+            used += at(i).length;
+        }
+        return used;
+    }
+
+    static uint16_t capacityBytes() { return ATEM_RETRANSMIT_BUFFER_SIZE; }
+    static uint16_t capacityPackets() { return MAX_RETRANSMIT_PACKETS; }
+
+private:
+    uint8_t _arena[ATEM_RETRANSMIT_BUFFER_SIZE];
+    Entry _entries[MAX_RETRANSMIT_PACKETS];
+    uint16_t _head;      // Ring index of the oldest entry
+    uint16_t _count;     // Number of stored entries
+    uint32_t _evicted;   // Packets dropped while still stored
+
+    void evictOldest() {
+        _head = (_head + 1) % MAX_RETRANSMIT_PACKETS;
+        _count--;
+        _evicted++;
+    }
+
+    /**
+     * Find a contiguous region of the arena for a new packet
+     * The occupied region runs from the oldest packet to the end of the newest
+     * one, wrapping at most once.
+     */
+    bool allocate(uint16_t length, uint16_t& offset) const {
+        if (_count == 0) {
+            offset = 0;
+            return true;
+        }
+
+        const Entry& oldest = at(0);
+        const Entry& newest = at(_count - 1);
+        uint16_t tail = oldest.offset;
+        uint16_t end  = newest.offset + newest.length;
+
+        if (newest.offset >= tail) {
+            // Not wrapped: free space after the newest packet and before the oldest
+            if (ATEM_RETRANSMIT_BUFFER_SIZE - end >= length) {
+                offset = end;
+                return true;
+            }
+            if (tail >= length) {
+                offset = 0;
+                return true;
+            }
+            return false;
+        }
+
+        // Wrapped: free space is the gap between the newest and the oldest packet
+        if (tail - end >= length) {
+            offset = end;
+            return true;
+        }
+        return false;
+    }
+};
+
+#endif // ATEM_RETRANSMIT_H
@@ -0,0 +1,177 @@
+#ifndef ATEM_SEQUENCE_H
+#define ATEM_SEQUENCE_H
+
+#include <stdint.h>
+
+/**
+ * @file ATEM_Sequence.h
+ * @brief Timed switching sequences run by the protocol engine
+ *
+ * A sequence is a constant array of 4-byte steps, so it can live in flash:
+ *
+ *   static const ATEMSequenceStep SHOW[] = {
+ *     atemSeqPreview(ATEM_INPUT_CAM3),
+ *     atemSeqWaitFrames(12),
+ *     atemSeqAuto(),
+ *     atemSeqWaitTransition(),
+ *     atemSeqGoto(0)
+ *   };
+ *   atem.runSequence(SHOW);
+ *
+ * Steps run on a frame grid at the switcher's frame rate (from VidM), counted
+ * from the moment the sequence starts. Every step up to the next wait is sent
+ * in one datagram, and waits are whole frames. The engine is driven by its own
+ * protocol timer rather than sketch code, and in task mode it runs in the
+ * network task; a late runLoop() delays one step but not the ones after it.
+ */
+
+// ===========================================
+// COMPILE-TIME CONFIGURATION
+// ===========================================
+#ifndef ATEM_SEQUENCE_FALLBACK_FRAME_RATE
+#define ATEM_SEQUENCE_FALLBACK_FRAME_RATE    50  // Frames per second until VidM arrives
+#endif
+
+#ifndef ATEM_SEQUENCE_TRANSITION_START_FRAMES
+#define ATEM_SEQUENCE_TRANSITION_START_FRAMES 10 // Default wait for a transition to start
+#endif
+
+#ifndef ATEM_SEQUENCE_MAX_STEPS_PER_FRAME
+#define ATEM_SEQUENCE_MAX_STEPS_PER_FRAME    32  // Guards against a goto loop without a wait
+#endif
+
+// ===========================================
+// STEPS
+// ===========================================
+enum ATEMSequenceOp : uint8_t {
+    ATEM_SEQ_END = 0,                        // Stop (also after the last step)
+    ATEM_SEQ_PREVIEW,                        // index = M/E, value = input
+    ATEM_SEQ_PROGRAM,                        // index = M/E, value = input
+    ATEM_SEQ_CUT,                            // index = M/E
+    ATEM_SEQ_AUTO,                           // index = M/E
+    ATEM_SEQ_FADE_TO_BLACK,                  // index = M/E
+    ATEM_SEQ_TRANSITION_POSITION,            // index = M/E, value = 0-10000
+    ATEM_SEQ_AUX,                            // index = AUX bus, value = source
+    ATEM_SEQ_DSK_ON_AIR,                     // index = keyer, value = 0/1
+    ATEM_SEQ_DSK_AUTO,                       // index = keyer
+    ATEM_SEQ_USK_ON_AIR,                     // index = M/E, value = keyer << 8 | 0/1
+    ATEM_SEQ_WAIT_FRAMES,                    // value = frames
+    ATEM_SEQ_WAIT_TRANSITION,                // index = M/E, value = frames to wait for the start (0 = default)
+    ATEM_SEQ_GOTO                            // value = step index
+};
+
+struct ATEMSequenceStep {
+    uint8_t op;                              // ATEMSequenceOp
+    uint8_t index;                           // M/E, keyer or AUX bus
+    uint16_t value;                          // Input, frames, step, ...
+};
+
+constexpr ATEMSequenceStep atemSeqPreview(uint16_t input, uint8_t me = 0) { return {ATEM_SEQ_PREVIEW, me, input}; }
+constexpr ATEMSequenceStep atemSeqProgram(uint16_t input, uint8_t me = 0) { return {ATEM_SEQ_PROGRAM, me, input}; }
+constexpr ATEMSequenceStep atemSeqCut(uint8_t me = 0) { return {ATEM_SEQ_CUT, me, 0}; }
+constexpr ATEMSequenceStep atemSeqAuto(uint8_t me = 0) { return {ATEM_SEQ_AUTO, me, 0}; }
+constexpr ATEMSequenceStep atemSeqFadeToBlack(uint8_t me = 0) { return {ATEM_SEQ_FADE_TO_BLACK, me, 0}; }
+constexpr ATEMSequenceStep atemSeqTransitionPosition(uint16_t position, uint8_t me = 0) {
+    return {ATEM_SEQ_TRANSITION_POSITION, me, position};
+}
+constexpr ATEMSequenceStep atemSeqAux(uint16_t source, uint8_t bus = 0) { return {ATEM_SEQ_AUX, bus, source}; }
+constexpr ATEMSequenceStep atemSeqDownstreamKeyOnAir(bool on_air, uint8_t key = 0) {
+    return {ATEM_SEQ_DSK_ON_AIR, key, (uint16_t)on_air};
+}
+constexpr ATEMSequenceStep atemSeqAutoDownstreamKey(uint8_t key = 0) { return {ATEM_SEQ_DSK_AUTO, key, 0}; }
+constexpr ATEMSequenceStep atemSeqUpstreamKeyerOnAir(bool on_air, uint8_t me = 0, uint8_t keyer = 0) {
+    return {ATEM_SEQ_USK_ON_AIR, me, (uint16_t)((keyer << 8) | on_air)};
+}
+constexpr ATEMSequenceStep atemSeqWaitFrames(uint16_t frames) { return {ATEM_SEQ_WAIT_FRAMES, 0, frames}; }
+constexpr ATEMSequenceStep atemSeqWaitTransition(uint8_t me = 0, uint16_t start_frames = 0) {
+    return {ATEM_SEQ_WAIT_TRANSITION, me, start_frames};
+}
+constexpr ATEMSequenceStep atemSeqGoto(uint16_t step) { return {ATEM_SEQ_GOTO, 0, step}; }
+constexpr ATEMSequenceStep atemSeqEnd() { return {ATEM_SEQ_END, 0, 0}; }
+
+// ===========================================
+// SEQUENCER
+// ===========================================
+/**
+ * Position in a running sequence and its frame clock
+ *
+ * Step times are origin + frames / rate, computed from the frame count rather
+ * than by adding rounded frame periods, so 59.94 Hz does not drift. A late
+ * service (a busy loop) delays one step but not the grid.
+ */
+class ATEMSequencer {
+public:
+    ATEMSequencer() : _rate_mhz(ATEM_SEQUENCE_FALLBACK_FRAME_RATE * 1000UL) { stop(); }
+
+    /**
+     * @param rate_mhz Frame rate in millihertz (0 = ATEM_SEQUENCE_FALLBACK_FRAME_RATE)
+     */
+    void start(const ATEMSequenceStep* steps, uint16_t count, uint32_t now_us, uint32_t rate_mhz) {
+        _steps = steps;
+        _count = count;
+        _step = 0;
+        _origin_us = now_us;
+        _frames = 0;
+        _rate_mhz = rate_mhz ? rate_mhz : ATEM_SEQUENCE_FALLBACK_FRAME_RATE * 1000UL;
+        _waited = 0;
+    }
+
+    void stop() {
+        _steps = nullptr;
+        _count = 0;
+        _step = 0;
+    }
+
+    bool running() const { return _steps != nullptr; }
+    uint16_t step() const { return _step; }
+
+    /**
+     * @return Step to run now, nullptr past the end
+     */
+    const ATEMSequenceStep* current() const { return _step < _count ? &_steps[_step] : nullptr; }
+
+    void next() { _step++; _waited = 0; }
+    void jump(uint16_t step) { _step = step; _waited = 0; }
+
+    // Frame clock
+
+    uint32_t dueUs() const {
+        return _origin_us + (uint32_t)((uint64_t)_frames * 1000000000ULL / _rate_mhz);
+    }
+
+    /**
+     * @return Microseconds until the current step is due (0 if due)
+     */
+    uint32_t usUntilDue(uint32_t now_us) const {
+        int32_t remaining = (int32_t)(dueUs() - now_us);
+        return remaining > 0 ? (uint32_t)remaining : 0;
+    }
+
+    void waitFrames(uint16_t frames) { _frames += frames; }
+
+    /**
+     * Follow a new frame rate from the current step on
+     */
+    void setFrameRate(uint32_t rate_mhz) {
+        if (rate_mhz && rate_mhz != _rate_mhz) {
+            _origin_us = dueUs();
+            _frames = 0;
+            _rate_mhz = rate_mhz;
+        }
+    }
+
+    // Progress of ATEM_SEQ_WAIT_TRANSITION
+    uint16_t waitedFrames() const { return _waited; }
+    void waitedFrame() { _waited++; }
+
+private:
+    const ATEMSequenceStep* _steps;          // nullptr = idle
+    uint16_t _count;
+    uint16_t _step;
+    uint32_t _origin_us;                     // micros() of frame 0
+    uint32_t _frames;                        // Frames from the origin to the current step
+    uint32_t _rate_mhz;
+    uint16_t _waited;                        // Frames spent in the current wait step
+};
+
+#endif // ATEM_SEQUENCE_H
@@ -0,0 +1,373 @@
+#ifndef ATEM_SESSION_MANAGER_H
+#define ATEM_SESSION_MANAGER_H
+
+#include <stdint.h>
+#include "ATEM.h"
+
+/**
+ * @file ATEM_SessionManager.h
+ * @brief Several switcher sessions over one UDP socket
+ *
+ * Each ATEM instance binds LOCAL_PORT in begin(), so two of them in one sketch
+ * collide. ATEMSessionManager owns a single socket instead and gives every
+ * session a lightweight port (an ATEMTransport) on top of it:
+ *
+ *   ATEM main_atem, backup_atem;
+ *   ATEMSessionManager sessions;
+ *   sessions.add(main_atem);
+ *   sessions.add(backup_atem);
+ *   main_atem.beginAsync(IPAddress(192, 168, 1, 240));
+ *   backup_atem.beginAsync(IPAddress(192, 168, 1, 241));
+ *
+ *   void loop() {
+ *     sessions.runLoop();   // Instead of main_atem.runLoop() and backup_atem.runLoop()
+ *   }
+ *
+ * runLoop() drains the shared socket, routes each datagram to its session by
+ * remote IP and ATEM session ID, and hands it over in place (no copy when the
+ * shared transport supports receiveView()). All sessions share one local port
+ * and send the same HELLO client ID, so a new switcher-assigned ID cannot be
+ * told apart by address; handshakes with the same switcher are therefore run
+ * one at a time, and the ID is adopted by the one session waiting for it.
+ * Every session is then serviced once, and heartbeats are aligned to staggered
+ * slots so the sessions do not all send in the same loop iteration.
+ *
+ * The manager adds a few bytes per session; memory still scales with the number
+ * of ATEM instances and their retransmit budget (ATEM_RETRANSMIT_BUFFER_SIZE).
+ * Sessions share the manager's loop, so they must not use enableNetworkTask().
+ * Not included by ATEM.h.
+ */
+
+// ===========================================
+// COMPILE-TIME CONFIGURATION
+// ===========================================
+#ifndef ATEM_MAX_SESSIONS
+#define ATEM_MAX_SESSIONS            4         // Sessions per manager
+#endif
+
+#ifndef ATEM_SESSION_HELLO_HOLD
+#define ATEM_SESSION_HELLO_HOLD      500       // ms a handshake holds back other HELLOs to its switcher
+#endif
+
+class ATEMSessionManager;
+
+// ===========================================
+// SESSION PORT
+// ===========================================
+/**
+ * Per-session view of the shared socket (created by ATEMSessionManager::add())
+ */
+class ATEMSessionPort : public ATEMTransport {
+public:
+    ATEMSessionPort() : _manager(nullptr), _pending(nullptr), _pending_length(0), _session_id(0),
+                        _open(false), _awaiting_session_id(false), _hello_ms(0) {}
+
+    bool begin(uint16_t local_port) override;
+    void stop() override;
+    bool send(const IPAddress& ip, uint16_t port, const uint8_t* data, uint16_t length) override;
+
+    int receive(uint8_t* buffer, uint16_t size) override {
+        const uint8_t* data;
+        int length = receiveView(data);
+        if (length <= 0) {
+            return 0;
+        }
+        if (length > size) length = size;
+        memcpy(buffer, data, length);
+        releaseView();
+        return length;
+    }
+
+    int receiveView(const uint8_t*& data) override {
+        if (!_pending) {
+            return 0;
+        }
+        data = _pending;
+        return _pending_length;
+    }
+
+    void releaseView() override {
+        _pending = nullptr;
+        _pending_length = 0;
+    }
+
+    IPAddress remoteIP() override { return _switcher_ip; }
+    uint16_t remotePort() override { return ATEM_PORT; }
+
+private:
+    friend class ATEMSessionManager;
+
+    ATEMSessionManager* _manager;
+    const uint8_t* _pending;             // Datagram routed to this session, not yet read
+    uint16_t _pending_length;
+    IPAddress _switcher_ip;              // Destination of the last datagram sent
+    uint16_t _session_id;                // Client ID from HELLO, then the switcher-assigned ID
+    bool _open;
+    bool _awaiting_session_id;           // HELLO sent, switcher ID not seen yet
+    unsigned long _hello_ms;             // millis() of the last HELLO
+};
+
+// ===========================================
+// SESSION MANAGER
+// ===========================================
+class ATEMSessionManager {
+public:
+    ATEMSessionManager() : _transport(&_wifi_transport), _session_count(0), _open_ports(0),
+                           _unrouted(0), _rx_batch_max(ATEM_RX_BATCH_MAX),
+                           _rx_batch_budget_us(ATEM_RX_BATCH_BUDGET_US) {}
+
+    /**
+     * Replace the shared socket (default WiFiUDP); call before any session begins
+     * @param transport Transport to use, nullptr to go back to WiFiUDP
+     */
+    void setTransport(ATEMTransport* transport) {
+        if (_open_ports) {
+            return;
+        }
+        _transport = transport ? transport : &_wifi_transport;
+    }
+
+    /**
+     * Attach a session; call before its begin()/beginAsync()
+     * @return false if ATEM_MAX_SESSIONS sessions are attached already
+     */
+    bool add(ATEM& atem) {
+        int8_t slot = -1;
+        for (uint8_t i = 0; i < _session_count; i++) {
+            if (_sessions[i] == &atem) return true;
+            if (slot < 0 && !_sessions[i] && !_ports[i]._open) slot = i;
+        }
+        if (slot < 0) {
+            if (_session_count >= ATEM_MAX_SESSIONS) {
+                return false;
+            }
+            slot = _session_count++;
+        }
+        ATEMSessionPort& port = _ports[slot];
+        port = ATEMSessionPort();
+        port._manager = this;
+        _sessions[slot] = &atem;
+        atem.setTransport(&port);
+        restagger();
+        return true;
+    }
+
+    /**
+     * Detach a session (disconnects it first); its slot is reused by add()
+     */
+    void remove(ATEM& atem) {
+        for (uint8_t i = 0; i < _session_count; i++) {
+            if (_sessions[i] == &atem) {
+                atem.disconnect();
+                atem.setTransport(nullptr);
+                _sessions[i] = nullptr;
+                restagger();
+                return;
+            }
+        }
+    }
+
+    uint8_t sessionCount() const {
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < _session_count; i++) {
+            if (_sessions[i]) count++;
+        }
+        return count;
+    }
+
+    /**
+     * Drain the shared socket and service every session (call from loop())
+     * @return Milliseconds until the earliest deadline of any session (see ATEM::runLoop())
+     */
+    uint32_t runLoop() {
+        unsigned long start_us = micros();
+        uint32_t serviced = 0;
+        uint32_t next = ATEM_NO_DEADLINE;
+        int processed = 0;
+
+        while (_open_ports && processed < _rx_batch_max) {
+            const uint8_t* data = nullptr;
+            int length = _transport->receiveView(data);
+            bool borrowed = length >= 0;
+            if (!borrowed) {
+                data = _rx_buffer;
+                length = _transport->receive(_rx_buffer, sizeof(_rx_buffer));
+            }
+            if (length <= 0) {
+                break;
+            }
+            processed++;
+
+            int8_t index = route(_transport->remoteIP(), data, length);
+            if (index >= 0) {
+                ATEMSessionPort& port = _ports[index];
+                port._pending = data;
+                port._pending_length = length > MAX_PACKET_SIZE ? MAX_PACKET_SIZE : length;
+                uint32_t due = _sessions[index]->runLoop();
+                if (due < next) next = due;
+                port.releaseView();
+                serviced |= 1UL << index;
+            } else {
+                _unrouted++;
+            }
+            if (borrowed) _transport->releaseView();
+
+            if (_rx_batch_budget_us > 0 && micros() - start_us >= _rx_batch_budget_us) {
+                break;
+            }
+        }
+
+        // Timers (handshake, heartbeats, timeouts) for sessions that got no traffic
+        for (uint8_t i = 0; i < _session_count; i++) {
+            if (_sessions[i] && !(serviced & (1UL << i))) {
+                uint32_t due = _sessions[i]->runLoop();
+                if (due < next) next = due;
+            }
+        }
+        // A full batch means more datagrams are probably waiting
+        return processed >= _rx_batch_max ? 0 : next;
+    }
+
+    /**
+     * Datagrams (per runLoop() call) drained from the shared socket, as
+     * ATEM::setReceiveBatch()
+     */
+    void setReceiveBatch(uint8_t max_packets, uint32_t budget_us = ATEM_RX_BATCH_BUDGET_US) {
+        _rx_batch_max = (max_packets == 0) ? 1 : max_packets;
+        _rx_batch_budget_us = budget_us;
+    }
+
+    /**
+     * Datagrams that matched no session (other hosts, closed sessions)
+     */
+    uint32_t unroutedDatagrams() const { return _unrouted; }
+
+private:
+    friend class ATEMSessionPort;
+
+    bool openPort(uint16_t local_port) {
+        if (_open_ports == 0 && !_transport->begin(local_port)) {
+            return false;
+        }
+        _open_ports++;
+        return true;
+    }
+
+    void closePort() {
+        if (_open_ports && --_open_ports == 0) {
+            _transport->stop();
+        }
+    }
+
+    /**
+     * Whether another session's handshake with this switcher is still open
+     * (HELLO sent within ATEM_SESSION_HELLO_HOLD, switcher ID not seen yet)
+     */
+    bool handshakeRunning(const IPAddress& ip, const ATEMSessionPort* except) {
+        unsigned long now = millis();
+        for (uint8_t i = 0; i < _session_count; i++) {
+            ATEMSessionPort& port = _ports[i];
+            if (&port != except && port._open && port._awaiting_session_id && port._switcher_ip == ip &&
+                now - port._hello_ms < ATEM_SESSION_HELLO_HOLD) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Pick the session a received datagram belongs to
+     * @return Session index, -1 if none matches
+     *
+     * 1. Same switcher IP and session ID
+     * 2. Same IP, HELLO sent and the switcher-assigned ID not seen yet: the
+     *    session adopts this ID. Only one session per switcher is in this
+     *    state (see handshakeRunning()), so it cannot take another's ID.
+     * 3. Same IP (e.g. a stray packet from an old session ID)
+     */
+    int8_t route(const IPAddress& source, const uint8_t* data, int length) {
+        if (length < HEADER_SIZE) {
+            return -1;
+        }
+        uint16_t session_id = (data[2] << 8) | data[3];
+        int8_t awaiting = -1;
+        int8_t any = -1;
+        for (uint8_t i = 0; i < _session_count; i++) {
+            ATEMSessionPort& port = _ports[i];
+            if (!_sessions[i] || !port._open || !(port._switcher_ip == source)) continue;
+            if (port._session_id == session_id) return i;
+            if (awaiting < 0 && port._awaiting_session_id) awaiting = i;
+            if (any < 0) any = i;
+        }
+        if (awaiting >= 0) {
+            _ports[awaiting]._session_id = session_id;
+            _ports[awaiting]._awaiting_session_id = false;
+            return awaiting;
+        }
+        return any;
+    }
+
+    /**
+     * Spread the sessions' heartbeats evenly over HEARTBEAT_INTERVAL
+     */
+    void restagger() {
+        uint8_t count = sessionCount();
+        uint8_t slot = 0;
+        for (uint8_t i = 0; i < _session_count; i++) {
+            if (_sessions[i]) {
+                _sessions[i]->setHeartbeatPhase((uint16_t)(HEARTBEAT_INTERVAL * slot++ / count));
+            }
+        }
+    }
+
+    ATEMWiFiTransport _wifi_transport;   // Default shared socket
+    ATEMTransport* _transport;
+    ATEM* _sessions[ATEM_MAX_SESSIONS];
+    ATEMSessionPort _ports[ATEM_MAX_SESSIONS];
+    uint8_t _session_count;              // Slots in use, including removed ones
+    uint8_t _open_ports;                 // Sessions between begin() and stop()
+    uint32_t _unrouted;
+    uint8_t _rx_batch_max;
+    uint32_t _rx_batch_budget_us;
+    uint8_t _rx_buffer[MAX_PACKET_SIZE]; // Receive copy for transports that cannot lend their buffers
+};
+
+// ===========================================
+// SESSION PORT (shared socket calls)
+// ===========================================
+inline bool ATEMSessionPort::begin(uint16_t local_port) {
+    if (_open) {
+        return true;
+    }
+    _open = _manager && _manager->openPort(local_port);
+    return _open;
+}
+
+inline void ATEMSessionPort::stop() {
+    releaseView();
+    if (_open) {
+        _open = false;
+        _awaiting_session_id = false;
+        _manager->closePort();
+    }
+}
+
+inline bool ATEMSessionPort::send(const IPAddress& ip, uint16_t port, const uint8_t* data, uint16_t length) {
+    if (!_open) {
+        return false;
+    }
+    // HELLO (NewSessionId flag) starts a session: its client ID is what the
+    // switcher answers with until it assigns its own
+    if (length >= HEADER_SIZE && (data[0] >> 3) & 0x02) {
+        if (_manager->handshakeRunning(ip, this)) {
+            return true;  // Held back like a lost HELLO; ATEM resends it
+        }
+        _session_id = (data[2] << 8) | data[3];
+        _awaiting_session_id = true;
+        _hello_ms = millis();
+    }
+    _switcher_ip = ip;
+    return _manager->_transport->send(ip, port, data, length);
+}
+
+#endif // ATEM_SESSION_MANAGER_H
@@ -0,0 +1,584 @@
+#ifndef ATEM_SIMULATOR_H
+#define ATEM_SIMULATOR_H
+
+#include <stdint.h>
+#include <stddef.h>  // For offsetof
+#include <string.h>  // For memcpy, memset
+#include "ATEM_Transport.h"
+#include "ATEM_Retransmit.h"  // For atemNextPacketId, atemPacketCoveredByAck
+#include "ATEM_Commands.h"    // For atemFourCC, atemReadFourCC, atemPutU16
+
+/**
+ * @file ATEM_Simulator.h
+ * @brief Scripted ATEM switcher behind the ATEMTransport interface
+ *
+ * ATEMSimulator plays the switcher side of the UDP protocol in memory, so the
+ * real protocol engine (parsePacket(), processInitialPayload(),
+ * handleRetransmitRequest()) can run without a network:
+ *
+ *   ATEMSimulator sim;
+ *   sim.setStateDump(dump, dump_length);   // Raw command blocks, e.g. from a capture
+ *   atem.setTransport(&sim);
+ *   atem.beginAsync(IPAddress(10, 0, 0, 1));
+ *
+ * The simulator answers HELLO, streams the state dump in reliable packets with a
+ * bounded send window, resends unacknowledged packets, acknowledges client
+ * packets in order and requests retransmits when one goes missing. CPgI, CPvI,
+ * DCut, DAut and CTPs are answered with the matching PrgI/PrvI/TrPs updates and a
+ * TlIn tally for inputs 1..ATEM_SIM_TALLY_INPUTS (on program/preview of any
+ * M/E; keyers are not modelled). Faults (loss in either direction, reordering,
+ * duplicates, latency) come from a seeded PRNG, so every run is reproducible.
+ *
+ * Not included by ATEM.h. Memory is fixed: one ATEM_SIM_MAX_DATAGRAM buffer per
+ * queued and per in-flight packet (about 35 KB with the defaults).
+ */
+
+// ===========================================
+// COMPILE-TIME CONFIGURATION
+// ===========================================
+#ifndef ATEM_SIM_MAX_DATAGRAM
+#define ATEM_SIM_MAX_DATAGRAM        1420      // Largest datagram the switcher sends
+#endif
+
+#ifndef ATEM_SIM_QUEUE_DEPTH
+#define ATEM_SIM_QUEUE_DEPTH         16        // Datagrams waiting to be received by the client
+#endif
+
+#ifndef ATEM_SIM_WINDOW
+#define ATEM_SIM_WINDOW              8         // Unacknowledged reliable packets in flight
+#endif
+
+#ifndef ATEM_SIM_RESEND_TIMEOUT
+#define ATEM_SIM_RESEND_TIMEOUT      100       // ms before an unacknowledged packet is resent
+#endif
+
+#define ATEM_SIM_HEADER_SIZE         12
+#define ATEM_SIM_MAX_MIX_EFFECTS     4
+#define ATEM_SIM_TALLY_INPUTS        20        // Inputs reported in TlIn
+
+// Header flags (high 5 bits of byte 0)
+#define ATEM_SIM_FLAG_ACK_REQUEST        0x01
+#define ATEM_SIM_FLAG_NEW_SESSION_ID     0x02
+#define ATEM_SIM_FLAG_IS_RETRANSMIT      0x04
+#define ATEM_SIM_FLAG_RETRANSMIT_REQUEST 0x08
+#define ATEM_SIM_FLAG_ACK_REPLY          0x10
+
+static_assert(ATEM_SIM_QUEUE_DEPTH <= 0xFF && ATEM_SIM_WINDOW <= 0xFF, "Simulator queues use 8-bit indices");
+
+// ===========================================
+// FAULTS AND STATISTICS
+// ===========================================
+struct ATEMSimulatorFaults {
+    uint8_t downlink_loss;           // % of switcher -> client datagrams dropped
+    uint8_t uplink_loss;             // % of client -> switcher datagrams dropped
+    uint8_t reorder;                 // % of datagrams delivered before the one queued ahead of them
+    uint8_t duplicate;               // % of datagrams delivered twice
+    uint32_t latency_us;             // Delay before a queued datagram can be received
+};
+
+struct ATEMSimulatorStats {
+    uint32_t datagrams_sent;         // Delivered to the client (including duplicates)
+    uint32_t datagrams_received;     // Accepted from the client
+    uint32_t datagrams_dropped;      // Lost by fault injection, both directions
+    uint32_t datagrams_reordered;
+    uint32_t packets_resent;         // Switcher packets resent after a timeout
+    uint32_t packets_acked_unseen;   // Acknowledged although every copy was dropped (state lost)
+    uint32_t retransmit_requests;    // Requests sent to the client
+    uint32_t commands_received;      // Control commands parsed from client packets
+    uint32_t dump_bytes_sent;        // Progress through the state dump
+};
+
+/**
+ * Write one command block (header + payload)
+ * @param out Destination, at least 8 + length bytes
+ * @return Block size in bytes
+ */
+inline uint16_t atemSimWriteCommand(uint8_t* out, const char* name, const uint8_t* payload, uint16_t length) {
+    uint16_t size = ATEM_COMMAND_HEADER_SIZE + length;
+    atemPutU16(out, 0, size);
+    out[2] = 0x00;
+    out[3] = 0x00;
+    memcpy(out + 4, name, 4);
+    if (length) {
+        memcpy(out + ATEM_COMMAND_HEADER_SIZE, payload, length);
+    }
+    return size;
+}
+
+// ===========================================
+// SIMULATED SWITCHER
+// ===========================================
+class ATEMSimulator : public ATEMTransport {
+public:
+    ATEMSimulator() {
+        memset(&_faults, 0, sizeof(_faults));
+        memset(_staged, 0, sizeof(_staged));
+        memset(_queue, 0, sizeof(_queue));
+        memset(_window, 0, sizeof(_window));
+        _seed = 0x2545F491;
+        _online = true;
+        _dump = nullptr;
+        _dump_length = 0;
+        _session_counter = 0;
+        resetStats();
+        reset();
+    }
+
+    // Script
+
+    /**
+     * State dump sent after every handshake, as concatenated command blocks
+     * The data is not copied and must stay valid. InCm is appended automatically.
+     */
+    void setStateDump(const uint8_t* blocks, uint32_t length) {
+        _dump = blocks;
+        _dump_length = length;
+    }
+
+    void setFaults(const ATEMSimulatorFaults& faults) { _faults = faults; }
+    void setSeed(uint32_t seed) { _seed = seed ? seed : 1; }
+
+    /**
+     * Stop answering (cable pulled) or come back; the client has to reconnect
+     */
+    void setOnline(bool online) { _online = online; }
+
+    /**
+     * Queue a state command for the client, sent in the next reliable packet
+     * @return false if the staging packet is full (call again after receive())
+     */
+    bool queueCommand(const char* name, const uint8_t* payload, uint16_t length) {
+        uint16_t size = ATEM_COMMAND_HEADER_SIZE + length;
+        if (_staged_length + size > ATEM_SIM_MAX_DATAGRAM - ATEM_SIM_HEADER_SIZE) {
+            return false;
+        }
+        atemSimWriteCommand(_staged + _staged_length, name, payload, length);
+        _staged_length += size;
+        return true;
+    }
+
+    /**
+     * Ask the client to resend its packets from the given packet ID onwards
+     */
+    void requestRetransmit(uint16_t from_packet_id) {
+        uint8_t packet[ATEM_SIM_HEADER_SIZE];
+        writeHeader(packet, ATEM_SIM_FLAG_RETRANSMIT_REQUEST, ATEM_SIM_HEADER_SIZE, 0);
+        atemPutU16(packet, 6, from_packet_id);
+        atemPutU16(packet, 10, _last_sent_id);
+        enqueue(packet, ATEM_SIM_HEADER_SIZE);
+        _stats.retransmit_requests++;
+    }
+
+    // Inspection
+
+    bool isSessionOpen() const { return _session_open; }
+    uint16_t getSessionId() const { return _session_id; }
+    bool isDumpComplete() const { return _dump_done; }
+    uint16_t getProgramInput(uint8_t me = 0) const { return me < ATEM_SIM_MAX_MIX_EFFECTS ? _program[me] : 0; }
+    uint16_t getPreviewInput(uint8_t me = 0) const { return me < ATEM_SIM_MAX_MIX_EFFECTS ? _preview[me] : 0; }
+    uint16_t getNextClientPacketId() const { return _client_expected; }
+    uint8_t inFlight() const { return _window_count; }
+    const ATEMSimulatorStats& getStats() const { return _stats; }
+    void resetStats() { memset(&_stats, 0, sizeof(_stats)); }
+
+    // ATEMTransport
+
+    bool begin(uint16_t local_port) override {
+        reset();
+        return true;
+    }
+
+    void stop() override {
+        reset();
+    }
+
+    bool send(const IPAddress& ip, uint16_t port, const uint8_t* data, uint16_t length) override {
+        if (!_online || length < ATEM_SIM_HEADER_SIZE) {
+            return true;  // Sent into the void, like a real socket
+        }
+        if (chance(_faults.uplink_loss)) {
+            _stats.datagrams_dropped++;
+            return true;
+        }
+        _stats.datagrams_received++;
+
+        uint8_t flags = data[0] >> 3;
+        uint16_t packet_id = ((uint16_t)data[10] << 8) | data[11];
+
+        if (flags & ATEM_SIM_FLAG_NEW_SESSION_ID) {
+            openSession(((uint16_t)data[2] << 8) | data[3]);
+            return true;
+        }
+        if (!_session_open) {
+            return true;
+        }
+        if (flags & ATEM_SIM_FLAG_ACK_REPLY) {
+            releaseAcked(((uint16_t)data[4] << 8) | data[5]);
+        }
+        if (flags & ATEM_SIM_FLAG_ACK_REQUEST) {
+            receiveReliable(packet_id, data, length);
+        }
+        return true;
+    }
+
+    int receive(uint8_t* buffer, uint16_t size) override {
+        const uint8_t* data;
+        int length = receiveView(data);
+        if (length <= 0) {
+            return 0;
+        }
+        if (length > size) length = size;
+        memcpy(buffer, data, length);
+        releaseView();
+        return length;
+    }
+
+    int receiveView(const uint8_t*& data) override {
+        service();
+        if (_queue_count == 0) {
+            return 0;
+        }
+        Datagram& next = _queue[_queue_order[_queue_head]];
+        if ((int32_t)(micros() - next.deliver_at) < 0) {
+            return 0;
+        }
+        data = next.data;
+        _view_pending = true;
+        return next.length;
+    }
+
+    void releaseView() override {
+        if (!_view_pending) return;
+        _view_pending = false;
+        _queue_head = (_queue_head + 1) % ATEM_SIM_QUEUE_DEPTH;
+        _queue_count--;
+        _stats.datagrams_sent++;
+    }
+
+private:
+    struct Datagram {
+        uint32_t deliver_at;             // micros() from which the client can read it
+        uint16_t length;
+        uint8_t data[ATEM_SIM_MAX_DATAGRAM];
+    };
+
+    struct InFlight {
+        uint16_t packet_id;
+        uint16_t length;
+        unsigned long sent_at;           // millis() of the last (re)send
+        bool delivered;                  // At least one copy reached the client queue
+        uint8_t data[ATEM_SIM_MAX_DATAGRAM];
+    };
+
+    ATEMSimulatorFaults _faults;
+    ATEMSimulatorStats _stats;
+    uint32_t _seed;
+    bool _online;
+
+    // Session
+    bool _session_open;
+    uint16_t _session_id;
+    uint16_t _session_counter;
+    uint16_t _next_packet_id;            // Next switcher -> client packet ID
+    uint16_t _last_sent_id;
+    uint16_t _client_expected;           // Next in-order client packet ID
+
+    // Script
+    const uint8_t* _dump;
+    uint32_t _dump_length;
+    uint32_t _dump_offset;
+    bool _dump_done;
+    uint8_t _staged[ATEM_SIM_MAX_DATAGRAM - ATEM_SIM_HEADER_SIZE];
+    uint16_t _staged_length;
+    uint16_t _program[ATEM_SIM_MAX_MIX_EFFECTS];
+    uint16_t _preview[ATEM_SIM_MAX_MIX_EFFECTS];
+
+    // Client receive queue (ring of slot indices so reordering is a swap)
+    Datagram _queue[ATEM_SIM_QUEUE_DEPTH];
+    uint8_t _queue_order[ATEM_SIM_QUEUE_DEPTH];
+    uint8_t _queue_head;
+    uint8_t _queue_count;
+    bool _view_pending;                  // Head slot lent out by receiveView()
+
+    // Send window, oldest first
+    InFlight _window[ATEM_SIM_WINDOW];
+    uint8_t _window_count;
+
+    void reset() {
+        _session_open    = false;
+        _session_id      = 0;
+        _next_packet_id  = 1;
+        _last_sent_id    = 0;
+        _client_expected = 1;
+        _dump_offset     = 0;
+        _dump_done       = false;
+        _staged_length   = 0;
+        _queue_head      = 0;
+        _queue_count     = 0;
+        _view_pending    = false;
+        _window_count    = 0;
+        for (uint8_t i = 0; i < ATEM_SIM_QUEUE_DEPTH; i++) {
+            _queue_order[i] = i;
+        }
+        memset(_program, 0, sizeof(_program));
+        memset(_preview, 0, sizeof(_preview));
+    }
+
+    // xorshift32: cheap and reproducible for a given seed
+    bool chance(uint8_t percent) {
+        if (percent == 0) return false;
+        _seed ^= _seed << 13;
+        _seed ^= _seed >> 17;
+        _seed ^= _seed << 5;
+        return (_seed % 100) < percent;
+    }
+
+    void writeHeader(uint8_t* packet, uint8_t flags, uint16_t length, uint16_t packet_id) {
+        atemPutU16(packet, 0, ((uint16_t)flags << 11) | (length & 0x07FF));
+        atemPutU16(packet, 2, _session_id);
+        memset(packet + 4, 0, 6);
+        atemPutU16(packet, 10, packet_id);
+    }
+
+    /**
+     * Hand a datagram to the client side, applying loss, duplicates and reordering
+     * @return false if it was dropped
+     */
+    bool enqueue(const uint8_t* data, uint16_t length) {
+        if (chance(_faults.downlink_loss)) {
+            _stats.datagrams_dropped++;
+            return false;
+        }
+        uint8_t copies = chance(_faults.duplicate) ? 2 : 1;
+        for (uint8_t c = 0; c < copies && _queue_count < ATEM_SIM_QUEUE_DEPTH; c++) {
+            uint8_t position = (_queue_head + _queue_count) % ATEM_SIM_QUEUE_DEPTH;
+            Datagram& slot = _queue[_queue_order[position]];
+            slot.deliver_at = micros() + _faults.latency_us;
+            slot.length = length;
+            memcpy(slot.data, data, length);
+            _queue_count++;
+
+            if (_queue_count > 1 && chance(_faults.reorder)) {
+                uint8_t previous = (position + ATEM_SIM_QUEUE_DEPTH - 1) % ATEM_SIM_QUEUE_DEPTH;
+                uint8_t swap = _queue_order[previous];
+                _queue_order[previous] = _queue_order[position];
+                _queue_order[position] = swap;
+                _stats.datagrams_reordered++;
+            }
+        }
+        return true;
+    }
+
+    void openSession(uint16_t hello_session) {
+        uint16_t counter = _session_counter;
+        reset();
+        _session_counter = counter + 1;
+
+        // HELLO answer carries the client's session ID; data packets use the
+        // switcher-assigned one (high bit set), which the client adopts
+        uint8_t answer[20] = {0};
+        _session_id = hello_session;
+        writeHeader(answer, ATEM_SIM_FLAG_NEW_SESSION_ID, sizeof(answer), 0);
+        answer[12] = 0x02;  // Connection accepted
+        enqueue(answer, sizeof(answer));
+
+        _session_id = 0x8000 | (_session_counter & 0x7FFF);
+        _session_open = true;
+    }
+
+    void releaseAcked(uint16_t ack_id) {
+        uint8_t released = 0;
+        while (released < _window_count && atemPacketCoveredByAck(ack_id, _window[released].packet_id)) {
+            released++;
+        }
+        if (released == 0) return;
+        for (uint8_t i = 0; i < released; i++) {
+            if (!_window[i].delivered) _stats.packets_acked_unseen++;
+        }
+        for (uint8_t i = released; i < _window_count; i++) {
+            memcpy(&_window[i - released], &_window[i], offsetof(InFlight, data) + _window[i].length);
+        }
+        _window_count -= released;
+    }
+
+    void sendAck(uint16_t packet_id) {
+        uint8_t packet[ATEM_SIM_HEADER_SIZE];
+        writeHeader(packet, ATEM_SIM_FLAG_ACK_REPLY, ATEM_SIM_HEADER_SIZE, 0);
+        atemPutU16(packet, 4, packet_id);
+        enqueue(packet, ATEM_SIM_HEADER_SIZE);
+    }
+
+    /**
+     * Client packets are applied strictly in order; a gap triggers one
+     * RetransmitRequest and later packets are ignored until it is filled
+     */
+    void receiveReliable(uint16_t packet_id, const uint8_t* data, uint16_t length) {
+        if (packet_id == _client_expected) {
+            sendAck(packet_id);
+            _client_expected = atemNextPacketId(_client_expected);
+            applyCommands(data + ATEM_SIM_HEADER_SIZE, length - ATEM_SIM_HEADER_SIZE);
+        } else if (atemPacketCoveredByAck((uint16_t)(_client_expected - 1), packet_id)) {
+            sendAck(packet_id);  // Duplicate of a packet already applied
+        } else {
+            requestRetransmit(_client_expected);
+        }
+    }
+
+    void applyCommands(const uint8_t* data, uint16_t length) {
+        uint16_t offset = 0;
+        while (offset + ATEM_COMMAND_HEADER_SIZE <= length) {
+            uint16_t size = ((uint16_t)data[offset] << 8) | data[offset + 1];
+            if (size < ATEM_COMMAND_HEADER_SIZE || offset + size > length) break;
+            applyCommand(atemReadFourCC(data + offset + 4), data + offset + ATEM_COMMAND_HEADER_SIZE,
+                         size - ATEM_COMMAND_HEADER_SIZE);
+            offset += size;
+            _stats.commands_received++;
+        }
+    }
+
+    void queueInput(const char* name, uint8_t me, uint16_t input) {
+        uint8_t payload[4] = {me, 0, (uint8_t)(input >> 8), (uint8_t)(input & 0xFF)};
+        queueCommand(name, payload, sizeof(payload));
+    }
+
+    void queueTally() {
+        uint8_t payload[2 + ATEM_SIM_TALLY_INPUTS] = {0, ATEM_SIM_TALLY_INPUTS};
+        for (uint8_t i = 0; i < ATEM_SIM_MAX_MIX_EFFECTS; i++) {
+            if (_program[i] >= 1 && _program[i] <= ATEM_SIM_TALLY_INPUTS) payload[1 + _program[i]] |= 0x01;
+            if (_preview[i] >= 1 && _preview[i] <= ATEM_SIM_TALLY_INPUTS) payload[1 + _preview[i]] |= 0x02;
+        }
+        queueCommand("TlIn", payload, sizeof(payload));
+    }
+
+    void queueTransitionPosition(uint8_t me, bool in_transition, uint16_t position) {
+        uint8_t payload[8] = {me, (uint8_t)in_transition, 0, 0, (uint8_t)(position >> 8), (uint8_t)(position & 0xFF), 0, 0};
+        queueCommand("TrPs", payload, sizeof(payload));
+    }
+
+    void applyCommand(uint32_t name, const uint8_t* payload, uint16_t length) {
+        if (length < 1 || payload[0] >= ATEM_SIM_MAX_MIX_EFFECTS) return;
+        uint8_t me = payload[0];
+        uint16_t input = length >= 4 ? ((uint16_t)payload[2] << 8) | payload[3] : 0;
+
+        switch (name) {
+            case atemFourCC("CPgI"):
+                _program[me] = input;
+                queueInput("PrgI", me, input);
+                queueTally();
+                break;
+            case atemFourCC("CPvI"):
+                _preview[me] = input;
+                queueInput("PrvI", me, input);
+                queueTally();
+                break;
+            case atemFourCC("CTPs"):
+                queueTransitionPosition(me, input > 0 && input < 10000, input);
+                break;
+            case atemFourCC("DAut"):
+                // Reported as an instant transition: started, then completed
+                queueTransitionPosition(me, true, 0);
+                queueTransitionPosition(me, false, 10000);
+                // fall through
+            case atemFourCC("DCut"): {
+                uint16_t previous = _program[me];
+                _program[me] = _preview[me];
+                _preview[me] = previous;
+                queueInput("PrgI", me, _program[me]);
+                queueInput("PrvI", me, _preview[me]);
+                queueTally();
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    /**
+     * Track program/preview from the dump so DCut/DAut swap the right inputs
+     */
+    void observe(const uint8_t* block, uint16_t size) {
+        if (size < ATEM_COMMAND_HEADER_SIZE + 4) return;
+        uint32_t name = atemReadFourCC(block + 4);
+        const uint8_t* payload = block + ATEM_COMMAND_HEADER_SIZE;
+        if (payload[0] >= ATEM_SIM_MAX_MIX_EFFECTS) return;
+        uint16_t input = ((uint16_t)payload[2] << 8) | payload[3];
+        if (name == atemFourCC("PrgI")) _program[payload[0]] = input;
+        if (name == atemFourCC("PrvI")) _preview[payload[0]] = input;
+    }
+
+    /**
+     * Fill the next reliable packet from staged commands or the state dump
+     * @return Payload bytes written, 0 if there is nothing to send
+     */
+    uint16_t nextPayload(uint8_t* payload, uint16_t capacity) {
+        if (_staged_length) {
+            uint16_t length = _staged_length;
+            memcpy(payload, _staged, length);
+            _staged_length = 0;
+            return length;
+        }
+        if (_dump_done) {
+            return 0;
+        }
+
+        // Whole command blocks only, as the switcher does
+        uint16_t length = 0;
+        while (_dump_offset + ATEM_COMMAND_HEADER_SIZE <= _dump_length) {
+            uint16_t size = ((uint16_t)_dump[_dump_offset] << 8) | _dump[_dump_offset + 1];
+            if (size < ATEM_COMMAND_HEADER_SIZE || _dump_offset + size > _dump_length) {
+                _dump_offset = _dump_length;  // Malformed dump: stop there
+                break;
+            }
+            if (length + size > capacity) break;
+            memcpy(payload + length, _dump + _dump_offset, size);
+            observe(_dump + _dump_offset, size);
+            length += size;
+            _dump_offset += size;
+            _stats.dump_bytes_sent += size;
+        }
+        if (_dump_offset + ATEM_COMMAND_HEADER_SIZE > _dump_length && length + ATEM_COMMAND_HEADER_SIZE <= capacity) {
+            length += atemSimWriteCommand(payload + length, "InCm", nullptr, 0);
+            _dump_done = true;
+        }
+        return length;
+    }
+
+    /**
+     * Resend timed-out packets and fill the send window
+     */
+    void service() {
+        if (!_online || !_session_open) {
+            return;
+        }
+
+        unsigned long now = millis();
+        for (uint8_t i = 0; i < _window_count; i++) {
+            InFlight& packet = _window[i];
+            if (now - packet.sent_at >= ATEM_SIM_RESEND_TIMEOUT && _queue_count < ATEM_SIM_QUEUE_DEPTH) {
+                packet.data[0] |= ATEM_SIM_FLAG_IS_RETRANSMIT << 3;
+                packet.sent_at = now;
+                packet.delivered |= enqueue(packet.data, packet.length);
+                _stats.packets_resent++;
+            }
+        }
+
+        while (_window_count < ATEM_SIM_WINDOW && _queue_count < ATEM_SIM_QUEUE_DEPTH) {
+            InFlight& packet = _window[_window_count];
+            uint16_t payload = nextPayload(packet.data + ATEM_SIM_HEADER_SIZE,
+                                           ATEM_SIM_MAX_DATAGRAM - ATEM_SIM_HEADER_SIZE);
+            if (payload == 0) break;
+
+            packet.packet_id = _next_packet_id;
+            packet.length = ATEM_SIM_HEADER_SIZE + payload;
+            packet.sent_at = now;
+            writeHeader(packet.data, ATEM_SIM_FLAG_ACK_REQUEST, packet.length, packet.packet_id);
+            _window_count++;
+
+            _last_sent_id = _next_packet_id;
+            _next_packet_id = atemNextPacketId(_next_packet_id);
+            packet.delivered = enqueue(packet.data, packet.length);
+        }
+    }
+};
+
+#endif // ATEM_SIMULATOR_H
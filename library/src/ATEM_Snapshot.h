@@ -0,0 +1,637 @@
+#ifndef ATEM_SNAPSHOT_H
+#define ATEM_SNAPSHOT_H
+
+#include <stdint.h>
+#include <string.h>  // For memcpy
+#include "ATEM_State.h"  // For ATEMState, ATEM_STATE_CHANGED_*
+#include "ATEM_Tally.h"  // For ATEMTally
+#include "ATEM_View.h"   // For ATEMByteView
+
+/**
+ * @file ATEM_Snapshot.h
+ * @brief Compact binary snapshots and deltas of the state store
+ *
+ * One ESP32 holding the switcher session can keep any number of downstream
+ * tally and display nodes in sync over ESP-NOW or UDP, instead of each node
+ * taking one of the switcher's few client slots. ATEMSnapshotEncoder turns the
+ * ATEM_STATE_CHANGED_* bits into frames that carry only the changed sections,
+ * and a full snapshot on request or when the topology changes:
+ *
+ *   ATEMSnapshotEncoder exporter;
+ *   void onStateChanged() override { exporter.add(getStateChanges()); }
+ *   ...
+ *   uint8_t frame[ATEM_SNAPSHOT_FRAME_SIZE];
+ *   uint16_t length;
+ *   while ((length = exporter.encode(atem.getStateRef(), &atem.getTally(), frame, sizeof(frame)))) {
+ *     esp_now_send(broadcast, frame, length);
+ *   }
+ *
+ * A node applies the frames to its own ATEMState/ATEMTally with
+ * ATEMSnapshotDecoder and can use the ATEM_State.h helpers on it. A program
+ * change on one M/E is a frame of 11 bytes plus the tally record.
+ *
+ * Frame: {u8 version, u8 flags, u16 sequence}, then records
+ * {u8 section, u8 count, u16 first, u8 length} each followed by count entries
+ * of that section (big-endian, as the ATEM protocol). The section number is
+ * the bit index of its ATEM_STATE_CHANGED_* flag; decoders skip sections they
+ * do not know by the record length. Every frame has the next sequence number,
+ * so a node that misses one ignores deltas until the next full snapshot
+ * (send one periodically, e.g. every few seconds, for nodes that join late).
+ *
+ * Entries:
+ *   PROGRAM, PREVIEW       per M/E: u16 input
+ *   TRANSITION             per M/E: u16 position, u8 frames left, u8 in transition
+ *   TRANSITION_SETUP       per M/E: u8 style, u8 next layers, u8 preview transition
+ *   UPSTREAM_KEYERS        per M/E: u8 on-air mask
+ *   DOWNSTREAM_KEYERS      per keyer: u16 fill, u16 key, u8 rate, u8 frames left,
+ *                          u8 flags (on air, in transition, auto, tie)
+ *   FADE_TO_BLACK          per M/E: u8 rate, u8 frames left, u8 flags (black, in transition)
+ *   AUX                    per output: u16 source
+ *   MEDIA_PLAYERS          per player: u8 source type, u8 still, u8 clip
+ *   INPUTS                 per input: u16 id, u8 port type, u8 availability,
+ *                          u8 M/E availability, u8 length + long name, u8 length + short name
+ *   STALE                  u8 stale
+ *   TOPOLOGY               u8 M/Es, u8 upstream keyers, u8 downstream keyers, u8 aux, u8 media players
+ *   TALLY                  per input on program or preview: u16 id | program << 15 | preview << 14
+ *                          (a record with first = 0 clears the map)
+ *   VIDEO_MODE             u8 mode, u16 frame rate in millihertz
+ */
+
+// ===========================================
+// COMPILE-TIME CONFIGURATION
+// ===========================================
+#ifndef ATEM_SNAPSHOT_FRAME_SIZE
+#define ATEM_SNAPSHOT_FRAME_SIZE     250       // ESP-NOW payload limit
+#endif
+
+#define ATEM_SNAPSHOT_VERSION        1
+#define ATEM_SNAPSHOT_HEADER_SIZE    4         // Per frame
+#define ATEM_SNAPSHOT_RECORD_SIZE    5         // Per record
+#define ATEM_SNAPSHOT_MAX_ENTRY_SIZE (8 + ATEM_INPUT_LONG_NAME_LENGTH + ATEM_INPUT_SHORT_NAME_LENGTH)
+#define ATEM_SNAPSHOT_MIN_FRAME_SIZE (ATEM_SNAPSHOT_HEADER_SIZE + ATEM_SNAPSHOT_RECORD_SIZE + ATEM_SNAPSHOT_MAX_ENTRY_SIZE)
+
+// Frame flags
+#define ATEM_SNAPSHOT_FLAG_FULL      0x01      // First frame of a full snapshot: reset the store
+#define ATEM_SNAPSHOT_FLAG_COMPLETE  0x02      // Nothing left to send: the store matches the sender
+
+#define ATEM_SNAPSHOT_SECTIONS       0x3FFF    // Every ATEM_STATE_CHANGED_* bit
+#define ATEM_SNAPSHOT_SECTION_COUNT  14
+
+static_assert(ATEM_SNAPSHOT_FRAME_SIZE >= ATEM_SNAPSHOT_MIN_FRAME_SIZE, "ATEM_SNAPSHOT_FRAME_SIZE is too small");
+static_assert(ATEM_TALLY_MAX_INPUT_ID < 0x4000, "Tally entries keep the flags in the top two bits");
+
+// ===========================================
+// HELPER FUNCTIONS
+// ===========================================
+inline uint8_t atemSnapshotSection(uint16_t change) {
+    uint8_t section = 0;
+    while (change > 1) {
+        change >>= 1;
+        section++;
+    }
+    return section;
+}
+
+inline uint8_t atemSnapshotNameLength(const char* name, uint8_t width) {
+    uint8_t length = 0;
+    while (length < width && name[length]) {
+        length++;
+    }
+    return length;
+}
+
+// ===========================================
+// ENCODER
+// ===========================================
+/**
+ * Sections waiting to be sent and the position in the one being written
+ *
+ * A section is read from the state when its record is written, not when
+ * add() is called, so several changes to it between two encode() calls cost
+ * one record. Sections longer than a frame (input labels, a busy tally map)
+ * continue in the next frame.
+ */
+class ATEMSnapshotEncoder {
+public:
+    ATEMSnapshotEncoder() : _sequence(0), _section(0), _entry(0), _ordinal(0) { snapshot(); }
+
+    /**
+     * Send every section next, starting with a frame that resets the nodes
+     */
+    void snapshot() {
+        _pending = ATEM_SNAPSHOT_SECTIONS;
+        _full = true;
+        _in_section = false;
+    }
+
+    /**
+     * Queue changed sections
+     * @param changes ATEM_STATE_CHANGED_* bits (getStateChanges()); a topology
+     *        change queues a full snapshot
+     */
+    void add(uint16_t changes) {
+        if (changes & ATEM_STATE_CHANGED_TOPOLOGY) {
+            snapshot();
+        } else {
+            _pending |= changes & ATEM_SNAPSHOT_SECTIONS;
+        }
+    }
+
+    bool pending() const { return _pending || _in_section; }
+
+    /**
+     * Sequence number of the next frame
+     */
+    uint16_t sequence() const { return _sequence; }
+
+    /**
+     * Write the next frame
+     * @param tally Tally to export, nullptr to leave the tally section out
+     * @param size Buffer size, at least ATEM_SNAPSHOT_MIN_FRAME_SIZE
+     * @return Frame length, 0 when nothing is pending
+     */
+    uint16_t encode(const ATEMState& state, const ATEMTally* tally, uint8_t* out, uint16_t size) {
+        if (!pending() || size < ATEM_SNAPSHOT_MIN_FRAME_SIZE) {
+            return 0;
+        }
+        uint16_t offset = ATEM_SNAPSHOT_HEADER_SIZE;
+        while (pending()) {
+            if (!_in_section) {
+                // Topology first, so a node sizes its sections before filling them
+                uint16_t change = (_pending & ATEM_STATE_CHANGED_TOPOLOGY) ? ATEM_STATE_CHANGED_TOPOLOGY
+                                                                            : (_pending & -_pending);
+                _pending &= ~change;
+                if (change == ATEM_STATE_CHANGED_TALLY && !tally) {
+                    continue;
+                }
+                _section = atemSnapshotSection(change);
+                _entry = 0;
+                _ordinal = 0;
+                _in_section = true;
+            }
+            if (!writeRecord(state, tally, out, size, offset)) {
+                break;  // Frame full
+            }
+        }
+        if (offset == ATEM_SNAPSHOT_HEADER_SIZE && !_full) {
+            return 0;  // Only the tally was pending and there is none to export
+        }
+        out[0] = ATEM_SNAPSHOT_VERSION;
+        out[1] = (_full ? ATEM_SNAPSHOT_FLAG_FULL : 0) | (pending() ? 0 : ATEM_SNAPSHOT_FLAG_COMPLETE);
+        out[2] = _sequence >> 8;
+        out[3] = _sequence;
+        _sequence++;
+        _full = false;
+        return offset;
+    }
+
+private:
+    /**
+     * Write one record of the current section
+     * @return false if the frame is full
+     */
+    bool writeRecord(const ATEMState& state, const ATEMTally* tally, uint8_t* out, uint16_t size, uint16_t& offset) {
+        if (offset + ATEM_SNAPSHOT_RECORD_SIZE + ATEM_SNAPSHOT_MAX_ENTRY_SIZE > size) {
+            return false;
+        }
+        uint8_t* record = out + offset;
+        uint8_t* entries = record + ATEM_SNAPSHOT_RECORD_SIZE;
+        uint16_t room = size - offset - ATEM_SNAPSHOT_RECORD_SIZE;
+        if (room > 0xFF) room = 0xFF;  // u8 record length
+        uint16_t first = _ordinal;
+        uint16_t length = 0;
+        uint8_t count = 0;
+        while (length + ATEM_SNAPSHOT_MAX_ENTRY_SIZE <= room && count < 0xFF) {
+            uint8_t written = writeEntry(state, tally, entries + length);
+            if (!written) {
+                break;
+            }
+            length += written;
+            count++;
+            _ordinal++;
+        }
+        _in_section = more(state, tally);
+
+        record[0] = _section;
+        record[1] = count;
+        record[2] = first >> 8;
+        record[3] = first;
+        record[4] = length;
+        offset += ATEM_SNAPSHOT_RECORD_SIZE + length;
+        return true;  // A section left unfinished continues in the next record or frame
+    }
+
+    /**
+     * Whether the current section has entries left
+     */
+    bool more(const ATEMState& state, const ATEMTally* tally) const {
+        if (_section == atemSnapshotSection(ATEM_STATE_CHANGED_TALLY)) {
+            return nextTallyId(tally) >= 0;
+        }
+        return _entry < entryCount(state);
+    }
+
+    uint8_t entryCount(const ATEMState& state) const {
+        switch (1 << _section) {
+            case ATEM_STATE_CHANGED_PROGRAM:
+            case ATEM_STATE_CHANGED_PREVIEW:
+            case ATEM_STATE_CHANGED_TRANSITION:
+            case ATEM_STATE_CHANGED_TRANSITION_SETUP:
+            case ATEM_STATE_CHANGED_UPSTREAM_KEYERS:
+            case ATEM_STATE_CHANGED_FADE_TO_BLACK:   return state.mix_effect_count;
+            case ATEM_STATE_CHANGED_DOWNSTREAM_KEYERS: return state.downstream_keyer_count;
+            case ATEM_STATE_CHANGED_AUX:             return state.aux_count;
+            case ATEM_STATE_CHANGED_MEDIA_PLAYERS:   return state.media_player_count;
+            case ATEM_STATE_CHANGED_INPUTS:          return state.input_count;
+            case ATEM_STATE_CHANGED_TALLY:           return 0;  // Walked by nextTallyId()
+            default:                                 return 1;
+        }
+    }
+
+    /**
+     * Next input at or after _entry with a tally bit set
+     * @return Input ID, -1 if there is none or this is not the tally section
+     */
+    int32_t nextTallyId(const ATEMTally* tally) const {
+        if (!tally || _section != atemSnapshotSection(ATEM_STATE_CHANGED_TALLY)) {
+            return -1;
+        }
+        for (uint32_t id = _entry; id <= tally->max_id; id++) {
+            uint32_t word = tally->program[id >> 5] | tally->preview[id >> 5];
+            if ((id & 31) == 0 && word == 0) {
+                id += 31;  // Skip a dark word
+                continue;
+            }
+            if ((word >> (id & 31)) & 1) {
+                return (int32_t)id;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Write the entry at _entry and advance
+     * @return Bytes written, 0 at the end of the section
+     */
+    uint8_t writeEntry(const ATEMState& state, const ATEMTally* tally, uint8_t* out) {
+        if (_section == atemSnapshotSection(ATEM_STATE_CHANGED_TALLY)) {
+            int32_t id = nextTallyId(tally);
+            if (id < 0) {
+                return 0;
+            }
+            uint16_t value = (uint16_t)id | (tally->isProgram(id) ? 0x8000 : 0) | (tally->isPreview(id) ? 0x4000 : 0);
+            out[0] = value >> 8;
+            out[1] = value;
+            _entry = (uint16_t)id + 1;
+            return 2;
+        }
+        if (_entry >= entryCount(state)) {
+            return 0;
+        }
+        uint8_t index = _entry++;
+        const ATEMMixEffectState& me = state.mix_effects[index < ATEM_MAX_MIX_EFFECTS ? index : 0];
+        switch (1 << _section) {
+            case ATEM_STATE_CHANGED_PROGRAM:
+                return put16(out, me.program_input);
+            case ATEM_STATE_CHANGED_PREVIEW:
+                return put16(out, me.preview_input);
+            case ATEM_STATE_CHANGED_TRANSITION:
+                put16(out, me.transition_position);
+                out[2] = me.transition_frames_left;
+                out[3] = me.in_transition;
+                return 4;
+            case ATEM_STATE_CHANGED_TRANSITION_SETUP:
+                out[0] = me.transition_style;
+                out[1] = me.transition_next;
+                out[2] = me.preview_transition;
+                return 3;
+            case ATEM_STATE_CHANGED_UPSTREAM_KEYERS:
+                out[0] = me.keyers_on_air;
+                return 1;
+            case ATEM_STATE_CHANGED_DOWNSTREAM_KEYERS: {
+                const ATEMDownstreamKeyerState& dsk = state.downstream_keyers[index];
+                put16(out, dsk.fill_source);
+                put16(out + 2, dsk.key_source);
+                out[4] = dsk.rate;
+                out[5] = dsk.frames_left;
+                out[6] = dsk.on_air | (dsk.in_transition << 1) | (dsk.auto_transitioning << 2) | (dsk.tie << 3);
+                return 7;
+            }
+            case ATEM_STATE_CHANGED_FADE_TO_BLACK:
+                out[0] = me.ftb_rate;
+                out[1] = me.ftb_frames_left;
+                out[2] = me.ftb_fully_black | (me.ftb_in_transition << 1);
+                return 3;
+            case ATEM_STATE_CHANGED_AUX:
+                return put16(out, state.aux_sources[index]);
+            case ATEM_STATE_CHANGED_MEDIA_PLAYERS: {
+                const ATEMMediaPlayerState& player = state.media_players[index];
+                out[0] = player.source_type;
+                out[1] = player.still_index;
+                out[2] = player.clip_index;
+                return 3;
+            }
+            case ATEM_STATE_CHANGED_INPUTS: {
+                const ATEMInputProperties& input = state.inputs[index];
+                uint8_t long_length  = atemSnapshotNameLength(input.long_name, ATEM_INPUT_LONG_NAME_LENGTH);
+                uint8_t short_length = atemSnapshotNameLength(input.short_name, ATEM_INPUT_SHORT_NAME_LENGTH);
+                put16(out, input.id);
+                out[2] = input.port_type;
+                out[3] = input.availability;
+                out[4] = input.me_availability;
+                out[5] = long_length;
+                memcpy(out + 6, input.long_name, long_length);
+                out[6 + long_length] = short_length;
+                memcpy(out + 7 + long_length, input.short_name, short_length);
+                return 7 + long_length + short_length;
+            }
+            case ATEM_STATE_CHANGED_STALE:
+                out[0] = state.stale;
+                return 1;
+            case ATEM_STATE_CHANGED_TOPOLOGY:
+                out[0] = state.mix_effect_count;
+                out[1] = state.upstream_keyer_count;
+                out[2] = state.downstream_keyer_count;
+                out[3] = state.aux_count;
+                out[4] = state.media_player_count;
+                return 5;
+            case ATEM_STATE_CHANGED_VIDEO_MODE:
+                out[0] = state.video_mode;
+                put16(out + 1, state.frame_rate_mhz);
+                return 3;
+            default:
+                return 0;
+        }
+    }
+
+    static uint8_t put16(uint8_t* out, uint16_t value) {
+        out[0] = value >> 8;
+        out[1] = value;
+        return 2;
+    }
+
+    uint16_t _pending;                       // ATEM_STATE_CHANGED_* bits not yet started
+    uint16_t _sequence;
+    bool _full;                              // Next frame starts a full snapshot
+    bool _in_section;                        // _section has entries left
+    uint8_t _section;                        // Section being written
+    uint16_t _entry;                         // Next entry index (input ID for the tally)
+    uint16_t _ordinal;                       // Entries of the section already written
+};
+
+// ===========================================
+// DECODER
+// ===========================================
+/**
+ * Applies frames to a node's copy of the state store
+ *
+ *   ATEMState state;
+ *   ATEMTally tally;
+ *   ATEMSnapshotDecoder decoder;
+ *   void onReceive(const uint8_t* data, int length) {
+ *     if (decoder.apply(data, length, state, &tally) && (decoder.changes() & ATEM_STATE_CHANGED_TALLY)) {
+ *       setLed(tally.isProgram(MY_CAMERA));
+ *     }
+ *   }
+ *
+ * Deltas are only applied in order after a full snapshot; after a lost or
+ * malformed frame the decoder waits for the next one.
+ */
+class ATEMSnapshotDecoder {
+public:
+    ATEMSnapshotDecoder() { reset(); }
+
+    /**
+     * Forget the sender (wait for a full snapshot)
+     */
+    void reset() {
+        _started = false;
+        _synced = false;
+        _sequence = 0;
+        _changes = 0;
+        _lost = 0;
+    }
+
+    /**
+     * Apply one frame
+     * @param tally Tally to update, nullptr to ignore the tally section
+     * @return false if the frame was not applied (not a frame of this
+     *         version, malformed, or a delta while out of sync)
+     */
+    bool apply(const uint8_t* data, uint16_t length, ATEMState& state, ATEMTally* tally) {
+        ATEMByteView frame(data, length);
+        _changes = 0;
+        if (!frame.has(0, ATEM_SNAPSHOT_HEADER_SIZE) || frame.u8(0) != ATEM_SNAPSHOT_VERSION) {
+            return false;
+        }
+        uint8_t flags = frame.u8(1);
+        uint16_t sequence = frame.u16(2);
+        if (flags & ATEM_SNAPSHOT_FLAG_FULL) {
+            atemStateReset(state);
+            if (tally) tally->clear();
+            _started = true;
+            _synced = false;
+        } else if (!_started || sequence != _sequence) {
+            if (_started) _lost++;
+            _started = false;
+            _synced = false;
+            return false;
+        }
+        _sequence = sequence + 1;
+
+        uint16_t offset = ATEM_SNAPSHOT_HEADER_SIZE;
+        while (frame.has(offset, ATEM_SNAPSHOT_RECORD_SIZE)) {
+            uint8_t section = frame.u8(offset);
+            uint8_t count   = frame.u8(offset + 1);
+            uint16_t first  = frame.u16(offset + 2);
+            ATEMByteView entries = frame.sub(offset + ATEM_SNAPSHOT_RECORD_SIZE, frame.u8(offset + 4));
+            if (entries.length != frame.u8(offset + 4) || !applyRecord(section, count, first, entries, state, tally)) {
+                _started = false;
+                _synced = false;
+                return false;
+            }
+            if (section < ATEM_SNAPSHOT_SECTION_COUNT) {
+                _changes |= 1 << section;
+            }
+            offset += ATEM_SNAPSHOT_RECORD_SIZE + entries.length;
+        }
+
+        // M/E 1 summary fields
+        state.program_input       = state.mix_effects[0].program_input;
+        state.preview_input       = state.mix_effects[0].preview_input;
+        state.in_transition       = state.mix_effects[0].in_transition;
+        state.transition_position = (uint8_t)(state.mix_effects[0].transition_position / 100);
+
+        if (flags & ATEM_SNAPSHOT_FLAG_COMPLETE) {
+            _synced = true;
+        }
+        return true;
+    }
+
+    /**
+     * @return ATEM_STATE_CHANGED_* bits of the sections the last applied frame carried
+     */
+    uint16_t changes() const { return _changes; }
+
+    /**
+     * @return true once a full snapshot has arrived completely and no frame has been lost since
+     */
+    bool synced() const { return _synced; }
+
+    /**
+     * @return Deltas lost since the decoder was created (frames out of sequence)
+     */
+    uint32_t lostFrames() const { return _lost; }
+
+private:
+    static bool applyRecord(uint8_t section, uint8_t count, uint16_t first, ATEMByteView entries,
+                            ATEMState& state, ATEMTally* tally) {
+        uint16_t offset = 0;
+        uint16_t change = section < ATEM_SNAPSHOT_SECTION_COUNT ? (uint16_t)(1 << section) : 0;
+        if (change == ATEM_STATE_CHANGED_TALLY && tally && first == 0) {
+            tally->clear();
+        }
+        for (uint16_t i = 0; i < count; i++) {
+            uint16_t index = first + i;
+            ATEMMixEffectState* me = index < ATEM_MAX_MIX_EFFECTS ? &state.mix_effects[index] : nullptr;
+            switch (change) {
+                case ATEM_STATE_CHANGED_PROGRAM:
+                    if (!entries.has(offset, 2)) return false;
+                    if (me) me->program_input = entries.u16(offset);
+                    offset += 2;
+                    break;
+                case ATEM_STATE_CHANGED_PREVIEW:
+                    if (!entries.has(offset, 2)) return false;
+                    if (me) me->preview_input = entries.u16(offset);
+                    offset += 2;
+                    break;
+                case ATEM_STATE_CHANGED_TRANSITION:
+                    if (!entries.has(offset, 4)) return false;
+                    if (me) {
+                        me->transition_position    = entries.u16(offset);
+                        me->transition_frames_left = entries.u8(offset + 2);
+                        me->in_transition          = entries.u8(offset + 3) != 0;
+                    }
+                    offset += 4;
+                    break;
+                case ATEM_STATE_CHANGED_TRANSITION_SETUP:
+                    if (!entries.has(offset, 3)) return false;
+                    if (me) {
+                        me->transition_style   = entries.u8(offset);
+                        me->transition_next    = entries.u8(offset + 1);
+                        me->preview_transition = entries.u8(offset + 2) != 0;
+                    }
+                    offset += 3;
+                    break;
+                case ATEM_STATE_CHANGED_UPSTREAM_KEYERS:
+                    if (!entries.has(offset, 1)) return false;
+                    if (me) me->keyers_on_air = entries.u8(offset);
+                    offset += 1;
+                    break;
+                case ATEM_STATE_CHANGED_DOWNSTREAM_KEYERS:
+                    if (!entries.has(offset, 7)) return false;
+                    if (index < ATEM_MAX_DOWNSTREAM_KEYERS) {
+                        ATEMDownstreamKeyerState& dsk = state.downstream_keyers[index];
+                        uint8_t flags = entries.u8(offset + 6);
+                        dsk.fill_source        = entries.u16(offset);
+                        dsk.key_source         = entries.u16(offset + 2);
+                        dsk.rate               = entries.u8(offset + 4);
+                        dsk.frames_left        = entries.u8(offset + 5);
+                        dsk.on_air             = flags & 0x01;
+                        dsk.in_transition      = flags & 0x02;
+                        dsk.auto_transitioning = flags & 0x04;
+                        dsk.tie                = flags & 0x08;
+                    }
+                    offset += 7;
+                    break;
+                case ATEM_STATE_CHANGED_FADE_TO_BLACK:
+                    if (!entries.has(offset, 3)) return false;
+                    if (me) {
+                        me->ftb_rate          = entries.u8(offset);
+                        me->ftb_frames_left   = entries.u8(offset + 1);
+                        me->ftb_fully_black   = entries.u8(offset + 2) & 0x01;
+                        me->ftb_in_transition = entries.u8(offset + 2) & 0x02;
+                    }
+                    offset += 3;
+                    break;
+                case ATEM_STATE_CHANGED_AUX:
+                    if (!entries.has(offset, 2)) return false;
+                    if (index < ATEM_MAX_AUX_OUTPUTS) state.aux_sources[index] = entries.u16(offset);
+                    offset += 2;
+                    break;
+                case ATEM_STATE_CHANGED_MEDIA_PLAYERS:
+                    if (!entries.has(offset, 3)) return false;
+                    if (index < ATEM_MAX_MEDIA_PLAYERS) {
+                        ATEMMediaPlayerState& player = state.media_players[index];
+                        player.source_type = entries.u8(offset);
+                        player.still_index = entries.u8(offset + 1);
+                        player.clip_index  = entries.u8(offset + 2);
+                    }
+                    offset += 3;
+                    break;
+                case ATEM_STATE_CHANGED_INPUTS: {
+                    if (!entries.has(offset, 6)) return false;
+                    uint8_t long_length = entries.u8(offset + 5);
+                    if (long_length > ATEM_INPUT_LONG_NAME_LENGTH || !entries.has(offset + 6, long_length + 1)) return false;
+                    uint8_t short_length = entries.u8(offset + 6 + long_length);
+                    if (short_length > ATEM_INPUT_SHORT_NAME_LENGTH ||
+                        !entries.has(offset + 7 + long_length, short_length)) return false;
+                    ATEMInputProperties* input = atemStateInputSlot(state, entries.u16(offset));
+                    if (input) {
+                        input->port_type       = entries.u8(offset + 2);
+                        input->availability    = entries.u8(offset + 3);
+                        input->me_availability = entries.u8(offset + 4);
+                        memcpy(input->long_name, entries.data + offset + 6, long_length);
+                        input->long_name[long_length] = '\0';
+                        memcpy(input->short_name, entries.data + offset + 7 + long_length, short_length);
+                        input->short_name[short_length] = '\0';
+                    }
+                    offset += 7 + long_length + short_length;
+                    break;
+                }
+                case ATEM_STATE_CHANGED_STALE:
+                    if (!entries.has(offset, 1)) return false;
+                    state.stale = entries.u8(offset) != 0;
+                    offset += 1;
+                    break;
+                case ATEM_STATE_CHANGED_TOPOLOGY:
+                    if (!entries.has(offset, 5)) return false;
+                    state.mix_effect_count       = atemStateLimit(entries.u8(offset), ATEM_MAX_MIX_EFFECTS);
+                    state.upstream_keyer_count   = atemStateLimit(entries.u8(offset + 1), ATEM_MAX_UPSTREAM_KEYERS);
+                    state.downstream_keyer_count = atemStateLimit(entries.u8(offset + 2), ATEM_MAX_DOWNSTREAM_KEYERS);
+                    state.aux_count              = atemStateLimit(entries.u8(offset + 3), ATEM_MAX_AUX_OUTPUTS);
+                    state.media_player_count     = atemStateLimit(entries.u8(offset + 4), ATEM_MAX_MEDIA_PLAYERS);
+                    if (state.mix_effect_count == 0) state.mix_effect_count = 1;
+                    offset += 5;
+                    break;
+                case ATEM_STATE_CHANGED_TALLY: {
+                    if (!entries.has(offset, 2)) return false;
+                    uint16_t value = entries.u16(offset);
+                    if (tally) {
+                        tally->set(value & 0x3FFF, ((value & 0x8000) ? ATEM_TALLY_FLAG_PROGRAM : 0) |
+                                                   ((value & 0x4000) ? ATEM_TALLY_FLAG_PREVIEW : 0));
+                    }
+                    offset += 2;
+                    break;
+                }
+                case ATEM_STATE_CHANGED_VIDEO_MODE:
+                    if (!entries.has(offset, 3)) return false;
+                    state.video_mode     = entries.u8(offset);
+                    state.frame_rate_mhz = entries.u16(offset + 1);
+                    offset += 3;
+                    break;
+                default:
+                    return true;  // Unknown section, skipped by its length
+            }
+        }
+        return offset == entries.length;
+    }
+
+    bool _started;                           // Full snapshot received, sequence followed since
+    bool _synced;                            // ... and completed
+    uint16_t _sequence;                      // Expected sequence number
+    uint16_t _changes;
+    uint32_t _lost;
+};
+
+#endif // ATEM_SNAPSHOT_H
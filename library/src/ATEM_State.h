@@ -0,0 +1,375 @@
+#ifndef ATEM_STATE_H
+#define ATEM_STATE_H
+
+#include <stdint.h>
+#include <string.h>  // For memset, memcpy, strncmp
+#include "ATEM_Models.h"  // For ATEMCapabilities
+
+/**
+ * @file ATEM_State.h
+ * @brief Switcher state store filled from the ATEM state dump and updates
+ *
+ * All storage is fixed-size: every section is an array sized by a compile-time
+ * maximum, and the counts in ATEMState say how many entries the connected model
+ * actually has (taken from ATEMCapabilities). Lower the maxima with build flags
+ * to save RAM on small nodes:
+ *   -DATEM_MAX_MIX_EFFECTS=1 -DATEM_MAX_AUX_OUTPUTS=1 -DATEM_MAX_INPUTS=16
+ *
+ * A node that only needs part of the state can limit which command families are
+ * decoded (ATEM_SUBSCRIBE_*); commands of other families are skipped by their
+ * length without reading the payload. Families left out of ATEM_SUBSCRIPTIONS at
+ * build time also drop their storage to one entry:
+ *   -DATEM_SUBSCRIPTIONS=ATEM_SUBSCRIBE_TALLY   Tally light: no keyer, aux,
+ *                                               media or input records
+ * ATEM::setSubscriptions() narrows the set further at runtime.
+ *
+ * Every update sets one ATEM_STATE_CHANGED_* bit and, for sections with several
+ * entries, the entry's bit in an ATEMStateChanges mask. ATEM::getStateChanges()
+ * returns the section bits collected since the previous onStateChanged() call,
+ * ATEM::getStateChangeMasks() which M/Es, keyers, buses, players and inputs.
+ */
+
+// ===========================================
+// SUBSCRIPTIONS
+// ===========================================
+// Command families decoded into the state store. Identification and topology
+// (_ver, _pin, _top, _MeC), the video mode (VidM) and InCm are always decoded.
+#define ATEM_SUBSCRIBE_PROGRAM_PREVIEW  (1UL << 0)   // PrgI, PrvI
+#define ATEM_SUBSCRIBE_TRANSITIONS      (1UL << 1)   // TrPs, TrSS, TrPr
+#define ATEM_SUBSCRIBE_KEYERS           (1UL << 2)   // KeOn, DskS, DskP, DskB
+#define ATEM_SUBSCRIBE_FADE_TO_BLACK    (1UL << 3)   // FtbS, FtbP
+#define ATEM_SUBSCRIBE_AUX              (1UL << 4)   // AuxS
+#define ATEM_SUBSCRIBE_MEDIA            (1UL << 5)   // MPCE
+#define ATEM_SUBSCRIBE_INPUTS           (1UL << 6)   // InPr (labels, availability)
+#define ATEM_SUBSCRIBE_TALLY            (1UL << 7)   // TlIn, TlSr
+#define ATEM_SUBSCRIBE_ALL              0xFFUL
+
+// ===========================================
+// COMPILE-TIME CONFIGURATION
+// ===========================================
+#ifndef ATEM_SUBSCRIPTIONS
+#define ATEM_SUBSCRIPTIONS           ATEM_SUBSCRIBE_ALL  // Families compiled in (handlers and storage)
+#endif
+
+#ifndef ATEM_MAX_MIX_EFFECTS
+#define ATEM_MAX_MIX_EFFECTS         4         // Constellation 4K/8K
+#endif
+
+#ifndef ATEM_MAX_UPSTREAM_KEYERS
+#define ATEM_MAX_UPSTREAM_KEYERS     4         // Per M/E
+#endif
+
+#ifndef ATEM_MAX_DOWNSTREAM_KEYERS
+#if ATEM_SUBSCRIPTIONS & ATEM_SUBSCRIBE_KEYERS
+#define ATEM_MAX_DOWNSTREAM_KEYERS   4
+#else
+#define ATEM_MAX_DOWNSTREAM_KEYERS   1         // Not decoded (ATEM_SUBSCRIPTIONS)
+#endif
+#endif
+
+#ifndef ATEM_MAX_AUX_OUTPUTS
+#if ATEM_SUBSCRIPTIONS & ATEM_SUBSCRIBE_AUX
+#define ATEM_MAX_AUX_OUTPUTS         24
+#else
+#define ATEM_MAX_AUX_OUTPUTS         1         // Not decoded (ATEM_SUBSCRIPTIONS)
+#endif
+#endif
+
+#ifndef ATEM_MAX_MEDIA_PLAYERS
+#if ATEM_SUBSCRIPTIONS & ATEM_SUBSCRIBE_MEDIA
+#define ATEM_MAX_MEDIA_PLAYERS       4
+#else
+#define ATEM_MAX_MEDIA_PLAYERS       1         // Not decoded (ATEM_SUBSCRIPTIONS)
+#endif
+#endif
+
+#ifndef ATEM_MAX_INPUTS
+#if ATEM_SUBSCRIPTIONS & ATEM_SUBSCRIBE_INPUTS
+#define ATEM_MAX_INPUTS              64        // Input property records (cameras + internal sources)
+#else
+#define ATEM_MAX_INPUTS              1         // Not decoded (ATEM_SUBSCRIPTIONS)
+#endif
+#endif
+
+#define ATEM_INPUT_LONG_NAME_LENGTH  20        // InPr long name field
+#define ATEM_INPUT_SHORT_NAME_LENGTH 4         // InPr short name field
+
+static_assert(ATEM_MAX_MIX_EFFECTS >= 1, "ATEM_MAX_MIX_EFFECTS must be at least 1");
+static_assert(ATEM_MAX_UPSTREAM_KEYERS <= 8, "Upstream keyer on-air flags are an 8-bit mask");
+static_assert(ATEM_MAX_INPUTS <= 0xFF, "ATEM_MAX_INPUTS must fit in uint8_t");
+static_assert(ATEM_MAX_MIX_EFFECTS <= 8 && ATEM_MAX_DOWNSTREAM_KEYERS <= 8 && ATEM_MAX_MEDIA_PLAYERS <= 8,
+              "Changed M/Es, downstream keyers and media players are 8-bit masks");
+static_assert(ATEM_MAX_AUX_OUTPUTS <= 32, "Changed aux buses are a 32-bit mask");
+
+// ===========================================
+// CHANGE GROUPS
+// ===========================================
+// One bit per section of ATEMState. 16 bits so the mask fits in ATEMEvent::value.
+enum ATEMStateChange : uint16_t {
+    ATEM_STATE_CHANGED_PROGRAM           = 1 << 0,   // MixEffect::program_input
+    ATEM_STATE_CHANGED_PREVIEW           = 1 << 1,   // MixEffect::preview_input
+    ATEM_STATE_CHANGED_TRANSITION        = 1 << 2,   // Position / in-transition (TrPs)
+    ATEM_STATE_CHANGED_TRANSITION_SETUP  = 1 << 3,   // Style, next layers, preview (TrSS, TrPr)
+    ATEM_STATE_CHANGED_UPSTREAM_KEYERS   = 1 << 4,   // KeOn
+    ATEM_STATE_CHANGED_DOWNSTREAM_KEYERS = 1 << 5,   // DskS, DskP, DskB
+    ATEM_STATE_CHANGED_FADE_TO_BLACK     = 1 << 6,   // FtbS, FtbP
+    ATEM_STATE_CHANGED_AUX               = 1 << 7,   // AuxS
+    ATEM_STATE_CHANGED_MEDIA_PLAYERS     = 1 << 8,   // MPCE
+    ATEM_STATE_CHANGED_INPUTS            = 1 << 9,   // InPr (names, port type, availability)
+    ATEM_STATE_CHANGED_STALE             = 1 << 10,  // ATEMState::stale flipped
+    ATEM_STATE_CHANGED_TOPOLOGY          = 1 << 11,  // Section counts changed
+    ATEM_STATE_CHANGED_TALLY             = 1 << 12,  // TlIn, TlSr (ATEM::getTally(), kept outside ATEMState)
+    ATEM_STATE_CHANGED_VIDEO_MODE        = 1 << 13   // VidM
+};
+
+#define ATEM_INPUT_CHANGE_WORDS      ((ATEM_MAX_INPUTS + 31) / 32)
+
+/**
+ * Which entries changed, next to the section bits
+ * Bit n of a mask is entry n of the matching ATEMState array
+ */
+struct ATEMStateChanges {
+    uint16_t sections;               // ATEM_STATE_CHANGED_* bits
+    uint8_t mix_effects;             // Program, preview, transition, keyer or fade to black
+    uint8_t downstream_keyers;
+    uint8_t media_players;
+    uint32_t aux;                    // aux_sources
+    uint32_t inputs[ATEM_INPUT_CHANGE_WORDS];  // inputs[] records (not input IDs)
+};
+
+// ===========================================
+// STATE SECTIONS
+// ===========================================
+struct ATEMMixEffectState {
+    uint16_t program_input;
+    uint16_t preview_input;
+    uint16_t transition_position;    // Handle position 0-10000 (TrPs)
+    uint8_t transition_frames_left;  // Frames remaining in the running transition
+    uint8_t transition_style;        // 0 mix, 1 dip, 2 wipe, 3 DVE, 4 stinger (TrSS)
+    uint8_t transition_next;         // Layers in the next transition: bit 0 background, bit n+1 keyer n
+    uint8_t keyers_on_air;           // Bit n = upstream keyer n on air (KeOn)
+    uint8_t ftb_rate;                // Fade to black rate in frames (FtbP)
+    uint8_t ftb_frames_left;         // Frames remaining in the running fade
+    bool in_transition;
+    bool preview_transition;         // Transition preview enabled (TrPr)
+    bool ftb_fully_black;
+    bool ftb_in_transition;
+};
+
+struct ATEMDownstreamKeyerState {
+    uint16_t fill_source;            // DskB
+    uint16_t key_source;
+    uint8_t rate;                    // Auto transition rate in frames (DskP)
+    uint8_t frames_left;             // Frames remaining in the running auto transition
+    bool on_air;                     // DskS
+    bool in_transition;
+    bool auto_transitioning;
+    bool tie;                        // DskP
+};
+
+struct ATEMMediaPlayerState {
+    uint8_t source_type;             // 1 = still, 2 = clip (MPCE)
+    uint8_t still_index;
+    uint8_t clip_index;
+};
+
+struct ATEMInputProperties {
+    uint16_t id;                     // Input ID as used by CPgI/CPvI
+    char long_name[ATEM_INPUT_LONG_NAME_LENGTH + 1];    // Label set on the switcher (NUL terminated)
+    char short_name[ATEM_INPUT_SHORT_NAME_LENGTH + 1];  // Multiviewer/tally label
+    uint8_t port_type;               // Internal port type (0 external, 1 black, 2 bars, ...)
+    uint8_t availability;            // Source availability bits (aux, multiviewer, SuperSource, ...)
+    uint8_t me_availability;         // Bit n = selectable on M/E n
+};
+
+// ===========================================
+// STATE STORE
+// ===========================================
+struct ATEMState {
+    // M/E 1 summary, kept for sketches written against the original four fields
+    uint16_t program_input;
+    uint16_t preview_input;
+    bool in_transition;
+    uint8_t transition_position;     // M/E 1 transition position in percent (0-100)
+    bool stale;                      // Last known values, not yet confirmed by the current session
+
+    // Video standard, for frame-based timing (VidM)
+    uint8_t video_mode;              // Switcher video mode number (see atemVideoModeFrameRate())
+    uint16_t frame_rate_mhz;         // Its frame rate in millihertz, 0 until VidM arrives
+
+    // Entries in use for the connected model (never above the ATEM_MAX_* limits)
+    uint8_t mix_effect_count;
+    uint8_t upstream_keyer_count;    // Per M/E
+    uint8_t downstream_keyer_count;
+    uint8_t aux_count;
+    uint8_t media_player_count;
+    uint8_t input_count;             // Input property records received so far
+
+    ATEMMixEffectState mix_effects[ATEM_MAX_MIX_EFFECTS];
+    ATEMDownstreamKeyerState downstream_keyers[ATEM_MAX_DOWNSTREAM_KEYERS];
+    uint16_t aux_sources[ATEM_MAX_AUX_OUTPUTS];
+    ATEMMediaPlayerState media_players[ATEM_MAX_MEDIA_PLAYERS];
+    ATEMInputProperties inputs[ATEM_MAX_INPUTS];
+};
+
+// ===========================================
+// HELPER FUNCTIONS
+// ===========================================
+inline uint8_t atemStateLimit(uint8_t count, uint8_t max) {
+    return count < max ? count : max;
+}
+
+/**
+ * Record an update of one entry
+ * @param change ATEM_STATE_CHANGED_* bit of the section
+ * @param index Entry within the section (M/E, keyer, bus, player or inputs[] record);
+ *              ignored for sections without entries
+ */
+inline void atemStateChangesMark(ATEMStateChanges& changes, uint16_t change, uint8_t index) {
+    changes.sections |= change;
+    switch (change) {
+        case ATEM_STATE_CHANGED_PROGRAM:
+        case ATEM_STATE_CHANGED_PREVIEW:
+        case ATEM_STATE_CHANGED_TRANSITION:
+        case ATEM_STATE_CHANGED_TRANSITION_SETUP:
+        case ATEM_STATE_CHANGED_UPSTREAM_KEYERS:
+        case ATEM_STATE_CHANGED_FADE_TO_BLACK:
+            if (index < ATEM_MAX_MIX_EFFECTS) changes.mix_effects |= (uint8_t)(1 << index);
+            break;
+        case ATEM_STATE_CHANGED_DOWNSTREAM_KEYERS:
+            if (index < ATEM_MAX_DOWNSTREAM_KEYERS) changes.downstream_keyers |= (uint8_t)(1 << index);
+            break;
+        case ATEM_STATE_CHANGED_AUX:
+            if (index < ATEM_MAX_AUX_OUTPUTS) changes.aux |= 1UL << index;
+            break;
+        case ATEM_STATE_CHANGED_MEDIA_PLAYERS:
+            if (index < ATEM_MAX_MEDIA_PLAYERS) changes.media_players |= (uint8_t)(1 << index);
+            break;
+        case ATEM_STATE_CHANGED_INPUTS:
+            if (index < ATEM_MAX_INPUTS) changes.inputs[index / 32] |= 1UL << (index % 32);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Add the changes of from to into (changes not reported yet)
+ */
+inline void atemStateChangesMerge(ATEMStateChanges& into, const ATEMStateChanges& from) {
+    into.sections          |= from.sections;
+    into.mix_effects       |= from.mix_effects;
+    into.downstream_keyers |= from.downstream_keyers;
+    into.media_players     |= from.media_players;
+    into.aux               |= from.aux;
+    for (uint8_t i = 0; i < ATEM_INPUT_CHANGE_WORDS; i++) {
+        into.inputs[i] |= from.inputs[i];
+    }
+}
+
+/**
+ * @return true if the inputs[] record at index changed
+ */
+inline bool atemStateInputChanged(const ATEMStateChanges& changes, uint8_t index) {
+    return index < ATEM_MAX_INPUTS && (changes.inputs[index / 32] & (1UL << (index % 32)));
+}
+
+/**
+ * Frame rate of a VidM video mode
+ * Interlaced modes count frames, not fields, as transition rates do
+ * @return Millihertz (59940 for 1080p59.94), 0 for an unknown mode
+ */
+inline uint16_t atemVideoModeFrameRate(uint8_t mode) {
+    static const uint16_t rates[] = {
+        29970, 25000, 29970, 25000,          // 525i59.94, 625i50 (4:3, 16:9)
+        50000, 59940,                        // 720p50, 720p59.94
+        25000, 29970,                        // 1080i50, 1080i59.94
+        23976, 24000, 25000, 29970, 50000, 59940,  // 1080p23.98 ... 1080p59.94
+        23976, 24000, 25000, 29970, 50000, 59940,  // 2160p
+        23976, 24000, 25000, 29970, 50000, 59940,  // 4320p
+        30000, 60000                         // 1080p30, 1080p60
+    };
+    return mode < sizeof(rates) / sizeof(rates[0]) ? rates[mode] : 0;
+}
+
+/**
+ * Set the section counts from the model capabilities
+ * Without capabilities every section uses its full ATEM_MAX_* size
+ * @return true if any count changed
+ */
+inline bool atemStateConfigure(ATEMState& state, const ATEMCapabilities* caps) {
+    uint8_t me    = caps ? atemStateLimit(caps->mix_effects, ATEM_MAX_MIX_EFFECTS) : ATEM_MAX_MIX_EFFECTS;
+    uint8_t usk   = caps ? atemStateLimit(caps->upstream_keyers, ATEM_MAX_UPSTREAM_KEYERS) : ATEM_MAX_UPSTREAM_KEYERS;
+    uint8_t dsk   = caps ? atemStateLimit(caps->downstream_keyers, ATEM_MAX_DOWNSTREAM_KEYERS) : ATEM_MAX_DOWNSTREAM_KEYERS;
+    uint8_t aux   = caps ? atemStateLimit(caps->aux_outputs, ATEM_MAX_AUX_OUTPUTS) : ATEM_MAX_AUX_OUTPUTS;
+    uint8_t media = caps ? atemStateLimit(caps->media_players, ATEM_MAX_MEDIA_PLAYERS) : ATEM_MAX_MEDIA_PLAYERS;
+    if (me == 0) me = 1;  // Every switcher has at least one M/E
+
+    bool changed = state.mix_effect_count != me || state.upstream_keyer_count != usk ||
+                   state.downstream_keyer_count != dsk || state.aux_count != aux ||
+                   state.media_player_count != media;
+
+    state.mix_effect_count       = me;
+    state.upstream_keyer_count   = usk;
+    state.downstream_keyer_count = dsk;
+    state.aux_count              = aux;
+    state.media_player_count     = media;
+    return changed;
+}
+
+/**
+ * Clear all values and size the sections for the given model
+ * The state starts out stale until a state dump has been received.
+ */
+inline void atemStateReset(ATEMState& state, const ATEMCapabilities* caps = nullptr) {
+    memset(&state, 0, sizeof(state));
+    state.stale = true;
+    atemStateConfigure(state, caps);
+}
+
+/**
+ * Find the property record for an input ID
+ * @return Record, or nullptr if the switcher has not reported the input
+ */
+inline const ATEMInputProperties* atemStateFindInput(const ATEMState& state, uint16_t id) {
+    for (uint8_t i = 0; i < state.input_count; i++) {
+        if (state.inputs[i].id == id) {
+            return &state.inputs[i];
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Copy a fixed-width, NUL-padded name field into a terminated buffer
+ * @return true if the stored name changed
+ */
+inline bool atemStateCopyName(char* dest, const uint8_t* field, uint8_t width) {
+    uint8_t length = 0;
+    while (length < width && field[length]) {
+        length++;
+    }
+    if (strncmp(dest, (const char*)field, length) == 0 && dest[length] == '\0') {
+        return false;
+    }
+    memcpy(dest, field, length);
+    dest[length] = '\0';
+    return true;
+}
+
+/**
+ * Find or add the property record for an input ID
+ * @return Record, or nullptr if all ATEM_MAX_INPUTS records are in use
+ */
+inline ATEMInputProperties* atemStateInputSlot(ATEMState& state, uint16_t id) {
+    ATEMInputProperties* input = const_cast<ATEMInputProperties*>(atemStateFindInput(state, id));
+    if (input || state.input_count >= ATEM_MAX_INPUTS) {
+        return input;
+    }
+    input = &state.inputs[state.input_count++];
+    memset(input, 0, sizeof(*input));
+    input->id = id;
+    return input;
+}
+
+#endif // ATEM_STATE_H
@@ -0,0 +1,175 @@
+#ifndef ATEM_TALLY_H
+#define ATEM_TALLY_H
+
+#include <stdint.h>
+#include <string.h>  // For memset, memcpy
+#include "ATEM_Models.h"  // For ATEMCapabilities
+#include "ATEM_State.h"   // For ATEM_SUBSCRIPTIONS
+
+/**
+ * @file ATEM_Tally.h
+ * @brief Per-input tally bitsets from the switcher's TlIn/TlSr commands
+ *
+ * The switcher computes tally itself: an input is on program if it reaches the
+ * program output through any path (M/E program, an upstream or downstream key,
+ * SuperSource, another M/E), which program/preview input tracking alone cannot
+ * see. ATEMTally keeps one program and one preview bit per input ID, sized for
+ * the connected model from ATEMCapabilities::max_input_id and a compile-time
+ * ceiling:
+ *   -DATEM_TALLY_MAX_INPUT_ID=40      Cameras only (16 bytes per map)
+ *   -DATEM_TALLY_MAX_INPUT_ID=11001   Every source TlSr reports (2.75 KB per map)
+ * ATEM keeps two maps: the live one and the one last reported to the callback.
+ * Without ATEM_SUBSCRIBE_TALLY in ATEM_SUBSCRIPTIONS the maps shrink to one word.
+ *
+ * ATEM::onTallyChanged() receives an ATEMTallyDiff holding the XOR of the
+ * previous and new words, so it runs only when a bit flipped and a tally light
+ * just tests its own input.
+ */
+
+// ===========================================
+// COMPILE-TIME CONFIGURATION
+// ===========================================
+#ifndef ATEM_TALLY_MAX_INPUT_ID
+#if ATEM_SUBSCRIPTIONS & ATEM_SUBSCRIBE_TALLY
+#define ATEM_TALLY_MAX_INPUT_ID      255       // Highest input ID tracked (covers all external inputs)
+#else
+#define ATEM_TALLY_MAX_INPUT_ID      0         // Not decoded (ATEM_SUBSCRIPTIONS)
+#endif
+#endif
+
+#define ATEM_TALLY_WORDS             ((ATEM_TALLY_MAX_INPUT_ID + 32) / 32)
+
+// Tally flags in TlIn/TlSr entries
+#define ATEM_TALLY_FLAG_PROGRAM      0x01
+#define ATEM_TALLY_FLAG_PREVIEW      0x02
+
+// ===========================================
+// TALLY MAP
+// ===========================================
+struct ATEMTally {
+    uint32_t program[ATEM_TALLY_WORDS];      // Bit per input ID
+    uint32_t preview[ATEM_TALLY_WORDS];
+    uint16_t max_id;                         // Highest input ID tracked for the connected model
+
+    bool isProgram(uint16_t id) const { return id <= max_id && (program[id >> 5] >> (id & 31)) & 1; }
+    bool isPreview(uint16_t id) const { return id <= max_id && (preview[id >> 5] >> (id & 31)) & 1; }
+
+    void clear() {
+        memset(program, 0, sizeof(program));
+        memset(preview, 0, sizeof(preview));
+        max_id = ATEM_TALLY_MAX_INPUT_ID;
+    }
+
+    /**
+     * Size the map for a model; bits of inputs it does not have are cleared
+     * @param caps Capabilities of the connected model, nullptr if unknown
+     */
+    void configure(const ATEMCapabilities* caps) {
+        max_id = (caps && caps->max_input_id < ATEM_TALLY_MAX_INPUT_ID) ? caps->max_input_id
+                                                                           : ATEM_TALLY_MAX_INPUT_ID;
+        for (uint32_t id = (uint32_t)max_id + 1; id < ATEM_TALLY_WORDS * 32; id++) {
+            program[id >> 5] &= ~(1UL << (id & 31));
+            preview[id >> 5] &= ~(1UL << (id & 31));
+        }
+    }
+
+    /**
+     * Set the tally of one input from its TlIn/TlSr flags
+     * @return true if a bit changed
+     */
+    bool set(uint16_t id, uint8_t flags) {
+        if (id > max_id) {
+            return false;
+        }
+        uint32_t mask = 1UL << (id & 31);
+        uint32_t& program_word = program[id >> 5];
+        uint32_t& preview_word = preview[id >> 5];
+        uint32_t new_program = (flags & ATEM_TALLY_FLAG_PROGRAM) ? (program_word | mask) : (program_word & ~mask);
+        uint32_t new_preview = (flags & ATEM_TALLY_FLAG_PREVIEW) ? (preview_word | mask) : (preview_word & ~mask);
+        bool changed = ((program_word ^ new_program) | (preview_word ^ new_preview)) != 0;
+        program_word = new_program;
+        preview_word = new_preview;
+        return changed;
+    }
+};
+
+// ===========================================
+// TALLY DIFF
+// ===========================================
+/**
+ * Inputs whose tally changed since the previous onTallyChanged() call
+ *
+ *   void onTallyChanged(const ATEMTallyDiff& diff) override {
+ *     if (diff.changed(MY_CAMERA)) setLed(diff.tally.isProgram(MY_CAMERA));
+ *   }
+ *
+ * or walk every changed input:
+ *   for (int32_t id = diff.next(); id >= 0; id = diff.next(id)) { ... }
+ */
+struct ATEMTallyDiff {
+    const ATEMTally& tally;                  // New tally (the reported copy, not the live map)
+    uint32_t program_changed[ATEM_TALLY_WORDS]; // Old XOR new program words
+    uint32_t preview_changed[ATEM_TALLY_WORDS];
+
+    /**
+     * Compute the difference and bring the reported copy up to date
+     * @param current Live tally
+     * @param reported Tally as of the previous diff; updated to current
+     */
+    ATEMTallyDiff(const ATEMTally& current, ATEMTally& reported) : ATEMTallyDiff(reported) {
+        memcpy(&reported, &current, sizeof(reported));
+        update();
+    }
+
+    /**
+     * Start a difference against the tally last reported; copy the new tally
+     * into reported (e.g. under a lock), then call update()
+     * @param reported Tally as of the previous diff
+     */
+    explicit ATEMTallyDiff(const ATEMTally& reported) : tally(reported) {
+        memcpy(program_changed, reported.program, sizeof(program_changed));
+        memcpy(preview_changed, reported.preview, sizeof(preview_changed));
+    }
+
+    /**
+     * Finish the difference once tally holds the new map
+     */
+    void update() {
+        for (uint16_t i = 0; i < ATEM_TALLY_WORDS; i++) {
+            program_changed[i] ^= tally.program[i];
+            preview_changed[i] ^= tally.preview[i];
+        }
+    }
+
+    bool programChanged(uint16_t id) const { return id <= tally.max_id && (program_changed[id >> 5] >> (id & 31)) & 1; }
+    bool previewChanged(uint16_t id) const { return id <= tally.max_id && (preview_changed[id >> 5] >> (id & 31)) & 1; }
+    bool changed(uint16_t id) const { return programChanged(id) || previewChanged(id); }
+
+    bool empty() const {
+        uint32_t any = 0;
+        for (uint16_t i = 0; i < ATEM_TALLY_WORDS; i++) {
+            any |= program_changed[i] | preview_changed[i];
+        }
+        return any == 0;
+    }
+
+    /**
+     * Next input ID whose program or preview bit flipped
+     * @param after Start after this ID (-1 = from the beginning)
+     * @return Input ID, -1 when there are no more
+     */
+    int32_t next(int32_t after = -1) const {
+        uint32_t id = (uint32_t)(after + 1);
+        while (id <= tally.max_id) {
+            uint32_t word = (program_changed[id >> 5] | preview_changed[id >> 5]) >> (id & 31);
+            if (word) {
+                id += __builtin_ctz(word);
+                return id <= tally.max_id ? (int32_t)id : -1;
+            }
+            id = (id | 31) + 1;  // Rest of this word is clear
+        }
+        return -1;
+    }
+};
+
+#endif // ATEM_TALLY_H
@@ -0,0 +1,149 @@
+#ifndef ATEM_TIMERS_H
+#define ATEM_TIMERS_H
+
+#include <stdint.h>
+
+/**
+ * @file ATEM_Timers.h
+ * @brief Protocol deadline scheduler
+ *
+ * Every protocol deadline (HELLO resend, handshake timeout, heartbeat, receive
+ * timeout, reconnect backoff, paced command tick, speculation deadline, sequence
+ * step) is one named slot in an ATEMTimers set. Arming, re-arming and
+ * cancelling are O(1); the earliest deadline is cached and only recomputed
+ * after the timer holding it moved, so the common case of re-arming the
+ * receive timeout on every packet costs one store. With a handful of slots a
+ * linear scan beats a heap or wheel in both code size and cache behaviour.
+ *
+ * Deadlines are millis() values compared with wrap-safe signed differences, so
+ * they keep working across the 49-day rollover.
+ */
+
+// ===========================================
+// TIMER IDS
+// ===========================================
+enum ATEMTimerId : uint8_t {
+    ATEM_TIMER_HELLO_RESEND = 0,             // Resend HELLO (exponential backoff)
+    ATEM_TIMER_HANDSHAKE_TIMEOUT,            // Give up on the handshake
+    ATEM_TIMER_HEARTBEAT,                    // Next heartbeat
+    ATEM_TIMER_RECEIVE_TIMEOUT,              // Nothing received for CONNECTION_TIMEOUT
+    ATEM_TIMER_RECONNECT,                    // Next reconnect attempt
+    ATEM_TIMER_PACING,                       // Next tick of the paced command channel
+    ATEM_TIMER_OPTIMISTIC,                   // Earliest speculation deadline
+    ATEM_TIMER_SEQUENCE,                     // Next frame a running sequence waits for
+    ATEM_TIMER_COUNT
+};
+
+// Returned when no timer is armed
+#define ATEM_NO_DEADLINE             0xFFFFFFFFUL
+
+// ===========================================
+// TIMER SET
+// ===========================================
+class ATEMTimers {
+public:
+    ATEMTimers() { clear(); }
+
+    /**
+     * Cancel every timer
+     */
+    void clear() {
+        _armed = 0;
+        _next = ATEM_TIMER_HELLO_RESEND;
+        _next_valid = true;
+    }
+
+    /**
+     * Arm (or move) a timer
+     * @param id Timer to arm
+     * @param at millis() deadline
+     */
+    void arm(ATEMTimerId id, unsigned long at) {
+        bool was_next = _next_valid && (_armed & bit(id)) && _next == id;
+        _deadline[id] = at;
+        _armed |= bit(id);
+        if (!_next_valid) {
+            return;
+        }
+        if (was_next) {
+            _next_valid = false;  // Moved the earliest one: rescan when asked
+        } else if (_armed == bit(id) || before(at, _deadline[_next])) {
+            _next = id;
+        }
+    }
+
+    void cancel(ATEMTimerId id) {
+        if (!(_armed & bit(id))) {
+            return;
+        }
+        _armed &= ~bit(id);
+        if (_next == id) {
+            _next_valid = false;
+        }
+    }
+
+    bool armed(ATEMTimerId id) const { return _armed & bit(id); }
+
+    /**
+     * Take the earliest timer that has expired
+     * @param now Current millis()
+     * @param id Set to the expired timer, which is disarmed
+     * @return false if no timer is due
+     */
+    bool expired(unsigned long now, ATEMTimerId& id) {
+        if (!findNext()) {
+            return false;
+        }
+        if ((long)(now - _deadline[_next]) < 0) {
+            return false;
+        }
+        id = _next;
+        cancel(id);
+        return true;
+    }
+
+    /**
+     * @param now Current millis()
+     * @return Milliseconds until the earliest deadline (0 if one is due),
+     *         ATEM_NO_DEADLINE if no timer is armed
+     */
+    uint32_t msUntilNext(unsigned long now) {
+        if (!findNext()) {
+            return ATEM_NO_DEADLINE;
+        }
+        long remaining = (long)(_deadline[_next] - now);
+        return remaining > 0 ? (uint32_t)remaining : 0;
+    }
+
+private:
+    static uint8_t bit(ATEMTimerId id) { return (uint8_t)(1 << id); }
+
+    static bool before(unsigned long a, unsigned long b) { return (long)(a - b) < 0; }
+
+    bool findNext() {
+        if (_armed == 0) {
+            return false;
+        }
+        if (!_next_valid) {
+            bool found = false;
+            for (uint8_t i = 0; i < ATEM_TIMER_COUNT; i++) {
+                ATEMTimerId id = (ATEMTimerId)i;
+                if ((_armed & bit(id)) && (!found || before(_deadline[id], _deadline[_next]))) {
+                    _next = id;
+                    found = true;
+                }
+            }
+            _next_valid = true;
+        }
+        return true;
+    }
+
+    unsigned long _deadline[ATEM_TIMER_COUNT];
+    uint8_t _armed;                          // Bit per ATEMTimerId
+    ATEMTimerId _next;                       // Earliest armed timer, if _next_valid
+    bool _next_valid;
+};
+
+static_assert(ATEM_TIMER_COUNT <= 8, "Armed timers are tracked in an 8-bit mask");
+
+#endif // ATEM_TIMERS_H
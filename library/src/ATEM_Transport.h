@@ -0,0 +1,127 @@
+#ifndef ATEM_TRANSPORT_H
+#define ATEM_TRANSPORT_H
+
+#include <stdint.h>
+#include <WiFiUdp.h>
+
+/**
+ * @file ATEM_Transport.h
+ * @brief Datagram transport used by the protocol engine
+ *
+ * ATEM only needs to send and receive whole UDP datagrams, so the socket sits
+ * behind this small interface. ATEMWiFiTransport (WiFiUDP) is the default; a
+ * sketch can hand ATEM::setTransport() any other implementation:
+ *
+ *   ATEMUdpTransport<EthernetUDP>   W5500 and other boards using the Arduino
+ *                                   Ethernet library (own TCP/IP stack)
+ *   ATEMLwipTransport               Raw lwIP udp_pcb on ESP32, any netif
+ *                                   (ATEM_LwipTransport.h)
+ *   ATEMSimulator                   Scripted switcher (ATEM_Simulator.h)
+ *
+ * On ESP32, WiFiUDP is a thin layer over lwIP sockets, so the default transport
+ * also runs over the ETH interface (LAN8720, or W5500 through the core's ETH
+ * driver); only the route to the switcher decides which interface is used.
+ *
+ * All calls are made from the context that services the connection (runLoop()
+ * or the network task), never concurrently.
+ */
+
+// ===========================================
+// TRANSPORT INTERFACE
+// ===========================================
+class ATEMTransport {
+public:
+    virtual ~ATEMTransport() {}
+
+    /**
+     * Open the socket
+     * @param local_port UDP port to bind
+     * @return true if the transport is ready to send and receive
+     */
+    virtual bool begin(uint16_t local_port) = 0;
+
+    /**
+     * Close the socket and drop queued datagrams
+     */
+    virtual void stop() = 0;
+
+    /**
+     * Send one datagram
+     * @return true if the whole datagram was handed to the network
+     */
+    virtual bool send(const IPAddress& ip, uint16_t port, const uint8_t* data, uint16_t length) = 0;
+
+    /**
+     * Read the next queued datagram
+     * @param buffer Destination
+     * @param size Size of buffer; longer datagrams are truncated
+     * @return Bytes read, 0 if nothing is queued
+     */
+    virtual int receive(uint8_t* buffer, uint16_t size) = 0;
+
+    /**
+     * Zero-copy receive: lend the next queued datagram in the transport's own buffer
+     * @param data Set to the first byte of the datagram
+     * @return Bytes at data, 0 if nothing is queued, -1 if the transport cannot
+     *         lend its buffers (the caller falls back to receive())
+     * The datagram stays valid until releaseView(), which must be called before
+     * the next receive call.
+     */
+    virtual int receiveView(const uint8_t*& data) { return -1; }
+    virtual void releaseView() {}
+
+    /**
+     * Sender of the datagram last returned by receive() (for logging)
+     */
+    virtual IPAddress remoteIP() { return IPAddress(); }
+    virtual uint16_t remotePort() { return 0; }
+};
+
+// ===========================================
+// ARDUINO UDP TRANSPORT
+// ===========================================
+/**
+ * Transport over any class with the Arduino UDP API (WiFiUDP, EthernetUDP, ...)
+ */
+template <typename UDPClass>
+class ATEMUdpTransport : public ATEMTransport {
+public:
+    bool begin(uint16_t local_port) override {
+        return _udp.begin(local_port);
+    }
+
+    void stop() override {
+        _udp.stop();
+    }
+
+    bool send(const IPAddress& ip, uint16_t port, const uint8_t* data, uint16_t length) override {
+        if (!_udp.beginPacket(ip, port)) {
+            return false;
+        }
+        size_t written = _udp.write(data, length);
+        return _udp.endPacket() && written == length;
+    }
+
+    int receive(uint8_t* buffer, uint16_t size) override {
+        if (_udp.parsePacket() <= 0) {
+            return 0;
+        }
+        int length = _udp.read(buffer, size);
+        return length > 0 ? length : 0;
+    }
+
+    IPAddress remoteIP() override { return _udp.remoteIP(); }
+    uint16_t remotePort() override { return _udp.remotePort(); }
+
+    /**
+     * Underlying socket, e.g. to set options the interface does not cover
+     */
+    UDPClass& udp() { return _udp; }
+
+private:
+    UDPClass _udp;
+};
+
+typedef ATEMUdpTransport<WiFiUDP> ATEMWiFiTransport;
+
+#endif // ATEM_TRANSPORT_H
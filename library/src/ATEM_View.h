@@ -0,0 +1,119 @@
+#ifndef ATEM_VIEW_H
+#define ATEM_VIEW_H
+
+#include <stdint.h>
+
+/**
+ * @file ATEM_View.h
+ * @brief Bounds-checked views over received packets
+ *
+ * The receive path parses commands in place, straight from the buffer the
+ * transport received the datagram into. ATEMByteView is a pointer + length
+ * pair whose readers never touch memory outside it (out-of-range reads return
+ * 0), and ATEMCommandReader walks the command blocks of a packet payload,
+ * handing out a view of each block's payload only after checking that the
+ * whole block lies inside the packet.
+ *
+ *   ATEMCommandReader reader(ATEMByteView(payload, length));
+ *   uint32_t name;
+ *   ATEMByteView command;
+ *   while (reader.next(name, command)) { ... }
+ *   if (reader.malformed()) { ... }
+ */
+
+// ===========================================
+// BYTE VIEW
+// ===========================================
+struct ATEMByteView {
+    const uint8_t* data;
+    uint16_t length;
+
+    ATEMByteView() : data(nullptr), length(0) {}
+    ATEMByteView(const uint8_t* bytes, uint16_t size) : data(bytes), length(bytes ? size : 0) {}
+
+    bool empty() const { return length == 0; }
+
+    /**
+     * Check that count bytes starting at offset lie inside the view
+     */
+    bool has(uint16_t offset, uint16_t count) const {
+        return (uint32_t)offset + count <= length;
+    }
+
+    // Big-endian readers; 0 when the field is outside the view
+    uint8_t u8(uint16_t offset) const {
+        return has(offset, 1) ? data[offset] : 0;
+    }
+
+    uint16_t u16(uint16_t offset) const {
+        return has(offset, 2) ? (uint16_t)((data[offset] << 8) | data[offset + 1]) : 0;
+    }
+
+    uint32_t u32(uint16_t offset) const {
+        return has(offset, 4) ? ((uint32_t)data[offset] << 24) | ((uint32_t)data[offset + 1] << 16) |
+                                ((uint32_t)data[offset + 2] << 8) | data[offset + 3]
+                              : 0;
+    }
+
+    /**
+     * Part of the view; empty if it does not fit entirely
+     */
+    ATEMByteView sub(uint16_t offset, uint16_t count) const {
+        return has(offset, count) ? ATEMByteView(data + offset, count) : ATEMByteView();
+    }
+
+    /**
+     * Everything from offset to the end; empty if offset is past the end
+     */
+    ATEMByteView from(uint16_t offset) const {
+        return offset <= length ? ATEMByteView(data + offset, length - offset) : ATEMByteView();
+    }
+};
+
+// ===========================================
+// COMMAND READER
+// ===========================================
+/**
+ * Iterates the command blocks of a packet payload:
+ *   u16 length (including the 8-byte header) | u16 reserved | 4-char name | payload
+ */
+class ATEMCommandReader {
+public:
+    explicit ATEMCommandReader(ATEMByteView payload) : _payload(payload), _offset(0), _malformed(false) {}
+
+    /**
+     * Advance to the next command block
+     * @param name Receives the command name (as atemFourCC())
+     * @param payload Receives a view of the block payload
+     * @return false at the end of the packet or at a block whose length is
+     *         invalid or runs past the packet (malformed() is then true)
+     */
+    bool next(uint32_t& name, ATEMByteView& payload) {
+        if (!_payload.has(_offset, 8)) {
+            return false;  // Fewer than 8 bytes left: end of packet (trailing padding is ignored)
+        }
+        uint16_t size = _payload.u16(_offset);
+        if (size < 8 || !_payload.has(_offset, size)) {
+            _malformed = true;
+            return false;
+        }
+        name    = _payload.u32(_offset + 4);
+        payload = _payload.sub(_offset + 8, size - 8);
+        _offset += size;
+        return true;
+    }
+
+    bool malformed() const { return _malformed; }
+
+    /**
+     * Offset of the next block (the size of the well-formed prefix once next() has failed)
+     */
+    uint16_t offset() const { return _offset; }
+
+private:
+    ATEMByteView _payload;
+    uint16_t _offset;
+    bool _malformed;
+};
+
+#endif // ATEM_VIEW_H
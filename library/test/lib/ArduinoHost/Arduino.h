@@ -0,0 +1,142 @@
+#ifndef ARDUINO_HOST_H
+#define ARDUINO_HOST_H
+
+/**
+ * @file Arduino.h
+ * @brief The parts of the Arduino core ATEM.cpp uses, for native builds
+ *
+ * Only used by the [env:simulator] test environment. Time is the host's
+ * monotonic clock plus a virtual offset: delay() and hostAdvanceClock() move
+ * the offset instead of sleeping, so timeouts can be fast-forwarded while the
+ * work between them is still measured in real microseconds.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <string>
+
+#define HEX 16
+#define DEC 10
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ===========================================
+// TIME AND RANDOM
+// ===========================================
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void hostAdvanceClock(unsigned long us);   // Fast-forward without sleeping
+long random(long max);
+long random(long min, long max);
+
+// ===========================================
+// STRING
+// ===========================================
+class String {
+public:
+    String(const char* text = "") : _text(text ? text : "") {}
+    const char* c_str() const { return _text.c_str(); }
+    unsigned int length() const { return (unsigned int)_text.size(); }
+    String operator+(const String& other) const { return String((_text + other._text).c_str()); }
+
+private:
+    std::string _text;
+};
+
+// ===========================================
+// PRINT / SERIAL
+// ===========================================
+class Print;
+
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& out) const = 0;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+
+    size_t print(const char* text) { return ::printf("%s", text); }
+    size_t print(const String& text) { return ::printf("%s", text.c_str()); }
+    size_t print(char c) { return ::printf("%c", c); }
+    size_t print(int value, int base = DEC) { return base == HEX ? ::printf("%X", value) : ::printf("%d", value); }
+    size_t print(unsigned int value, int base = DEC) { return base == HEX ? ::printf("%X", value) : ::printf("%u", value); }
+    size_t print(long value, int base = DEC) { return base == HEX ? ::printf("%lX", value) : ::printf("%ld", value); }
+    size_t print(unsigned long value, int base = DEC) { return base == HEX ? ::printf("%lX", value) : ::printf("%lu", value); }
+    size_t print(double value, int digits = 2) { return ::printf("%.*f", digits, value); }
+    size_t print(const Printable& value) { return value.printTo(*this); }
+
+    size_t println() { return ::printf("\n"); }
+    template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+    template <typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n > 0 ? (size_t)n : 0;
+    }
+};
+
+class Stream : public Print {};
+
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) {}
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// ===========================================
+// IP ADDRESS
+// ===========================================
+class IPAddress : public Printable {
+public:
+    IPAddress() { memset(_octets, 0, sizeof(_octets)); }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        _octets[0] = a; _octets[1] = b; _octets[2] = c; _octets[3] = d;
+    }
+
+    uint8_t operator[](int index) const { return _octets[index]; }
+    uint8_t& operator[](int index) { return _octets[index]; }
+    bool operator==(const IPAddress& other) const { return memcmp(_octets, other._octets, 4) == 0; }
+    bool operator!=(const IPAddress& other) const { return !(*this == other); }
+
+    bool fromString(const char* text) {
+        unsigned a, b, c, d;
+        if (sscanf(text, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+            return false;
+        }
+        _octets[0] = a; _octets[1] = b; _octets[2] = c; _octets[3] = d;
+        return true;
+    }
+
+    String toString() const {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", _octets[0], _octets[1], _octets[2], _octets[3]);
+        return String(text);
+    }
+
+    size_t printTo(Print& out) const override { return out.print(toString()); }
+
+private:
+    uint8_t _octets[4];
+};
+
+#endif // ARDUINO_HOST_H
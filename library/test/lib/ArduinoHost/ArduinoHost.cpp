@@ -0,0 +1,43 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <time.h>
+
+HardwareSerial Serial;
+WiFiClass WiFi;
+
+static unsigned long host_offset_us = 0;
+
+static unsigned long hostMonotonicUs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000000UL + now.tv_nsec / 1000;
+}
+
+unsigned long micros() {
+    static unsigned long start = hostMonotonicUs();
+    return hostMonotonicUs() - start + host_offset_us;
+}
+
+unsigned long millis() {
+    return micros() / 1000;
+}
+
+void hostAdvanceClock(unsigned long us) {
+    host_offset_us += us;
+}
+
+void delay(unsigned long ms) {
+    hostAdvanceClock(ms * 1000UL);
+}
+
+void delayMicroseconds(unsigned int us) {
+    hostAdvanceClock(us);
+}
+
+long random(long max) {
+    return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max) {
+    return min + random(max - min);
+}
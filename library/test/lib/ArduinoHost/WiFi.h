@@ -0,0 +1,18 @@
+#ifndef ARDUINO_HOST_WIFI_H
+#define ARDUINO_HOST_WIFI_H
+
+#include <Arduino.h>
+
+#define WL_CONNECTED 3
+
+class WiFiClass {
+public:
+    int status() { return WL_CONNECTED; }
+    void begin(const char* ssid, const char* password = nullptr) {}
+    void disconnect(bool wifi_off = false) {}
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+};
+
+extern WiFiClass WiFi;
+
+#endif // ARDUINO_HOST_WIFI_H
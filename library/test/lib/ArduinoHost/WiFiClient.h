@@ -0,0 +1,12 @@
+#ifndef ARDUINO_HOST_WIFICLIENT_H
+#define ARDUINO_HOST_WIFICLIENT_H
+
+#include <Arduino.h>
+
+class WiFiClient {
+public:
+    int connect(IPAddress ip, uint16_t port) { return 0; }
+    void stop() {}
+};
+
+#endif // ARDUINO_HOST_WIFICLIENT_H
@@ -0,0 +1,22 @@
+#ifndef ARDUINO_HOST_WIFIUDP_H
+#define ARDUINO_HOST_WIFIUDP_H
+
+#include <Arduino.h>
+
+// No network on the host: sends succeed and nothing is ever received.
+// Native runs replace the transport (ATEM::setTransport()) with a simulator.
+class WiFiUDP : public Stream {
+public:
+    uint8_t begin(uint16_t port) { return 1; }
+    void stop() {}
+    int beginPacket(IPAddress ip, uint16_t port) { return 1; }
+    int endPacket() { return 1; }
+    size_t write(uint8_t c) override { return 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { return size; }
+    int parsePacket() { return 0; }
+    int read(uint8_t* buffer, size_t size) { return 0; }
+    IPAddress remoteIP() { return IPAddress(); }
+    uint16_t remotePort() { return 0; }
+};
+
+#endif // ARDUINO_HOST_WIFIUDP_H
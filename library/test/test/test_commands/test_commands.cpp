@@ -0,0 +1,179 @@
+#include <unity.h>
+
+// Outgoing command blocks against the wire layout, the per-model index limits,
+// and ATEMCommandReader walking received blocks
+#include "../../../src/ATEM_Commands.h"
+#include "../../../src/ATEM_View.h"
+#include "../../../src/ATEM_State.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_fourcc_packing() {
+    TEST_ASSERT_EQUAL_HEX32(0x43506749, atemFourCC("CPgI"));
+    TEST_ASSERT_EQUAL_HEX32(0x44437574, atemFourCC("DCut"));
+}
+
+void test_read_fourcc_matches_constexpr() {
+    const uint8_t block[8] = {0x00, 0x0C, 0x00, 0x00, 'P', 'r', 'g', 'I'};
+    TEST_ASSERT_EQUAL_HEX32(atemFourCC("PrgI"), atemReadFourCC(block + 4));
+    TEST_ASSERT_NOT_EQUAL(atemFourCC("PrvI"), atemReadFourCC(block + 4));
+}
+
+void test_command_table_sizes() {
+    for (uint8_t i = 0; i < ATEM_CMD_COUNT; i++) {
+        const ATEMCommandSpec& spec = atemCommandSpec((ATEMCommandId)i);
+        TEST_ASSERT_EQUAL(4, strlen(spec.name));
+        TEST_ASSERT_TRUE(spec.payload_length <= ATEM_MAX_COMMAND_PAYLOAD);
+        // Command blocks are 32-bit aligned on the wire
+        TEST_ASSERT_EQUAL(0, atemCommandBlockSize((ATEMCommandId)i) % 4);
+    }
+}
+
+void test_program_input_block_matches_protocol() {
+    // Same bytes the hand-built CPgI packet used to produce: 000C 0000 "CPgI" 0000 0003
+    uint8_t block[16];
+    memset(block, 0xAA, sizeof(block));
+
+    uint8_t* payload = atemWriteCommandHeader(block, ATEM_CMD_CPGI);
+    atemPutU8(payload, 0, 0);
+    atemPutU16(payload, 2, 3);
+
+    const uint8_t expected[12] = {0x00, 0x0C, 0x00, 0x00, 'C', 'P', 'g', 'I', 0x00, 0x00, 0x00, 0x03};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, block, 12);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, block[12]);  // Nothing written past the block
+}
+
+void test_header_clears_payload() {
+    uint8_t block[20];
+    memset(block, 0xFF, sizeof(block));
+
+    uint8_t* payload = atemWriteCommandHeader(block, ATEM_CMD_CAMI);
+    TEST_ASSERT_EQUAL_PTR(block + ATEM_COMMAND_HEADER_SIZE, payload);
+    TEST_ASSERT_EQUAL(20, atemCommandBlockSize(ATEM_CMD_CAMI));
+    for (int i = 0; i < ATEM_MAX_COMMAND_PAYLOAD; i++) {
+        TEST_ASSERT_EQUAL_HEX8(0x00, payload[i]);
+    }
+}
+
+void test_signed_writer() {
+    uint8_t payload[2];
+    atemPutI16(payload, 0, -1000);
+    TEST_ASSERT_EQUAL_HEX8(0xFC, payload[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x18, payload[1]);
+}
+
+void test_decibel_to_gain() {
+    TEST_ASSERT_EQUAL(32768, atemDecibelToGain(0.0f));
+    TEST_ASSERT_EQUAL(0, atemDecibelToGain(-60.0f));
+    TEST_ASSERT_UINT16_WITHIN(2, 65381, atemDecibelToGain(6.0f));
+}
+
+void test_index_checked_against_model() {
+    const ATEMCapabilities* mini = getATEMCapabilities(ATEM_MINI);
+    TEST_ASSERT_NOT_NULL(mini);
+
+    // ATEM Mini: one AUX (HDMI out), one DSK, one media player, no multiviewer
+    TEST_ASSERT_EQUAL(1, atemCommandIndexCount(ATEM_CMD_CAUS, mini));
+    TEST_ASSERT_EQUAL(1, atemCommandIndexCount(ATEM_CMD_DDSA, mini));
+    TEST_ASSERT_EQUAL(1, atemCommandIndexCount(ATEM_CMD_MPCS, mini));
+    TEST_ASSERT_EQUAL(0, atemCommandIndexCount(ATEM_CMD_CMVI, mini));
+    TEST_ASSERT_FALSE(1 < atemCommandIndexCount(ATEM_CMD_CAUS, mini));   // AUX 2 is rejected
+
+    // Unknown model and commands without a model-dependent index accept any u8
+    TEST_ASSERT_TRUE(255 < atemCommandIndexCount(ATEM_CMD_CAUS, nullptr));
+    TEST_ASSERT_TRUE(255 < atemCommandIndexCount(ATEM_CMD_CAMM, mini));
+}
+
+void test_upstream_keyer_limited_by_model() {
+    // The keyer commands are checked against the store's per-M/E keyer count
+    ATEMState state;
+    atemStateReset(state);
+
+    atemStateConfigure(state, getATEMCapabilities(ATEM_MINI));
+    TEST_ASSERT_EQUAL(1, state.upstream_keyer_count);      // Keyer 2 is rejected
+    atemStateConfigure(state, getATEMCapabilities(ATEM_TVS_HD8_ISO));
+    TEST_ASSERT_EQUAL(4, state.upstream_keyer_count);
+
+    // Without a model the store's own bound still applies
+    atemStateConfigure(state, nullptr);
+    TEST_ASSERT_EQUAL(ATEM_MAX_UPSTREAM_KEYERS, state.upstream_keyer_count);
+}
+
+void test_command_reader_walks_blocks() {
+    // PrgI (12 bytes) + Time (16 bytes) + 4 bytes of trailing padding
+    const uint8_t packet[] = {
+        0x00, 0x0C, 0x00, 0x00, 'P', 'r', 'g', 'I', 0x00, 0x00, 0x00, 0x05,
+        0x00, 0x10, 0x00, 0x00, 'T', 'i', 'm', 'e', 0x0A, 0x14, 0x1E, 0x02, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+    };
+    ATEMCommandReader reader(ATEMByteView(packet, sizeof(packet)));
+    uint32_t name;
+    ATEMByteView payload;
+
+    TEST_ASSERT_TRUE(reader.next(name, payload));
+    TEST_ASSERT_EQUAL_HEX32(atemFourCC("PrgI"), name);
+    TEST_ASSERT_EQUAL(4, payload.length);
+    TEST_ASSERT_EQUAL(5, payload.u16(2));
+    TEST_ASSERT_TRUE(payload.data == packet + 8);  // In place, not copied
+
+    TEST_ASSERT_TRUE(reader.next(name, payload));
+    TEST_ASSERT_EQUAL_HEX32(atemFourCC("Time"), name);
+    TEST_ASSERT_EQUAL(0x0A141E02, payload.u32(0));
+    TEST_ASSERT_EQUAL(0, payload.u32(6));           // Past the end of the view
+
+    TEST_ASSERT_FALSE(reader.next(name, payload));
+    TEST_ASSERT_FALSE(reader.malformed());
+}
+
+void test_command_reader_stops_at_bad_length() {
+    // Second block claims 64 bytes but only 12 remain
+    const uint8_t packet[] = {
+        0x00, 0x0C, 0x00, 0x00, 'P', 'r', 'v', 'I', 0x00, 0x00, 0x00, 0x02,
+        0x00, 0x40, 0x00, 0x00, 'I', 'n', 'P', 'r', 0x00, 0x01, 0x00, 0x00,
+    };
+    ATEMCommandReader reader(ATEMByteView(packet, sizeof(packet)));
+    uint32_t name;
+    ATEMByteView payload;
+
+    TEST_ASSERT_TRUE(reader.next(name, payload));
+    TEST_ASSERT_FALSE(reader.next(name, payload));
+    TEST_ASSERT_TRUE(reader.malformed());
+    TEST_ASSERT_EQUAL(12, reader.offset());
+
+    // A length below the 8-byte header is malformed too
+    const uint8_t runt[] = {0x00, 0x04, 0x00, 0x00, 'P', 'r', 'g', 'I'};
+    ATEMCommandReader runt_reader(ATEMByteView(runt, sizeof(runt)));
+    TEST_ASSERT_FALSE(runt_reader.next(name, payload));
+    TEST_ASSERT_TRUE(runt_reader.malformed());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_fourcc_packing);
+    RUN_TEST(test_read_fourcc_matches_constexpr);
+    RUN_TEST(test_command_table_sizes);
+    RUN_TEST(test_program_input_block_matches_protocol);
+    RUN_TEST(test_header_clears_payload);
+    RUN_TEST(test_signed_writer);
+    RUN_TEST(test_decibel_to_gain);
+    RUN_TEST(test_index_checked_against_model);
+    RUN_TEST(test_upstream_keyer_limited_by_model);
+    RUN_TEST(test_command_reader_walks_blocks);
+    RUN_TEST(test_command_reader_stops_at_bad_length);
+
+    return UNITY_END();
+}
+
+// For PlatformIO compatibility
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Give time for serial monitor
+    main(0, NULL);
+}
+
+void loop() {
+    // Empty loop for Arduino compatibility
+}
+#endif
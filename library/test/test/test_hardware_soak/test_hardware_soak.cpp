@@ -0,0 +1,351 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <WiFi.h>
+#include <ATEM.h>
+#include <ATEM_Simulator.h>
+
+// Soak and throughput benchmark on real ESP32 hardware (pio test -e esp32_soak).
+// Runs the protocol in the network task against a switcher, or against the
+// in-memory simulator with -DSOAK_USE_SIMULATOR=1, and prints every result as
+// one "ATEM_BENCH <phase> key=value ..." line so runs of different library
+// versions can be compared with a script.
+
+#if !ATEM_METRICS
+#error "test_hardware_soak needs -DATEM_METRICS=1 for the latency histograms"
+#endif
+
+// ===========================================
+// CONFIGURATION (build flags)
+// ===========================================
+#ifndef SOAK_WIFI_SSID
+#define SOAK_WIFI_SSID           "YOUR_WIFI_SSID"
+#endif
+
+#ifndef SOAK_WIFI_PASSWORD
+#define SOAK_WIFI_PASSWORD       "YOUR_WIFI_PASSWORD"
+#endif
+
+#ifndef SOAK_ATEM_IP
+#define SOAK_ATEM_IP             "192.168.1.240"
+#endif
+
+#ifndef SOAK_USE_SIMULATOR
+#define SOAK_USE_SIMULATOR       0         // 1 = in-memory switcher, no WiFi needed
+#endif
+
+#ifndef SOAK_MINUTES
+#define SOAK_MINUTES             120       // Length of the soak phase
+#endif
+
+#ifndef SOAK_REPORT_SECONDS
+#define SOAK_REPORT_SECONDS      60        // One soak line per interval
+#endif
+
+#ifndef SOAK_DROP_MINUTES
+#define SOAK_DROP_MINUTES        15        // Forced WiFi drop interval (0 = never)
+#endif
+
+#ifndef SOAK_COMMAND_RATE
+#define SOAK_COMMAND_RATE        10        // Preview changes per second during the soak
+#endif
+
+#ifndef SOAK_THROUGHPUT_SECONDS
+#define SOAK_THROUGHPUT_SECONDS  10        // Length of the throughput phase
+#endif
+
+#ifndef SOAK_MAX_IN_FLIGHT
+#define SOAK_MAX_IN_FLIGHT       4         // Unconfirmed commands in the throughput phase
+#endif
+
+#define SOAK_CONNECT_TIMEOUT     30000     // ms to connect and receive the dump
+#define SOAK_TARGET              (SOAK_USE_SIMULATOR ? "simulator" : "switcher")
+
+// ===========================================
+// HARNESS
+// ===========================================
+static ATEM atem;
+static volatile uint32_t confirmed = 0;   // PrvI received (runs in the network task)
+static uint32_t sent = 0;
+static ATEMMetrics metrics;               // copyMetrics() destination, too big for the stack
+
+#if SOAK_USE_SIMULATOR
+static ATEMSimulator sim;
+static uint8_t dump[256];
+
+/**
+ * Transport in front of the simulator that applies link changes from inside
+ * the network task's own send/receive calls, so the test task never touches
+ * the simulator while the protocol runs
+ */
+class SoakLink : public ATEMTransport {
+public:
+    SoakLink() : online(true), _applied(true) {}
+
+    bool begin(uint16_t local_port) override { apply(); return sim.begin(local_port); }
+    void stop() override { sim.stop(); }
+    bool send(const IPAddress& ip, uint16_t port, const uint8_t* data, uint16_t length) override {
+        apply();
+        return sim.send(ip, port, data, length);
+    }
+    int receive(uint8_t* buffer, uint16_t size) override { apply(); return sim.receive(buffer, size); }
+    int receiveView(const uint8_t*& data) override { apply(); return sim.receiveView(data); }
+    void releaseView() override { sim.releaseView(); }
+    IPAddress remoteIP() override { return sim.remoteIP(); }
+    uint16_t remotePort() override { return sim.remotePort(); }
+
+    volatile bool online;                 // Set by the test task
+
+private:
+    bool _applied;
+
+    void apply() {
+        bool wanted = online;
+        if (wanted != _applied) {
+            sim.setOnline(wanted);
+            _applied = wanted;
+        }
+    }
+};
+
+static SoakLink soak_link;
+#endif
+
+static void countConfirmation(uint32_t name, const uint8_t* payload, uint16_t length, void* context) {
+    confirmed++;
+}
+
+/**
+ * Print one machine-readable result line
+ */
+static void bench(const char* phase, const char* fields) {
+    Serial.printf("ATEM_BENCH %s version=%s target=%s t_ms=%lu %s\n", phase, ATEM_ESP32_VERSION, SOAK_TARGET,
+                  millis(), fields);
+}
+
+/**
+ * Keep events flowing for a while (callbacks run in this task)
+ */
+static void service(unsigned long ms) {
+    unsigned long start = millis();
+    do {
+        atem.runLoop();
+        delay(1);
+    } while (millis() - start < ms);
+}
+
+// The network task writes the store, so read a consistent copy (not getStateRef())
+static bool dumpReceived() {
+    return atem.isConnected() && !atem.getState().stale;
+}
+
+/**
+ * Wait for the connection and the full state dump
+ * @return ms it took, or 0 on timeout
+ */
+static unsigned long waitForDump(unsigned long since) {
+    while (!dumpReceived()) {
+        if (millis() - since > SOAK_CONNECT_TIMEOUT) return 0;
+        service(1);
+    }
+    unsigned long elapsed = millis() - since;
+    return elapsed ? elapsed : 1;
+}
+
+static void changePreview() {
+    atem.changePreviewInput(sent & 1 ? ATEM_INPUT_CAM2 : ATEM_INPUT_CAM1);
+    sent++;
+}
+
+static void latencyFields(char* out, size_t size) {
+    const ATEMLatencyHistogram& rtt = metrics.command_rtt[ATEM_CMD_CPVI];
+    snprintf(out, size, "samples=%lu p50_us=%lu p99_us=%lu max_us=%lu", (unsigned long)rtt.count,
+             (unsigned long)rtt.percentileUs(50), (unsigned long)rtt.percentileUs(99), (unsigned long)rtt.max_us);
+}
+
+static void memoryFields(char* out, size_t size) {
+    snprintf(out, size, "heap_free=%lu heap_min=%lu heap_largest=%lu stack_hw=%lu",
+             (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(),
+             (unsigned long)ESP.getMaxAllocHeap(), (unsigned long)atem.getNetworkTaskStackHighWater());
+}
+
+/**
+ * Take the link down until the session times out
+ */
+static void dropLink() {
+#if SOAK_USE_SIMULATOR
+    soak_link.online = false;
+    service(CONNECTION_TIMEOUT + 500);
+    soak_link.online = true;
+#else
+    WiFi.disconnect();
+    service(CONNECTION_TIMEOUT + 500);
+    WiFi.reconnect();
+#endif
+}
+
+// ===========================================
+// BENCHMARKS
+// ===========================================
+void test_soak_dump_ingest() {
+#if SOAK_USE_SIMULATOR
+    // A small dump: identification, topology, program/preview and video mode
+    uint32_t length = 0;
+    uint8_t version[4] = {0x00, 0x02, 0x00, 0x1E};
+    uint8_t product[44] = "ATEM Mini Pro";
+    uint8_t topology[24] = {1, 10, 1, 1, 0, 1};
+    uint8_t program[4] = {0, 0, 0, 1}, preview[4] = {0, 0, 0, 2}, video_mode[4] = {13};
+    length += atemSimWriteCommand(dump + length, "_ver", version, sizeof(version));
+    length += atemSimWriteCommand(dump + length, "_pin", product, sizeof(product));
+    length += atemSimWriteCommand(dump + length, "_top", topology, sizeof(topology));
+    length += atemSimWriteCommand(dump + length, "PrgI", program, sizeof(program));
+    length += atemSimWriteCommand(dump + length, "PrvI", preview, sizeof(preview));
+    length += atemSimWriteCommand(dump + length, "VidM", video_mode, sizeof(video_mode));
+    sim.setStateDump(dump, length);
+    atem.setTransport(&soak_link);
+#else
+    WiFi.begin(SOAK_WIFI_SSID, SOAK_WIFI_PASSWORD);
+    unsigned long wifi_start = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - wifi_start < 20000) {
+        delay(100);
+    }
+    TEST_ASSERT_EQUAL(WL_CONNECTED, WiFi.status());
+#endif
+    atem.setLogLevel(ATEM_LOG_WARN);
+    atem.registerCommandHandler("PrvI", countConfirmation);
+    TEST_ASSERT_TRUE(atem.enableNetworkTask());
+
+    char fields[160];
+    memoryFields(fields, sizeof(fields));
+    bench("start", fields);
+
+    atem.resetMetrics();
+    unsigned long start = millis();
+    IPAddress ip;
+    ip.fromString(SOAK_ATEM_IP);
+    TEST_ASSERT_TRUE(atem.beginAsync(ip));
+    unsigned long ingest_ms = waitForDump(start);
+    TEST_ASSERT_TRUE(ingest_ms > 0);
+    TEST_ASSERT_TRUE(atem.isNetworkTaskRunning());
+
+    atem.copyMetrics(metrics);
+    snprintf(fields, sizeof(fields), "ms=%lu datagrams=%lu commands=%lu model=%d", ingest_ms,
+             (unsigned long)metrics.rx_datagrams, (unsigned long)metrics.rx_commands, (int)atem.getModel());
+    bench("ingest", fields);
+}
+
+void test_soak_command_throughput() {
+    TEST_ASSERT_TRUE(dumpReceived());
+    service(500);
+    atem.resetMetrics();
+    if (atem.getPreviewInput() == ATEM_INPUT_CAM1) sent++;  // The first change must be a change
+    uint32_t first_sent = sent, first_confirmed = confirmed;
+
+    unsigned long start = millis();
+    while (millis() - start < SOAK_THROUGHPUT_SECONDS * 1000UL) {
+        if (sent - first_sent - (confirmed - first_confirmed) < SOAK_MAX_IN_FLIGHT) {
+            changePreview();
+        }
+        atem.runLoop();
+        delay(1);
+    }
+    service(1000);  // Let the last confirmations arrive
+
+    uint32_t commands = sent - first_sent, echoes = confirmed - first_confirmed;
+    char latency[96], fields[200];
+    atem.copyMetrics(metrics);
+    latencyFields(latency, sizeof(latency));
+    snprintf(fields, sizeof(fields), "seconds=%d commands=%lu confirmed=%lu per_second=%lu in_flight=%d %s",
+             SOAK_THROUGHPUT_SECONDS, (unsigned long)commands, (unsigned long)echoes,
+             (unsigned long)(echoes / SOAK_THROUGHPUT_SECONDS), SOAK_MAX_IN_FLIGHT, latency);
+    bench("throughput", fields);
+    TEST_ASSERT_EQUAL_UINT32(commands, echoes);
+}
+
+void test_soak_long_run() {
+    TEST_ASSERT_TRUE(dumpReceived());
+    uint32_t start_heap = ESP.getFreeHeap();
+    uint32_t reconnects = 0, failed_reconnects = 0;
+    unsigned long max_reconnect_ms = 0;
+    uint32_t interval_start_sent = sent, interval_start_confirmed = confirmed;
+    atem.resetMetrics();
+
+    unsigned long start = millis(), last_report = start, last_drop = start, next_command = start;
+    while (millis() - start < SOAK_MINUTES * 60000UL) {
+        unsigned long now = millis();
+        if ((long)(now - next_command) >= 0) {
+            if (atem.isConnected()) changePreview();
+            next_command += 1000 / SOAK_COMMAND_RATE;
+        }
+
+        if (SOAK_DROP_MINUTES && now - last_drop >= SOAK_DROP_MINUTES * 60000UL) {
+            unsigned long drop_start = millis();
+            dropLink();
+            unsigned long ms = waitForDump(drop_start);
+            char fields[96];
+            snprintf(fields, sizeof(fields), "n=%lu ms=%lu ok=%d", (unsigned long)(reconnects + 1), ms, ms > 0);
+            bench("reconnect", fields);
+            reconnects++;
+            if (ms == 0) failed_reconnects++;
+            else if (ms > max_reconnect_ms) max_reconnect_ms = ms;
+            last_drop = next_command = millis();
+        }
+
+        if (now - last_report >= SOAK_REPORT_SECONDS * 1000UL) {
+            atem.copyMetrics(metrics);
+            char latency[96], memory[128], fields[400];
+            latencyFields(latency, sizeof(latency));
+            memoryFields(memory, sizeof(memory));
+            snprintf(fields, sizeof(fields),
+                     "elapsed_s=%lu commands=%lu confirmed=%lu %s %s reconnects=%lu max_reconnect_ms=%lu "
+                     "rx_datagrams=%lu rx_duplicates=%lu rx_out_of_order=%lu resent=%lu",
+                     (now - start) / 1000, (unsigned long)(sent - interval_start_sent),
+                     (unsigned long)(confirmed - interval_start_confirmed), latency, memory,
+                     (unsigned long)reconnects, max_reconnect_ms, (unsigned long)metrics.rx_datagrams,
+                     (unsigned long)metrics.rx_duplicate_packets, (unsigned long)metrics.rx_out_of_order_packets,
+                     (unsigned long)metrics.packets_resent);
+            bench("soak", fields);
+            interval_start_sent = sent;
+            interval_start_confirmed = confirmed;
+            atem.resetMetrics();  // Percentiles per interval
+            last_report = now;
+        }
+
+        atem.runLoop();
+        delay(1);
+    }
+
+    char memory[128], fields[256];
+    memoryFields(memory, sizeof(memory));
+    snprintf(fields, sizeof(fields), "minutes=%d reconnects=%lu failed_reconnects=%lu max_reconnect_ms=%lu "
+             "heap_start=%lu %s", SOAK_MINUTES, (unsigned long)reconnects, (unsigned long)failed_reconnects,
+             max_reconnect_ms, (unsigned long)start_heap, memory);
+    bench("end", fields);
+
+    TEST_ASSERT_EQUAL_UINT32(0, failed_reconnects);
+    TEST_ASSERT_TRUE(dumpReceived());
+    TEST_ASSERT_TRUE(atem.getNetworkTaskStackHighWater() > 0);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_soak_dump_ingest);
+    RUN_TEST(test_soak_command_throughput);
+    RUN_TEST(test_soak_long_run);
+
+    atem.disconnect();
+    return UNITY_END();
+}
+
+// For PlatformIO compatibility
+#ifdef ARDUINO
+void setup() {
+    Serial.begin(115200);
+    delay(2000); // Give time for serial monitor
+    main(0, NULL);
+}
+
+void loop() {
+    // Empty loop for Arduino compatibility
+}
+#endif
@@ -0,0 +1,76 @@
+#include <unity.h>
+
+// Latency histogram buckets and percentiles; samples are fed in as
+// microseconds, so no clock is involved
+#define ATEM_METRICS 1
+#include "../../../src/ATEM_Metrics.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_empty_histogram() {
+    ATEMLatencyHistogram histogram;
+    histogram.reset();
+    TEST_ASSERT_EQUAL(0, histogram.count);
+    TEST_ASSERT_EQUAL(0, histogram.meanUs());
+    TEST_ASSERT_EQUAL(0, histogram.percentileUs(99));
+}
+
+void test_bucket_boundaries() {
+    ATEMLatencyHistogram histogram;
+    histogram.reset();
+    histogram.record(0);
+    histogram.record(249);
+    histogram.record(250);      // First sample of the <500us bucket
+    histogram.record(10000000); // Open-ended last bucket
+    TEST_ASSERT_EQUAL(2, histogram.buckets[0]);
+    TEST_ASSERT_EQUAL(1, histogram.buckets[1]);
+    TEST_ASSERT_EQUAL(1, histogram.buckets[ATEM_METRICS_BUCKETS - 1]);
+    TEST_ASSERT_EQUAL(0, histogram.min_us);
+    TEST_ASSERT_EQUAL(10000000, histogram.max_us);
+}
+
+void test_percentiles() {
+    ATEMLatencyHistogram histogram;
+    histogram.reset();
+    for (int i = 0; i < 98; i++) histogram.record(1800);  // <2000us bucket
+    histogram.record(40000);
+    histogram.record(300000);                             // Slowest sample
+    TEST_ASSERT_EQUAL(2000, histogram.percentileUs(50));
+    TEST_ASSERT_EQUAL(64000, histogram.percentileUs(99));
+    TEST_ASSERT_EQUAL(300000, histogram.percentileUs(100));
+}
+
+void test_metrics_reset() {
+    ATEMMetrics metrics;
+    metrics.reset();
+    metrics.command_rtt[ATEM_CMD_CPGI].record(5000);
+    metrics.rx_datagrams = 12;
+    metrics.reset();
+    TEST_ASSERT_EQUAL(0, metrics.command_rtt[ATEM_CMD_CPGI].count);
+    TEST_ASSERT_EQUAL(0xFFFFFFFF, metrics.command_rtt[ATEM_CMD_CPGI].min_us);
+    TEST_ASSERT_EQUAL(0, metrics.rx_datagrams);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_empty_histogram);
+    RUN_TEST(test_bucket_boundaries);
+    RUN_TEST(test_percentiles);
+    RUN_TEST(test_metrics_reset);
+
+    return UNITY_END();
+}
+
+// For PlatformIO compatibility
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Give time for serial monitor
+    main(0, NULL);
+}
+
+void loop() {
+    // Empty loop for Arduino compatibility
+}
+#endif
@@ -0,0 +1,58 @@
+#include <unity.h>
+
+// _pin product names to models: specific names before their prefixes, case,
+// unknown names, and a capability entry for every pattern
+#include "../../../src/ATEM_Models.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_detect_specific_before_prefix() {
+    TEST_ASSERT_EQUAL(ATEM_MINI, detectATEMModel("ATEM Mini"));
+    TEST_ASSERT_EQUAL(ATEM_MINI_PRO_ISO, detectATEMModel("ATEM Mini Pro ISO"));
+    TEST_ASSERT_EQUAL(ATEM_MINI_EXTREME_ISO, detectATEMModel("ATEM Mini Extreme ISO"));
+    TEST_ASSERT_EQUAL(ATEM_TVS_HD8_ISO, detectATEMModel("ATEM Television Studio HD8 ISO"));
+    TEST_ASSERT_EQUAL(ATEM_TVS_HD, detectATEMModel("ATEM Television Studio HD"));
+}
+
+void test_detect_ignores_case_and_prefix_words() {
+    TEST_ASSERT_EQUAL(ATEM_CONSTELLATION_4K, detectATEMModel("ATEM 4 M/E Constellation 4K"));
+    TEST_ASSERT_EQUAL(ATEM_SDI_PRO_ISO, detectATEMModel("atem sdi PRO iso"));
+}
+
+void test_detect_unknown() {
+    TEST_ASSERT_EQUAL(ATEM_MODEL_UNKNOWN, detectATEMModel("ATEM 2 M/E Production Switcher"));
+    TEST_ASSERT_EQUAL(ATEM_MODEL_UNKNOWN, detectATEMModel(""));
+    TEST_ASSERT_EQUAL(ATEM_MODEL_UNKNOWN, detectATEMModel(nullptr));
+}
+
+void test_every_pattern_has_capabilities() {
+    for (size_t i = 0; i < sizeof(ATEM_MODEL_PATTERNS) / sizeof(ATEM_MODEL_PATTERNS[0]); i++) {
+        const ATEMCapabilities* caps = getATEMCapabilities(ATEM_MODEL_PATTERNS[i].model);
+        TEST_ASSERT_NOT_NULL(caps);
+        TEST_ASSERT_TRUE(caps->mix_effects >= 1);
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_detect_specific_before_prefix);
+    RUN_TEST(test_detect_ignores_case_and_prefix_words);
+    RUN_TEST(test_detect_unknown);
+    RUN_TEST(test_every_pattern_has_capabilities);
+
+    return UNITY_END();
+}
+
+// For PlatformIO compatibility
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Give time for serial monitor
+    main(0, NULL);
+}
+
+void loop() {
+    // Empty loop for Arduino compatibility
+}
+#endif
@@ -0,0 +1,1143 @@
+#include <unity.h>
+#include <new>
+
+// Protocol engine against the scripted switcher in ATEM_Simulator.h. Runs in
+// [env:simulator], which links the library (real ATEM.cpp) on the host through
+// the ArduinoHost shim in test/lib. The benchmark tests print their numbers with
+// TEST_MESSAGE so regressions show up in the test log.
+#include <ATEM.h>
+#include <ATEM_Simulator.h>
+#include <ATEM_SessionManager.h>
+
+// ===========================================
+// ALLOCATION COUNTER
+// ===========================================
+static unsigned long allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* block = malloc(size ? size : 1);
+    if (!block) throw std::bad_alloc();
+    return block;
+}
+
+void operator delete(void* block) noexcept { free(block); }
+void operator delete(void* block, size_t) noexcept { free(block); }
+
+// ===========================================
+// STATE DUMP BUILDER
+// ===========================================
+static uint8_t dump[160 * 1024];
+static uint32_t dump_length = 0;
+static uint32_t dump_commands = 0;
+
+static void dumpCommand(const char* name, const uint8_t* payload, uint16_t length) {
+    dump_length += atemSimWriteCommand(dump + dump_length, name, payload, length);
+    dump_commands++;
+}
+
+static void dumpInput(const char* name, uint8_t me, uint16_t input) {
+    uint8_t payload[4] = {me, 0, (uint8_t)(input >> 8), (uint8_t)input};
+    dumpCommand(name, payload, sizeof(payload));
+}
+
+/**
+ * Synthetic dump shaped like a 2 M/E switcher's: identification, topology,
+ * per-M/E state, one InPr per input and filler_blocks 64-byte commands the
+ * library does not parse (audio, macros, multiviewer, ...)
+ */
+static void buildDump(uint16_t inputs, uint32_t filler_blocks) {
+    dump_length = 0;
+    dump_commands = 0;
+
+    uint8_t version[4] = {0x00, 0x02, 0x00, 0x1E};
+    dumpCommand("_ver", version, sizeof(version));
+
+    uint8_t product[44] = {0};
+    strcpy((char*)product, "ATEM Television Studio HD8 ISO");
+    dumpCommand("_pin", product, sizeof(product));
+
+    uint8_t topology[24] = {2, 40, 2, 4, 0, 2};
+    dumpCommand("_top", topology, sizeof(topology));
+
+    uint8_t video_mode[4] = {13};  // 1080p59.94
+    dumpCommand("VidM", video_mode, sizeof(video_mode));
+
+    for (uint8_t me = 0; me < 2; me++) {
+        dumpInput("PrgI", me, 1 + me);
+        dumpInput("PrvI", me, 3 + me);
+    }
+    uint8_t tally[2 + ATEM_SIM_TALLY_INPUTS] = {0, ATEM_SIM_TALLY_INPUTS, 0x01, 0x01, 0x02, 0x02};
+    dumpCommand("TlIn", tally, sizeof(tally));
+
+    for (uint16_t i = 0; i < inputs; i++) {
+        uint8_t properties[36] = {0};
+        uint16_t id = i + 1;
+        properties[0] = id >> 8;
+        properties[1] = id & 0xFF;
+        snprintf((char*)properties + 2, 21, "Camera %u", id);
+        snprintf((char*)properties + 22, 5, "C%u", (unsigned)(id % 100));
+        properties[35] = 0x03;
+        dumpCommand("InPr", properties, sizeof(properties));
+    }
+
+    uint8_t filler[56];
+    for (uint32_t i = 0; i < filler_blocks; i++) {
+        memset(filler, (uint8_t)i, sizeof(filler));
+        dumpCommand("AMIP", filler, sizeof(filler));
+    }
+}
+
+// ===========================================
+// HARNESS
+// ===========================================
+struct LoopStats {
+    unsigned long iterations;
+    unsigned long busy_us;           // Real time spent inside runLoop()
+    unsigned long worst_us;
+};
+
+static ATEMSimulator sim;
+alignas(ATEM) static uint8_t atem_storage[sizeof(ATEM)];
+static ATEM* atem = nullptr;
+
+/**
+ * Call runLoop() with 1 ms of virtual time between calls
+ * @return Loop timing for the run
+ */
+template <typename Done>
+static LoopStats pump(unsigned long max_iterations, Done done) {
+    LoopStats stats = {0, 0, 0};
+    while (stats.iterations < max_iterations && !done()) {
+        unsigned long start = micros();
+        atem->runLoop();
+        unsigned long elapsed = micros() - start;
+        stats.busy_us += elapsed;
+        if (elapsed > stats.worst_us) stats.worst_us = elapsed;
+        stats.iterations++;
+        hostAdvanceClock(1000);
+    }
+    return stats;
+}
+
+static bool dumpReceived() {
+    return atem->isConnected() && sim.isDumpComplete() && !atem->getStateRef().stale;
+}
+
+static void connectSimulator() {
+    TEST_ASSERT_TRUE(atem->beginAsync(IPAddress(192, 168, 10, 240)));
+    pump(5000, dumpReceived);
+    TEST_ASSERT_TRUE(dumpReceived());
+}
+
+static void report(const char* label, const LoopStats& loop, uint32_t commands, unsigned long allocated) {
+    char line[160];
+    snprintf(line, sizeof(line), "%s: %lu commands/s, worst loop %lu us, %lu iterations, %lu allocations",
+             label, loop.busy_us ? (unsigned long)((uint64_t)commands * 1000000ULL / loop.busy_us) : 0UL,
+             loop.worst_us, loop.iterations, allocated);
+    TEST_MESSAGE(line);
+}
+
+void setUp(void) {
+    sim = ATEMSimulator();
+    atem = new (atem_storage) ATEM();  // Fresh instance per test
+    atem->setLogLevel(ATEM_LOG_ERROR);
+    atem->setTransport(&sim);
+    buildDump(20, 0);
+    sim.setStateDump(dump, dump_length);
+}
+
+void tearDown(void) {
+    atem->disconnect();
+    atem->~ATEM();
+    atem = nullptr;
+}
+
+// ===========================================
+// PROTOCOL TESTS
+// ===========================================
+void test_state_dump_is_applied() {
+    connectSimulator();
+
+    const ATEMState& state = atem->getStateRef();
+    TEST_ASSERT_EQUAL(ATEM_TVS_HD8_ISO, atem->getModel());
+    TEST_ASSERT_EQUAL(2, atem->getMixEffectCount());
+    TEST_ASSERT_EQUAL(1, atem->getProgramInput(0));
+    TEST_ASSERT_EQUAL(4, atem->getPreviewInput(1));
+    TEST_ASSERT_EQUAL(20, state.input_count);
+    TEST_ASSERT_EQUAL_STRING("Camera 7", atem->getInputLabel(7));
+    TEST_ASSERT_EQUAL(59940, state.frame_rate_mhz);
+    TEST_ASSERT_EQUAL(0, sim.inFlight());
+}
+
+void test_commands_are_confirmed() {
+    connectSimulator();
+
+    atem->changePreviewInput(6, 1);
+    atem->cut(1);
+    pump(50, []() { return atem->getProgramInput(1) == 6; });
+
+    TEST_ASSERT_EQUAL(6, sim.getProgramInput(1));
+    TEST_ASSERT_EQUAL(6, atem->getProgramInput(1));
+    TEST_ASSERT_EQUAL(2, atem->getPreviewInput(1));
+
+    // Indexes the switcher does not have never reach the wire
+    TEST_ASSERT_TRUE(atem->setUpstreamKeyerOnAir(true, 1, 3));
+    TEST_ASSERT_FALSE(atem->setUpstreamKeyerOnAir(true, 1, 4));   // Four keyers per M/E
+    TEST_ASSERT_FALSE(atem->setUpstreamKeyerCutSource(5, 2, 0));  // Two M/Es
+}
+
+void test_lost_commands_are_resent_on_request() {
+    connectSimulator();
+
+    ATEMSimulatorFaults faults = {};
+    faults.uplink_loss = 30;
+    sim.setFaults(faults);
+
+    for (uint16_t input = 1; input <= 8; input++) {
+        atem->changeProgramInput(input);
+        pump(20, []() { return false; });
+    }
+    faults.uplink_loss = 0;
+    sim.setFaults(faults);
+    pump(3000, []() { return sim.getProgramInput() == 8 && atem->getProgramInput() == 8; });
+
+    TEST_ASSERT_TRUE(sim.getStats().datagrams_dropped > 0);
+    TEST_ASSERT_TRUE(sim.getStats().retransmit_requests > 0);
+    TEST_ASSERT_EQUAL(8, sim.getProgramInput());
+    TEST_ASSERT_EQUAL(8, atem->getProgramInput());
+    TEST_ASSERT_TRUE(atem->isConnected());
+}
+
+void test_reordered_and_duplicated_dump() {
+    ATEMSimulatorFaults faults = {};
+    faults.reorder = 30;
+    faults.duplicate = 10;
+    sim.setFaults(faults);
+    buildDump(40, 400);
+    sim.setStateDump(dump, dump_length);
+
+    connectSimulator();
+
+    TEST_ASSERT_TRUE(sim.getStats().datagrams_reordered > 0);
+    TEST_ASSERT_EQUAL(40, atem->getStateRef().input_count);
+    TEST_ASSERT_EQUAL_STRING("Camera 40", atem->getInputLabel(40));
+    TEST_ASSERT_EQUAL(3, atem->getPreviewInput(0));
+}
+
+void test_injected_retransmit_request() {
+    connectSimulator();
+
+    // Lose the switcher's ACKs so both command packets stay in the retransmit store
+    ATEMSimulatorFaults faults = {};
+    faults.downlink_loss = 100;
+    sim.setFaults(faults);
+    uint16_t next = sim.getNextClientPacketId();
+    atem->changeProgramInput(5);
+    atem->changePreviewInput(7);
+    pump(5, []() { return false; });
+
+    faults.downlink_loss = 0;
+    sim.setFaults(faults);
+    uint32_t received = sim.getStats().datagrams_received;
+    sim.requestRetransmit(next);
+    pump(20, []() { return false; });
+
+    // Both command packets come back; the switcher recognises them as duplicates
+    TEST_ASSERT_TRUE(sim.getStats().datagrams_received >= received + 2);
+    TEST_ASSERT_EQUAL(5, sim.getProgramInput());
+    TEST_ASSERT_EQUAL(7, sim.getPreviewInput());
+    TEST_ASSERT_TRUE(atem->isConnected());
+}
+
+void test_sleeping_until_the_next_deadline() {
+    connectSimulator();
+    pump(20, []() { return false; });  // Let the ACKs for the dump go out
+
+    // Idle: the next deadline is the heartbeat, and sleeping exactly until it
+    // (instead of polling every millisecond) keeps the session alive
+    uint32_t calls = 0;
+    for (unsigned long slept = 0; slept < 10000; calls++) {
+        uint32_t wait_ms = atem->runLoop();
+        TEST_ASSERT_TRUE(wait_ms <= HEARTBEAT_INTERVAL);
+        if (wait_ms == 0) wait_ms = 1;
+        hostAdvanceClock(wait_ms * 1000UL);
+        slept += wait_ms;
+    }
+    TEST_ASSERT_TRUE(atem->isConnected());
+    TEST_ASSERT_TRUE(calls < 200);  // About two calls per heartbeat, not 10000
+
+    atem->disconnect();
+    TEST_ASSERT_EQUAL_UINT32(ATEM_NO_DEADLINE, atem->runLoop());
+}
+
+struct TallyNode : public ATEM {
+    uint32_t calls = 0;
+    uint32_t changed_inputs = 0;
+
+    void onTallyChanged(const ATEMTallyDiff& diff) override {
+        calls++;
+        changed_inputs = 0;
+        for (int32_t id = diff.next(); id >= 0; id = diff.next(id)) changed_inputs++;
+    }
+};
+
+void test_tally_changes_only() {
+    alignas(TallyNode) static uint8_t storage[sizeof(TallyNode)];
+    tearDown();  // Use a TallyNode instead of the plain ATEM from setUp()
+    TallyNode* node = new (storage) TallyNode();
+    atem = node;
+    atem->setLogLevel(ATEM_LOG_ERROR);
+    atem->setTransport(&sim);
+    connectSimulator();
+
+    TEST_ASSERT_EQUAL(1, node->calls);
+    TEST_ASSERT_EQUAL(4, node->changed_inputs);
+    TEST_ASSERT_TRUE(atem->isOnProgram(1) && atem->isOnProgram(2));
+    TEST_ASSERT_TRUE(atem->isOnPreview(3) && !atem->isOnProgram(3));
+
+    // Preview 3 -> 5: inputs 3 and 5 flip, nothing else is reported
+    atem->changePreviewInput(5);
+    pump(50, []() { return atem->isOnPreview(5); });
+    TEST_ASSERT_EQUAL(2, node->calls);
+    TEST_ASSERT_EQUAL(2, node->changed_inputs);
+    TEST_ASSERT_FALSE(atem->isOnPreview(3));
+
+    // The same tally again changes no bit and does not call back
+    uint8_t same[2 + ATEM_SIM_TALLY_INPUTS] = {0, ATEM_SIM_TALLY_INPUTS, 0x01, 0x01, 0x00, 0x02, 0x02};
+    sim.queueCommand("TlIn", same, sizeof(same));
+    pump(50, []() { return false; });
+    TEST_ASSERT_EQUAL(2, node->calls);
+    TEST_ASSERT_TRUE(atem->isOnPreview(5));
+
+    node->disconnect();
+    node->~TallyNode();
+    atem = new (atem_storage) ATEM();  // For tearDown()
+}
+
+class ChangeLog : public ATEM {
+public:
+    ChangeLog() : changes() {}
+    void onStateChanged() override { atemStateChangesMerge(changes, getStateChangeMasks()); }
+
+    ATEMStateChanges changes;
+};
+
+void test_state_changes_name_the_entries() {
+    alignas(ChangeLog) static uint8_t storage[sizeof(ChangeLog)];
+    tearDown();  // Use a ChangeLog instead of the plain ATEM from setUp()
+    ChangeLog* log = new (storage) ChangeLog();
+    atem = log;
+    atem->setLogLevel(ATEM_LOG_ERROR);
+    atem->setTransport(&sim);
+    connectSimulator();
+    pump(50, []() { return false; });
+    log->changes = ATEMStateChanges();
+
+    uint8_t aux[4] = {2, 0, 0, 5};       // Aux 3 -> input 5
+    uint8_t program[4] = {1, 0, 0, 7};   // M/E 2 program -> input 7
+    sim.queueCommand("AuxS", aux, sizeof(aux));
+    sim.queueCommand("PrgI", program, sizeof(program));
+    pump(50, []() { return false; });
+
+    TEST_ASSERT_EQUAL_HEX16(ATEM_STATE_CHANGED_AUX | ATEM_STATE_CHANGED_PROGRAM, log->changes.sections);
+    TEST_ASSERT_EQUAL_HEX32(1 << 2, log->changes.aux);
+    TEST_ASSERT_EQUAL_HEX8(1 << 1, log->changes.mix_effects);
+    TEST_ASSERT_EQUAL_HEX8(0, log->changes.downstream_keyers);
+    TEST_ASSERT_FALSE(atemStateInputChanged(log->changes, 0));
+
+    log->disconnect();
+    log->~ChangeLog();
+    atem = new (atem_storage) ATEM();  // For tearDown()
+}
+
+void test_unsubscribed_families_are_skipped() {
+    atem->setSubscriptions(ATEM_SUBSCRIBE_TALLY);
+    connectSimulator();
+
+    const ATEMState& state = atem->getStateRef();
+    TEST_ASSERT_EQUAL(2, atem->getMixEffectCount());  // Topology is always decoded
+    TEST_ASSERT_EQUAL(0, atem->getProgramInput(0));
+    TEST_ASSERT_EQUAL(0, state.input_count);
+    TEST_ASSERT_TRUE(atem->isOnProgram(1) && atem->isOnPreview(3));
+
+    atem->setSubscriptions(ATEM_SUBSCRIBE_ALL);  // Ignored while connected
+    TEST_ASSERT_EQUAL(ATEM_SUBSCRIBE_TALLY, atem->getSubscriptions());
+}
+
+void test_transition_position_is_paced() {
+    connectSimulator();
+    ATEMSimulatorFaults faults = {};
+    faults.latency_us = 15000;      // ACKs arrive inside one 20 ms tick
+    sim.setFaults(faults);
+    uint32_t before = sim.getStats().commands_received;
+
+    // A T-bar sampled at 1 kHz for 200 ms
+    for (uint16_t i = 1; i <= 200; i++) {
+        atem->setTransitionPosition(i * 50);
+        pump(1, []() { return false; });
+    }
+    pump(200, []() { return false; });
+
+    // About one CTPs per tick instead of 200, and the last value always arrives
+    uint32_t sent = sim.getStats().commands_received - before;
+    TEST_ASSERT_TRUE(sent >= 5 && sent <= 12);
+    TEST_ASSERT_EQUAL(10000, atem->getStateRef().mix_effects[0].transition_position);
+    TEST_ASSERT_EQUAL_UINT32(200 - sent, atem->getMergedUpdates());
+}
+
+struct UpdateLog {
+    uint32_t names[8];
+    uint8_t count;
+};
+
+static void logUpdate(uint32_t name, const uint8_t* payload, uint16_t length, void* context) {
+    UpdateLog* log = (UpdateLog*)context;
+    if (log->count < 8) log->names[log->count++] = name;
+}
+
+void test_paced_value_goes_out_before_a_later_command() {
+    connectSimulator();
+    UpdateLog log = {{0}, 0};
+    TEST_ASSERT_TRUE(atem->registerCommandHandler("TrPs", logUpdate, &log));
+    TEST_ASSERT_TRUE(atem->registerCommandHandler("PrgI", logUpdate, &log));
+
+    atem->setTransitionPosition(2000);   // Sent at once after the idle period
+    pump(1, []() { return false; });     // ACKed, but the next tick is still ahead
+    atem->setTransitionPosition(4000);   // Waits for the tick...
+    atem->cut();                         // ...unless a later command carries it
+    pump(100, []() { return false; });
+
+    // The switcher applies them in call order: TrPs, TrPs, then the cut's PrgI
+    TEST_ASSERT_EQUAL(3, log.count);
+    TEST_ASSERT_EQUAL_HEX32(atemFourCC("TrPs"), log.names[1]);
+    TEST_ASSERT_EQUAL_HEX32(atemFourCC("PrgI"), log.names[2]);
+    TEST_ASSERT_EQUAL(4000, atem->getStateRef().mix_effects[0].transition_position);
+}
+
+void test_receive_window_across_the_wrap() {
+    TEST_ASSERT_EQUAL(2, atemPacketIdDelta(32767, 1));
+    TEST_ASSERT_EQUAL(-2, atemPacketIdDelta(1, 32767));
+    TEST_ASSERT_TRUE(atemPacketCoveredByAck(1, 32767));
+    TEST_ASSERT_FALSE(atemPacketCoveredByAck(32767, 1));
+
+    ATEMReceiveWindow window;
+    window.reset(32765);
+    TEST_ASSERT_EQUAL(ATEM_RX_IN_ORDER, window.receive(32766));
+    TEST_ASSERT_EQUAL(ATEM_RX_OUT_OF_ORDER, window.receive(0));     // 32767 missing
+    TEST_ASSERT_EQUAL(32766, window.lastInOrder());
+    TEST_ASSERT_EQUAL(ATEM_RX_IN_ORDER, window.receive(32767));    // Fills the gap
+    TEST_ASSERT_EQUAL(ATEM_RX_IN_ORDER, window.receive(0));        // Resent after it
+    TEST_ASSERT_EQUAL(0, window.lastInOrder());
+    TEST_ASSERT_EQUAL(ATEM_RX_DUPLICATE, window.receive(0));
+    TEST_ASSERT_EQUAL(ATEM_RX_DUPLICATE, window.receive(32766));
+    TEST_ASSERT_EQUAL(0, window.lastInOrder());
+}
+
+struct ProgramLog {
+    uint16_t inputs[8];
+    uint8_t count;
+};
+
+static void logProgram(uint32_t name, const uint8_t* payload, uint16_t length, void* context) {
+    ProgramLog* log = (ProgramLog*)context;
+    if (length >= 4 && log->count < 8) log->inputs[log->count++] = (payload[2] << 8) | payload[3];
+}
+
+void test_overtaking_packet_is_applied_in_order() {
+    connectSimulator();
+    ProgramLog log = {{0}, 0};
+    TEST_ASSERT_TRUE(atem->registerCommandHandler("PrgI", logProgram, &log));
+    ATEMSimulatorFaults faults = {};
+    faults.latency_us = 5000;        // Both packets are still queued when the second is sent
+    faults.reorder = 100;
+    sim.setFaults(faults);
+    uint32_t reordered = sim.getStats().datagrams_reordered;
+
+    // PrgI 3 overtakes PrgI 2; the switcher resends it after 2, so 3 wins
+    uint8_t first[4] = {0, 0, 0, 2};
+    uint8_t second[4] = {0, 0, 0, 3};
+    sim.queueCommand("PrgI", first, sizeof(first));
+    pump(1, []() { return false; });
+    sim.queueCommand("PrgI", second, sizeof(second));
+    pump(1, []() { return false; });
+    faults.reorder = 0;
+    sim.setFaults(faults);
+    pump(500, []() { return false; });
+
+    TEST_ASSERT_TRUE(sim.getStats().datagrams_reordered > reordered);
+    TEST_ASSERT_EQUAL(2, log.count);                 // Each parsed once, in the order sent
+    TEST_ASSERT_EQUAL(2, log.inputs[0]);
+    TEST_ASSERT_EQUAL(3, log.inputs[1]);
+    TEST_ASSERT_EQUAL(3, atem->getProgramInput());
+    TEST_ASSERT_EQUAL(0, sim.inFlight());
+    TEST_ASSERT_EQUAL_UINT32(0, sim.getStats().packets_acked_unseen);
+}
+
+static void countCommand(uint32_t name, const uint8_t* payload, uint16_t length, void* context) {
+    (*(uint32_t*)context)++;
+}
+
+void test_session_runs_past_the_packet_id_wrap() {
+    connectSimulator();
+    uint32_t previews = 0;
+    TEST_ASSERT_TRUE(atem->registerCommandHandler("PrvI", countCommand, &previews));
+    ATEMSimulatorFaults faults = {};
+    faults.duplicate = 5;
+    faults.reorder = 5;
+    sim.setFaults(faults);
+
+    // Both directions wrap: one client packet and one switcher packet per change
+    const uint32_t changes = ATEM_MAX_PACKET_ID + 500;
+    for (uint32_t i = 0; i < changes; i++) {
+        atem->changePreviewInput(1 + i % 8);
+        pump(2, []() { return false; });
+    }
+    pump(200, []() { return false; });
+
+    TEST_ASSERT_TRUE(atem->isConnected());
+    TEST_ASSERT_EQUAL_UINT32(changes, previews);   // Duplicated datagrams are not parsed again
+    TEST_ASSERT_EQUAL(1 + (changes - 1) % 8, atem->getPreviewInput());
+    TEST_ASSERT_EQUAL(sim.getPreviewInput(), atem->getPreviewInput());
+    TEST_ASSERT_TRUE(sim.getNextClientPacketId() < 1000);
+    TEST_ASSERT_EQUAL(0, sim.inFlight());
+    TEST_ASSERT_EQUAL_UINT32(0, sim.getStats().packets_acked_unseen);
+    TEST_ASSERT_TRUE(sim.getStats().datagrams_reordered > 0);
+}
+
+// ===========================================
+// OPTIMISTIC UPDATES
+// ===========================================
+class ProgramMonitor : public ATEM {
+public:
+    ProgramMonitor() : speculative(0), confirmed(0), corrections(0), shown(0) {}
+
+    void onMixEffectProgramChanged(uint8_t me, uint16_t input) override {
+        if (me != 0) return;
+        shown = input;
+        if (isSpeculative()) speculative++;
+        else if (isCorrection()) corrections++;
+        else confirmed++;
+    }
+
+    uint8_t speculative;
+    uint8_t confirmed;
+    uint8_t corrections;
+    uint16_t shown;
+};
+
+void test_optimistic_program_change() {
+    alignas(ProgramMonitor) static uint8_t storage[sizeof(ProgramMonitor)];
+    tearDown();  // Use a ProgramMonitor instead of the plain ATEM from setUp()
+    ProgramMonitor* monitor = new (storage) ProgramMonitor();
+    atem = monitor;
+    atem->setLogLevel(ATEM_LOG_ERROR);
+    atem->setTransport(&sim);
+    atem->setOptimisticUpdates(true);
+    connectSimulator();
+    TEST_ASSERT_EQUAL(1, monitor->confirmed);  // From the dump
+
+    // Shown before anything is received; the echo confirms it without a callback
+    atem->changeProgramInput(7);
+    TEST_ASSERT_EQUAL(1, monitor->speculative);
+    TEST_ASSERT_EQUAL(7, atem->getProgramInput());
+    TEST_ASSERT_EQUAL(1, atem->getPendingSpeculations());
+    pump(50, []() { return atem->getPendingSpeculations() == 0; });
+    TEST_ASSERT_EQUAL(0, atem->getPendingSpeculations());
+    TEST_ASSERT_EQUAL(1, monitor->confirmed);
+    TEST_ASSERT_EQUAL(7, sim.getProgramInput());
+
+    // The switcher stops answering: never acknowledged, so rolled back
+    sim.setOnline(false);
+    atem->changeProgramInput(9);
+    TEST_ASSERT_EQUAL(9, monitor->shown);
+    pump(ATEM_OPTIMISTIC_TIMEOUT + 10, []() { return false; });
+    TEST_ASSERT_EQUAL(1, monitor->corrections);
+    TEST_ASSERT_EQUAL(7, monitor->shown);
+    TEST_ASSERT_EQUAL(7, atem->getProgramInput());
+    TEST_ASSERT_EQUAL_UINT32(1, atem->getRollbacks());
+    TEST_ASSERT_TRUE(atem->isConnected());  // Well inside CONNECTION_TIMEOUT
+
+    monitor->disconnect();
+    monitor->~ProgramMonitor();
+    atem = new (atem_storage) ATEM();  // For tearDown()
+}
+
+void test_batched_speculation_waits_for_its_packet() {
+    alignas(ProgramMonitor) static uint8_t storage[sizeof(ProgramMonitor)];
+    tearDown();
+    ProgramMonitor* monitor = new (storage) ProgramMonitor();
+    atem = monitor;
+    atem->setLogLevel(ATEM_LOG_ERROR);
+    atem->setTransport(&sim);
+    atem->setOptimisticUpdates(true);
+    connectSimulator();
+
+    // Heartbeats go out and are acknowledged while the batch is open; none of
+    // those ACKs may count for the command still in the TX buffer
+    atem->beginBatch();
+    atem->changeProgramInput(5);
+    pump(ATEM_OPTIMISTIC_CONFIRM_WINDOW + HEARTBEAT_INTERVAL + 50, []() { return false; });
+    TEST_ASSERT_EQUAL(0, monitor->corrections);
+    TEST_ASSERT_EQUAL(1, atem->getPendingSpeculations());
+    TEST_ASSERT_EQUAL(5, atem->getProgramInput());
+
+    TEST_ASSERT_TRUE(atem->commitBatch());
+    pump(50, []() { return atem->getPendingSpeculations() == 0; });
+    TEST_ASSERT_EQUAL(0, atem->getPendingSpeculations());
+    TEST_ASSERT_EQUAL(0, monitor->corrections);
+    TEST_ASSERT_EQUAL(5, sim.getProgramInput());
+
+    monitor->disconnect();
+    monitor->~ProgramMonitor();
+    atem = new (atem_storage) ATEM();
+}
+
+// ===========================================
+// SEQUENCES
+// ===========================================
+/**
+ * micros() of the first captured TX datagram carrying a command
+ * @return 0 if none was sent
+ */
+static uint32_t sentAt(ATEMCapture& capture, const char* name, uint16_t* length = nullptr) {
+    ATEMCaptureCursor cursor = capture.begin();
+    ATEMCaptureRecord record;
+    while (capture.read(cursor, record)) {
+        if (record.direction != ATEM_CAPTURE_TX) continue;
+        for (uint16_t i = HEADER_SIZE + 4; i + 4 <= record.length; i++) {
+            if (memcmp(record.data + i, name, 4) == 0) {
+                if (length) *length = record.length;
+                return record.time_us;
+            }
+        }
+    }
+    return 0;
+}
+
+void test_sequence_runs_on_the_frame_grid() {
+    static ATEMCapture capture;
+    static const ATEMSequenceStep SHOW[] = {
+        atemSeqPreview(5),
+        atemSeqAux(5),
+        atemSeqWaitFrames(12),
+        atemSeqAuto(),
+        atemSeqWaitTransition(),
+        atemSeqPreview(6)
+    };
+    capture.clear();
+    connectSimulator();
+    atem->setCapture(&capture);
+    uint32_t before = sim.getStats().commands_received;
+
+    TEST_ASSERT_TRUE(atem->runSequence(SHOW));
+    TEST_ASSERT_TRUE(atem->isSequenceRunning());
+    pump(1000, []() { return !atem->isSequenceRunning(); });
+    pump(50, []() { return false; });
+    TEST_ASSERT_FALSE(atem->isSequenceRunning());
+    TEST_ASSERT_EQUAL_UINT32(4, sim.getStats().commands_received - before);
+    TEST_ASSERT_EQUAL(5, sim.getProgramInput());
+    TEST_ASSERT_EQUAL(6, atem->getPreviewInput());
+
+    // Preview and AUX share a datagram; the auto follows 12 frames of 59.94 Hz later
+    uint16_t length = 0;
+    uint32_t start = sentAt(capture, "CPvI", &length);
+    TEST_ASSERT_EQUAL(HEADER_SIZE + 2 * (ATEM_COMMAND_HEADER_SIZE + 4), length);
+    TEST_ASSERT_EQUAL_UINT32(start, sentAt(capture, "CAuS"));
+    uint32_t elapsed = sentAt(capture, "DAut") - start;
+    TEST_ASSERT_UINT32_WITHIN(1000, 200200 + 1000, elapsed);  // Timer resolution is 1 ms
+
+    // Lost connection stops it
+    TEST_ASSERT_TRUE(atem->runSequence(SHOW));
+    sim.setOnline(false);
+    pump(CONNECTION_TIMEOUT + 100, []() { return false; });
+    TEST_ASSERT_FALSE(atem->isSequenceRunning());
+    atem->setCapture(nullptr);
+}
+
+// ===========================================
+// STATE EXPORT
+// ===========================================
+class StateExporter : public ATEM {
+public:
+    void onStateChanged() override { exporter.add(getStateChanges()); }
+
+    ATEMSnapshotEncoder exporter;
+};
+
+static uint32_t relayed_bytes = 0;
+static uint32_t relay_rejected = 0;
+
+/**
+ * Encode everything pending and apply it to a node
+ * @return Frames sent (relayed_bytes and relay_rejected hold the rest)
+ */
+static uint32_t relay(StateExporter* source, ATEMSnapshotDecoder& decoder, ATEMState& node, ATEMTally& tally) {
+    uint8_t frame[ATEM_SNAPSHOT_FRAME_SIZE];
+    uint16_t length;
+    uint32_t frames = 0;
+    relayed_bytes = 0;
+    relay_rejected = 0;
+    while ((length = source->exporter.encode(source->getStateRef(), &source->getTally(), frame, sizeof(frame)))) {
+        if (!decoder.apply(frame, length, node, &tally)) relay_rejected++;
+        frames++;
+        relayed_bytes += length;
+    }
+    return frames;
+}
+
+void test_snapshot_and_deltas_keep_a_node_in_sync() {
+    alignas(StateExporter) static uint8_t storage[sizeof(StateExporter)];
+    static ATEMState node;
+    static ATEMTally tally;
+    tearDown();  // Use a StateExporter instead of the plain ATEM from setUp()
+    StateExporter* source = new (storage) StateExporter();
+    atem = source;
+    atem->setLogLevel(ATEM_LOG_ERROR);
+    atem->setTransport(&sim);
+    connectSimulator();
+    ATEMSnapshotDecoder decoder;
+
+    // Full snapshot: 20 input labels take several ESP-NOW frames
+    source->exporter.snapshot();
+    TEST_ASSERT_TRUE(relay(source, decoder, node, tally) > 1);
+    TEST_ASSERT_EQUAL_UINT32(0, relay_rejected);
+    TEST_ASSERT_TRUE(decoder.synced());
+    TEST_ASSERT_EQUAL_MEMORY(&source->getStateRef(), &node, sizeof(node));
+    TEST_ASSERT_EQUAL_MEMORY(source->getTally().program, tally.program, sizeof(tally.program));
+    TEST_ASSERT_EQUAL_MEMORY(source->getTally().preview, tally.preview, sizeof(tally.preview));
+    TEST_ASSERT_EQUAL_STRING("Camera 7", atemStateFindInput(node, 7)->long_name);
+
+    // A preview change is one small frame: PrvI and the tally
+    atem->changePreviewInput(5);
+    pump(50, []() { return atem->isOnPreview(5); });
+    TEST_ASSERT_EQUAL_UINT32(1, relay(source, decoder, node, tally));
+    TEST_ASSERT_EQUAL_UINT32(0, relay_rejected);
+    TEST_ASSERT_TRUE(relayed_bytes <= ATEM_SNAPSHOT_HEADER_SIZE + 2 * ATEM_SNAPSHOT_RECORD_SIZE + 2 * 2 + 4 * 2);
+    TEST_ASSERT_EQUAL(5, node.preview_input);
+    TEST_ASSERT_TRUE(tally.isPreview(5) && !tally.isPreview(3));
+    TEST_ASSERT_TRUE(decoder.synced());
+
+    // A lost delta: the node ignores deltas until the next snapshot
+    uint8_t frame[ATEM_SNAPSHOT_FRAME_SIZE];
+    atem->changePreviewInput(6);
+    pump(50, []() { return atem->isOnPreview(6); });
+    while (source->exporter.encode(source->getStateRef(), &source->getTally(), frame, sizeof(frame))) {}
+    atem->changePreviewInput(7);
+    pump(50, []() { return atem->isOnPreview(7); });
+    uint16_t length = source->exporter.encode(source->getStateRef(), &source->getTally(), frame, sizeof(frame));
+    TEST_ASSERT_FALSE(decoder.apply(frame, length, node, &tally));
+    TEST_ASSERT_FALSE(decoder.synced());
+    TEST_ASSERT_EQUAL(5, node.preview_input);
+    TEST_ASSERT_EQUAL_UINT32(1, decoder.lostFrames());
+
+    source->exporter.snapshot();
+    relay(source, decoder, node, tally);
+    TEST_ASSERT_EQUAL_UINT32(0, relay_rejected);
+    TEST_ASSERT_TRUE(decoder.synced());
+    TEST_ASSERT_EQUAL(7, node.preview_input);
+    TEST_ASSERT_EQUAL_MEMORY(&source->getStateRef(), &node, sizeof(node));
+
+    source->disconnect();
+    source->~StateExporter();
+    atem = new (atem_storage) ATEM();  // For tearDown()
+}
+
+// ===========================================
+// CAPTURE AND REPLAY
+// ===========================================
+class ImageWriter : public Print {
+public:
+    ImageWriter(uint8_t* image, size_t size) : length(0), _image(image), _size(size) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        if (size > _size - length) size = _size - length;
+        memcpy(_image + length, buffer, size);
+        length += size;
+        return size;
+    }
+
+    size_t length;
+
+private:
+    uint8_t* _image;
+    size_t _size;
+};
+
+void test_capture_ring_keeps_the_newest() {
+    static ATEMCapture capture;
+    uint8_t datagram[100 + 7];
+    for (uint32_t i = 0; i < 1000; i++) {
+        uint16_t length = 100 + i % 8;   // Uneven sizes so the wrap point moves
+        memset(datagram, (uint8_t)i, length);
+        capture.record(i & 1 ? ATEM_CAPTURE_TX : ATEM_CAPTURE_RX, datagram, length, i * 1000);
+    }
+    TEST_ASSERT_TRUE(capture.recordCount() > 100);
+    TEST_ASSERT_TRUE(capture.recordCount() < 1000);
+
+    ATEMCaptureCursor cursor = capture.begin();
+    ATEMCaptureRecord record;
+    uint32_t expected = 1000 - capture.recordCount();
+    while (capture.read(cursor, record)) {
+        TEST_ASSERT_EQUAL_UINT32(expected * 1000, record.time_us);
+        TEST_ASSERT_EQUAL(100 + expected % 8, record.length);
+        TEST_ASSERT_EQUAL(expected & 1 ? ATEM_CAPTURE_TX : ATEM_CAPTURE_RX, record.direction);
+        TEST_ASSERT_EQUAL_UINT8((uint8_t)expected, record.data[record.length - 1]);
+        expected++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(1000, expected);
+}
+
+void test_capture_replays_the_session() {
+    static ATEMCapture capture;
+    static ATEMCapture loaded;
+    static uint8_t image[ATEM_CAPTURE_BUFFER_SIZE + ATEM_CAPTURE_MAGIC_SIZE];
+    capture.clear();
+    atem->setCapture(&capture);
+    connectSimulator();
+    capture.setEnabled(false);
+
+    ATEMCaptureCursor cursor = capture.begin();
+    ATEMCaptureRecord hello;
+    TEST_ASSERT_TRUE(capture.read(cursor, hello));
+    TEST_ASSERT_EQUAL(ATEM_CAPTURE_TX, hello.direction);   // Nothing evicted
+    TEST_ASSERT_EQUAL(20, hello.length);
+
+    ImageWriter out(image, sizeof(image));
+    size_t written = capture.writeTo(out);
+    TEST_ASSERT_EQUAL(written, out.length);
+    TEST_ASSERT_TRUE(loaded.load(image, out.length));
+    TEST_ASSERT_EQUAL(capture.recordCount(), loaded.recordCount());
+
+    // A fresh instance fed the captured side of the switcher ends up in the same state
+    tearDown();
+    ATEMCaptureReplay replay(loaded);
+    atem = new (atem_storage) ATEM();
+    atem->setLogLevel(ATEM_LOG_ERROR);
+    atem->setTransport(&replay);
+    TEST_ASSERT_TRUE(atem->beginAsync(IPAddress(192, 168, 10, 240)));
+    pump(5000, [&replay]() { return replay.finished(); });
+
+    TEST_ASSERT_TRUE(replay.finished());
+    TEST_ASSERT_TRUE(atem->isConnected());
+    TEST_ASSERT_FALSE(atem->getStateRef().stale);
+    TEST_ASSERT_EQUAL(4, atem->getPreviewInput(1));
+    TEST_ASSERT_EQUAL_STRING("Camera 7", atem->getInputLabel(7));
+
+    atem->disconnect();
+    atem->~ATEM();
+    atem = new (atem_storage) ATEM();  // For tearDown(), without the replay
+}
+
+// ===========================================
+// SESSION MANAGER
+// ===========================================
+/**
+ * Two simulated switchers behind one socket, told apart by IP address
+ */
+class SimNetwork : public ATEMTransport {
+public:
+    SimNetwork(ATEMSimulator& a, IPAddress ip_a, ATEMSimulator& b, IPAddress ip_b)
+        : _a(a), _b(b), _ip_a(ip_a), _ip_b(ip_b), _lent(nullptr), begins(0) {}
+
+    bool begin(uint16_t local_port) override {
+        begins++;
+        return _a.begin(local_port) && _b.begin(local_port);
+    }
+
+    void stop() override {
+        _a.stop();
+        _b.stop();
+    }
+
+    bool send(const IPAddress& ip, uint16_t port, const uint8_t* data, uint16_t length) override {
+        return (ip == _ip_a ? _a : _b).send(ip, port, data, length);
+    }
+
+    int receive(uint8_t* buffer, uint16_t size) override {
+        return 0;  // Not used: the manager takes views
+    }
+
+    int receiveView(const uint8_t*& data) override {
+        int length = _a.receiveView(data);
+        _lent = &_a;
+        _source = _ip_a;
+        if (length <= 0) {
+            length = _b.receiveView(data);
+            _lent = &_b;
+            _source = _ip_b;
+        }
+        return length;
+    }
+
+    void releaseView() override { _lent->releaseView(); }
+    IPAddress remoteIP() override { return _source; }
+
+private:
+    ATEMSimulator& _a;
+    ATEMSimulator& _b;
+    IPAddress _ip_a;
+    IPAddress _ip_b;
+    IPAddress _source;
+    ATEMSimulator* _lent;
+
+public:
+    uint8_t begins;
+};
+
+static ATEMSimulator backup_sim;
+alignas(ATEM) static uint8_t backup_storage[sizeof(ATEM)];
+
+void test_session_manager_shares_one_socket() {
+    IPAddress main_ip(192, 168, 10, 240);
+    IPAddress backup_ip(192, 168, 10, 241);
+    backup_sim = ATEMSimulator();
+    backup_sim.setStateDump(dump, dump_length);
+    SimNetwork network(sim, main_ip, backup_sim, backup_ip);
+    ATEM* backup = new (backup_storage) ATEM();
+    backup->setLogLevel(ATEM_LOG_ERROR);
+
+    ATEMSessionManager sessions;
+    sessions.setTransport(&network);
+    TEST_ASSERT_TRUE(sessions.add(*atem));
+    TEST_ASSERT_TRUE(sessions.add(*backup));
+    TEST_ASSERT_TRUE(atem->beginAsync(main_ip));
+    TEST_ASSERT_TRUE(backup->beginAsync(backup_ip));
+    TEST_ASSERT_EQUAL(1, network.begins);
+
+    auto service = [&](unsigned long iterations) {
+        for (unsigned long i = 0; i < iterations; i++) {
+            sessions.runLoop();
+            hostAdvanceClock(1000);
+        }
+    };
+    service(500);
+    TEST_ASSERT_TRUE(atem->isConnected() && sim.isDumpComplete());
+    TEST_ASSERT_TRUE(backup->isConnected() && backup_sim.isDumpComplete());
+
+    // Commands reach only their own switcher, and the state updates come back to the right session
+    backup->changeProgramInput(9);
+    atem->changePreviewInput(5);
+    service(50);
+    TEST_ASSERT_EQUAL(9, backup_sim.getProgramInput());
+    TEST_ASSERT_EQUAL(9, backup->getProgramInput());
+    TEST_ASSERT_EQUAL(1, sim.getProgramInput());
+    TEST_ASSERT_EQUAL(5, atem->getPreviewInput());
+    TEST_ASSERT_EQUAL(3, backup->getPreviewInput());
+
+    // Both sessions stay up on the shared heartbeat schedule
+    service(5000);
+    TEST_ASSERT_TRUE(atem->isConnected());
+    TEST_ASSERT_TRUE(backup->isConnected());
+    TEST_ASSERT_EQUAL(0, sessions.unroutedDatagrams());
+
+    sessions.remove(*backup);
+    sessions.remove(*atem);
+    backup->~ATEM();
+}
+
+/**
+ * One switcher with two client sessions: HELLOs open the two simulators in
+ * turn, other packets go to the simulator whose session ID they carry
+ */
+class SharedSwitcher : public ATEMTransport {
+public:
+    SharedSwitcher(ATEMSimulator& a, ATEMSimulator& b, IPAddress ip)
+        : _sims{&a, &b}, _ip(ip), _hellos(0), _next(0), _opened(&a), _lent(nullptr) {}
+
+    bool begin(uint16_t local_port) override { return _sims[0]->begin(local_port) && _sims[1]->begin(local_port); }
+    void stop() override { _sims[0]->stop(); _sims[1]->stop(); }
+
+    bool send(const IPAddress& ip, uint16_t port, const uint8_t* data, uint16_t length) override {
+        if ((data[0] >> 3) & 0x02) {
+            _opened = _sims[_hellos++ & 1];
+            return _opened->send(ip, port, data, length);
+        }
+        uint16_t session_id = (data[2] << 8) | data[3];
+        for (ATEMSimulator* sim : _sims) {
+            if (sim->isSessionOpen() && sim->getSessionId() == session_id) return sim->send(ip, port, data, length);
+        }
+        return _opened->send(ip, port, data, length);  // ACK of the HELLO answer, still on the client ID
+    }
+
+    int receive(uint8_t* buffer, uint16_t size) override { return 0; }
+
+    // Alternate between the sessions, so their datagrams interleave on the socket
+    int receiveView(const uint8_t*& data) override {
+        for (uint8_t i = 0; i < 2; i++) {
+            ATEMSimulator* sim = _sims[_next++ & 1];
+            int length = sim->receiveView(data);
+            if (length > 0) {
+                _lent = sim;
+                return length;
+            }
+        }
+        return 0;
+    }
+
+    void releaseView() override { if (_lent) _lent->releaseView(); }
+    IPAddress remoteIP() override { return _ip; }
+
+private:
+    ATEMSimulator* _sims[2];
+    IPAddress _ip;
+    uint8_t _hellos;
+    uint8_t _next;
+    ATEMSimulator* _opened;
+    ATEMSimulator* _lent;
+};
+
+void test_session_manager_two_sessions_to_one_switcher() {
+    IPAddress ip(192, 168, 10, 240);
+    backup_sim = ATEMSimulator();
+    backup_sim.setStateDump(dump, dump_length);
+    // A real switcher numbers its sessions; start the second simulator one ahead
+    uint8_t hello[20] = {0x10, 0x14, 0x12, 0x34};
+    backup_sim.send(ip, ATEM_PORT, hello, sizeof(hello));
+    SharedSwitcher network(sim, backup_sim, ip);
+    ATEM* second = new (backup_storage) ATEM();
+    second->setLogLevel(ATEM_LOG_ERROR);
+
+    ATEMSessionManager sessions;
+    sessions.setTransport(&network);
+    TEST_ASSERT_TRUE(sessions.add(*atem));
+    TEST_ASSERT_TRUE(sessions.add(*second));
+    TEST_ASSERT_TRUE(atem->beginAsync(ip));
+    TEST_ASSERT_TRUE(second->beginAsync(ip));   // Its HELLO waits for the first handshake
+
+    auto service = [&](unsigned long iterations) {
+        for (unsigned long i = 0; i < iterations; i++) {
+            sessions.runLoop();
+            hostAdvanceClock(1000);
+        }
+    };
+    service(1500);
+    TEST_ASSERT_TRUE(atem->isConnected() && sim.isDumpComplete());
+    TEST_ASSERT_TRUE(second->isConnected() && backup_sim.isDumpComplete());
+    TEST_ASSERT_NOT_EQUAL(sim.getSessionId(), backup_sim.getSessionId());
+
+    // Each session kept its own switcher-assigned ID
+    atem->changeProgramInput(4);
+    second->changeProgramInput(6);
+    service(50);
+    TEST_ASSERT_EQUAL(4, sim.getProgramInput());
+    TEST_ASSERT_EQUAL(6, backup_sim.getProgramInput());
+    TEST_ASSERT_EQUAL(4, atem->getProgramInput());
+    TEST_ASSERT_EQUAL(6, second->getProgramInput());
+
+    service(3000);
+    TEST_ASSERT_TRUE(atem->isConnected());
+    TEST_ASSERT_TRUE(second->isConnected());
+
+    sessions.remove(*second);
+    sessions.remove(*atem);
+    second->~ATEM();
+}
+
+// ===========================================
+// FIXED MEMORY
+// ===========================================
+void test_run_loop_does_not_allocate() {
+    unsigned long allocated = allocations;
+    connectSimulator();
+
+    // Commands over a lossy, reordering link
+    ATEMSimulatorFaults faults = {};
+    faults.downlink_loss = 10;
+    faults.uplink_loss = 10;
+    faults.reorder = 10;
+    faults.duplicate = 10;
+    sim.setFaults(faults);
+    for (uint16_t input = 1; input <= 8; input++) {
+        atem->changeProgramInput(input);
+        atem->setTransitionPosition(input * 1000);
+        pump(20, []() { return false; });
+    }
+
+    // Cable pulled and back: timeout, reconnect and a second state dump
+    sim.setOnline(false);
+    pump(CONNECTION_TIMEOUT + 100, []() { return false; });
+    TEST_ASSERT_FALSE(atem->isConnected());
+    sim.setFaults(ATEMSimulatorFaults());
+    sim.setOnline(true);
+    pump(5000, dumpReceived);
+    TEST_ASSERT_TRUE(dumpReceived());
+
+    TEST_ASSERT_EQUAL(0, allocations - allocated);
+}
+
+// ===========================================
+// BENCHMARKS
+// ===========================================
+void test_benchmark_state_dump_ingest() {
+    buildDump(40, 2000);
+    sim.setStateDump(dump, dump_length);
+
+    TEST_ASSERT_TRUE(atem->beginAsync(IPAddress(192, 168, 10, 240)));
+    pump(5, []() { return atem->isConnected(); });
+    unsigned long allocated = allocations;
+    LoopStats loop = pump(20000, dumpReceived);
+    allocated = allocations - allocated;
+
+    TEST_ASSERT_TRUE(dumpReceived());
+    report("Clean dump", loop, dump_commands, allocated);
+    TEST_ASSERT_EQUAL(0, allocated);
+}
+
+void test_benchmark_lossy_dump_ingest() {
+    ATEMSimulatorFaults faults = {};
+    faults.downlink_loss = 2;
+    faults.reorder = 5;
+    faults.latency_us = 2000;
+    sim.setFaults(faults);
+    buildDump(40, 2000);
+    sim.setStateDump(dump, dump_length);
+
+    TEST_ASSERT_TRUE(atem->beginAsync(IPAddress(192, 168, 10, 240)));
+    unsigned long allocated = allocations;
+    LoopStats loop = pump(60000, [] { return sim.isDumpComplete() && sim.inFlight() == 0; });
+    allocated = allocations - allocated;
+
+    char line[120];
+    snprintf(line, sizeof(line), "Lossy dump: %lu dropped, %lu resent by the switcher, %lu acknowledged unseen",
+             (unsigned long)sim.getStats().datagrams_dropped, (unsigned long)sim.getStats().packets_resent,
+             (unsigned long)sim.getStats().packets_acked_unseen);
+    TEST_MESSAGE(line);
+    report("Lossy dump", loop, dump_commands, allocated);
+    TEST_ASSERT_TRUE(atem->isConnected());
+    TEST_ASSERT_TRUE(sim.isDumpComplete());
+    TEST_ASSERT_EQUAL_UINT32(0, sim.getStats().packets_acked_unseen);  // ACKs never skip a lost packet
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_state_dump_is_applied);
+    RUN_TEST(test_commands_are_confirmed);
+    RUN_TEST(test_lost_commands_are_resent_on_request);
+    RUN_TEST(test_reordered_and_duplicated_dump);
+    RUN_TEST(test_injected_retransmit_request);
+    RUN_TEST(test_sleeping_until_the_next_deadline);
+    RUN_TEST(test_tally_changes_only);
+    RUN_TEST(test_state_changes_name_the_entries);
+    RUN_TEST(test_unsubscribed_families_are_skipped);
+    RUN_TEST(test_transition_position_is_paced);
+    RUN_TEST(test_paced_value_goes_out_before_a_later_command);
+    RUN_TEST(test_receive_window_across_the_wrap);
+    RUN_TEST(test_overtaking_packet_is_applied_in_order);
+    RUN_TEST(test_session_runs_past_the_packet_id_wrap);
+    RUN_TEST(test_optimistic_program_change);
+    RUN_TEST(test_batched_speculation_waits_for_its_packet);
+    RUN_TEST(test_sequence_runs_on_the_frame_grid);
+    RUN_TEST(test_snapshot_and_deltas_keep_a_node_in_sync);
+    RUN_TEST(test_capture_ring_keeps_the_newest);
+    RUN_TEST(test_capture_replays_the_session);
+    RUN_TEST(test_session_manager_shares_one_socket);
+    RUN_TEST(test_session_manager_two_sessions_to_one_switcher);
+    RUN_TEST(test_run_loop_does_not_allocate);
+    RUN_TEST(test_benchmark_state_dump_ingest);
+    RUN_TEST(test_benchmark_lossy_dump_ingest);
+
+    return UNITY_END();
+}
@@ -0,0 +1,83 @@
+#include <unity.h>
+
+// Protocol deadlines: expiry order, re-arming and cancelling, and millis()
+// rollover
+#include "../../../src/ATEM_Timers.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_timers_expire_in_deadline_order() {
+    ATEMTimers timers;
+    ATEMTimerId id;
+    TEST_ASSERT_EQUAL_UINT32(ATEM_NO_DEADLINE, timers.msUntilNext(0));
+
+    timers.arm(ATEM_TIMER_RECEIVE_TIMEOUT, 5000);
+    timers.arm(ATEM_TIMER_HEARTBEAT, 500);
+    timers.arm(ATEM_TIMER_HELLO_RESEND, 200);
+    TEST_ASSERT_EQUAL_UINT32(150, timers.msUntilNext(50));
+    TEST_ASSERT_FALSE(timers.expired(199, id));
+
+    TEST_ASSERT_TRUE(timers.expired(600, id));
+    TEST_ASSERT_EQUAL(ATEM_TIMER_HELLO_RESEND, id);
+    TEST_ASSERT_TRUE(timers.expired(600, id));
+    TEST_ASSERT_EQUAL(ATEM_TIMER_HEARTBEAT, id);
+    TEST_ASSERT_FALSE(timers.expired(600, id));
+    TEST_ASSERT_EQUAL_UINT32(4400, timers.msUntilNext(600));
+}
+
+void test_timers_rearm_and_cancel() {
+    ATEMTimers timers;
+    ATEMTimerId id;
+    timers.arm(ATEM_TIMER_HEARTBEAT, 500);
+    timers.arm(ATEM_TIMER_RECEIVE_TIMEOUT, 1000);
+
+    // Moving the earliest timer later hands the lead to the next one
+    timers.arm(ATEM_TIMER_HEARTBEAT, 2000);
+    TEST_ASSERT_EQUAL_UINT32(1000, timers.msUntilNext(0));
+
+    timers.cancel(ATEM_TIMER_RECEIVE_TIMEOUT);
+    TEST_ASSERT_FALSE(timers.armed(ATEM_TIMER_RECEIVE_TIMEOUT));
+    TEST_ASSERT_EQUAL_UINT32(2000, timers.msUntilNext(0));
+    TEST_ASSERT_EQUAL_UINT32(0, timers.msUntilNext(2500));  // Overdue
+
+    timers.clear();
+    TEST_ASSERT_FALSE(timers.expired(10000, id));
+}
+
+void test_timers_survive_millis_rollover() {
+    ATEMTimers timers;
+    ATEMTimerId id;
+    unsigned long now = (unsigned long)-100;  // 100 ms before millis() wraps
+    timers.arm(ATEM_TIMER_HEARTBEAT, now + 500);
+    timers.arm(ATEM_TIMER_RECONNECT, now + 50);
+
+    TEST_ASSERT_EQUAL_UINT32(50, timers.msUntilNext(now));
+    TEST_ASSERT_TRUE(timers.expired(now + 60, id));
+    TEST_ASSERT_EQUAL(ATEM_TIMER_RECONNECT, id);
+    TEST_ASSERT_FALSE(timers.expired(now + 499, id));
+    TEST_ASSERT_TRUE(timers.expired(now + 500, id));
+    TEST_ASSERT_EQUAL(ATEM_TIMER_HEARTBEAT, id);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_timers_expire_in_deadline_order);
+    RUN_TEST(test_timers_rearm_and_cancel);
+    RUN_TEST(test_timers_survive_millis_rollover);
+
+    return UNITY_END();
+}
+
+// For PlatformIO compatibility
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Give time for serial monitor
+    main(0, NULL);
+}
+
+void loop() {
+    // Empty loop for Arduino compatibility
+}
+#endif